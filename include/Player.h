@@ -6,6 +6,8 @@
 // Forward declarations
 class Mesh;
 class Shader;
+class Texture;
+class RenderQueue;
 
 // InputState structure for handling player input
 // This provides a simple interface for input handling
@@ -39,6 +41,8 @@ public:
     void Update(float dt); // dt in seconds
     void HandleInput(const InputState& input);
     void Draw(Shader& shader) const; // Shader must be bound before calling
+    // Queues the draw instead (texture nullptr = per-vertex material colors)
+    void Submit(RenderQueue& queue, Shader& shader, const Texture* texture) const;
 
     // Mesh management
     void SetMesh(std::shared_ptr<Mesh> mesh);
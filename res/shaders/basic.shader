@@ -3,19 +3,31 @@
 layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec2 a_TexCoord;
 layout(location = 2) in vec3 a_Color;
+layout(location = 3) in mat4 a_InstanceModel;  // Per instance (locations 3-6), see InstanceBuffer
+layout(location = 7) in vec4 a_InstanceColor;  // Per instance tint
+
+// Per frame, binding UniformBlock::Camera (see UniformBuffer.h)
+layout(std140) uniform Camera {
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec4 u_CameraPosition;
+};
 
 uniform mat4 u_Model;      // Model Matrix
-uniform mat4 u_View;       // View Matrix
-uniform mat4 u_Projection; // Projection Matrix
+uniform int u_Instanced;   // 0 = u_Model, 1 = per-instance attributes
 
 out vec2 v_TexCoord;
 out vec3 v_Color;
+out vec4 v_Tint;
 
 void main()
 {
-    gl_Position = u_Projection * u_View * u_Model * vec4(a_Position, 1.0);
+    mat4 model = u_Instanced == 1 ? a_InstanceModel : u_Model;
+    gl_Position = u_ViewProjection * model * vec4(a_Position, 1.0);
     v_TexCoord = a_TexCoord;
     v_Color = a_Color;
+    v_Tint = u_Instanced == 1 ? a_InstanceColor : vec4(1.0);
 }
 
 #shader fragment
@@ -24,9 +36,15 @@ layout(location = 0) out vec4 color;
 
 in vec2 v_TexCoord;
 in vec3 v_Color;
+in vec4 v_Tint;
+
+// Per material, binding UniformBlock::Material (see MaterialBlocks)
+layout(std140) uniform Material {
+    vec4 u_MaterialTint;
+    int u_UseTexture; // 0 = use vertex color, 1 = use texture
+};
 
-uniform sampler2D u_Texture;
-uniform int u_UseTexture; // 0 = use vertex color, 1 = use texture
+uniform sampler2D u_Texture; // Unit 0, set when the program is linked
 
 void main()
 {
@@ -35,4 +53,5 @@ void main()
     } else {
         color = vec4(v_Color, 1.0);
     }
+    color *= v_Tint * u_MaterialTint;
 }
@@ -0,0 +1,111 @@
+#shader vertex
+#version 330 core
+layout(location = 0) in vec4 a_Instance; // xyz = world position, w = scale
+
+// Per frame, binding UniformBlock::Camera (see UniformBuffer.h)
+layout(std140) uniform Camera {
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec4 u_CameraPosition;
+};
+
+uniform vec3 u_Center;         // Object-space center of the baked bounding sphere
+uniform float u_Radius;
+uniform float u_FramesPerSide;
+uniform int u_Hemisphere;
+
+out vec2 v_AtlasCoord;
+out vec3 v_WorldPos;
+out vec3 v_FrameDir;
+out float v_WorldRadius;
+
+float SignNotZero(float v) { return v >= 0.0 ? 1.0 : -1.0; }
+
+// Octahedral mapping with +Y as the pole - must match Impostor.cpp
+vec2 OctahedralEncode(vec3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    if (u_Hemisphere == 1) {
+        n.y = max(n.y, 0.0);
+        vec2 p = vec2(n.x + n.z, n.x - n.z);
+        return p * 0.5 + 0.5;
+    }
+    vec2 p = n.xz;
+    if (n.y < 0.0)
+        p = (1.0 - abs(p.yx)) * vec2(SignNotZero(p.x), SignNotZero(p.y));
+    return p * 0.5 + 0.5;
+}
+
+vec3 OctahedralDecode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    if (u_Hemisphere == 1) {
+        vec2 q = vec2(p.x + p.y, p.x - p.y) * 0.5;
+        return normalize(vec3(q.x, 1.0 - abs(q.x) - abs(q.y), q.y));
+    }
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (n.y < 0.0)
+        n.xz = (1.0 - abs(n.zx)) * vec2(SignNotZero(n.x), SignNotZero(n.z));
+    return normalize(n);
+}
+
+void main()
+{
+    // Triangle strip corners from gl_VertexID: (-1,-1) (1,-1) (-1,1) (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+
+    float scale = a_Instance.w;
+    vec3 center = a_Instance.xyz + u_Center * scale;
+
+    // Pick the baked frame closest to the current view direction
+    vec3 viewDir = normalize(u_CameraPosition.xyz - center);
+    vec2 frame = min(floor(OctahedralEncode(viewDir) * u_FramesPerSide), vec2(u_FramesPerSide - 1.0));
+    vec3 frameDir = OctahedralDecode((frame + 0.5) / u_FramesPerSide);
+
+    // Same camera basis as the bake, so the quad matches the baked image
+    vec3 upRef = abs(frameDir.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(upRef, frameDir));
+    vec3 up = cross(frameDir, right);
+
+    float radius = u_Radius * scale;
+    v_WorldPos = center + (right * corner.x + up * corner.y) * radius;
+    v_AtlasCoord = (frame + corner * 0.5 + 0.5) / u_FramesPerSide;
+    v_FrameDir = frameDir;
+    v_WorldRadius = radius;
+
+    gl_Position = u_ViewProjection * vec4(v_WorldPos, 1.0);
+}
+
+#shader fragment
+#version 330 core
+layout(location = 0) out vec4 color;
+
+in vec2 v_AtlasCoord;
+in vec3 v_WorldPos;
+in vec3 v_FrameDir;
+in float v_WorldRadius;
+
+// Per frame, binding UniformBlock::Camera (see UniformBuffer.h)
+layout(std140) uniform Camera {
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec4 u_CameraPosition;
+};
+
+uniform sampler2D u_ColorAtlas;
+uniform sampler2D u_DepthAtlas;
+
+void main()
+{
+    color = texture(u_ColorAtlas, v_AtlasCoord);
+    if (color.a < 0.5)
+        discard;
+
+    // Reconstruct the surface position from the baked linear depth (0 = front of the sphere)
+    float depth = texture(u_DepthAtlas, v_AtlasCoord).r;
+    vec3 surface = v_WorldPos + v_FrameDir * (v_WorldRadius - depth * 2.0 * v_WorldRadius);
+    vec4 clip = u_ViewProjection * vec4(surface, 1.0);
+    gl_FragDepth = (clip.z / clip.w) * 0.5 + 0.5;
+}
@@ -0,0 +1,53 @@
+#shader vertex
+#version 330 core
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec2 a_TexCoord;
+layout(location = 2) in vec3 a_Color;
+
+// Per baked frame (Impostor::Bake), binding UniformBlock::Camera (see UniformBuffer.h)
+layout(std140) uniform Camera {
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec4 u_CameraPosition;
+};
+
+uniform mat4 u_Model;
+
+out vec2 v_TexCoord;
+out vec3 v_Color;
+out float v_ViewDepth; // Distance in front of the bake camera
+
+void main()
+{
+    vec4 viewPos = u_View * u_Model * vec4(a_Position, 1.0);
+    gl_Position = u_Projection * viewPos;
+    v_TexCoord = a_TexCoord;
+    v_Color = a_Color;
+    v_ViewDepth = -viewPos.z;
+}
+
+#shader fragment
+#version 330 core
+layout(location = 0) out vec4 color;
+layout(location = 1) out float depth;
+
+in vec2 v_TexCoord;
+in vec3 v_Color;
+in float v_ViewDepth;
+
+uniform sampler2D u_Texture;
+uniform int u_UseTexture; // 0 = use vertex color, 1 = use texture
+uniform float u_Near;       // Distance of the front of the bounding sphere
+uniform float u_DepthRange; // Sphere diameter
+
+void main()
+{
+    if (u_UseTexture == 1) {
+        color = texture(u_Texture, v_TexCoord);
+    } else {
+        color = vec4(v_Color, 1.0);
+    }
+    // Linear depth across the bounding sphere: 0 = front, 1 = back
+    depth = clamp((v_ViewDepth - u_Near) / u_DepthRange, 0.0, 1.0);
+}
@@ -0,0 +1,283 @@
+#include "AssetManager.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MipChain.h"
+#include "Shader.h"
+#include "Texture.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <unordered_set>
+
+uint64_t AssetManager::HashFileContents(const std::string& path) {
+    MappedFile file;
+    if (!file.Open(path) || file.GetSize() == 0)
+        return 0;
+    return MipChain::HashData(file.GetData(), file.GetSize());
+}
+
+// Removes the entries that only the cache itself still references
+template <typename CacheT, typename OnRelease>
+static size_t PruneCache(CacheT& cache, OnRelease onRelease) {
+    std::unordered_map<const void*, long> cacheRefs;
+    for (const auto& item : cache.byPath)
+        ++cacheRefs[item.second.get()];
+    for (const auto& item : cache.byHash)
+        ++cacheRefs[item.second.get()];
+
+    std::unordered_set<const void*> unused;
+    for (const auto& item : cache.byPath) {
+        const auto& entry = item.second;
+        if (entry->state != AssetState::Loading && entry.use_count() == cacheRefs[entry.get()] &&
+            (!entry->asset || entry->asset.use_count() == 1))
+            unused.insert(entry.get());
+    }
+    for (const void* entry : unused)
+        onRelease(entry);
+
+    for (auto it = cache.byPath.begin(); it != cache.byPath.end();)
+        it = unused.count(it->second.get()) ? cache.byPath.erase(it) : std::next(it);
+    for (auto it = cache.byHash.begin(); it != cache.byHash.end();)
+        it = unused.count(it->second.get()) ? cache.byHash.erase(it) : std::next(it);
+    return unused.size();
+}
+
+AssetManager::AssetManager()
+    : m_Async(std::make_shared<AsyncQueue>()) {
+}
+
+AssetManager::~AssetManager() {
+    // Jobs still parsing only hold a weak_ptr to the queue and drop their result
+}
+
+void AssetManager::SetTextureLoader(TextureLoader loader) {
+    m_TextureLoader = std::move(loader);
+}
+
+std::string AssetManager::CanonicalPath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    if (error)
+        canonical = std::filesystem::absolute(path, error).lexically_normal();
+    if (error)
+        canonical = std::filesystem::path(path).lexically_normal();
+    return canonical.generic_string();
+}
+
+template <typename T>
+std::shared_ptr<AssetEntry<T>> AssetManager::Lookup(Cache<T>& cache, const std::string& key, bool byContent, uint64_t& outHash) {
+    outHash = 0;
+    auto it = cache.byPath.find(key);
+    if (it != cache.byPath.end()) {
+        ++m_Stats.pathHits;
+        return it->second;
+    }
+    if (!byContent)
+        return nullptr;
+
+    outHash = HashFileContents(key);
+    auto sameContents = outHash != 0 ? cache.byHash.find(outHash) : cache.byHash.end();
+    if (sameContents == cache.byHash.end())
+        return nullptr;
+
+    ++m_Stats.contentHits;
+    std::cout << "[AssetManager] " << key << " has the same contents as " << sameContents->second->path
+              << " - sharing it" << std::endl;
+    cache.byPath[key] = sameContents->second;
+    return sameContents->second;
+}
+
+template <typename T>
+std::shared_ptr<AssetEntry<T>> AssetManager::Insert(Cache<T>& cache, const std::string& key, uint64_t hash) {
+    auto entry = std::make_shared<AssetEntry<T>>();
+    entry->path = key;
+    entry->hash = hash;
+    cache.byPath[key] = entry;
+    if (hash != 0)
+        cache.byHash[hash] = entry;
+    return entry;
+}
+
+std::shared_ptr<AssetEntry<Mesh>> AssetManager::RequestMesh(const std::string& path, Mesh::CpuDataPolicy policy, bool& outCreated) {
+    outCreated = false;
+    const std::string key = CanonicalPath(path);
+    uint64_t hash = 0;
+    if (auto entry = Lookup(m_Meshes, key, false, hash)) {
+        MeshExtra& extra = m_MeshExtras[entry.get()];
+        if (policy == Mesh::CpuDataPolicy::Keep && extra.policy == Mesh::CpuDataPolicy::Release) {
+            if (!entry->asset || entry->asset->HasCpuData()) {
+                extra.policy = Mesh::CpuDataPolicy::Keep;
+                if (entry->asset)
+                    entry->asset->SetCpuDataPolicy(Mesh::CpuDataPolicy::Keep);
+            } else {
+                std::cerr << "[AssetManager] CPU data of " << path << " was already released - "
+                          << "load it with CpuDataPolicy::Keep first" << std::endl;
+            }
+        }
+        return entry;
+    }
+
+    auto entry = Insert(m_Meshes, key, 0);
+    m_MeshExtras[entry.get()].policy = policy;
+    ++m_Stats.loads;
+    outCreated = true;
+    return entry;
+}
+
+AssetHandle<Mesh> AssetManager::LoadMesh(const std::string& path, Mesh::CpuDataPolicy policy) {
+    bool created = false;
+    auto entry = RequestMesh(path, policy, created);
+    if (created) {
+        OBJLoader::MeshData data;
+        const bool loaded = OBJLoader::LoadOBJ(path, data, false);
+        FinishMesh(entry, loaded ? &data : nullptr);
+    }
+    // An async load of the same file may still be in flight - then the handle is Loading
+    return AssetHandle<Mesh>(entry);
+}
+
+AssetHandle<Mesh> AssetManager::LoadMeshAsync(const std::string& path, Mesh::CpuDataPolicy policy) {
+    bool created = false;
+    auto entry = RequestMesh(path, policy, created);
+    if (created) {
+        // The parse needs no GL - materials only get their texture paths until FinishMesh
+        std::weak_ptr<AsyncQueue> queue = m_Async;
+        JobSystem::Get().Submit([queue, entry, path]() {
+            auto data = std::make_unique<OBJLoader::MeshData>();
+            if (!OBJLoader::LoadOBJ(path, *data, false))
+                data.reset();
+            if (auto target = queue.lock()) {
+                std::lock_guard<std::mutex> lock(target->mutex);
+                target->finished.push_back({ entry, std::move(data) });
+            }
+        });
+    }
+    return AssetHandle<Mesh>(entry);
+}
+
+void AssetManager::FinishMesh(const std::shared_ptr<AssetEntry<Mesh>>& entry, OBJLoader::MeshData* data) {
+    if (!data) {
+        std::cerr << "[AssetManager] Failed to load mesh: " << entry->path << std::endl;
+        entry->state = AssetState::Failed;
+        return;
+    }
+
+    // Materials of an MTL that is already loaded are shared, textures included
+    std::vector<std::string> newMaterials;
+    for (auto& matPair : data->materials) {
+        const std::string key = CanonicalPath(matPair.second.libraryPath) + "#" + matPair.first;
+        auto cached = m_Materials.byPath.find(key);
+        if (cached != m_Materials.byPath.end() && cached->second->asset) {
+            matPair.second = *cached->second->asset;
+            ++m_Stats.pathHits;
+        } else {
+            newMaterials.push_back(matPair.first);
+        }
+    }
+
+    OBJLoader::LoadTextures(*data);
+
+    MeshExtra& extra = m_MeshExtras[entry.get()];
+    for (auto& matPair : data->materials) {
+        const std::string key = CanonicalPath(matPair.second.libraryPath) + "#" + matPair.first;
+        std::shared_ptr<AssetEntry<Material>> material;
+        if (std::find(newMaterials.begin(), newMaterials.end(), matPair.first) != newMaterials.end()) {
+            material = Insert(m_Materials, key, 0);
+            material->asset = std::make_shared<Material>(matPair.second);
+            material->state = AssetState::Ready;
+            ++m_Stats.loads;
+        } else {
+            material = m_Materials.byPath[key];
+        }
+        extra.materials.push_back(AssetHandle<Material>(material));
+    }
+
+    entry->asset = std::make_shared<Mesh>(std::move(*data), extra.policy);
+    entry->state = AssetState::Ready;
+}
+
+AssetHandle<Texture> AssetManager::LoadTexture(const std::string& path) {
+    const std::string key = CanonicalPath(path);
+    uint64_t hash = 0;
+    if (auto entry = Lookup(m_Textures, key, true, hash))
+        return AssetHandle<Texture>(entry);
+
+    auto entry = Insert(m_Textures, key, hash);
+    ++m_Stats.loads;
+    auto texture = m_TextureLoader ? m_TextureLoader(path) : std::make_shared<Texture>(path);
+    if (!texture || !texture->IsValid()) {
+        entry->state = AssetState::Failed;
+    } else {
+        entry->asset = std::move(texture);
+        if (entry->asset->IsReady()) {
+            entry->state = AssetState::Ready;
+        } else {
+            m_LoadingTextures.push_back(entry);
+        }
+    }
+    return AssetHandle<Texture>(entry);
+}
+
+AssetHandle<Shader> AssetManager::LoadShader(const std::string& path) {
+    const std::string key = CanonicalPath(path);
+    uint64_t hash = 0;
+    if (auto entry = Lookup(m_Shaders, key, true, hash))
+        return AssetHandle<Shader>(entry);
+
+    auto entry = Insert(m_Shaders, key, hash);
+    ++m_Stats.loads;
+    entry->asset = std::make_shared<Shader>(path);
+    entry->state = entry->asset->GetRendererID() != 0 ? AssetState::Ready : AssetState::Failed;
+    return AssetHandle<Shader>(entry);
+}
+
+AssetHandle<Material> AssetManager::FindMaterial(const std::string& mtlPath, const std::string& name) const {
+    auto it = m_Materials.byPath.find(CanonicalPath(mtlPath) + "#" + name);
+    return it != m_Materials.byPath.end() ? AssetHandle<Material>(it->second) : AssetHandle<Material>();
+}
+
+const std::vector<AssetHandle<Material>>& AssetManager::GetMaterials(const AssetHandle<Mesh>& mesh) const {
+    static const std::vector<AssetHandle<Material>> none;
+    auto it = m_MeshExtras.find(mesh.m_Entry.get());
+    return it != m_MeshExtras.end() ? it->second.materials : none;
+}
+
+void AssetManager::UpdateTextureStates() {
+    for (auto it = m_LoadingTextures.begin(); it != m_LoadingTextures.end();) {
+        AssetEntry<Texture>& entry = **it;
+        if (entry.asset->IsReady()) {
+            entry.state = AssetState::Ready;
+        } else if (!entry.asset->IsValid()) {
+            entry.state = AssetState::Failed;
+        } else {
+            ++it;
+            continue;
+        }
+        it = m_LoadingTextures.erase(it);
+    }
+}
+
+void AssetManager::Update() {
+    std::vector<AsyncQueue::Result> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_Async->mutex);
+        finished.swap(m_Async->finished);
+    }
+    for (AsyncQueue::Result& result : finished)
+        FinishMesh(result.entry, result.data.get());
+
+    UpdateTextureStates();
+}
+
+size_t AssetManager::ReleaseUnused() {
+    // Meshes first: their material handles keep the materials (and those the textures) alive
+    size_t released = PruneCache(m_Meshes, [this](const void* entry) {
+        m_MeshExtras.erase(static_cast<const AssetEntry<Mesh>*>(entry));
+    });
+    released += PruneCache(m_Materials, [](const void*) {});
+    released += PruneCache(m_Textures, [](const void*) {});
+    released += PruneCache(m_Shaders, [](const void*) {});
+    if (released > 0)
+        std::cout << "[AssetManager] Released " << released << " unused asset(s)" << std::endl;
+    return released;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Material.h"
+#include "Mesh.h"
+
+class Shader;
+class Texture;
+
+enum class AssetState {
+    Loading,    // Queued / parsing on a worker / texture still streaming
+    Ready,
+    Failed
+};
+
+template <typename T>
+struct AssetEntry {
+    std::string path;               // Canonical path (materials: "<mtl path>#<name>")
+    uint64_t hash = 0;              // Content hash, 0 if not deduplicated by content
+    std::atomic<AssetState> state{ AssetState::Loading };
+    std::shared_ptr<T> asset;       // Set on the main thread only
+};
+
+/**
+ * AssetHandle - shared reference to a cached asset
+ *
+ * Copying a handle only bumps a reference count. All handles to the same file
+ * point to the same entry, so an asynchronously loaded asset shows up in every
+ * copy once it is ready. Get() is nullptr while the asset is loading or failed.
+ */
+template <typename T>
+class AssetHandle {
+public:
+    AssetHandle() = default;
+
+    inline T* Get() const { return m_Entry ? m_Entry->asset.get() : nullptr; }
+    inline T* operator->() const { return Get(); }
+    inline T& operator*() const { return *Get(); }
+    inline explicit operator bool() const { return Get() != nullptr; }
+
+    // For code that stores plain shared_ptrs (Player, StaticBatcher, Material)
+    inline std::shared_ptr<T> GetShared() const { return m_Entry ? m_Entry->asset : nullptr; }
+
+    inline AssetState GetState() const { return m_Entry ? m_Entry->state.load() : AssetState::Failed; }
+    inline bool IsReady() const { return GetState() == AssetState::Ready; }
+    inline bool IsLoading() const { return GetState() == AssetState::Loading; }
+    inline const std::string& GetPath() const {
+        static const std::string empty;
+        return m_Entry ? m_Entry->path : empty;
+    }
+
+    inline bool operator==(const AssetHandle& other) const { return m_Entry == other.m_Entry; }
+    inline bool operator!=(const AssetHandle& other) const { return m_Entry != other.m_Entry; }
+
+private:
+    friend class AssetManager;
+    explicit AssetHandle(std::shared_ptr<AssetEntry<T>> entry) : m_Entry(std::move(entry)) {}
+
+    std::shared_ptr<AssetEntry<T>> m_Entry;
+};
+
+/**
+ * AssetManager - loads every mesh, texture, material and shader once
+ *
+ * Assets are cached by canonical path ("res/./models/../models/a.obj" and
+ * "res/models/a.obj" are the same file). Textures and shaders are self-contained,
+ * so they are also keyed by a hash of the file contents: a copy of a file under
+ * another name shares the already loaded asset. Meshes and materials reference
+ * other files by relative paths and are only deduplicated by path.
+ *
+ * Materials are cached per MTL file and name; OBJs sharing an MTL share its
+ * materials and their textures (OBJLoader::SetAssetManager routes map_Kd through
+ * LoadTexture). Textures come from the texture loader - e.g. a TextureStreamer -
+ * or Texture(path) by default.
+ *
+ * A mesh is loaded once with the CPU data policy of its first request; Keep
+ * wins if any request asks for it before the data is released. SetupGL() is up
+ * to the caller, as for any Mesh.
+ *
+ * LoadMeshAsync() parses the OBJ on the JobSystem and hands back a handle in the
+ * Loading state; Update() creates the Mesh, its materials and textures on the
+ * main thread. Textures from a streaming loader stay Loading until they are ready.
+ *
+ * Main thread only (except for the internal worker jobs). Usage:
+ *   AssetManager assets;
+ *   OBJLoader::SetAssetManager(&assets);
+ *   auto mesh = assets.LoadMesh("res/models/Test.obj");     // second call: cache hit
+ *   auto shader = assets.LoadShader("res/shaders/basic.shader");
+ *   ...
+ *   assets.Update();                                        // every frame
+ */
+class AssetManager {
+public:
+    using TextureLoader = std::function<std::shared_ptr<Texture>(const std::string& path)>;
+
+    struct Stats {
+        size_t pathHits = 0;        // Requests served by canonical path
+        size_t contentHits = 0;     // Different path, same contents
+        size_t loads = 0;           // Actual parses / decodes
+    };
+
+    AssetManager();
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Creates the Texture for a path on a cache miss. Default: synchronous Texture(path).
+    void SetTextureLoader(TextureLoader loader);
+
+    AssetHandle<Mesh> LoadMesh(const std::string& path, Mesh::CpuDataPolicy policy = Mesh::CpuDataPolicy::Release);
+    AssetHandle<Mesh> LoadMeshAsync(const std::string& path, Mesh::CpuDataPolicy policy = Mesh::CpuDataPolicy::Release);
+    AssetHandle<Texture> LoadTexture(const std::string& path);
+    AssetHandle<Shader> LoadShader(const std::string& path);
+    // nullptr handle if the material hasn't been loaded with a mesh yet
+    AssetHandle<Material> FindMaterial(const std::string& mtlPath, const std::string& name) const;
+
+    // Materials used by a mesh (empty while it is loading)
+    const std::vector<AssetHandle<Material>>& GetMaterials(const AssetHandle<Mesh>& mesh) const;
+
+    // Finishes async loads and updates the state of streaming textures
+    void Update();
+
+    // Drops cache entries nobody else references; returns how many
+    size_t ReleaseUnused();
+
+    inline const Stats& GetStats() const { return m_Stats; }
+
+    // Normalized absolute path with forward slashes - the cache key
+    static std::string CanonicalPath(const std::string& path);
+
+    // Content key for textures and shaders (same FNV-1a as the mip cache), 0 if unreadable
+    static uint64_t HashFileContents(const std::string& path);
+
+private:
+    template <typename T>
+    struct Cache {
+        std::unordered_map<std::string, std::shared_ptr<AssetEntry<T>>> byPath;
+        std::unordered_map<uint64_t, std::shared_ptr<AssetEntry<T>>> byHash;
+    };
+
+    struct MeshExtra {
+        std::vector<AssetHandle<Material>> materials;
+        Mesh::CpuDataPolicy policy = Mesh::CpuDataPolicy::Release;
+    };
+
+    // Written by the worker jobs, drained by Update()
+    struct AsyncQueue {
+        std::mutex mutex;
+        struct Result {
+            std::shared_ptr<AssetEntry<Mesh>> entry;
+            std::unique_ptr<OBJLoader::MeshData> data;   // nullptr: parse failed
+        };
+        std::vector<Result> finished;
+    };
+
+    template <typename T>
+    std::shared_ptr<AssetEntry<T>> Lookup(Cache<T>& cache, const std::string& key, bool byContent, uint64_t& outHash);
+    template <typename T>
+    static std::shared_ptr<AssetEntry<T>> Insert(Cache<T>& cache, const std::string& key, uint64_t hash);
+
+    std::shared_ptr<AssetEntry<Mesh>> RequestMesh(const std::string& path, Mesh::CpuDataPolicy policy, bool& outCreated);
+    void FinishMesh(const std::shared_ptr<AssetEntry<Mesh>>& entry, OBJLoader::MeshData* data);
+    void UpdateTextureStates();
+
+    TextureLoader m_TextureLoader;
+    Cache<Mesh> m_Meshes;
+    Cache<Texture> m_Textures;
+    Cache<Material> m_Materials;
+    Cache<Shader> m_Shaders;
+    std::unordered_map<const AssetEntry<Mesh>*, MeshExtra> m_MeshExtras;
+    std::vector<std::shared_ptr<AssetEntry<Texture>>> m_LoadingTextures;
+    std::shared_ptr<AsyncQueue> m_Async;
+    Stats m_Stats;
+};
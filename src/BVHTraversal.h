@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "vendor/glm/glm.hpp"
+
+// Helpers shared by the MeshBVH and DynamicBVH traversals.
+
+// 1 / d for slab tests. Zero components become +-1e20 instead of +-inf, so a ray that
+// starts exactly on a slab plane gets 0 * 1e20 = 0 there rather than 0 * inf = NaN.
+inline float SafeInverse(float d) {
+    if (std::fabs(d) < 1e-20f)
+        d = d < 0.0f ? -1e-20f : 1e-20f;
+    return 1.0f / d;
+}
+
+inline glm::vec3 SafeInverse(const glm::vec3& d) {
+    return glm::vec3(SafeInverse(d.x), SafeInverse(d.y), SafeInverse(d.z));
+}
+
+// Traversal stack: fixed storage for normal trees, heap only for degenerate ones
+template <class T, size_t Fixed = 64>
+class NodeStack {
+public:
+    inline void Push(const T& value) {
+        if (m_Size < Fixed)
+            m_Fixed[m_Size] = value;
+        else
+            m_Overflow.push_back(value);
+        ++m_Size;
+    }
+
+    inline T Pop() {
+        --m_Size;
+        if (m_Size < Fixed)
+            return m_Fixed[m_Size];
+        T value = m_Overflow.back();
+        m_Overflow.pop_back();
+        return value;
+    }
+
+    inline bool Empty() const { return m_Size == 0; }
+
+private:
+    T m_Fixed[Fixed];
+    std::vector<T> m_Overflow;
+    size_t m_Size = 0;
+};
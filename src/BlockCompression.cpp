@@ -0,0 +1,495 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr float kEpsilon = 1e-6f;
+
+// Mean and principal axis (power iteration on the covariance) of the used texels
+void FitAxis(const float px[16][4], const bool use[16], int channels, float mean[4], float axis[4]) {
+    int count = 0;
+    for (int c = 0; c < 4; ++c) {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+    for (int i = 0; i < 16; ++i) {
+        if (!use[i])
+            continue;
+        for (int c = 0; c < channels; ++c)
+            mean[c] += px[i][c];
+        ++count;
+    }
+    if (count == 0)
+        return;
+    for (int c = 0; c < channels; ++c)
+        mean[c] /= static_cast<float>(count);
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        if (!use[i])
+            continue;
+        for (int a = 0; a < channels; ++a) {
+            for (int b = a; b < channels; ++b)
+                cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+        }
+    }
+    for (int a = 0; a < channels; ++a) {
+        for (int b = 0; b < a; ++b)
+            cov[a][b] = cov[b][a];
+    }
+
+    // Start from the channel with the largest variance
+    int start = 0;
+    for (int c = 1; c < channels; ++c) {
+        if (cov[c][c] > cov[start][start])
+            start = c;
+    }
+    float v[4] = {};
+    v[start] = 1.0f;
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[4] = {};
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b)
+                next[a] += cov[a][b] * v[b];
+        }
+        float length = 0.0f;
+        for (int c = 0; c < channels; ++c)
+            length += next[c] * next[c];
+        if (length < kEpsilon)
+            break;
+        length = 1.0f / std::sqrt(length);
+        for (int c = 0; c < channels; ++c)
+            v[c] = next[c] * length;
+    }
+    for (int c = 0; c < channels; ++c)
+        axis[c] = v[c];
+}
+
+// Endpoints = extremes of the used texels projected onto the axis
+void AxisEndpoints(const float px[16][4], const bool use[16], int channels,
+                   const float mean[4], const float axis[4], float e0[4], float e1[4]) {
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        if (!use[i])
+            continue;
+        float t = 0.0f;
+        for (int c = 0; c < channels; ++c)
+            t += (px[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (int c = 0; c < channels; ++c) {
+        e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMax));
+        e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMin));
+    }
+}
+
+// Least-squares endpoints for fixed indices. weight[i] is the share of endpoint 0
+// in the palette entry texel i uses. Returns false if the system is singular.
+bool SolveEndpoints(const float px[16][4], const bool use[16], const float weight[16], int channels,
+                    float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        if (!use[i])
+            continue;
+        const float a = weight[i], b = 1.0f - weight[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; ++c) {
+            ax[c] += a * px[i][c];
+            bx[c] += b * px[i][c];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::fabs(det) < kEpsilon)
+        return false;
+    const float inv = 1.0f / det;
+    for (int c = 0; c < channels; ++c) {
+        e0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) * inv));
+        e1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) * inv));
+    }
+    return true;
+}
+
+// ---------- BC1 color block ----------
+
+inline uint16_t Pack565(const float c[4]) {
+    const int r = std::min(31, std::max(0, static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f)));
+    const int g = std::min(63, std::max(0, static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f)));
+    const int b = std::min(31, std::max(0, static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f)));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+inline void Unpack565(uint16_t packed, float out[3]) {
+    const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    out[0] = static_cast<float>((r << 3) | (r >> 2));
+    out[1] = static_cast<float>((g << 2) | (g >> 4));
+    out[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+struct ColorBlock {
+    uint16_t c0 = 0, c1 = 0;
+    uint8_t indices[16] = {};
+    float error = 0.0f;
+};
+
+// Quantizes the endpoints, orders them for the requested mode and picks indices.
+// Four-color mode needs c0 > c1, three-color mode (index 3 = transparent) c0 <= c1.
+ColorBlock EvaluateColorBlock(const float px[16][4], const bool transparent[16], bool threeColor,
+                              const float e0[4], const float e1[4]) {
+    ColorBlock block;
+    block.c0 = Pack565(e0);
+    block.c1 = Pack565(e1);
+    if (threeColor ? block.c0 > block.c1 : block.c0 < block.c1)
+        std::swap(block.c0, block.c1);
+
+    float pal[4][3];
+    Unpack565(block.c0, pal[0]);
+    Unpack565(block.c1, pal[1]);
+    int paletteSize = 4;
+    if (threeColor) {
+        for (int c = 0; c < 3; ++c)
+            pal[2][c] = (pal[0][c] + pal[1][c]) * 0.5f;
+        paletteSize = 3;
+    } else if (block.c0 == block.c1) {
+        paletteSize = 1;
+    } else {
+        for (int c = 0; c < 3; ++c) {
+            pal[2][c] = (2.0f * pal[0][c] + pal[1][c]) / 3.0f;
+            pal[3][c] = (pal[0][c] + 2.0f * pal[1][c]) / 3.0f;
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        if (transparent[i]) {
+            block.indices[i] = 3;
+            continue;
+        }
+        float best = 1e30f;
+        for (int k = 0; k < paletteSize; ++k) {
+            float d = 0.0f;
+            for (int c = 0; c < 3; ++c)
+                d += (px[i][c] - pal[k][c]) * (px[i][c] - pal[k][c]);
+            if (d < best) {
+                best = d;
+                block.indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+        block.error += best;
+    }
+    return block;
+}
+
+void EncodeColorBlock(const float px[16][4], const bool transparent[16], bool threeColor, unsigned char out[8]) {
+    bool use[16];
+    bool any = false;
+    for (int i = 0; i < 16; ++i) {
+        use[i] = !transparent[i];
+        any = any || use[i];
+    }
+
+    ColorBlock best;
+    if (!any) {
+        // Fully transparent: c0 == c1 selects three-color mode, every index 3
+        std::fill(best.indices, best.indices + 16, uint8_t(3));
+    } else {
+        float mean[4], axis[4], e0[4] = {}, e1[4] = {};
+        FitAxis(px, use, 3, mean, axis);
+        AxisEndpoints(px, use, 3, mean, axis, e0, e1);
+        best = EvaluateColorBlock(px, transparent, threeColor, e0, e1);
+
+        // One least-squares refinement with the chosen indices
+        const float fourWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        const float threeWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+        float weight[16];
+        for (int i = 0; i < 16; ++i)
+            weight[i] = (threeColor ? threeWeights : fourWeights)[best.indices[i]];
+        if (best.error > 0.0f && SolveEndpoints(px, use, weight, 3, e0, e1)) {
+            ColorBlock refined = EvaluateColorBlock(px, transparent, threeColor, e0, e1);
+            if (refined.error < best.error)
+                best = refined;
+        }
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+        bits |= static_cast<uint32_t>(best.indices[i]) << (i * 2);
+    out[0] = static_cast<unsigned char>(best.c0 & 0xFF);
+    out[1] = static_cast<unsigned char>(best.c0 >> 8);
+    out[2] = static_cast<unsigned char>(best.c1 & 0xFF);
+    out[3] = static_cast<unsigned char>(best.c1 >> 8);
+    for (int b = 0; b < 4; ++b)
+        out[4 + b] = static_cast<unsigned char>((bits >> (b * 8)) & 0xFF);
+}
+
+// ---------- BC4 single channel block (BC3 alpha, BC5 channels) ----------
+
+void EncodeChannelBlock(const float values[16], unsigned char out[8]) {
+    float lo = 255.0f, hi = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+    }
+    const int a0 = static_cast<int>(hi + 0.5f);
+    const int a1 = static_cast<int>(lo + 0.5f);
+
+    uint64_t bits = 0;
+    if (a0 > a1) {
+        // Eight-value mode
+        float pal[8];
+        pal[0] = static_cast<float>(a0);
+        pal[1] = static_cast<float>(a1);
+        for (int k = 2; k < 8; ++k)
+            pal[k] = ((8 - k) * a0 + (k - 1) * a1) / 7.0f;
+        for (int i = 0; i < 16; ++i) {
+            int bestIndex = 0;
+            float best = 1e30f;
+            for (int k = 0; k < 8; ++k) {
+                const float d = std::fabs(values[i] - pal[k]);
+                if (d < best) {
+                    best = d;
+                    bestIndex = k;
+                }
+            }
+            bits |= static_cast<uint64_t>(bestIndex) << (i * 3);
+        }
+    }
+    // a0 == a1: constant block, every index 0
+
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    for (int b = 0; b < 6; ++b)
+        out[2 + b] = static_cast<unsigned char>((bits >> (b * 8)) & 0xFF);
+}
+
+// ---------- BC7 mode 6 ----------
+
+const int kBc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Block {
+    int q0[4], q1[4];   // 7-bit endpoints
+    int p0 = 0, p1 = 0; // p-bits
+    uint8_t indices[16] = {};
+    float error = 0.0f;
+};
+
+// 7 bits + shared p-bit per endpoint; picks the p-bit with the smaller error
+void QuantizeBc7Endpoint(const float e[4], int q[4], int& p) {
+    float bestError = 1e30f;
+    for (int pbit = 0; pbit < 2; ++pbit) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = std::min(127, std::max(0, static_cast<int>((e[c] - pbit) * 0.5f + 0.5f)));
+            const float d = static_cast<float>((candidate[c] << 1) | pbit) - e[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            p = pbit;
+            std::copy(candidate, candidate + 4, q);
+        }
+    }
+}
+
+Bc7Block EvaluateBc7Block(const float px[16][4], const float e0[4], const float e1[4]) {
+    Bc7Block block;
+    QuantizeBc7Endpoint(e0, block.q0, block.p0);
+    QuantizeBc7Endpoint(e1, block.q1, block.p1);
+
+    int end0[4], end1[4];
+    for (int c = 0; c < 4; ++c) {
+        end0[c] = (block.q0[c] << 1) | block.p0;
+        end1[c] = (block.q1[c] << 1) | block.p1;
+    }
+    float pal[16][4];
+    for (int k = 0; k < 16; ++k) {
+        const int w = kBc7Weights4[k];
+        for (int c = 0; c < 4; ++c)
+            pal[k][c] = static_cast<float>(((64 - w) * end0[c] + w * end1[c] + 32) >> 6);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        float best = 1e30f;
+        for (int k = 0; k < 16; ++k) {
+            float d = 0.0f;
+            for (int c = 0; c < 4; ++c)
+                d += (px[i][c] - pal[k][c]) * (px[i][c] - pal[k][c]);
+            if (d < best) {
+                best = d;
+                block.indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+        block.error += best;
+    }
+    return block;
+}
+
+void PutBits(unsigned char out[16], int& pos, uint32_t value, int count) {
+    for (int i = 0; i < count; ++i, ++pos) {
+        if (value & (1u << i))
+            out[pos >> 3] |= static_cast<unsigned char>(1u << (pos & 7));
+    }
+}
+
+// Gathers a 4x4 block, replicating the border for partial blocks
+void LoadBlock(const unsigned char* rgba, int width, int height, int bx, int by, unsigned char block[64]) {
+    for (int y = 0; y < 4; ++y) {
+        const int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x) {
+            const int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+void ToFloat(const unsigned char rgba[64], float px[16][4]) {
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c)
+            px[i][c] = rgba[i * 4 + c];
+    }
+}
+
+} // namespace
+
+size_t BlockCompression::BlockBytes(Format format) {
+    return format == Format::BC1 ? 8 : 16;
+}
+
+size_t BlockCompression::CompressedSize(Format format, int width, int height) {
+    const size_t blocksX = static_cast<size_t>(std::max(1, (width + 3) / 4));
+    const size_t blocksY = static_cast<size_t>(std::max(1, (height + 3) / 4));
+    return blocksX * blocksY * BlockBytes(format);
+}
+
+const char* BlockCompression::FormatName(Format format) {
+    switch (format) {
+    case Format::BC1: return "BC1";
+    case Format::BC3: return "BC3";
+    case Format::BC5: return "BC5";
+    case Format::BC7: return "BC7";
+    }
+    return "?";
+}
+
+bool BlockCompression::ParseFormat(const std::string& name, Format& outFormat) {
+    std::string upper = name;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (upper == "BC1") outFormat = Format::BC1;
+    else if (upper == "BC3") outFormat = Format::BC3;
+    else if (upper == "BC5") outFormat = Format::BC5;
+    else if (upper == "BC7") outFormat = Format::BC7;
+    else return false;
+    return true;
+}
+
+void BlockCompression::EncodeBC1(const unsigned char rgba[64], unsigned char out[8]) {
+    float px[16][4];
+    ToFloat(rgba, px);
+    bool transparent[16];
+    bool anyTransparent = false;
+    for (int i = 0; i < 16; ++i) {
+        transparent[i] = rgba[i * 4 + 3] < 128;
+        anyTransparent = anyTransparent || transparent[i];
+    }
+    EncodeColorBlock(px, transparent, anyTransparent, out);
+}
+
+void BlockCompression::EncodeBC3(const unsigned char rgba[64], unsigned char out[16]) {
+    float px[16][4];
+    ToFloat(rgba, px);
+    float alpha[16];
+    for (int i = 0; i < 16; ++i)
+        alpha[i] = px[i][3];
+    EncodeChannelBlock(alpha, out);
+
+    const bool opaque[16] = {};
+    EncodeColorBlock(px, opaque, false, out + 8);
+}
+
+void BlockCompression::EncodeBC5(const unsigned char rgba[64], unsigned char out[16]) {
+    float red[16], green[16];
+    for (int i = 0; i < 16; ++i) {
+        red[i] = rgba[i * 4 + 0];
+        green[i] = rgba[i * 4 + 1];
+    }
+    EncodeChannelBlock(red, out);
+    EncodeChannelBlock(green, out + 8);
+}
+
+void BlockCompression::EncodeBC7(const unsigned char rgba[64], unsigned char out[16]) {
+    float px[16][4];
+    ToFloat(rgba, px);
+    bool use[16];
+    std::fill(use, use + 16, true);
+
+    float mean[4], axis[4], e0[4], e1[4];
+    FitAxis(px, use, 4, mean, axis);
+    AxisEndpoints(px, use, 4, mean, axis, e0, e1);
+    Bc7Block best = EvaluateBc7Block(px, e0, e1);
+
+    float weight[16];
+    for (int i = 0; i < 16; ++i)
+        weight[i] = (64 - kBc7Weights4[best.indices[i]]) / 64.0f;
+    if (best.error > 0.0f && SolveEndpoints(px, use, weight, 4, e0, e1)) {
+        Bc7Block refined = EvaluateBc7Block(px, e0, e1);
+        if (refined.error < best.error)
+            best = refined;
+    }
+
+    // The anchor index (texel 0) is stored without its top bit - swap the endpoints if it's set
+    if (best.indices[0] & 8) {
+        std::swap(best.q0, best.q1);
+        std::swap(best.p0, best.p1);
+        for (uint8_t& index : best.indices)
+            index = static_cast<uint8_t>(15 - index);
+    }
+
+    std::memset(out, 0, 16);
+    int pos = 0;
+    PutBits(out, pos, 1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        PutBits(out, pos, static_cast<uint32_t>(best.q0[c]), 7);
+        PutBits(out, pos, static_cast<uint32_t>(best.q1[c]), 7);
+    }
+    PutBits(out, pos, static_cast<uint32_t>(best.p0), 1);
+    PutBits(out, pos, static_cast<uint32_t>(best.p1), 1);
+    PutBits(out, pos, best.indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        PutBits(out, pos, best.indices[i], 4);
+}
+
+std::vector<unsigned char> BlockCompression::Compress(Format format, const unsigned char* rgba, int width, int height) {
+    std::vector<unsigned char> out;
+    if (!rgba || width <= 0 || height <= 0)
+        return out;
+
+    const int blocksX = std::max(1, (width + 3) / 4);
+    const int blocksY = std::max(1, (height + 3) / 4);
+    const size_t blockBytes = BlockBytes(format);
+    out.resize(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+    JobSystem::Get().ParallelFor(static_cast<size_t>(blocksY), 4, [&](size_t begin, size_t end) {
+        unsigned char block[64];
+        for (size_t by = begin; by < end; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                LoadBlock(rgba, width, height, bx, static_cast<int>(by), block);
+                unsigned char* dst = out.data() + (by * blocksX + bx) * blockBytes;
+                switch (format) {
+                case Format::BC1: EncodeBC1(block, dst); break;
+                case Format::BC3: EncodeBC3(block, dst); break;
+                case Format::BC5: EncodeBC5(block, dst); break;
+                case Format::BC7: EncodeBC7(block, dst); break;
+                }
+            }
+        }
+    });
+    return out;
+}
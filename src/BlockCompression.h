@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * BlockCompression - CPU encoders for the BCn GPU texture formats
+ *
+ *   BC1  RGB + 1-bit alpha, 8 bytes / 4x4 block   (opaque color maps)
+ *   BC3  RGBA, 16 bytes / block                   (color maps with alpha)
+ *   BC5  two channels (R, G), 16 bytes / block    (tangent space normal maps)
+ *   BC7  RGBA, 16 bytes / block                   (high quality color, mode 6 only)
+ *
+ * Endpoints are fitted along the principal axis of each block and refined with
+ * one least-squares pass. This is an offline encoder (see tools/TextureCooker.cpp):
+ * Compress() spreads block rows over the JobSystem, the runtime only uploads.
+ * Edge blocks of images that aren't a multiple of 4 replicate the border texels.
+ */
+class BlockCompression {
+public:
+    enum class Format {
+        BC1,
+        BC3,
+        BC5,
+        BC7
+    };
+
+    static size_t BlockBytes(Format format);
+    static size_t CompressedSize(Format format, int width, int height);
+    static const char* FormatName(Format format);
+    static bool ParseFormat(const std::string& name, Format& outFormat);
+
+    // Compresses tightly packed RGBA8 rows. Returns the blocks row by row.
+    static std::vector<unsigned char> Compress(Format format, const unsigned char* rgba, int width, int height);
+
+    // Single 4x4 block, rgba = 16 texels row-major
+    static void EncodeBC1(const unsigned char rgba[64], unsigned char out[8]);
+    static void EncodeBC3(const unsigned char rgba[64], unsigned char out[16]);
+    static void EncodeBC5(const unsigned char rgba[64], unsigned char out[16]);
+    static void EncodeBC7(const unsigned char rgba[64], unsigned char out[16]);
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cfloat>
+#include "vendor/glm/glm.hpp"
+
+// Axis-aligned bounding box shared by the geometry and culling code.
+// A default constructed box is "empty" (min > max) so that Grow() can be
+// used directly without special-casing the first point.
+struct AABB {
+    glm::vec3 min{ FLT_MAX,  FLT_MAX,  FLT_MAX };
+    glm::vec3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    AABB() = default;
+    AABB(const glm::vec3& mn, const glm::vec3& mx) : min(mn), max(mx) {}
+
+    inline bool IsValid() const {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    inline void Grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    inline void Grow(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    inline glm::vec3 Center() const { return (min + max) * 0.5f; }
+    inline glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+    // Half surface area - enough for SAH cost comparisons
+    inline float HalfArea() const {
+        if (!IsValid())
+            return 0.0f;
+        glm::vec3 d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    inline bool Contains(const AABB& other) const {
+        return other.min.x >= min.x && other.min.y >= min.y && other.min.z >= min.z &&
+               other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+    }
+
+    inline bool Overlaps(const AABB& other) const {
+        return min.x <= other.max.x && max.x >= other.min.x &&
+               min.y <= other.max.y && max.y >= other.min.y &&
+               min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    // Bounds of this box after applying an affine transform (Arvo's method)
+    inline AABB Transformed(const glm::mat4& m) const {
+        if (!IsValid())
+            return *this;
+        glm::vec3 t(m[3]);
+        AABB result(t, t);
+        for (int col = 0; col < 3; ++col) {
+            for (int row = 0; row < 3; ++row) {
+                float a = m[col][row] * min[col];
+                float b = m[col][row] * max[col];
+                result.min[row] += a < b ? a : b;
+                result.max[row] += a < b ? b : a;
+            }
+        }
+        return result;
+    }
+};
+
+// Six planes (a, b, c, d) of a view frustum; a point p is inside a plane if dot(abc, p) + d >= 0.
+// Planes point inwards and are normalized.
+struct Frustum {
+    enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    glm::vec4 planes[PlaneCount];
+
+    // Gribb/Hartmann extraction from projection * view (OpenGL clip space, z in [-w, w])
+    static inline Frustum FromMatrix(const glm::mat4& m) {
+        // glm is column-major: row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+        const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum frustum;
+        frustum.planes[Left] = row3 + row0;
+        frustum.planes[Right] = row3 - row0;
+        frustum.planes[Bottom] = row3 + row1;
+        frustum.planes[Top] = row3 - row1;
+        frustum.planes[Near] = row3 + row2;
+        frustum.planes[Far] = row3 - row2;
+        for (glm::vec4& plane : frustum.planes) {
+            const float length = glm::length(glm::vec3(plane));
+            if (length > 0.0f)
+                plane /= length;
+        }
+        return frustum;
+    }
+
+    // Conservative: boxes crossing a corner of the frustum may count as visible
+    inline bool Intersects(const AABB& box) const {
+        if (!box.IsValid())
+            return false;
+        const glm::vec3 center = box.Center();
+        const glm::vec3 extents = box.Extents();
+        for (const glm::vec4& plane : planes) {
+            const glm::vec3 normal(plane);
+            if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extents) < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
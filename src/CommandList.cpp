@@ -0,0 +1,166 @@
+#include "CommandList.h"
+#include "GeometryBuffer.h"
+#include "MaterialBlocks.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Texture.h"
+#include <iostream>
+
+namespace {
+
+struct ShaderCommand { Shader* shader; };
+struct Uniform1iCommand { UniformId id; int value; };
+struct Uniform1fCommand { UniformId id; float value; };
+struct Uniform4fCommand { UniformId id; glm::vec4 value; };
+struct UniformMat4Command { UniformId id; glm::mat4 matrix; };
+struct TextureCommand { const Texture* texture; unsigned int slot; };
+struct MaterialCommand { MaterialBlocks* materials; int slot; };
+struct MeshCommand { const Mesh* mesh; unsigned int instanceBuffer; };
+struct InstancedCommand { const Mesh* mesh; uint32_t instanceCount; uint32_t baseInstance; };
+struct GeometryCommand { const GeometryBuffer* geometry; uint32_t page; };
+struct IndirectCommand { const GeometryBuffer* geometry; size_t firstCommand; size_t count; };
+
+// Payloads are packed without padding, so they are copied out instead of cast in place
+template <typename T>
+inline T Read(const unsigned char* data) {
+    alignas(T) unsigned char payload[sizeof(T)];
+    std::memcpy(payload, data, sizeof(T));
+    return *reinterpret_cast<const T*>(payload);
+}
+
+inline bool HasShader(const Shader* shader) {
+    if (!shader)
+        std::cerr << "[CommandList] Uniform command before any BindShader in the list - dropped" << std::endl;
+    return shader != nullptr;
+}
+
+} // namespace
+
+void CommandList::BindShader(Shader* shader) {
+    Push(Type::BindShader, ShaderCommand{ shader });
+}
+
+void CommandList::SetUniform1i(UniformId id, int value) {
+    Push(Type::SetUniform1i, Uniform1iCommand{ id, value });
+}
+
+void CommandList::SetUniform1f(UniformId id, float value) {
+    Push(Type::SetUniform1f, Uniform1fCommand{ id, value });
+}
+
+void CommandList::SetUniform4f(UniformId id, const glm::vec4& value) {
+    Push(Type::SetUniform4f, Uniform4fCommand{ id, value });
+}
+
+void CommandList::SetUniformMat4f(UniformId id, const glm::mat4& matrix) {
+    Push(Type::SetUniformMat4f, UniformMat4Command{ id, matrix });
+}
+
+void CommandList::BindTexture(const Texture* texture, unsigned int slot) {
+    Push(Type::BindTexture, TextureCommand{ texture, slot });
+}
+
+void CommandList::BindMaterial(MaterialBlocks* materials, int slot) {
+    Push(Type::BindMaterial, MaterialCommand{ materials, slot });
+}
+
+void CommandList::BindMesh(const Mesh* mesh, unsigned int instanceBuffer) {
+    Push(Type::BindMesh, MeshCommand{ mesh, instanceBuffer });
+}
+
+void CommandList::DrawMesh(const Mesh* mesh) {
+    Push(Type::DrawMesh, MeshCommand{ mesh, 0 });
+}
+
+void CommandList::DrawInstanced(const Mesh* mesh, uint32_t instanceCount, uint32_t baseInstance) {
+    Push(Type::DrawInstanced, InstancedCommand{ mesh, instanceCount, baseInstance });
+}
+
+void CommandList::BindGeometry(const GeometryBuffer* geometry, uint32_t page) {
+    Push(Type::BindGeometry, GeometryCommand{ geometry, page });
+}
+
+void CommandList::DrawIndirect(const GeometryBuffer* geometry, size_t firstCommand, size_t count) {
+    Push(Type::DrawIndirect, IndirectCommand{ geometry, firstCommand, count });
+}
+
+void CommandList::Execute() const {
+    Shader* shader = nullptr;
+    const unsigned char* data = m_Data.data();
+    const unsigned char* end = data + m_Data.size();
+
+    while (data < end) {
+        const Header header = Read<Header>(data);
+        const unsigned char* payload = data + sizeof(Header);
+        data = payload + header.size;
+
+        switch (header.type) {
+        case Type::BindShader:
+            shader = Read<ShaderCommand>(payload).shader;
+            shader->Bind();
+            break;
+        case Type::SetUniform1i: {
+            const Uniform1iCommand command = Read<Uniform1iCommand>(payload);
+            if (HasShader(shader))
+                shader->SetUniform1i(command.id, command.value);
+            break;
+        }
+        case Type::SetUniform1f: {
+            const Uniform1fCommand command = Read<Uniform1fCommand>(payload);
+            if (HasShader(shader))
+                shader->SetUniform1f(command.id, command.value);
+            break;
+        }
+        case Type::SetUniform4f: {
+            const Uniform4fCommand command = Read<Uniform4fCommand>(payload);
+            if (HasShader(shader))
+                shader->SetUniform4f(command.id, command.value.x, command.value.y, command.value.z, command.value.w);
+            break;
+        }
+        case Type::SetUniformMat4f: {
+            const UniformMat4Command command = Read<UniformMat4Command>(payload);
+            if (HasShader(shader))
+                shader->SetUniformMat4f(command.id, command.matrix);
+            break;
+        }
+        case Type::BindTexture: {
+            const TextureCommand command = Read<TextureCommand>(payload);
+            command.texture->Bind(command.slot);
+            break;
+        }
+        case Type::BindMaterial: {
+            const MaterialCommand command = Read<MaterialCommand>(payload);
+            command.materials->Bind(command.slot);
+            break;
+        }
+        case Type::BindMesh: {
+            const MeshCommand command = Read<MeshCommand>(payload);
+            if (command.instanceBuffer != 0)
+                command.mesh->AttachInstanceBuffer(command.instanceBuffer);
+            command.mesh->BindGL();
+            break;
+        }
+        case Type::DrawMesh:
+            Read<MeshCommand>(payload).mesh->DrawBound();
+            break;
+        case Type::DrawInstanced: {
+            const InstancedCommand command = Read<InstancedCommand>(payload);
+            command.mesh->DrawInstanced(static_cast<GLsizei>(command.instanceCount), command.baseInstance);
+            break;
+        }
+        case Type::BindGeometry: {
+            const GeometryCommand command = Read<GeometryCommand>(payload);
+            command.geometry->Bind(command.page);
+            break;
+        }
+        case Type::DrawIndirect: {
+            const IndirectCommand command = Read<IndirectCommand>(payload);
+            command.geometry->DrawIndirect(command.firstCommand, command.count);
+            break;
+        }
+        default:
+            std::cerr << "[CommandList] Unknown command " << static_cast<uint32_t>(header.type) << std::endl;
+            return;
+        }
+    }
+}
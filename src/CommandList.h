@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "UniformId.h"
+#include "vendor/glm/glm.hpp"
+
+class GeometryBuffer;
+class MaterialBlocks;
+class Mesh;
+class Shader;
+class Texture;
+
+/**
+ * CommandList - draw commands recorded on any thread, executed on the GL thread
+ *
+ * Recording only appends small POD commands (the engine objects to bind, the
+ * uniform values, the draw ranges) to one linear byte buffer - no GL calls, no
+ * allocations once the buffer has grown to its working size. Worker threads
+ * each record into their own list; the GL thread then calls Execute() on the
+ * lists in order, which turns the commands into Shader / Texture / Mesh /
+ * GeometryBuffer calls. Redundant binds between the lists are dropped by
+ * GLState.
+ *
+ * Uniform commands apply to the shader of the last BindShader in the same
+ * list - a list that continues another list's shader binds it again first.
+ * Their UniformIds must be literals (the name is kept for error messages).
+ * The recorded objects must outlive Execute().
+ *
+ * Usage:
+ *   // worker thread
+ *   list.Reset();
+ *   list.BindShader(&shader);
+ *   list.SetUniformMat4f(kModel, transform);
+ *   list.BindMesh(&mesh);
+ *   list.DrawMesh(&mesh);
+ *   // GL thread, after the workers are done
+ *   list.Execute();
+ */
+class CommandList {
+public:
+    enum class Type : uint32_t {
+        BindShader,
+        SetUniform1i,
+        SetUniform1f,
+        SetUniform4f,
+        SetUniformMat4f,
+        BindTexture,
+        BindMaterial,
+        BindMesh,
+        DrawMesh,
+        DrawInstanced,
+        BindGeometry,
+        DrawIndirect
+    };
+
+    void BindShader(Shader* shader);
+    void SetUniform1i(UniformId id, int value);
+    void SetUniform1f(UniformId id, float value);
+    void SetUniform4f(UniformId id, const glm::vec4& value);
+    void SetUniformMat4f(UniformId id, const glm::mat4& matrix);
+    void BindTexture(const Texture* texture, unsigned int slot = 0);
+    void BindMaterial(MaterialBlocks* materials, int slot);
+    // instanceBuffer != 0 is attached to the mesh's VAO before it is bound
+    void BindMesh(const Mesh* mesh, unsigned int instanceBuffer = 0);
+    void DrawMesh(const Mesh* mesh);
+    void DrawInstanced(const Mesh* mesh, uint32_t instanceCount, uint32_t baseInstance);
+    void BindGeometry(const GeometryBuffer* geometry, uint32_t page);
+    // Commands [firstCommand, firstCommand + count) of the geometry buffer's indirect buffer
+    void DrawIndirect(const GeometryBuffer* geometry, size_t firstCommand, size_t count);
+
+    // GL thread only
+    void Execute() const;
+
+    // Keeps the memory for the next frame
+    inline void Reset() { m_Data.clear(); m_CommandCount = 0; }
+    inline bool IsEmpty() const { return m_CommandCount == 0; }
+    inline size_t GetCommandCount() const { return m_CommandCount; }
+    inline size_t GetSizeBytes() const { return m_Data.size(); }
+
+private:
+    struct Header {
+        Type type;
+        uint32_t size;      // Payload bytes that follow the header
+    };
+
+    template <typename T>
+    void Push(Type type, const T& payload) {
+        const Header header{ type, static_cast<uint32_t>(sizeof(T)) };
+        const size_t offset = m_Data.size();
+        m_Data.resize(offset + sizeof(header) + sizeof(T));
+        std::memcpy(m_Data.data() + offset, &header, sizeof(header));
+        std::memcpy(m_Data.data() + offset + sizeof(header), &payload, sizeof(T));
+        ++m_CommandCount;
+    }
+
+    std::vector<unsigned char> m_Data;
+    size_t m_CommandCount = 0;
+};
@@ -0,0 +1,433 @@
+#include "DynamicBVH.h"
+#include "BVHTraversal.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+inline AABB Union(const AABB& a, const AABB& b) {
+    return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+// Slab test, returns the entry distance or FLT_MAX on a miss
+inline float IntersectBox(const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection,
+                          float tMin, float tMax) {
+    const glm::vec3 t0 = (box.min - origin) * inverseDirection;
+    const glm::vec3 t1 = (box.max - origin) * inverseDirection;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+    const float entry = std::max(std::max(near.x, near.y), std::max(near.z, tMin));
+    const float exit = std::min(std::min(far.x, far.y), std::min(far.z, tMax));
+    return entry <= exit ? entry : FLT_MAX;
+}
+
+struct FrustumEntry {
+    int32_t node;
+    uint32_t planeMask;     // Planes the node still crosses - 0 = completely inside
+};
+
+} // namespace
+
+DynamicBVH::DynamicBVH(float margin)
+    : m_Root(kNull), m_FreeList(kNull), m_LeafCount(0), m_Margin(margin) {
+}
+
+int32_t DynamicBVH::Insert(const AABB& bounds, uint32_t userData) {
+    const int32_t leaf = AllocateNode();
+    Node& node = m_Nodes[leaf];
+    node.box = AABB(bounds.min - glm::vec3(m_Margin), bounds.max + glm::vec3(m_Margin));
+    node.userData = userData;
+    node.height = 0;
+    InsertLeaf(leaf);
+    ++m_LeafCount;
+    return leaf;
+}
+
+void DynamicBVH::Remove(int32_t proxy) {
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --m_LeafCount;
+}
+
+bool DynamicBVH::Move(int32_t proxy, const AABB& bounds, const glm::vec3& displacement) {
+    AABB fat(bounds.min - glm::vec3(m_Margin), bounds.max + glm::vec3(m_Margin));
+    fat.min += glm::min(displacement, glm::vec3(0.0f));
+    fat.max += glm::max(displacement, glm::vec3(0.0f));
+
+    // Still inside the fat box, and the fat box is not much larger than needed
+    // (an object that stopped would otherwise keep a huge box forever)
+    const AABB& current = m_Nodes[proxy].box;
+    if (current.Contains(bounds)) {
+        const AABB loose(fat.min - glm::vec3(4.0f * m_Margin), fat.max + glm::vec3(4.0f * m_Margin));
+        if (loose.Contains(current))
+            return false;
+    }
+
+    RemoveLeaf(proxy);
+    m_Nodes[proxy].box = fat;
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicBVH::Clear() {
+    m_Nodes.clear();
+    m_Root = kNull;
+    m_FreeList = kNull;
+    m_LeafCount = 0;
+}
+
+int32_t DynamicBVH::AllocateNode() {
+    int32_t index;
+    if (m_FreeList != kNull) {
+        index = m_FreeList;
+        m_FreeList = m_Nodes[index].parent;
+    } else {
+        index = static_cast<int32_t>(m_Nodes.size());
+        m_Nodes.emplace_back();
+    }
+    Node& node = m_Nodes[index];
+    node.parent = kNull;
+    node.child1 = kNull;
+    node.child2 = kNull;
+    node.height = 0;
+    node.userData = 0;
+    node.padding = 0;
+    return index;
+}
+
+void DynamicBVH::FreeNode(int32_t node) {
+    m_Nodes[node].parent = m_FreeList;
+    m_Nodes[node].height = -1;
+    m_FreeList = node;
+}
+
+void DynamicBVH::InsertLeaf(int32_t leaf) {
+    if (m_Root == kNull) {
+        m_Root = leaf;
+        m_Nodes[leaf].parent = kNull;
+        return;
+    }
+
+    // Walk down to the sibling with the smallest cost: the area of the new
+    // parent plus the area every ancestor grows by
+    const AABB leafBox = m_Nodes[leaf].box;
+    int32_t index = m_Root;
+    while (!m_Nodes[index].IsLeaf()) {
+        const Node& node = m_Nodes[index];
+        const float area = node.box.HalfArea();
+        const float combinedArea = Union(node.box, leafBox).HalfArea();
+        const float cost = 2.0f * combinedArea;                       // New parent here
+        const float inheritanceCost = 2.0f * (combinedArea - area);   // Growth of this node
+
+        float childCost[2];
+        const int32_t children[2] = { node.child1, node.child2 };
+        for (int i = 0; i < 2; ++i) {
+            const Node& child = m_Nodes[children[i]];
+            const float grown = Union(child.box, leafBox).HalfArea();
+            childCost[i] = (child.IsLeaf() ? grown : grown - child.box.HalfArea()) + inheritanceCost;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    const int32_t sibling = index;
+    const int32_t oldParent = m_Nodes[sibling].parent;
+    const int32_t newParent = AllocateNode();
+    Node& parent = m_Nodes[newParent];
+    parent.parent = oldParent;
+    parent.box = Union(leafBox, m_Nodes[sibling].box);
+    parent.height = m_Nodes[sibling].height + 1;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    m_Nodes[sibling].parent = newParent;
+    m_Nodes[leaf].parent = newParent;
+
+    if (oldParent == kNull) {
+        m_Root = newParent;
+    } else if (m_Nodes[oldParent].child1 == sibling) {
+        m_Nodes[oldParent].child1 = newParent;
+    } else {
+        m_Nodes[oldParent].child2 = newParent;
+    }
+
+    Refit(newParent);
+}
+
+void DynamicBVH::RemoveLeaf(int32_t leaf) {
+    if (leaf == m_Root) {
+        m_Root = kNull;
+        return;
+    }
+
+    const int32_t parent = m_Nodes[leaf].parent;
+    const int32_t grandParent = m_Nodes[parent].parent;
+    const int32_t sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+
+    if (grandParent == kNull) {
+        m_Root = sibling;
+        m_Nodes[sibling].parent = kNull;
+        FreeNode(parent);
+        return;
+    }
+
+    // The sibling takes the parent's place
+    if (m_Nodes[grandParent].child1 == parent)
+        m_Nodes[grandParent].child1 = sibling;
+    else
+        m_Nodes[grandParent].child2 = sibling;
+    m_Nodes[sibling].parent = grandParent;
+    FreeNode(parent);
+    Refit(grandParent);
+}
+
+void DynamicBVH::Refit(int32_t node) {
+    while (node != kNull) {
+        node = Balance(node);
+        Node& current = m_Nodes[node];
+        const Node& child1 = m_Nodes[current.child1];
+        const Node& child2 = m_Nodes[current.child2];
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.box = Union(child1.box, child2.box);
+        node = current.parent;
+    }
+}
+
+int32_t DynamicBVH::Balance(int32_t iA) {
+    Node& A = m_Nodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+        return iA;
+
+    const int32_t iB = A.child1;
+    const int32_t iC = A.child2;
+    Node& B = m_Nodes[iB];
+    Node& C = m_Nodes[iC];
+    const int32_t balance = C.height - B.height;
+
+    // Rotate the higher child up: it becomes the parent of A, A keeps the lower grandchild
+    if (balance > 1) {
+        const int32_t iF = C.child1;
+        const int32_t iG = C.child2;
+        Node& F = m_Nodes[iF];
+        Node& G = m_Nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if (C.parent == kNull)
+            m_Root = iC;
+        else if (m_Nodes[C.parent].child1 == iA)
+            m_Nodes[C.parent].child1 = iC;
+        else
+            m_Nodes[C.parent].child2 = iC;
+
+        if (F.height > G.height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = Union(B.box, G.box);
+            C.box = Union(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = Union(B.box, F.box);
+            C.box = Union(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    if (balance < -1) {
+        const int32_t iD = B.child1;
+        const int32_t iE = B.child2;
+        Node& D = m_Nodes[iD];
+        Node& E = m_Nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if (B.parent == kNull)
+            m_Root = iB;
+        else if (m_Nodes[B.parent].child1 == iA)
+            m_Nodes[B.parent].child1 = iB;
+        else
+            m_Nodes[B.parent].child2 = iB;
+
+        if (D.height > E.height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = Union(C.box, E.box);
+            B.box = Union(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = Union(C.box, D.box);
+            B.box = Union(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void DynamicBVH::QueryAABB(const AABB& box, std::vector<uint32_t>& out) const {
+    if (m_Root == kNull)
+        return;
+    NodeStack<int32_t> stack;
+    stack.Push(m_Root);
+    while (!stack.Empty()) {
+        const Node& node = m_Nodes[stack.Pop()];
+        if (!node.box.Overlaps(box))
+            continue;
+        if (node.IsLeaf()) {
+            out.push_back(node.userData);
+        } else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+void DynamicBVH::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+    if (m_Root == kNull)
+        return;
+    const float radiusSquared = radius * radius;
+    NodeStack<int32_t> stack;
+    stack.Push(m_Root);
+    while (!stack.Empty()) {
+        const Node& node = m_Nodes[stack.Pop()];
+        const glm::vec3 closest = glm::clamp(center, node.box.min, node.box.max);
+        const glm::vec3 delta = closest - center;
+        if (glm::dot(delta, delta) > radiusSquared)
+            continue;
+        if (node.IsLeaf()) {
+            out.push_back(node.userData);
+        } else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+void DynamicBVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const {
+    if (m_Root == kNull)
+        return;
+    constexpr uint32_t kAllPlanes = (1u << Frustum::PlaneCount) - 1;
+    NodeStack<FrustumEntry> stack;
+    stack.Push({ m_Root, kAllPlanes });
+    while (!stack.Empty()) {
+        const FrustumEntry entry = stack.Pop();
+        const Node& node = m_Nodes[entry.node];
+
+        uint32_t planeMask = entry.planeMask;
+        if (planeMask != 0) {
+            const glm::vec3 center = node.box.Center();
+            const glm::vec3 extents = node.box.Extents();
+            bool outside = false;
+            for (int i = 0; i < Frustum::PlaneCount && !outside; ++i) {
+                if (!(planeMask & (1u << i)))
+                    continue;
+                const glm::vec4& plane = frustum.planes[i];
+                const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+                if (distance + radius < 0.0f)
+                    outside = true;
+                else if (distance - radius >= 0.0f)
+                    planeMask &= ~(1u << i);    // Children are inside this plane too
+            }
+            if (outside)
+                continue;
+        }
+
+        if (node.IsLeaf()) {
+            out.push_back(node.userData);
+        } else {
+            stack.Push({ node.child1, planeMask });
+            stack.Push({ node.child2, planeMask });
+        }
+    }
+}
+
+bool DynamicBVH::Raycast(const Ray& ray, const RayTest& test, uint32_t& hitUserData, float& hitT) const {
+    if (m_Root == kNull)
+        return false;
+
+    const glm::vec3 inverseDirection = SafeInverse(ray.direction);
+    Ray candidate = ray;
+    bool hit = false;
+
+    NodeStack<int32_t> stack;
+    stack.Push(m_Root);
+    while (!stack.Empty()) {
+        const Node& node = m_Nodes[stack.Pop()];
+        const float entry = IntersectBox(node.box, ray.origin, inverseDirection, ray.tMin, candidate.tMax);
+        if (entry == FLT_MAX)
+            continue;
+
+        if (node.IsLeaf()) {
+            const float t = test ? test(node.userData, candidate) : entry;
+            if (t >= ray.tMin && t <= candidate.tMax) {
+                candidate.tMax = t;
+                hitUserData = node.userData;
+                hitT = t;
+                hit = true;
+            }
+            continue;
+        }
+
+        // Nearer child on top of the stack - its hits shorten the ray for the other one
+        const float entry1 = IntersectBox(m_Nodes[node.child1].box, ray.origin, inverseDirection, ray.tMin, candidate.tMax);
+        const float entry2 = IntersectBox(m_Nodes[node.child2].box, ray.origin, inverseDirection, ray.tMin, candidate.tMax);
+        if (entry1 <= entry2) {
+            if (entry2 != FLT_MAX) stack.Push(node.child2);
+            stack.Push(node.child1);
+        } else {
+            if (entry1 != FLT_MAX) stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+    return hit;
+}
+
+bool DynamicBVH::Validate() const {
+    if (m_Root == kNull)
+        return m_LeafCount == 0;
+    if (m_Nodes[m_Root].parent != kNull) {
+        std::cerr << "[DynamicBVH] Root has a parent" << std::endl;
+        return false;
+    }
+    return ValidateNode(m_Root, kNull);
+}
+
+bool DynamicBVH::ValidateNode(int32_t index, int32_t parent) const {
+    const Node& node = m_Nodes[index];
+    if (node.parent != parent) {
+        std::cerr << "[DynamicBVH] Node " << index << " has a wrong parent link" << std::endl;
+        return false;
+    }
+    if (node.IsLeaf())
+        return node.height == 0;
+
+    const Node& child1 = m_Nodes[node.child1];
+    const Node& child2 = m_Nodes[node.child2];
+    if (node.height != 1 + std::max(child1.height, child2.height)) {
+        std::cerr << "[DynamicBVH] Node " << index << " has a wrong height" << std::endl;
+        return false;
+    }
+    if (!node.box.Contains(child1.box) || !node.box.Contains(child2.box)) {
+        std::cerr << "[DynamicBVH] Node " << index << " does not contain its children" << std::endl;
+        return false;
+    }
+    return ValidateNode(node.child1, index) && ValidateNode(node.child2, index);
+}
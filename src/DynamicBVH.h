@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Bounds.h"
+#include "MeshBVH.h"
+#include "vendor/glm/glm.hpp"
+
+/**
+ * DynamicBVH - scene index for objects that move, appear and disappear
+ *
+ * Incremental AABB tree (in the style of Box2D / Bullet "dbvt"): every object
+ * is a leaf with a fat box (bounds + margin), interior nodes bound their two
+ * children. Insert() picks the sibling with the smallest surface area cost,
+ * Remove() splices the leaf out, and both refit and rebalance (AVL rotations)
+ * on the way up - O(log n) each. Move() does nothing while the object stays
+ * inside its fat box, so slowly moving entities rarely touch the tree.
+ *
+ * Nodes live in one array (48 bytes each) with a free list; proxies are
+ * node indices and stay valid until Remove().
+ *
+ * Queries return the userData of every leaf whose fat box matches, so they
+ * are conservative by up to the margin (+ predicted displacement); callers
+ * that need exact answers test the returned objects themselves. Queries are
+ * const and may run concurrently; Insert / Remove / Move may not.
+ *
+ * Usage:
+ *   DynamicBVH scene;
+ *   int32_t proxy = scene.Insert(enemy.GetBounds(), enemyIndex);
+ *   scene.Move(proxy, enemy.GetBounds(), enemy.GetVelocity() * deltaTime);
+ *   scene.QueryFrustum(Frustum::FromMatrix(projection * view), visible);
+ *   scene.QuerySphere(player.GetPosition(), 5.0f, nearby);
+ *   scene.Remove(proxy);
+ */
+class DynamicBVH {
+public:
+    static constexpr int32_t kNull = -1;
+
+    // Exact test of one candidate: the hit distance along the ray, or a negative value for a miss
+    using RayTest = std::function<float(uint32_t userData, const Ray& ray)>;
+
+    struct Node {
+        AABB box;               // Fat box of a leaf, union of the children otherwise
+        int32_t parent;         // Next free node while on the free list
+        int32_t child1;
+        int32_t child2;
+        int32_t height;         // 0 for leaves, -1 for free nodes
+        uint32_t userData;
+        uint32_t padding;
+
+        inline bool IsLeaf() const { return child1 == kNull; }
+    };
+
+    explicit DynamicBVH(float margin = 0.25f);
+
+    // Returns the proxy of the new leaf
+    int32_t Insert(const AABB& bounds, uint32_t userData);
+    void Remove(int32_t proxy);
+    // The fat box is extended along displacement (expected motion until the next call).
+    // Returns true if the leaf had to be re-inserted.
+    bool Move(int32_t proxy, const AABB& bounds, const glm::vec3& displacement = glm::vec3(0.0f));
+    void Clear();
+
+    void QueryAABB(const AABB& box, std::vector<uint32_t>& out) const;
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+    // Subtrees completely inside the frustum are collected without further tests
+    void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+    // Closest hit within [ray.tMin, ray.tMax]. Without a test the fat leaf box counts as the hit.
+    bool Raycast(const Ray& ray, const RayTest& test, uint32_t& hitUserData, float& hitT) const;
+
+    inline uint32_t GetUserData(int32_t proxy) const { return m_Nodes[proxy].userData; }
+    inline const AABB& GetFatBounds(int32_t proxy) const { return m_Nodes[proxy].box; }
+    inline size_t GetCount() const { return m_LeafCount; }
+    inline int GetHeight() const { return m_Root == kNull ? 0 : m_Nodes[m_Root].height; }
+    inline float GetMargin() const { return m_Margin; }
+
+    // Checks parent links, heights and boxes (debugging aid); false and a message on the first error
+    bool Validate() const;
+
+private:
+    int32_t AllocateNode();
+    void FreeNode(int32_t node);
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+    // Refits boxes and heights from node to the root, rotating where unbalanced
+    void Refit(int32_t node);
+    int32_t Balance(int32_t node);
+    bool ValidateNode(int32_t node, int32_t parent) const;
+
+    std::vector<Node> m_Nodes;
+    int32_t m_Root;
+    int32_t m_FreeList;
+    size_t m_LeafCount;
+    float m_Margin;
+};
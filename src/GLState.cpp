@@ -0,0 +1,154 @@
+#include "GLState.h"
+
+// Everything starts unknown - the first call of each kind reaches GL
+unsigned int GLState::s_Program = GLState::kUnknown;
+unsigned int GLState::s_VertexArray = GLState::kUnknown;
+unsigned int GLState::s_Buffers[GLState::kBufferTargetCount] = {
+    kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown
+};
+GLState::RangeBinding GLState::s_UniformBindings[GLState::kUniformBindings];
+unsigned int GLState::s_ActiveTexture = GLState::kUnknown;
+unsigned int GLState::s_Textures[GLState::kTextureUnits] = {
+    kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown,
+    kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown
+};
+uint8_t GLState::s_Capabilities[GLState::kCapabilityCount] = {
+    kUnknownFlag, kUnknownFlag, kUnknownFlag, kUnknownFlag
+};
+unsigned int GLState::s_DepthFunc = GLState::kUnknown;
+uint8_t GLState::s_DepthMask = GLState::kUnknownFlag;
+unsigned int GLState::s_BlendSource = GLState::kUnknown;
+unsigned int GLState::s_BlendDestination = GLState::kUnknown;
+GLState::Stats GLState::s_Frame;
+GLState::Stats GLState::s_LastFrame;
+
+void GLState::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    if (target == GL_UNIFORM_BUFFER && index < kUniformBindings) {
+        RangeBinding& binding = s_UniformBindings[index];
+        if (binding.buffer == buffer && binding.offset == offset && binding.size == size) {
+            ++s_Frame.filtered;
+            return;
+        }
+        binding = { buffer, offset, size };
+    }
+    const int slot = BufferSlot(target);
+    if (slot >= 0)
+        s_Buffers[slot] = buffer;
+    ++s_Frame.issued;
+    GLCall(glBindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size)));
+}
+
+void GLState::BindBufferBase(unsigned int target, unsigned int index, unsigned int buffer) {
+    // Size 0 stands for "whole buffer" - a range binding never has it
+    if (target == GL_UNIFORM_BUFFER && index < kUniformBindings) {
+        RangeBinding& binding = s_UniformBindings[index];
+        if (binding.buffer == buffer && binding.offset == 0 && binding.size == 0) {
+            ++s_Frame.filtered;
+            return;
+        }
+        binding = { buffer, 0, 0 };
+    }
+    const int slot = BufferSlot(target);
+    if (slot >= 0)
+        s_Buffers[slot] = buffer;
+    ++s_Frame.issued;
+    GLCall(glBindBufferBase(target, index, buffer));
+}
+
+void GLState::DepthFunc(unsigned int func) {
+    if (s_DepthFunc == func) {
+        ++s_Frame.filtered;
+        return;
+    }
+    s_DepthFunc = func;
+    ++s_Frame.issued;
+    GLCall(glDepthFunc(func));
+}
+
+void GLState::DepthMask(bool write) {
+    const uint8_t value = write ? 1 : 0;
+    if (s_DepthMask == value) {
+        ++s_Frame.filtered;
+        return;
+    }
+    s_DepthMask = value;
+    ++s_Frame.issued;
+    GLCall(glDepthMask(write ? GL_TRUE : GL_FALSE));
+}
+
+void GLState::BlendFunc(unsigned int source, unsigned int destination) {
+    if (s_BlendSource == source && s_BlendDestination == destination) {
+        ++s_Frame.filtered;
+        return;
+    }
+    s_BlendSource = source;
+    s_BlendDestination = destination;
+    ++s_Frame.issued;
+    GLCall(glBlendFunc(source, destination));
+}
+
+void GLState::DeleteBuffer(unsigned int buffer) {
+    if (buffer == 0)
+        return;
+    GLCall(glDeleteBuffers(1, &buffer));
+    for (unsigned int& bound : s_Buffers) {
+        if (bound == buffer)
+            bound = kUnknown;
+    }
+    for (RangeBinding& binding : s_UniformBindings) {
+        if (binding.buffer == buffer)
+            binding.buffer = kUnknown;
+    }
+}
+
+void GLState::DeleteVertexArray(unsigned int vertexArray) {
+    if (vertexArray == 0)
+        return;
+    GLCall(glDeleteVertexArrays(1, &vertexArray));
+    if (s_VertexArray == vertexArray) {
+        s_VertexArray = kUnknown;
+        s_Buffers[kElementArray] = kUnknown;
+    }
+}
+
+void GLState::DeleteTexture(unsigned int texture) {
+    if (texture == 0)
+        return;
+    GLCall(glDeleteTextures(1, &texture));
+    for (unsigned int& bound : s_Textures) {
+        if (bound == texture)
+            bound = kUnknown;
+    }
+}
+
+void GLState::DeleteProgram(unsigned int program) {
+    if (program == 0)
+        return;
+    GLCall(glDeleteProgram(program));
+    if (s_Program == program)
+        s_Program = kUnknown;
+}
+
+void GLState::Invalidate() {
+    s_Program = kUnknown;
+    s_VertexArray = kUnknown;
+    for (unsigned int& bound : s_Buffers)
+        bound = kUnknown;
+    for (RangeBinding& binding : s_UniformBindings)
+        binding = RangeBinding();
+    s_ActiveTexture = kUnknown;
+    for (unsigned int& bound : s_Textures)
+        bound = kUnknown;
+    for (uint8_t& capability : s_Capabilities)
+        capability = kUnknownFlag;
+    s_DepthFunc = kUnknown;
+    s_DepthMask = kUnknownFlag;
+    s_BlendSource = kUnknown;
+    s_BlendDestination = kUnknown;
+}
+
+GLState::Stats GLState::EndFrame() {
+    s_LastFrame = s_Frame;
+    s_Frame = Stats();
+    return s_LastFrame;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include "Debug.h"
+
+/**
+ * GLState - shadow copy of the GL binding state that drops redundant calls
+ *
+ * Tracks the program, vertex array, the buffer targets the renderer uses,
+ * the indexed uniform buffer bindings, GL_TEXTURE_2D per texture unit and the
+ * depth / blend state. A call that would set what is already set returns after
+ * one compare; everything else goes to GL and updates the copy. The checks are
+ * inline, so the cache stays on in release builds.
+ *
+ * All binds of tracked state must go through GLState, otherwise the copy goes
+ * stale - after code that talks to GL directly call Invalidate(). Objects are
+ * deleted through GLState as well (DeleteBuffer() etc.), because GL unbinds
+ * them. The element array binding belongs to the vertex array and is
+ * forgotten whenever the vertex array changes.
+ *
+ * GL thread only. Untracked targets / capabilities are passed through.
+ *
+ * Usage:
+ *   GLState::UseProgram(program);
+ *   GLState::BindVertexArray(vao);
+ *   GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+ *   GLState::Enable(GL_DEPTH_TEST);
+ *   GLState::Stats frame = GLState::EndFrame();   // once per frame
+ */
+class GLState {
+public:
+    static constexpr unsigned int kUnknown = 0xFFFFFFFFu;
+    static constexpr unsigned int kTextureUnits = 16;
+    static constexpr unsigned int kUniformBindings = 8;
+
+    struct Stats {
+        size_t issued = 0;          // Calls that reached GL
+        size_t filtered = 0;        // Calls dropped because nothing would change
+    };
+
+    static inline void UseProgram(unsigned int program) {
+        if (s_Program == program) {
+            ++s_Frame.filtered;
+            return;
+        }
+        s_Program = program;
+        ++s_Frame.issued;
+        GLCall(glUseProgram(program));
+    }
+
+    static inline void BindVertexArray(unsigned int vertexArray) {
+        if (s_VertexArray == vertexArray) {
+            ++s_Frame.filtered;
+            return;
+        }
+        s_VertexArray = vertexArray;
+        s_Buffers[kElementArray] = kUnknown;
+        ++s_Frame.issued;
+        GLCall(glBindVertexArray(vertexArray));
+    }
+
+    static inline void BindBuffer(unsigned int target, unsigned int buffer) {
+        const int slot = BufferSlot(target);
+        if (slot >= 0) {
+            if (s_Buffers[slot] == buffer) {
+                ++s_Frame.filtered;
+                return;
+            }
+            s_Buffers[slot] = buffer;
+        }
+        ++s_Frame.issued;
+        GLCall(glBindBuffer(target, buffer));
+    }
+
+    // Also sets the generic binding of the target, like GL does
+    static void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+    static void BindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+
+    // Binds on the given unit; glActiveTexture only goes out when the binding changes
+    static inline void BindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+        if (target == GL_TEXTURE_2D && unit < kTextureUnits) {
+            if (s_Textures[unit] == texture) {
+                ++s_Frame.filtered;
+                return;
+            }
+            s_Textures[unit] = texture;
+        }
+        ActiveTexture(unit);
+        ++s_Frame.issued;
+        GLCall(glBindTexture(target, texture));
+    }
+
+    // Binds on the active unit (texture creation / uploads)
+    static inline void BindTexture(unsigned int target, unsigned int texture) {
+        BindTexture(s_ActiveTexture < kTextureUnits ? s_ActiveTexture : 0, target, texture);
+    }
+
+    static inline void ActiveTexture(unsigned int unit) {
+        if (s_ActiveTexture == unit) {
+            ++s_Frame.filtered;
+            return;
+        }
+        s_ActiveTexture = unit;
+        ++s_Frame.issued;
+        GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+    }
+
+    static inline void Enable(unsigned int capability) { SetCapability(capability, true); }
+    static inline void Disable(unsigned int capability) { SetCapability(capability, false); }
+
+    static inline void SetCapability(unsigned int capability, bool enabled) {
+        const int slot = CapabilitySlot(capability);
+        const uint8_t value = enabled ? 1 : 0;
+        if (slot >= 0) {
+            if (s_Capabilities[slot] == value) {
+                ++s_Frame.filtered;
+                return;
+            }
+            s_Capabilities[slot] = value;
+        }
+        ++s_Frame.issued;
+        if (enabled) {
+            GLCall(glEnable(capability));
+        } else {
+            GLCall(glDisable(capability));
+        }
+    }
+
+    static void DepthFunc(unsigned int func);
+    static void DepthMask(bool write);
+    static void BlendFunc(unsigned int source, unsigned int destination);
+
+    // Delete and forget: GL unbinds deleted objects, the next bind of the name must go out
+    static void DeleteBuffer(unsigned int buffer);
+    static void DeleteVertexArray(unsigned int vertexArray);
+    static void DeleteTexture(unsigned int texture);
+    static void DeleteProgram(unsigned int program);
+
+    // Forget everything: the next call of each kind reaches GL
+    static void Invalidate();
+
+    // Counters of the frame that just ended; resets them
+    static Stats EndFrame();
+    static inline const Stats& GetLastFrameStats() { return s_LastFrame; }
+
+private:
+    enum BufferTarget {
+        kArray, kElementArray, kCopyRead, kCopyWrite, kPixelUnpack, kUniform, kDrawIndirect, kBufferTargetCount
+    };
+    enum Capability { kDepthTest, kBlend, kCullFace, kFramebufferSrgb, kCapabilityCount };
+
+    static inline int BufferSlot(unsigned int target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER:           return kArray;
+            case GL_ELEMENT_ARRAY_BUFFER:   return kElementArray;
+            case GL_COPY_READ_BUFFER:       return kCopyRead;
+            case GL_COPY_WRITE_BUFFER:      return kCopyWrite;
+            case GL_PIXEL_UNPACK_BUFFER:    return kPixelUnpack;
+            case GL_UNIFORM_BUFFER:         return kUniform;
+            case GL_DRAW_INDIRECT_BUFFER:   return kDrawIndirect;
+            default:                        return -1;
+        }
+    }
+
+    static inline int CapabilitySlot(unsigned int capability) {
+        switch (capability) {
+            case GL_DEPTH_TEST:         return kDepthTest;
+            case GL_BLEND:              return kBlend;
+            case GL_CULL_FACE:          return kCullFace;
+            case GL_FRAMEBUFFER_SRGB:   return kFramebufferSrgb;
+            default:                    return -1;
+        }
+    }
+
+    struct RangeBinding {
+        unsigned int buffer = kUnknown;
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    static constexpr uint8_t kUnknownFlag = 2;
+
+    static unsigned int s_Program;
+    static unsigned int s_VertexArray;
+    static unsigned int s_Buffers[kBufferTargetCount];
+    static RangeBinding s_UniformBindings[kUniformBindings];
+    static unsigned int s_ActiveTexture;
+    static unsigned int s_Textures[kTextureUnits];
+    static uint8_t s_Capabilities[kCapabilityCount];
+    static unsigned int s_DepthFunc;
+    static uint8_t s_DepthMask;
+    static unsigned int s_BlendSource;
+    static unsigned int s_BlendDestination;
+
+    static Stats s_Frame;
+    static Stats s_LastFrame;
+};
@@ -0,0 +1,183 @@
+#include "GeometryBuffer.h"
+#include "Debug.h"
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "UploadRing.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr GLsizei kVertexStride = 8 * sizeof(float);   // x, y, z, u, v, r, g, b - as Mesh::SetupGL
+
+} // namespace
+
+GeometryBuffer::GeometryBuffer()
+    : m_CommandBuffer(0), m_CommandSource(0), m_CommandOffset(0), m_InstanceBuffer(0), m_CommandCapacity(0) {
+}
+
+GeometryBuffer::~GeometryBuffer() {
+    Clear();
+    if (m_CommandBuffer != 0) {
+        GLState::DeleteBuffer(m_CommandBuffer);
+    }
+}
+
+uint32_t GeometryBuffer::AcquirePage(unsigned int vertexBuffer, unsigned int indexBuffer) {
+    for (uint32_t i = 0; i < m_Pages.size(); ++i) {
+        if (m_Pages[i].vertexArray != 0 && m_Pages[i].vertexBuffer == vertexBuffer && m_Pages[i].indexBuffer == indexBuffer)
+            return i;
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_Pages.size());
+    if (!m_FreePages.empty()) {
+        index = m_FreePages.back();
+        m_FreePages.pop_back();
+    } else {
+        m_Pages.emplace_back();
+    }
+    Page& page = m_Pages[index];
+    page.vertexBuffer = vertexBuffer;
+    page.indexBuffer = indexBuffer;
+    page.meshCount = 0;
+
+    // Offsets 0: meshes are reached through firstIndex / baseVertex
+    GLCall(glGenVertexArrays(1, &page.vertexArray));
+    GLState::BindVertexArray(page.vertexArray);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    GLCall(glEnableVertexAttribArray(0));
+    GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, kVertexStride, reinterpret_cast<void*>(0)));
+    GLCall(glEnableVertexAttribArray(1));
+    GLCall(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, kVertexStride, reinterpret_cast<void*>(3 * sizeof(float))));
+    GLCall(glEnableVertexAttribArray(2));
+    GLCall(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, kVertexStride, reinterpret_cast<void*>(5 * sizeof(float))));
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    if (m_InstanceBuffer != 0)
+        InstanceBuffer::SetupAttributes(m_InstanceBuffer);
+    GLState::BindVertexArray(0);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    return index;
+}
+
+void GeometryBuffer::ReleasePage(uint32_t index) {
+    Page& page = m_Pages[index];
+    if (--page.meshCount > 0)
+        return;
+    GLState::DeleteVertexArray(page.vertexArray);
+    page = Page();
+    m_FreePages.push_back(index);
+}
+
+bool GeometryBuffer::Add(const Mesh& mesh) {
+    if (!mesh.HasGL() || mesh.GetIndexCount() == 0) {
+        std::cerr << "[GeometryBuffer] Mesh has no GL buffers - call SetupGL() first" << std::endl;
+        return false;
+    }
+    if (m_Meshes.count(&mesh))
+        return true;
+    if (mesh.m_geometryBuffer) {
+        std::cerr << "[GeometryBuffer] Mesh is already in another GeometryBuffer" << std::endl;
+        return false;
+    }
+    if (!mesh.m_vertexArena || !mesh.m_indexArena) {
+        std::cerr << "[GeometryBuffer] Mesh is not in the buffer arenas - it is drawn on its own" << std::endl;
+        return false;
+    }
+
+    const uint32_t page = AcquirePage(mesh.GetVertexBufferID(), mesh.GetIndexBufferID());
+    ++m_Pages[page].meshCount;
+    m_Meshes[&mesh] = page;
+    mesh.m_geometryBuffer = this;
+    return true;
+}
+
+void GeometryBuffer::Remove(const Mesh& mesh) {
+    auto it = m_Meshes.find(&mesh);
+    if (it == m_Meshes.end())
+        return;
+    ReleasePage(it->second);
+    m_Meshes.erase(it);
+    mesh.m_geometryBuffer = nullptr;
+}
+
+void GeometryBuffer::Clear() {
+    for (const auto& entry : m_Meshes)
+        entry.first->m_geometryBuffer = nullptr;
+    m_Meshes.clear();
+    for (const Page& page : m_Pages) {
+        if (page.vertexArray != 0) {
+            GLState::DeleteVertexArray(page.vertexArray);
+        }
+    }
+    m_Pages.clear();
+    m_FreePages.clear();
+}
+
+bool GeometryBuffer::Find(const Mesh* mesh, GeometryRange& range) const {
+    auto it = m_Meshes.find(mesh);
+    if (it == m_Meshes.end())
+        return false;
+    // Offsets are read now - Defragment() may have moved the mesh since Add()
+    range.page = it->second;
+    range.firstIndex = static_cast<uint32_t>(mesh->GetIndexBufferOffset() / sizeof(GLuint));
+    range.indexCount = static_cast<uint32_t>(mesh->GetIndexCount());
+    range.baseVertex = static_cast<int32_t>(mesh->GetVertexBufferOffset() / kVertexStride);
+    range.vertexCount = static_cast<uint32_t>(mesh->GetVertexCount());
+    return true;
+}
+
+void GeometryBuffer::AttachInstanceBuffer(unsigned int buffer) {
+    if (buffer == m_InstanceBuffer)
+        return;
+    m_InstanceBuffer = buffer;
+    for (const Page& page : m_Pages) {
+        if (page.vertexArray == 0)
+            continue;
+        GLState::BindVertexArray(page.vertexArray);
+        InstanceBuffer::SetupAttributes(buffer);
+    }
+    GLState::BindVertexArray(0);
+}
+
+void GeometryBuffer::Bind(uint32_t page) const {
+    GLState::BindVertexArray(m_Pages[page].vertexArray);
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandSource);
+}
+
+void GeometryBuffer::UploadCommands(const DrawElementsIndirectCommand* commands, size_t count, UploadRing* ring) {
+    if (ring && count > 0) {
+        const RingAllocation allocation = ring->Allocate(count * sizeof(DrawElementsIndirectCommand), sizeof(uint32_t));
+        if (allocation) {
+            std::memcpy(allocation.data, commands, allocation.size);
+            m_CommandSource = allocation.buffer;
+            m_CommandOffset = allocation.offset;
+            return;
+        }
+    }
+
+    if (m_CommandBuffer == 0) {
+        GLCall(glGenBuffers(1, &m_CommandBuffer));
+    }
+    if (count > m_CommandCapacity || m_CommandCapacity == 0)
+        m_CommandCapacity = count + count / 2 + 64;
+
+    // Orphaned like InstanceBuffer::Upload - last frame's draws may still read the old storage
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+    GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, m_CommandCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW));
+    if (count > 0) {
+        GLCall(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, count * sizeof(DrawElementsIndirectCommand), commands));
+    }
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_CommandSource = m_CommandBuffer;
+    m_CommandOffset = 0;
+}
+
+void GeometryBuffer::DrawIndirect(size_t firstCommand, size_t count) const {
+    if (count == 0)
+        return;
+    const size_t offset = m_CommandOffset + firstCommand * sizeof(DrawElementsIndirectCommand);
+    GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset),
+                                       static_cast<GLsizei>(count), 0));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Mesh;
+class UploadRing;
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    uint32_t count;             // Indices per instance
+    uint32_t instanceCount;
+    uint32_t firstIndex;        // Into the shared index buffer
+    int32_t baseVertex;         // Added to every index
+    uint32_t baseInstance;      // First InstanceData of the draw
+};
+
+// Where a mesh lives in its arena page, in the units glMultiDrawElementsIndirect expects
+struct GeometryRange {
+    uint32_t page = 0;          // Bind(page) before drawing
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+};
+
+/**
+ * GeometryBuffer - one VAO per GpuBufferArena page for multi-draw-indirect
+ *
+ * Meshes uploaded to the buffer arenas (Mesh::SetBufferArenas) already share a
+ * few large vertex and index buffers. Add() does not copy anything: it makes
+ * sure there is a VAO over the mesh's vertex page and index page and remembers
+ * which one. Find() turns the mesh's arena offsets into firstIndex / baseVertex,
+ * so the RenderQueue draws all runs with the same shader, texture and page with
+ * one glMultiDrawElementsIndirect: UploadCommands() once per frame, then
+ * Bind(page) and DrawIndirect() per bucket.
+ *
+ * Per-draw data (model matrix, tint) is read from the instance attributes:
+ * each command's baseInstance points at its InstanceData. GLSL 3.30 has no
+ * gl_DrawID, and baseInstance also lets one command draw many instances.
+ *
+ * GpuBufferArena::Defragment() moves meshes within their page, so ranges are
+ * looked up every frame rather than cached. The geometry stays owned by the
+ * mesh: Remove() only forgets it (and drops the page VAO once no mesh uses it),
+ * and Mesh::DestroyGL() removes the mesh before it frees its arena range.
+ * Meshes with their own buffers (arenas not set or full) cannot be added and
+ * are drawn on their own. A mesh can be in one GeometryBuffer at a time.
+ * Must be destroyed before the arenas. Main thread only, needs GL 4.3.
+ */
+class GeometryBuffer {
+public:
+    GeometryBuffer();
+    ~GeometryBuffer();
+
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+    // False if the mesh has no GL buffers or does not live in the buffer arenas
+    bool Add(const Mesh& mesh);
+    void Remove(const Mesh& mesh);
+    void Clear();
+
+    // False if the mesh was not added
+    bool Find(const Mesh* mesh, GeometryRange& range) const;
+
+    // Points the per-instance attributes of every page VAO at an InstanceBuffer
+    void AttachInstanceBuffer(unsigned int buffer);
+    void Bind(uint32_t page) const;
+
+    // Replaces the frame's indirect commands - written into ring if it has room,
+    // else into an own buffer orphaned each frame
+    void UploadCommands(const DrawElementsIndirectCommand* commands, size_t count, UploadRing* ring = nullptr);
+    // Draws commands [firstCommand, firstCommand + count) - Bind() their page first
+    void DrawIndirect(size_t firstCommand, size_t count) const;
+
+    inline size_t GetMeshCount() const { return m_Meshes.size(); }
+    inline size_t GetPageCount() const { return m_Pages.size() - m_FreePages.size(); }
+
+private:
+    // VAO over one vertex page and one index page
+    struct Page {
+        unsigned int vertexArray = 0;   // 0 = unused slot
+        unsigned int vertexBuffer = 0;
+        unsigned int indexBuffer = 0;
+        size_t meshCount = 0;
+    };
+
+    uint32_t AcquirePage(unsigned int vertexBuffer, unsigned int indexBuffer);
+    void ReleasePage(uint32_t page);
+
+    std::vector<Page> m_Pages;
+    std::vector<uint32_t> m_FreePages;
+    unsigned int m_CommandBuffer;
+    unsigned int m_CommandSource;   // Buffer of the current commands: m_CommandBuffer or the ring's
+    size_t m_CommandOffset;         // Byte offset of the first command in it
+    unsigned int m_InstanceBuffer;  // Attached instance buffer, 0 = none
+    size_t m_CommandCapacity;       // In commands
+    std::unordered_map<const Mesh*, uint32_t> m_Meshes;    // Page of each mesh
+};
@@ -0,0 +1,192 @@
+#include "GpuBufferArena.h"
+#include "Debug.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+// All buffer operations go through the copy targets: binding GL_ELEMENT_ARRAY_BUFFER
+// would change the element buffer of whatever VAO is bound.
+
+GpuBufferArena::GpuBufferArena(const std::string& name, size_t pageSize)
+    : m_Name(name), m_PageSize(pageSize), m_PeakUsed(0), m_BytesMoved(0) {
+}
+
+GpuBufferArena::~GpuBufferArena() {
+    for (const auto& page : m_Pages) {
+        GLState::DeleteBuffer(page->buffer);
+    }
+}
+
+GpuBufferArena::Page* GpuBufferArena::CreatePage(size_t size) {
+    auto page = std::make_unique<Page>();
+    GLCall(glGenBuffers(1, &page->buffer));
+    if (page->buffer == 0) {
+        std::cerr << "[GpuBufferArena] " << m_Name << ": glGenBuffers failed" << std::endl;
+        return nullptr;
+    }
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page->buffer);
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    page->allocator.Reset(size);
+
+    std::cout << "[GpuBufferArena] " << m_Name << ": page " << m_Pages.size() << " with "
+              << (size >> 10) << " KB" << std::endl;
+    m_Pages.push_back(std::move(page));
+    return m_Pages.back().get();
+}
+
+GpuBufferArena::Handle GpuBufferArena::NewHandle() {
+    if (!m_FreeHandles.empty()) {
+        const Handle handle = m_FreeHandles.back();
+        m_FreeHandles.pop_back();
+        return handle;
+    }
+    m_Slots.emplace_back();
+    return static_cast<Handle>(m_Slots.size() - 1);
+}
+
+void GpuBufferArena::SetOwner(Page& page, uint32_t block, Handle handle) {
+    if (block >= page.owners.size())
+        page.owners.resize(block + 1, kInvalidHandle);
+    page.owners[block] = handle;
+}
+
+GpuBufferArena::Handle GpuBufferArena::Allocate(size_t size, size_t alignment) {
+    uint32_t pageIndex = 0;
+    uint32_t block = TlsfAllocator::kInvalidBlock;
+    for (; pageIndex < m_Pages.size(); ++pageIndex) {
+        block = m_Pages[pageIndex]->allocator.Allocate(size, alignment);
+        if (block != TlsfAllocator::kInvalidBlock)
+            break;
+    }
+    if (block == TlsfAllocator::kInvalidBlock) {
+        const size_t granularity = TlsfAllocator::kGranularity;
+        const size_t needed = (size + alignment + granularity - 1) & ~(granularity - 1);
+        Page* page = CreatePage(std::max(m_PageSize, needed));
+        if (!page)
+            return kInvalidHandle;
+        pageIndex = static_cast<uint32_t>(m_Pages.size() - 1);
+        block = page->allocator.Allocate(size, alignment);
+        if (block == TlsfAllocator::kInvalidBlock)
+            return kInvalidHandle;
+    }
+
+    const Handle handle = NewHandle();
+    m_Slots[handle] = { pageIndex, block, static_cast<uint32_t>(alignment) };
+    SetOwner(*m_Pages[pageIndex], block, handle);
+
+    size_t used = 0;
+    for (const auto& page : m_Pages)
+        used += page->allocator.GetUsed();
+    m_PeakUsed = std::max(m_PeakUsed, used);
+    return handle;
+}
+
+void GpuBufferArena::Free(Handle handle) {
+    if (handle >= m_Slots.size() || m_Slots[handle].block == TlsfAllocator::kInvalidBlock)
+        return;
+    Slot& slot = m_Slots[handle];
+    Page& page = *m_Pages[slot.page];
+    page.owners[slot.block] = kInvalidHandle;
+    page.allocator.Free(slot.block);
+    slot.block = TlsfAllocator::kInvalidBlock;
+    m_FreeHandles.push_back(handle);
+}
+
+void GpuBufferArena::Upload(Handle handle, const void* data, size_t size) {
+    const Slot& slot = m_Slots[handle];
+    const Page& page = *m_Pages[slot.page];
+    ASSERT(size <= page.allocator.GetSize(slot.block));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+    GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, page.allocator.GetOffset(slot.block), size, data));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+unsigned int GpuBufferArena::GetBuffer(Handle handle) const {
+    return m_Pages[m_Slots[handle].page]->buffer;
+}
+
+size_t GpuBufferArena::GetOffset(Handle handle) const {
+    const Slot& slot = m_Slots[handle];
+    return m_Pages[slot.page]->allocator.GetOffset(slot.block);
+}
+
+size_t GpuBufferArena::GetSize(Handle handle) const {
+    const Slot& slot = m_Slots[handle];
+    return m_Pages[slot.page]->allocator.GetSize(slot.block);
+}
+
+size_t GpuBufferArena::Defragment(size_t maxBytes) {
+    size_t moved = 0;
+    for (uint32_t pageIndex = 0; pageIndex < m_Pages.size() && moved < maxBytes; ++pageIndex) {
+        Page& page = *m_Pages[pageIndex];
+        TlsfAllocator& allocator = page.allocator;
+        bool bound = false;
+
+        while (moved < maxBytes) {
+            // Only worth it while the free space is split up
+            if (allocator.GetFree() == 0 || allocator.GetLargestFreeBlock() == allocator.GetFree())
+                break;
+            const uint32_t last = allocator.GetLastUsedBlock();
+            if (last == TlsfAllocator::kInvalidBlock)
+                break;
+            const Handle handle = page.owners[last];
+            const size_t size = allocator.GetSize(last);
+            const size_t oldOffset = allocator.GetOffset(last);
+
+            // The old range is still allocated, so the new one cannot overlap it
+            const uint32_t target = allocator.Allocate(size, m_Slots[handle].alignment);
+            if (target == TlsfAllocator::kInvalidBlock)
+                break;
+            const size_t newOffset = allocator.GetOffset(target);
+            if (newOffset > oldOffset) {
+                allocator.Free(target);     // No lower hole fits - the page is as compact as it gets
+                break;
+            }
+
+            if (!bound) {
+                GLState::BindBuffer(GL_COPY_READ_BUFFER, page.buffer);
+                GLState::BindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+                bound = true;
+            }
+            GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffset, newOffset, size));
+
+            page.owners[last] = kInvalidHandle;
+            allocator.Free(last);
+            SetOwner(page, target, handle);
+            m_Slots[handle].block = target;
+            moved += size;
+        }
+        if (bound) {
+            GLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+            GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+    m_BytesMoved += moved;
+    return moved;
+}
+
+GpuBufferArena::Stats GpuBufferArena::GetStats() const {
+    Stats stats;
+    stats.pages = m_Pages.size();
+    stats.peakUsed = m_PeakUsed;
+    stats.bytesMoved = m_BytesMoved;
+
+    float fragmented = 0.0f;
+    size_t totalFree = 0;
+    for (const auto& page : m_Pages) {
+        const TlsfAllocator& allocator = page->allocator;
+        const size_t largest = allocator.GetLargestFreeBlock();
+        stats.capacity += allocator.GetCapacity();
+        stats.used += allocator.GetUsed();
+        stats.allocations += allocator.GetAllocationCount();
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, largest);
+        if (allocator.GetFree() > 0) {
+            fragmented += static_cast<float>(allocator.GetFree() - largest);
+            totalFree += allocator.GetFree();
+        }
+    }
+    stats.fragmentation = totalFree > 0 ? fragmented / static_cast<float>(totalFree) : 0.0f;
+    return stats;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TlsfAllocator.h"
+
+/**
+ * GpuBufferArena - sub-allocates vertex / index memory from a few large GL buffers
+ *
+ * Instead of a glGenBuffers / glBufferData pair per mesh, meshes get ranges of
+ * shared pages (see Mesh::SetBufferArenas). Each page is one GL buffer whose
+ * space is managed by a TlsfAllocator, so Allocate() and Free() are O(1) and
+ * never touch the driver's allocator. A new page is only created when no page
+ * has room (pages are at least pageSize; larger requests get a page of their own).
+ *
+ * Defragment() compacts pages during idle frames: it moves the highest
+ * allocation of a page into a lower hole with glCopyBufferSubData and frees the
+ * old range. Allocations stay in their page, so VAOs that reference the page
+ * buffer stay valid - only the offset changes. Draw code must therefore ask
+ * GetOffset() when drawing instead of caching it.
+ *
+ * Handles are small integers that stay valid until Free(). Main thread only.
+ */
+class GpuBufferArena {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle kInvalidHandle = 0xFFFFFFFFu;
+
+    struct Stats {
+        size_t pages = 0;
+        size_t capacity = 0;        // Bytes in all pages
+        size_t used = 0;
+        size_t peakUsed = 0;        // Highest `used` since creation
+        size_t largestFreeBlock = 0;
+        size_t allocations = 0;
+        size_t bytesMoved = 0;      // By Defragment(), in total
+        float fragmentation = 0.0f; // Share of the free bytes outside each page's largest free block
+    };
+
+    GpuBufferArena(const std::string& name, size_t pageSize);
+    ~GpuBufferArena();
+
+    GpuBufferArena(const GpuBufferArena&) = delete;
+    GpuBufferArena& operator=(const GpuBufferArena&) = delete;
+
+    // alignment must be a power of two; kInvalidHandle if the GL buffer could not be created
+    Handle Allocate(size_t size, size_t alignment = TlsfAllocator::kGranularity);
+    void Free(Handle handle);
+
+    // Writes data at the start of the allocation
+    void Upload(Handle handle, const void* data, size_t size);
+
+    unsigned int GetBuffer(Handle handle) const;
+    size_t GetOffset(Handle handle) const;
+    size_t GetSize(Handle handle) const;
+
+    // Moves up to maxBytes of allocations into lower holes; returns the bytes moved
+    size_t Defragment(size_t maxBytes);
+
+    Stats GetStats() const;
+    inline const std::string& GetName() const { return m_Name; }
+
+private:
+    struct Page {
+        unsigned int buffer = 0;
+        TlsfAllocator allocator;
+        std::vector<Handle> owners;     // Per allocator block id
+    };
+    struct Slot {
+        uint32_t page = 0;
+        uint32_t block = TlsfAllocator::kInvalidBlock;
+        uint32_t alignment = 0;
+    };
+
+    Page* CreatePage(size_t size);
+    Handle NewHandle();
+    void SetOwner(Page& page, uint32_t block, Handle handle);
+
+    std::string m_Name;
+    size_t m_PageSize;
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    std::vector<Slot> m_Slots;
+    std::vector<Handle> m_FreeHandles;
+    size_t m_PeakUsed;
+    size_t m_BytesMoved;
+};
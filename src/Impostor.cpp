@@ -0,0 +1,420 @@
+#include "Impostor.h"
+#include "AssetManager.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Debug.h"
+#include "GLState.h"
+#include "MipChain.h"
+#include "UniformBuffer.h"
+#include "vendor/glm/gtc/matrix_transform.hpp"
+#include <glad/glad.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char* kBakeShaderPath = "res/shaders/impostor_bake.shader";
+
+AssetManager* s_AssetManager = nullptr;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t framesPerSide;
+    int32_t frameResolution;
+    int32_t hemisphere;
+    uint32_t vertexCount;   // Identifies the source mesh
+    uint32_t indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t reserved;      // Keeps sourceHash aligned without padding bytes (the header is memcmp'd)
+    uint64_t sourceHash;    // Mesh data and texture contents, see SourceHash()
+};
+static_assert(sizeof(CacheHeader) == 64, "RIMP header layout");
+
+// Counts and bounds alone miss edited vertex colors / UVs and a changed texture.
+// A mesh that released its CPU copy contributes nothing here.
+uint64_t SourceHash(const Mesh& mesh, const Texture* texture) {
+    uint64_t parts[3] = { 0, 0, 0 };
+    if (mesh.HasCpuData()) {
+        parts[0] = MipChain::HashData(mesh.GetVertices().data(), mesh.GetVertices().size_bytes());
+        parts[1] = MipChain::HashData(mesh.GetIndices().data(), mesh.GetIndices().size_bytes());
+    }
+    if (texture && texture->IsValid())
+        parts[2] = AssetManager::HashFileContents(texture->GetFilePath());
+    return MipChain::HashData(parts, sizeof(parts));
+}
+
+CacheHeader MakeHeader(const ImpostorSettings& settings, size_t vertexCount, size_t indexCount, const AABB& bounds,
+                       uint64_t sourceHash) {
+    CacheHeader header{};
+    std::memcpy(header.magic, "RIMP", 4);
+    header.version = 2;
+    header.framesPerSide = settings.framesPerSide;
+    header.frameResolution = settings.frameResolution;
+    header.hemisphere = settings.hemisphere ? 1 : 0;
+    header.vertexCount = static_cast<uint32_t>(vertexCount);
+    header.indexCount = static_cast<uint32_t>(indexCount);
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = bounds.min[i];
+        header.boundsMax[i] = bounds.max[i];
+    }
+    header.sourceHash = sourceHash;
+    return header;
+}
+
+inline float SignNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+// Octahedral mapping with +Y as the pole. Must match impostor.shader.
+glm::vec3 OctahedralDecode(glm::vec2 uv, bool hemisphere) {
+    glm::vec2 p = uv * 2.0f - 1.0f;
+    if (hemisphere) {
+        glm::vec2 q((p.x + p.y) * 0.5f, (p.x - p.y) * 0.5f);
+        return glm::normalize(glm::vec3(q.x, 1.0f - std::fabs(q.x) - std::fabs(q.y), q.y));
+    }
+    glm::vec3 n(p.x, 1.0f - std::fabs(p.x) - std::fabs(p.y), p.y);
+    if (n.y < 0.0f) {
+        float x = (1.0f - std::fabs(n.z)) * SignNotZero(n.x);
+        float z = (1.0f - std::fabs(n.x)) * SignNotZero(n.z);
+        n.x = x;
+        n.z = z;
+    }
+    return glm::normalize(n);
+}
+
+// Camera basis shared by bake and runtime, so the billboard matches the baked image
+void FrameBasis(const glm::vec3& dir, glm::vec3& right, glm::vec3& up) {
+    glm::vec3 upRef = std::fabs(dir.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    right = glm::normalize(glm::cross(upRef, dir));
+    up = glm::cross(dir, right);
+}
+
+} // namespace
+
+Impostor::Impostor()
+    : m_Center(0.0f), m_Radius(0.0f), m_SourceVertexCount(0), m_SourceIndexCount(0), m_SourceHash(0),
+      m_ColorAtlas(0), m_DepthAtlas(0),
+      m_VAO(0), m_InstanceVBO(0), m_InstanceCapacity(0) {
+}
+
+Impostor::~Impostor() {
+    Destroy();
+}
+
+void Impostor::SetAssetManager(AssetManager* assets) {
+    s_AssetManager = assets;
+}
+
+void Impostor::Destroy() {
+    if (m_ColorAtlas != 0) { GLState::DeleteTexture(m_ColorAtlas); m_ColorAtlas = 0; }
+    if (m_DepthAtlas != 0) { GLState::DeleteTexture(m_DepthAtlas); m_DepthAtlas = 0; }
+    if (m_InstanceVBO != 0) { GLState::DeleteBuffer(m_InstanceVBO); m_InstanceVBO = 0; }
+    if (m_VAO != 0) { GLState::DeleteVertexArray(m_VAO); m_VAO = 0; }
+    m_InstanceCapacity = 0;
+}
+
+bool Impostor::CreateAtlasTextures(const void* colorPixels, const void* depthPixels) {
+    const int size = m_Settings.framesPerSide * m_Settings.frameResolution;
+
+    GLCall(glGenTextures(1, &m_ColorAtlas));
+    GLState::BindTexture(GL_TEXTURE_2D, m_ColorAtlas);
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, colorPixels));
+
+    GLCall(glGenTextures(1, &m_DepthAtlas));
+    GLState::BindTexture(GL_TEXTURE_2D, m_DepthAtlas);
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, size, size, 0, GL_RED, GL_UNSIGNED_SHORT, depthPixels));
+
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void Impostor::GenerateColorMips() {
+    // Far impostors cover few pixels - without mips the atlas shimmers. The chain stops
+    // at one texel per frame, below that neighbouring frames would bleed into each other.
+    // The depth atlas keeps level 0 only: averaged depths are not a surface.
+    int maxLevel = 0;
+    while ((m_Settings.frameResolution >> (maxLevel + 1)) > 0)
+        ++maxLevel;
+
+    GLState::BindTexture(GL_TEXTURE_2D, m_ColorAtlas);
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    GLCall(glGenerateMipmap(GL_TEXTURE_2D));
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool Impostor::Bake(const Mesh& mesh, const Texture* texture, const ImpostorSettings& settings) {
+    if (!mesh.HasGL() || !mesh.GetBounds().IsValid()) {
+        std::cerr << "[Impostor] Bake: mesh has no GL objects or bounds" << std::endl;
+        return false;
+    }
+    if (settings.framesPerSide < 1 || settings.frameResolution < 1) {
+        std::cerr << "[Impostor] Bake: invalid settings" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<Shader> bakeShader = s_AssetManager ? s_AssetManager->LoadShader(kBakeShaderPath).GetShared()
+                                                        : std::make_shared<Shader>(kBakeShaderPath);
+    if (!bakeShader || bakeShader->GetRendererID() == 0)
+        return false;
+
+    Destroy();
+    m_Settings = settings;
+    m_SourceVertexCount = mesh.GetVertexCount();
+    m_SourceIndexCount = static_cast<size_t>(mesh.GetIndexCount());
+    m_SourceBounds = mesh.GetBounds();
+    m_SourceHash = SourceHash(mesh, texture);
+    m_Center = m_SourceBounds.Center();
+    m_Radius = glm::length(m_SourceBounds.Extents());
+    if (m_Radius <= 0.0f)
+        m_Radius = 1.0f;
+
+    if (!CreateAtlasTextures(nullptr, nullptr))
+        return false;
+
+    const int frames = settings.framesPerSide;
+    const int res = settings.frameResolution;
+    const int size = frames * res;
+
+    // Save the state we are about to change
+    GLint prevFramebuffer = 0, prevViewport[4];
+    GLCall(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFramebuffer));
+    GLCall(glGetIntegerv(GL_VIEWPORT, prevViewport));
+    const GLboolean prevDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    GLuint fbo = 0, depthRbo = 0;
+    GLCall(glGenFramebuffers(1, &fbo));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorAtlas, 0));
+    GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_DepthAtlas, 0));
+    GLCall(glGenRenderbuffers(1, &depthRbo));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, depthRbo));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRbo));
+
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    GLCall(glDrawBuffers(2, drawBuffers));
+
+    bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!ok) {
+        std::cerr << "[Impostor] Bake: offscreen framebuffer incomplete" << std::endl;
+    } else {
+        // Transparent background, far depth (1.0 = back of the bounding sphere)
+        GLCall(glViewport(0, 0, size, size));
+        const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const GLfloat clearDepth[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        GLCall(glClearBufferfv(GL_COLOR, 0, clearColor));
+        GLCall(glClearBufferfv(GL_COLOR, 1, clearDepth));
+        GLCall(glClear(GL_DEPTH_BUFFER_BIT));
+
+        bakeShader->Bind();
+        bakeShader->SetUniformMat4f("u_Model", glm::mat4(1.0f));
+        bakeShader->SetUniform1f("u_Near", m_Radius);
+        bakeShader->SetUniform1f("u_DepthRange", 2.0f * m_Radius);
+        if (texture && texture->IsValid()) {
+            texture->Bind(0);
+            bakeShader->SetUniform1i("u_Texture", 0);
+            bakeShader->SetUniform1i("u_UseTexture", 1);
+        } else {
+            bakeShader->SetUniform1i("u_UseTexture", 0);
+        }
+
+        // Orthographic camera 2R away from the center: near plane touches the front
+        // of the bounding sphere, far plane the back
+        const glm::mat4 projection = glm::ortho(-m_Radius, m_Radius, -m_Radius, m_Radius, m_Radius, 3.0f * m_Radius);
+
+        // One Camera block per frame, uploaded together; each frame binds its range.
+        // The frame's RenderQueue::Flush() binds its own camera again.
+        const size_t alignment = UniformBuffer::GetOffsetAlignment();
+        const size_t stride = (sizeof(CameraUniforms) + alignment - 1) / alignment * alignment;
+        std::vector<unsigned char> cameraData(stride * frames * frames);
+        for (int y = 0; y < frames; ++y) {
+            for (int x = 0; x < frames; ++x) {
+                glm::vec2 uv((x + 0.5f) / frames, (y + 0.5f) / frames);
+                glm::vec3 dir = OctahedralDecode(uv, settings.hemisphere);
+                glm::vec3 right, up;
+                FrameBasis(dir, right, up);
+
+                CameraUniforms camera;
+                camera.view = glm::lookAt(m_Center + dir * (2.0f * m_Radius), m_Center, up);
+                camera.projection = projection;
+                camera.viewProjection = projection * camera.view;
+                camera.position = glm::vec4(m_Center + dir * (2.0f * m_Radius), 1.0f);
+                std::memcpy(cameraData.data() + stride * (y * frames + x), &camera, sizeof(camera));
+            }
+        }
+        UniformBuffer cameras;
+        cameras.Allocate(cameraData.size());
+        cameras.Update(0, cameraData.data(), cameraData.size());
+
+        for (int y = 0; y < frames; ++y) {
+            for (int x = 0; x < frames; ++x) {
+                cameras.BindRange(UniformBlock::Camera, stride * (y * frames + x), sizeof(CameraUniforms));
+                GLCall(glViewport(x * res, y * res, res, res));
+                mesh.Draw();
+            }
+        }
+        bakeShader->Unbind();
+    }
+
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer));
+    GLCall(glDeleteRenderbuffers(1, &depthRbo));
+    GLCall(glDeleteFramebuffers(1, &fbo));
+    GLCall(glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]));
+    GLState::SetCapability(GL_DEPTH_TEST, prevDepthTest == GL_TRUE);
+
+    if (!ok) {
+        Destroy();
+        return false;
+    }
+    GenerateColorMips();
+
+    std::cout << "[Impostor] Baked " << frames * frames << " views into a " << size << "x" << size << " atlas" << std::endl;
+    return true;
+}
+
+bool Impostor::SaveCache(const std::string& filepath) const {
+    if (!IsValid())
+        return false;
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[Impostor] Failed to write cache: " << filepath << std::endl;
+        return false;
+    }
+
+    const int size = m_Settings.framesPerSide * m_Settings.frameResolution;
+    std::vector<unsigned char> color(static_cast<size_t>(size) * size * 4);
+    std::vector<uint16_t> depth(static_cast<size_t>(size) * size);
+
+    GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GLState::BindTexture(GL_TEXTURE_2D, m_ColorAtlas);
+    GLCall(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, color.data()));
+    GLState::BindTexture(GL_TEXTURE_2D, m_DepthAtlas);
+    GLCall(glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_SHORT, depth.data()));
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+    GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+
+    CacheHeader header = MakeHeader(m_Settings, m_SourceVertexCount, m_SourceIndexCount, m_SourceBounds, m_SourceHash);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(color.data()), color.size());
+    file.write(reinterpret_cast<const char*>(depth.data()), depth.size() * sizeof(uint16_t));
+    return file.good();
+}
+
+bool Impostor::LoadCache(const std::string& filepath, const Mesh& mesh, const Texture* texture,
+                         const ImpostorSettings& settings) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    const uint64_t sourceHash = SourceHash(mesh, texture);
+    const CacheHeader expected = MakeHeader(settings, mesh.GetVertexCount(),
+                                            static_cast<size_t>(mesh.GetIndexCount()), mesh.GetBounds(), sourceHash);
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(&header, &expected, sizeof(CacheHeader)) != 0)
+        return false; // Missing, stale or baked with other settings
+
+    const int size = settings.framesPerSide * settings.frameResolution;
+    std::vector<unsigned char> color(static_cast<size_t>(size) * size * 4);
+    std::vector<uint16_t> depth(static_cast<size_t>(size) * size);
+    file.read(reinterpret_cast<char*>(color.data()), color.size());
+    file.read(reinterpret_cast<char*>(depth.data()), depth.size() * sizeof(uint16_t));
+    if (!file) {
+        std::cerr << "[Impostor] Truncated cache: " << filepath << std::endl;
+        return false;
+    }
+
+    Destroy();
+    m_Settings = settings;
+    m_SourceVertexCount = mesh.GetVertexCount();
+    m_SourceIndexCount = static_cast<size_t>(mesh.GetIndexCount());
+    m_SourceBounds = mesh.GetBounds();
+    m_SourceHash = sourceHash;
+    m_Center = m_SourceBounds.Center();
+    m_Radius = glm::length(m_SourceBounds.Extents());
+    if (m_Radius <= 0.0f)
+        m_Radius = 1.0f;
+
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    bool ok = CreateAtlasTextures(color.data(), depth.data());
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    if (ok)
+        GenerateColorMips();
+
+    std::cout << "[Impostor] Loaded cached atlas: " << filepath << std::endl;
+    return ok;
+}
+
+bool Impostor::BakeOrLoad(const Mesh& mesh, const Texture* texture, const ImpostorSettings& settings,
+                          const std::string& cachePath) {
+    if (!cachePath.empty() && LoadCache(cachePath, mesh, texture, settings))
+        return true;
+    if (!Bake(mesh, texture, settings))
+        return false;
+    if (!cachePath.empty())
+        SaveCache(cachePath);
+    return true;
+}
+
+bool Impostor::ShouldUse(const glm::vec3& cameraPos, const glm::vec3& objectPos) const {
+    const glm::vec3 d = objectPos - cameraPos;
+    return IsValid() && glm::dot(d, d) > m_Settings.switchDistance * m_Settings.switchDistance;
+}
+
+void Impostor::EnsureInstanceBuffers(size_t instanceCount) {
+    if (m_VAO == 0) {
+        GLCall(glGenVertexArrays(1, &m_VAO));
+        GLCall(glGenBuffers(1, &m_InstanceVBO));
+
+        GLState::BindVertexArray(m_VAO);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+        // a_Instance (location = 0): xyz = position, w = scale. Quad corners come from gl_VertexID.
+        GLCall(glEnableVertexAttribArray(0));
+        GLCall(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), nullptr));
+        GLCall(glVertexAttribDivisor(0, 1));
+        GLState::BindVertexArray(0);
+    }
+
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_InstanceVBO);
+    if (instanceCount > m_InstanceCapacity) {
+        m_InstanceCapacity = instanceCount + instanceCount / 2;
+        GLCall(glBufferData(GL_ARRAY_BUFFER, m_InstanceCapacity * sizeof(ImpostorInstance), nullptr, GL_STREAM_DRAW));
+    }
+}
+
+void Impostor::Draw(Shader& shader, const std::vector<ImpostorInstance>& instances) {
+    if (!IsValid() || instances.empty())
+        return;
+
+    static_assert(sizeof(ImpostorInstance) == 4 * sizeof(float), "ImpostorInstance must be a tightly packed vec4");
+    EnsureInstanceBuffers(instances.size());
+    GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(ImpostorInstance), instances.data()));
+
+    shader.Bind();
+    shader.SetUniform3f("u_Center", m_Center.x, m_Center.y, m_Center.z);
+    shader.SetUniform1f("u_Radius", m_Radius);
+    shader.SetUniform1f("u_FramesPerSide", static_cast<float>(m_Settings.framesPerSide));
+    shader.SetUniform1i("u_Hemisphere", m_Settings.hemisphere ? 1 : 0);
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_ColorAtlas);
+    GLState::BindTexture(1, GL_TEXTURE_2D, m_DepthAtlas);
+    shader.SetUniform1i("u_ColorAtlas", 0);
+    shader.SetUniform1i("u_DepthAtlas", 1);
+
+    GLState::BindVertexArray(m_VAO);
+    GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size())));
+}
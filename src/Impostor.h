@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Bounds.h"
+#include "vendor/glm/glm.hpp"
+
+class AssetManager;
+class Mesh;
+class Shader;
+class Texture;
+
+struct ImpostorSettings {
+    int framesPerSide = 8;          // Octahedral grid: framesPerSide^2 baked view directions
+    int frameResolution = 128;      // Pixels per frame (atlas = framesPerSide * frameResolution)
+    bool hemisphere = false;        // Only bake views from above (ground props never seen from below)
+    float switchDistance = 40.0f;   // Objects farther away than this are drawn as impostor
+};
+
+// One far-field instance (impostors are position/scale only, they don't rotate)
+struct ImpostorInstance {
+    glm::vec3 position;
+    float scale = 1.0f;
+};
+
+/**
+ * Impostor - octahedral billboard impostor of a Mesh
+ *
+ * Bake() renders the mesh from framesPerSide^2 directions (octahedral mapping)
+ * into a colour atlas (RGBA8, mipmapped down to one texel per frame) and a
+ * linear depth atlas (R16) in an offscreen pass.
+ * The atlases can be written to / read from a disk cache, keyed by the settings
+ * and a hash of the mesh data (if it still has its CPU copy) and the texture file.
+ *
+ * At runtime every far instance is a single camera-facing quad. All instances of
+ * one impostor are drawn with one glDrawArraysInstanced call (res/shaders/impostor.shader);
+ * view, projection and camera position come from the Camera uniform block.
+ * The quad picks the baked frame closest to the view direction and reconstructs
+ * depth from the depth atlas, so impostors still intersect correctly with geometry.
+ *
+ * Typical use:
+ *   Impostor impostor;
+ *   impostor.BakeOrLoad(*mesh, texture.get(), settings, "res/cache/well.impostor");
+ *   ...
+ *   if (impostor.ShouldUse(cameraPos, objectPos)) farInstances.push_back({ objectPos, 1.0f });
+ *   else                                         { draw the full mesh }
+ *   queue.Flush();                                // binds the Camera block
+ *   impostor.Draw(impostorShader, farInstances);
+ */
+class Impostor {
+public:
+    Impostor();
+    ~Impostor();
+
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+
+    // The bake shader is loaded through the AssetManager, so it is compiled once for
+    // all impostors (nullptr: every Bake() compiles its own, default)
+    static void SetAssetManager(AssetManager* assets);
+
+    // Offscreen bake. Needs a GL context and the mesh's GL objects (SetupGL()).
+    // texture may be nullptr (per-vertex material colors are used then).
+    bool Bake(const Mesh& mesh, const Texture* texture, const ImpostorSettings& settings);
+
+    bool SaveCache(const std::string& filepath) const;
+    // Fails if the cache was baked from other settings, mesh data or texture contents
+    bool LoadCache(const std::string& filepath, const Mesh& mesh, const Texture* texture, const ImpostorSettings& settings);
+
+    // LoadCache() if a matching cache exists, otherwise Bake() and SaveCache()
+    bool BakeOrLoad(const Mesh& mesh, const Texture* texture, const ImpostorSettings& settings,
+                    const std::string& cachePath);
+
+    // Distance based LOD switch
+    bool ShouldUse(const glm::vec3& cameraPos, const glm::vec3& objectPos) const;
+
+    // Draws all instances with one instanced draw. The impostor shader must be loaded,
+    // binding is done here. The Camera block must be bound (e.g. by RenderQueue::Flush()).
+    void Draw(Shader& shader, const std::vector<ImpostorInstance>& instances);
+
+    void Destroy();
+
+    inline bool IsValid() const { return m_ColorAtlas != 0 && m_DepthAtlas != 0; }
+    inline unsigned int GetColorAtlas() const { return m_ColorAtlas; }
+    inline unsigned int GetDepthAtlas() const { return m_DepthAtlas; }
+    inline const ImpostorSettings& GetSettings() const { return m_Settings; }
+
+private:
+    bool CreateAtlasTextures(const void* colorPixels, const void* depthPixels);
+    void GenerateColorMips();
+    void EnsureInstanceBuffers(size_t instanceCount);
+
+    ImpostorSettings m_Settings;
+    glm::vec3 m_Center;     // Object-space center of the baked bounding sphere
+    float m_Radius;
+
+    // Identity of the baked mesh, used to validate disk caches
+    size_t m_SourceVertexCount;
+    size_t m_SourceIndexCount;
+    AABB m_SourceBounds;
+    uint64_t m_SourceHash;  // Mesh data and texture file contents
+
+    unsigned int m_ColorAtlas;
+    unsigned int m_DepthAtlas;
+    unsigned int m_VAO;
+    unsigned int m_InstanceVBO;
+    size_t m_InstanceCapacity;
+};
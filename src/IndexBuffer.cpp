@@ -1,6 +1,7 @@
 #include "IndexBuffer.h"
 #include "Debug.h"
 #include "BufferLimits.h"
+#include "GLState.h"
 #include <glad/glad.h>
 #include <iostream>
 
@@ -27,25 +28,27 @@ IndexBuffer::IndexBuffer(const unsigned int* indices, unsigned int count)
         ASSERT(false);
     }
     
+    // Uploaded through the copy target: the element array binding belongs to
+    // whichever vertex array is bound (GLState leaves the last one bound)
     GLCall(glGenBuffers(1, &m_RendererID));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, GL_STATIC_DRAW));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID);
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(unsigned int), indices, GL_STATIC_DRAW));
 }
 
 IndexBuffer::~IndexBuffer() {
-    GLCall(glDeleteBuffers(1, &m_RendererID));
+    GLState::DeleteBuffer(m_RendererID);
 }
 
 void IndexBuffer::Bind() const {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID);
 }
 
 void IndexBuffer::Unbind() const {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void IndexBuffer::UpdateData(const unsigned int* indices, unsigned int count) {
-    Bind();
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID);
     ASSERT(count <= m_Count); // Ensure buffer is large enough
-    GLCall(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, count * sizeof(unsigned int), indices));
+    GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, count * sizeof(unsigned int), indices));
 }
@@ -0,0 +1,66 @@
+#include "InstanceBuffer.h"
+#include "Debug.h"
+#include "UploadRing.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstring>
+
+InstanceBuffer::InstanceBuffer()
+    : m_RendererID(0), m_Source(0), m_Capacity(0), m_Ring(nullptr) {
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    if (m_RendererID != 0) {
+        GLState::DeleteBuffer(m_RendererID);
+    }
+}
+
+void InstanceBuffer::SetUploadRing(UploadRing* ring) {
+    m_Ring = ring;
+}
+
+uint32_t InstanceBuffer::Upload(const InstanceData* instances, size_t count) {
+    if (m_Ring && count > 0) {
+        // Aligned to whole instances, so the offset is a baseInstance
+        const RingAllocation allocation = m_Ring->Allocate(count * sizeof(InstanceData), sizeof(InstanceData));
+        if (allocation) {
+            std::memcpy(allocation.data, instances, allocation.size);
+            m_Source = allocation.buffer;
+            return static_cast<uint32_t>(allocation.offset / sizeof(InstanceData));
+        }
+    }
+
+    if (m_RendererID == 0) {
+        GLCall(glGenBuffers(1, &m_RendererID));
+    }
+    if (count > m_Capacity || m_Capacity == 0)
+        m_Capacity = count + count / 2 + 64;
+
+    // Fresh storage every upload (orphaning): last frame's draws may still read the old one
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_RendererID);
+    GLCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW));
+    if (count > 0) {
+        GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances));
+    }
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    m_Source = m_RendererID;
+    return 0;
+}
+
+void InstanceBuffer::SetupAttributes(unsigned int buffer) {
+    constexpr GLsizei stride = sizeof(InstanceData);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; ++column) {
+        const GLuint location = kModelLocation + column;
+        const size_t offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+        GLCall(glEnableVertexAttribArray(location));
+        GLCall(glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset)));
+        GLCall(glVertexAttribDivisor(location, 1));
+    }
+    GLCall(glEnableVertexAttribArray(kColorLocation));
+    GLCall(glVertexAttribPointer(kColorLocation, 4, GL_FLOAT, GL_FALSE, stride,
+                                 reinterpret_cast<void*>(offsetof(InstanceData, color))));
+    GLCall(glVertexAttribDivisor(kColorLocation, 1));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "vendor/glm/glm.hpp"
+
+class UploadRing;
+
+// Per-instance vertex data of instanced mesh draws (divisor 1):
+// location 3-6 = model matrix columns, location 7 = color tint
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 color;    // Multiplied with the texture / vertex color
+};
+
+/**
+ * InstanceBuffer - streamed GL buffer of InstanceData for instanced draws
+ *
+ * Upload() writes a whole frame's instances at once; draws then select their
+ * range with the baseInstance of glDrawElementsInstancedBaseInstance (GL 4.2),
+ * so one buffer serves every mesh. Meshes point their instance attributes at it
+ * with Mesh::AttachInstanceBuffer(), the shared GeometryBuffer with its own
+ * AttachInstanceBuffer().
+ *
+ * With an UploadRing the instances are written straight into its persistently
+ * mapped region for the frame, and Upload() returns where they start. Without
+ * one (or when the ring is full / unavailable) they go into an own buffer that
+ * is orphaned with glBufferData each frame.
+ */
+class InstanceBuffer {
+public:
+    static constexpr unsigned int kModelLocation = 3;   // mat4: locations 3, 4, 5, 6
+    static constexpr unsigned int kColorLocation = 7;
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // Uses the ring between its BeginFrame / EndFrame (nullptr = own buffer only)
+    void SetUploadRing(UploadRing* ring);
+
+    // Replaces the contents; returns the instance index of instances[0] in GetRendererID()
+    uint32_t Upload(const InstanceData* instances, size_t count);
+
+    // Points attributes 3-7 of the currently bound VAO at buffer (divisor 1)
+    static void SetupAttributes(unsigned int buffer);
+
+    // The buffer the last Upload() went to - the ring's or the own one
+    inline unsigned int GetRendererID() const { return m_Source; }
+    inline size_t GetCapacity() const { return m_Capacity; }
+
+private:
+    unsigned int m_RendererID;
+    unsigned int m_Source;
+    size_t m_Capacity;      // In instances
+    UploadRing* m_Ring;
+};
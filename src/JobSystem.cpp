@@ -0,0 +1,105 @@
+#include "JobSystem.h"
+#include <memory>
+#include <algorithm>
+
+JobSystem& JobSystem::Get() {
+    static JobSystem instance(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return instance;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+    : m_Stop(false) {
+    m_Workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i)
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+    for (auto& worker : m_Workers)
+        worker.join();
+}
+
+void JobSystem::Submit(Job job) {
+    if (m_Workers.empty()) {
+        // No workers (single core machine) - run inline
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(job));
+    }
+    m_Condition.notify_one();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const RangeJob& fn) {
+    if (count == 0)
+        return;
+    if (grainSize == 0)
+        grainSize = 1;
+
+    const size_t chunkCount = (count + grainSize - 1) / grainSize;
+    if (chunkCount == 1 || m_Workers.empty()) {
+        fn(0, count);
+        return;
+    }
+
+    // Shared state outlives this call in case a helper job is dequeued late
+    struct Batch {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> doneChunks{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto batch = std::make_shared<Batch>();
+
+    auto runChunks = [batch, count, grainSize, chunkCount, &fn]() {
+        size_t finished = 0;
+        for (;;) {
+            size_t chunk = batch->nextChunk.fetch_add(1);
+            if (chunk >= chunkCount)
+                break;
+            size_t begin = chunk * grainSize;
+            fn(begin, std::min(begin + grainSize, count));
+            ++finished;
+        }
+        if (finished > 0 && batch->doneChunks.fetch_add(finished) + finished == chunkCount) {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->done.notify_all();
+        }
+    };
+
+    // fn is only referenced while chunks are outstanding, and we block until all are done
+    const size_t helpers = std::min<size_t>(m_Workers.size(), chunkCount - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (size_t i = 0; i < helpers; ++i)
+            m_Queue.push_back(runChunks);
+    }
+    m_Condition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&]() { return batch->doneChunks.load() == chunkCount; });
+}
+
+void JobSystem::WorkerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+            if (m_Stop && m_Queue.empty())
+                return;
+            job = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+
+// Small fixed-size worker pool used for CPU side preprocessing
+// (BVH builds, mesh processing, culling, ...).
+//
+// - Submit() queues a fire-and-forget job.
+// - ParallelFor() splits [0, count) into chunks of grainSize and blocks until all
+//   chunks are done. The calling thread works on chunks itself, so nested
+//   ParallelFor calls from inside a job cannot dead-lock the pool.
+// Note: GL calls must never be issued from jobs - only the main thread owns the context.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+    using RangeJob = std::function<void(size_t begin, size_t end)>;
+
+    // Global pool, created on first use with (hardware threads - 1) workers
+    static JobSystem& Get();
+
+    explicit JobSystem(unsigned int workerCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void Submit(Job job);
+    void ParallelFor(size_t count, size_t grainSize, const RangeJob& fn);
+
+    inline unsigned int GetWorkerCount() const { return static_cast<unsigned int>(m_Workers.size()); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Workers;
+    std::deque<Job> m_Queue;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stop;
+};
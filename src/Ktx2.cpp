@@ -0,0 +1,253 @@
+#include "Ktx2.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const unsigned char kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Header {
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint32_t sgdByteOffset[2];  // uint64 in the file, split so the struct has no padding
+    uint32_t sgdByteLength[2];
+};
+static_assert(sizeof(Header) == 68, "KTX2 header layout");
+
+struct LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos data format descriptor values
+constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+constexpr uint32_t KHR_DF_SAMPLE_LINEAR = 0x10; // Qualifier: channel is linear even for sRGB formats
+
+struct DfdSample {
+    uint32_t bitOffset;
+    uint32_t bitLength;
+    uint32_t channelType;
+};
+
+std::vector<uint32_t> BuildDfd(BlockCompression::Format format, bool srgb) {
+    uint32_t model = KHR_DF_MODEL_BC1A;
+    std::vector<DfdSample> samples;
+    switch (format) {
+    case BlockCompression::Format::BC1:
+        model = KHR_DF_MODEL_BC1A;
+        samples.push_back({ 0, 64, 1 });                               // color + 1 bit alpha
+        break;
+    case BlockCompression::Format::BC3:
+        model = KHR_DF_MODEL_BC3;
+        samples.push_back({ 0, 64, 15 | KHR_DF_SAMPLE_LINEAR });      // alpha
+        samples.push_back({ 64, 64, 0 });                              // color
+        break;
+    case BlockCompression::Format::BC5:
+        model = KHR_DF_MODEL_BC5;
+        samples.push_back({ 0, 64, 0 });                               // red
+        samples.push_back({ 64, 64, 1 });                              // green
+        break;
+    case BlockCompression::Format::BC7:
+        model = KHR_DF_MODEL_BC7;
+        samples.push_back({ 0, 128, 0 });
+        break;
+    }
+
+    const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    const uint32_t transfer = srgb && format != BlockCompression::Format::BC5 ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+    std::vector<uint32_t> words;
+    words.push_back(4 + blockSize);                                    // dfdTotalSize
+    words.push_back(0);                                                // vendorId / descriptorType
+    words.push_back(2u | (blockSize << 16));                           // versionNumber / blockSize
+    words.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    words.push_back(3u | (3u << 8));                                   // 4x4x1x1 texel block
+    words.push_back(static_cast<uint32_t>(BlockCompression::BlockBytes(format)));
+    words.push_back(0);
+    for (const DfdSample& s : samples) {
+        words.push_back(s.bitOffset | ((s.bitLength - 1) << 16) | (s.channelType << 24));
+        words.push_back(0);                                            // sample position
+        words.push_back(0);                                            // sampleLower
+        words.push_back(0xFFFFFFFFu);                                  // sampleUpper
+    }
+    return words;
+}
+
+std::vector<unsigned char> BuildKeyValueData() {
+    const char key[] = "KTXorientation";
+    const char value[] = "ru";
+    const uint32_t length = sizeof(key) + sizeof(value); // both include the terminator
+    std::vector<unsigned char> kvd(4 + length);
+    std::memcpy(kvd.data(), &length, 4);
+    std::memcpy(kvd.data() + 4, key, sizeof(key));
+    std::memcpy(kvd.data() + 4 + sizeof(key), value, sizeof(value));
+    kvd.resize((kvd.size() + 3) & ~static_cast<size_t>(3), 0);
+    return kvd;
+}
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+uint32_t Ktx2::VkFormatFor(BlockCompression::Format format, bool srgb) {
+    switch (format) {
+    case BlockCompression::Format::BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case BlockCompression::Format::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case BlockCompression::Format::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case BlockCompression::Format::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return 0;
+}
+
+bool Ktx2::FromVkFormat(uint32_t vkFormat, BlockCompression::Format& outFormat, bool& outSrgb) {
+    switch (vkFormat) {
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: outFormat = BlockCompression::Format::BC1; outSrgb = false; return true;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:  outFormat = BlockCompression::Format::BC1; outSrgb = true;  return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:      outFormat = BlockCompression::Format::BC3; outSrgb = false; return true;
+    case VK_FORMAT_BC3_SRGB_BLOCK:       outFormat = BlockCompression::Format::BC3; outSrgb = true;  return true;
+    case VK_FORMAT_BC5_UNORM_BLOCK:      outFormat = BlockCompression::Format::BC5; outSrgb = false; return true;
+    case VK_FORMAT_BC7_UNORM_BLOCK:      outFormat = BlockCompression::Format::BC7; outSrgb = false; return true;
+    case VK_FORMAT_BC7_SRGB_BLOCK:       outFormat = BlockCompression::Format::BC7; outSrgb = true;  return true;
+    default: return false;
+    }
+}
+
+bool Ktx2::Parse(const unsigned char* data, size_t size, Image& outImage) {
+    outImage = Image();
+    if (!data || size < sizeof(kIdentifier) + sizeof(Header) || std::memcmp(data, kIdentifier, sizeof(kIdentifier)) != 0)
+        return false;
+
+    Header header;
+    std::memcpy(&header, data + sizeof(kIdentifier), sizeof(Header));
+
+    if (!FromVkFormat(header.vkFormat, outImage.format, outImage.srgb)) {
+        std::cerr << "[Ktx2] Unsupported vkFormat " << header.vkFormat << std::endl;
+        return false;
+    }
+    // Levels are computed with int shifts - anything near INT_MAX is corrupt anyway
+    constexpr uint32_t kMaxExtent = 1u << 16;
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 ||
+        header.pixelWidth > kMaxExtent || header.pixelHeight > kMaxExtent ||
+        header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0) {
+        std::cerr << "[Ktx2] Only plain 2D textures (up to " << kMaxExtent << " texels wide) without supercompression are supported" << std::endl;
+        return false;
+    }
+
+    const uint32_t levelCount = std::max(1u, header.levelCount);
+    // A full chain ends at 1x1: 1 + floor(log2(max(width, height))) levels
+    uint32_t maxLevels = 1;
+    for (uint32_t extent = std::max(header.pixelWidth, header.pixelHeight); extent > 1; extent >>= 1)
+        ++maxLevels;
+    if (levelCount > maxLevels) {
+        std::cerr << "[Ktx2] " << levelCount << " levels for " << header.pixelWidth << "x" << header.pixelHeight
+                  << ", at most " << maxLevels << " possible" << std::endl;
+        return false;
+    }
+    const size_t indexOffset = sizeof(kIdentifier) + sizeof(Header);
+    if (indexOffset + levelCount * sizeof(LevelIndex) > size)
+        return false;
+
+    outImage.vkFormat = header.vkFormat;
+    outImage.width = static_cast<int>(header.pixelWidth);
+    outImage.height = static_cast<int>(header.pixelHeight);
+
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        LevelIndex index;
+        std::memcpy(&index, data + indexOffset + i * sizeof(LevelIndex), sizeof(LevelIndex));
+
+        Level level;
+        level.width = std::max(1, outImage.width >> i);
+        level.height = std::max(1, outImage.height >> i);
+        if (index.byteOffset > size || index.byteLength > size - index.byteOffset ||
+            index.byteLength != BlockCompression::CompressedSize(outImage.format, level.width, level.height)) {
+            std::cerr << "[Ktx2] Corrupt level " << i << std::endl;
+            outImage.levels.clear();
+            return false;
+        }
+        level.data = data + index.byteOffset;
+        level.size = static_cast<size_t>(index.byteLength);
+        outImage.levels.push_back(level);
+    }
+    return true;
+}
+
+bool Ktx2::Write(const std::string& filepath, BlockCompression::Format format, bool srgb,
+                 int width, int height, const std::vector<std::vector<unsigned char>>& levels) {
+    if (levels.empty() || width <= 0 || height <= 0)
+        return false;
+
+    const std::vector<uint32_t> dfd = BuildDfd(format, srgb);
+    const std::vector<unsigned char> kvd = BuildKeyValueData();
+    const size_t levelCount = levels.size();
+
+    Header header{};
+    header.vkFormat = VkFormatFor(format, srgb);
+    header.typeSize = 1;
+    header.pixelWidth = static_cast<uint32_t>(width);
+    header.pixelHeight = static_cast<uint32_t>(height);
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levelCount);
+
+    size_t offset = sizeof(kIdentifier) + sizeof(Header) + levelCount * sizeof(LevelIndex);
+    header.dfdByteOffset = static_cast<uint32_t>(offset);
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * 4);
+    offset += header.dfdByteLength;
+    header.kvdByteOffset = static_cast<uint32_t>(offset);
+    header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+    offset += kvd.size();
+
+    // Level data is stored smallest mip first, each level aligned to the block size
+    const size_t alignment = BlockCompression::BlockBytes(format);
+    std::vector<LevelIndex> index(levelCount);
+    for (size_t i = levelCount; i-- > 0;) {
+        offset = AlignUp(offset, alignment);
+        index[i] = { offset, levels[i].size(), levels[i].size() };
+        offset += levels[i].size();
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[Ktx2] Failed to write: " << filepath << std::endl;
+        return false;
+    }
+
+    size_t written = 0;
+    auto write = [&](const void* bytes, size_t count) {
+        file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+        written += count;
+    };
+    write(kIdentifier, sizeof(kIdentifier));
+    write(&header, sizeof(header));
+    write(index.data(), index.size() * sizeof(LevelIndex));
+    write(dfd.data(), dfd.size() * 4);
+    write(kvd.data(), kvd.size());
+
+    const char padding[16] = {};
+    for (size_t i = levelCount; i-- > 0;) {
+        write(padding, static_cast<size_t>(index[i].byteOffset) - written);
+        write(levels[i].data(), levels[i].size());
+    }
+    return file.good();
+}
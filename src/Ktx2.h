@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+
+/**
+ * Ktx2 - minimal KTX 2.0 container for block-compressed 2D textures
+ *
+ * Only what the cooker writes is supported: one face, one layer, no
+ * supercompression, BC1/BC3/BC5/BC7 with a full mip chain. Parse() works on
+ * memory (e.g. a MappedFile) and returns views into it - nothing is copied.
+ *
+ * Cooked data is stored bottom-up (OpenGL row order, KTXorientation "ru"),
+ * so the levels can be handed to glCompressedTexImage2D as they are.
+ */
+class Ktx2 {
+public:
+    // VkFormat values used in the header
+    enum : uint32_t {
+        VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+        VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+        VK_FORMAT_BC3_UNORM_BLOCK = 137,
+        VK_FORMAT_BC3_SRGB_BLOCK = 138,
+        VK_FORMAT_BC5_UNORM_BLOCK = 141,
+        VK_FORMAT_BC7_UNORM_BLOCK = 145,
+        VK_FORMAT_BC7_SRGB_BLOCK = 146
+    };
+
+    struct Level {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct Image {
+        uint32_t vkFormat = 0;
+        BlockCompression::Format format = BlockCompression::Format::BC1;
+        bool srgb = false;
+        int width = 0;
+        int height = 0;
+        std::vector<Level> levels;  // Level 0 first
+    };
+
+    static uint32_t VkFormatFor(BlockCompression::Format format, bool srgb);
+    static bool FromVkFormat(uint32_t vkFormat, BlockCompression::Format& outFormat, bool& outSrgb);
+
+    static bool Parse(const unsigned char* data, size_t size, Image& outImage);
+
+    // levels[0] is the full resolution level, each one already block-compressed
+    static bool Write(const std::string& filepath, BlockCompression::Format format, bool srgb,
+                      int width, int height, const std::vector<std::vector<unsigned char>>& levels);
+};
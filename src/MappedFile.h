@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * MappedFile - read-only memory mapping of a whole file
+ *
+ * The OS pages the data in on demand, so cooked assets can be handed to the
+ * driver without reading them into a heap buffer first.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::string& filepath);
+    void Close();
+
+    inline bool IsOpen() const { return m_Data != nullptr; }
+    inline const unsigned char* GetData() const { return m_Data; }
+    inline size_t GetSize() const { return m_Size; }
+
+private:
+    const unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
@@ -6,6 +6,7 @@
 
 struct Material {
     std::string name;
+    std::string libraryPath;    // MTL file the material was defined in
     
     // Colors (default to white)
     float ambient[3] = {1.0f, 1.0f, 1.0f};
@@ -0,0 +1,49 @@
+#include "MaterialBlocks.h"
+#include <algorithm>
+
+MaterialBlocks::MaterialBlocks()
+    : m_Stride(0), m_Capacity(0), m_FirstDirty(0) {
+    MaterialUniforms vertexColors;
+    MaterialUniforms textured;
+    textured.useTexture = 1;
+    m_Materials.push_back(vertexColors);
+    m_Materials.push_back(textured);
+}
+
+int MaterialBlocks::Add(const MaterialUniforms& material) {
+    m_Materials.push_back(material);
+    return static_cast<int>(m_Materials.size() - 1);
+}
+
+void MaterialBlocks::Set(int slot, const MaterialUniforms& material) {
+    m_Materials[slot] = material;
+    m_FirstDirty = std::min(m_FirstDirty, static_cast<size_t>(slot));
+}
+
+void MaterialBlocks::Upload() {
+    if (m_Stride == 0) {
+        const size_t alignment = UniformBuffer::GetOffsetAlignment();
+        m_Stride = (sizeof(MaterialUniforms) + alignment - 1) / alignment * alignment;
+    }
+    if (m_Materials.size() > m_Capacity) {
+        m_Capacity = std::max<size_t>(m_Materials.size() + m_Materials.size() / 2, 16);
+        m_Buffer.Allocate(m_Capacity * m_Stride);
+        m_FirstDirty = 0;
+    }
+    if (m_FirstDirty >= m_Materials.size())
+        return;
+
+    // Strided copy of the dirty tail, one glBufferSubData
+    std::vector<unsigned char> staging((m_Materials.size() - m_FirstDirty) * m_Stride);
+    for (size_t slot = m_FirstDirty; slot < m_Materials.size(); ++slot)
+        std::copy_n(reinterpret_cast<const unsigned char*>(&m_Materials[slot]), sizeof(MaterialUniforms),
+                    staging.data() + (slot - m_FirstDirty) * m_Stride);
+    m_Buffer.Update(m_FirstDirty * m_Stride, staging.data(), staging.size());
+    m_FirstDirty = m_Materials.size();
+}
+
+void MaterialBlocks::Bind(int slot) {
+    if (m_FirstDirty < m_Materials.size() || m_Materials.size() > m_Capacity)
+        Upload();
+    m_Buffer.BindRange(UniformBlock::Material, static_cast<size_t>(slot) * m_Stride, sizeof(MaterialUniforms));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "UniformBuffer.h"
+
+/**
+ * MaterialBlocks - std140 Material blocks sub-allocated from one uniform buffer
+ *
+ * Every material gets a slot at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+ * Switching materials is a single glBindBufferRange on UniformBlock::Material -
+ * no glUniform calls. Slot 0 (vertex colors) and slot 1 (textured) always exist.
+ *
+ * Add() / Set() only touch the CPU copy; the changed slots are uploaded on the
+ * next Bind(). The buffer grows when slots are added (GL thread only).
+ */
+class MaterialBlocks {
+public:
+    static constexpr int kVertexColors = 0;
+    static constexpr int kTextured = 1;
+
+    MaterialBlocks();
+
+    MaterialBlocks(const MaterialBlocks&) = delete;
+    MaterialBlocks& operator=(const MaterialBlocks&) = delete;
+
+    // Returns the new slot
+    int Add(const MaterialUniforms& material);
+    void Set(int slot, const MaterialUniforms& material);
+    inline const MaterialUniforms& Get(int slot) const { return m_Materials[slot]; }
+
+    // Points the Material binding at the slot
+    void Bind(int slot);
+
+    inline size_t GetCount() const { return m_Materials.size(); }
+
+private:
+    void Upload();
+
+    UniformBuffer m_Buffer;
+    std::vector<MaterialUniforms> m_Materials;
+    size_t m_Stride;            // Slot size rounded to the offset alignment, 0 until the first upload
+    size_t m_Capacity;          // In slots
+    size_t m_FirstDirty;        // Slots from here on need an upload
+};
@@ -1,17 +1,49 @@
 #include "Mesh.h"
+#include "MeshBVH.h"
+#include "InstanceBuffer.h"
+#include "GpuBufferArena.h"
+#include "GLState.h"
+#include "GeometryBuffer.h"
+#include <cmath>
 #include <iostream>
 
+namespace
+{
+    constexpr GLsizei kVertexStride = 8 * sizeof(float); // x, y, z, u, v, r, g, b
+
+    GpuBufferArena* s_vertexArena = nullptr;
+    GpuBufferArena* s_indexArena = nullptr;
+}
+
+void Mesh::SetBufferArenas(GpuBufferArena* vertices, GpuBufferArena* indices)
+{
+    s_vertexArena = vertices;
+    s_indexArena = indices;
+}
+
 Mesh::Mesh()
-    : m_vao(0), m_vbo(0), m_ebo(0), m_indexCount(0), m_hasGL(false)
+    : m_vertexCount(0), m_uvDensity(0.0f), m_cpuPolicy(CpuDataPolicy::Release),
+      m_vao(0), m_vbo(0), m_ebo(0),
+      m_vertexArena(nullptr), m_indexArena(nullptr),
+      m_vertexAlloc(GpuBufferArena::kInvalidHandle), m_indexAlloc(GpuBufferArena::kInvalidHandle),
+      m_indexCount(0), m_instanceBuffer(0), m_geometryBuffer(nullptr), m_hasGL(false)
 {
 }
 
-Mesh::Mesh(const OBJLoader::MeshData& data)
+Mesh::Mesh(const OBJLoader::MeshData& data, CpuDataPolicy policy)
     : Mesh()
 {
+    m_cpuPolicy = policy;
     SetData(data);
 }
 
+Mesh::Mesh(OBJLoader::MeshData&& data, CpuDataPolicy policy)
+    : Mesh()
+{
+    m_cpuPolicy = policy;
+    SetData(std::move(data));
+}
+
 Mesh::~Mesh()
 {
     DestroyGL();
@@ -21,7 +53,54 @@ void Mesh::SetData(const OBJLoader::MeshData& data)
 {
     m_vertices = data.vertices;
     m_indices = data.indices;
+    OnDataChanged();
+}
+
+void Mesh::SetData(OBJLoader::MeshData&& data)
+{
+    m_vertices = std::move(data.vertices);
+    m_indices = std::move(data.indices);
+    data.vertices.clear();
+    data.indices.clear();
+    OnDataChanged();
+}
+
+void Mesh::ReleaseCpuData()
+{
+    // swap mit leeren Vektoren, damit der Speicher wirklich freigegeben wird
+    std::vector<float>().swap(m_vertices);
+    std::vector<unsigned int>().swap(m_indices);
+}
+
+void Mesh::OnDataChanged()
+{
+    constexpr size_t stride = 8; // x, y, z, u, v, r, g, b
+    m_vertexCount = m_vertices.size() / stride;
     m_indexCount = static_cast<GLsizei>(m_indices.size());
+
+    m_bounds = AABB();
+    for (size_t i = 0; i + stride <= m_vertices.size(); i += stride)
+        m_bounds.Grow(glm::vec3(m_vertices[i], m_vertices[i + 1], m_vertices[i + 2]));
+
+    // UV-Dichte: Wurzel aus (UV-Flche / Weltflche) ber alle Dreiecke
+    double worldArea = 0.0, uvArea = 0.0;
+    for (size_t t = 0; t + 3 <= m_indices.size(); t += 3)
+    {
+        // Ungueltige Indizes (kaputte OBJ-Datei) ueberspringen
+        if (m_indices[t] >= m_vertexCount || m_indices[t + 1] >= m_vertexCount || m_indices[t + 2] >= m_vertexCount)
+            continue;
+        const float* v0 = &m_vertices[m_indices[t] * stride];
+        const float* v1 = &m_vertices[m_indices[t + 1] * stride];
+        const float* v2 = &m_vertices[m_indices[t + 2] * stride];
+        const glm::vec3 e1(v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]);
+        const glm::vec3 e2(v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]);
+        worldArea += 0.5 * glm::length(glm::cross(e1, e2));
+        uvArea += 0.5 * std::abs((v1[3] - v0[3]) * (v2[4] - v0[4]) - (v2[3] - v0[3]) * (v1[4] - v0[4]));
+    }
+    m_uvDensity = worldArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / worldArea)) : 0.0f;
+
+    // Neue Geometrie - eine vorhandene BVH passt nicht mehr
+    m_bvh.reset();
     // Falls bereits GL-Objekte existieren, neu aufbauen
     if (m_hasGL)
     {
@@ -40,31 +119,40 @@ bool Mesh::SetupGL()
     }
 
     // Erwarte, dass GL-Kontext und glad bereits initialisiert sind
-    // Generiere VAO/VBO/EBO
+    // Generiere VAO (+ VBO/EBO, falls keine Arenen gesetzt sind)
     glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glGenBuffers(1, &m_ebo);
+    GLState::BindVertexArray(m_vao);
 
-    glBindVertexArray(m_vao);
+    if (UploadToArenas())
+    {
+        // Seiten der Arenen - gezeichnet wird mit baseVertex und Index-Offset
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    }
+    else
+    {
+        glGenBuffers(1, &m_vbo);
+        glGenBuffers(1, &m_ebo);
 
-    // VBO
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER,
-        m_vertices.size() * sizeof(float),
-        m_vertices.data(),
-        GL_STATIC_DRAW);
+        // VBO
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER,
+            m_vertices.size() * sizeof(float),
+            m_vertices.data(),
+            GL_STATIC_DRAW);
 
-    // EBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-        m_indices.size() * sizeof(unsigned int),
-        m_indices.data(),
-        GL_STATIC_DRAW);
+        // EBO
+        GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+            m_indices.size() * sizeof(unsigned int),
+            m_indices.data(),
+            GL_STATIC_DRAW);
+    }
 
     // Vertex-Layout: Position (location = 0) mit 3 floats (x,y,z),
     //                TexCoords (location = 1) mit 2 floats (u,v),
     //                und Color (location = 2) mit 3 floats (r,g,b)
-    constexpr GLsizei stride = 8 * sizeof(float); // x, y, z, u, v, r, g, b
+    constexpr GLsizei stride = kVertexStride;
     
     // Position attribute (location = 0)
     glEnableVertexAttribArray(0);
@@ -79,12 +167,50 @@ bool Mesh::SetupGL()
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(5 * sizeof(float)));
 
     // Unbind VAO (EBO bleibt an VAO gebunden)
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::BindVertexArray(0);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 
     m_indexCount = static_cast<GLsizei>(m_indices.size());
     m_hasGL = true;
 
+    // Daten liegen jetzt auf der GPU - CPU-Kopie nur behalten, wenn gewünscht
+    if (m_cpuPolicy == CpuDataPolicy::Release)
+        ReleaseCpuData();
+
+    return true;
+}
+
+bool Mesh::BuildBVH(const std::string& cachePath)
+{
+    if (!HasCpuData())
+    {
+        std::cerr << "Mesh::BuildBVH: Keine CPU-Geometriedaten vorhanden "
+                  << "(vor SetupGL() aufrufen oder CpuDataPolicy::Keep verwenden).\n";
+        return false;
+    }
+
+    constexpr size_t stride = 8; // x, y, z, u, v, r, g, b
+    const size_t vertexCount = m_vertices.size() / stride;
+
+    auto bvh = std::make_unique<MeshBVH>();
+    if (!cachePath.empty())
+    {
+        uint64_t hash = MeshBVH::ComputeSourceHash(m_vertices.data(), vertexCount, stride,
+                                                   m_indices.data(), m_indices.size());
+        if (bvh->Load(cachePath, hash))
+        {
+            m_bvh = std::move(bvh);
+            return true;
+        }
+    }
+
+    if (!bvh->Build(m_vertices.data(), vertexCount, stride, m_indices.data(), m_indices.size()))
+        return false;
+
+    if (!cachePath.empty())
+        bvh->Save(cachePath);
+
+    m_bvh = std::move(bvh);
     return true;
 }
 
@@ -98,13 +224,91 @@ void Mesh::Draw() const
     if (m_indexCount == 0)
         return;
 
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    // Bleibt gebunden - GLState filtert das erneute Binden beim naechsten Draw
+    GLState::BindVertexArray(m_vao);
+    DrawBound();
+}
+
+void Mesh::BindGL() const
+{
+    if (m_hasGL)
+        GLState::BindVertexArray(m_vao);
+}
+
+void Mesh::DrawBound() const
+{
+    if (m_hasGL && m_indexCount > 0)
+        glDrawElementsBaseVertex(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT,
+                                 reinterpret_cast<const void*>(GetIndexBufferOffset()), GetBaseVertex());
+}
+
+void Mesh::AttachInstanceBuffer(GLuint buffer) const
+{
+    if (!m_hasGL || buffer == m_instanceBuffer)
+        return;
+
+    GLState::BindVertexArray(m_vao);
+    InstanceBuffer::SetupAttributes(buffer);
+    m_instanceBuffer = buffer;
+}
+
+void Mesh::DrawInstanced(GLsizei instanceCount, GLuint baseInstance) const
+{
+    if (m_hasGL && m_indexCount > 0 && instanceCount > 0)
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT,
+                                                      reinterpret_cast<const void*>(GetIndexBufferOffset()),
+                                                      instanceCount, GetBaseVertex(), baseInstance);
+}
+
+size_t Mesh::GetVertexBufferOffset() const
+{
+    return m_vertexArena ? m_vertexArena->GetOffset(m_vertexAlloc) : 0;
+}
+
+size_t Mesh::GetIndexBufferOffset() const
+{
+    return m_indexArena ? m_indexArena->GetOffset(m_indexAlloc) : 0;
+}
+
+GLint Mesh::GetBaseVertex() const
+{
+    // Die Arena richtet Vertex-Bloecke am Stride aus
+    return static_cast<GLint>(GetVertexBufferOffset() / kVertexStride);
+}
+
+bool Mesh::UploadToArenas()
+{
+    if (!s_vertexArena || !s_indexArena)
+        return false;
+
+    const size_t vertexBytes = m_vertices.size() * sizeof(float);
+    const size_t indexBytes = m_indices.size() * sizeof(unsigned int);
+    const GpuBufferArena::Handle vertices = s_vertexArena->Allocate(vertexBytes, kVertexStride);
+    const GpuBufferArena::Handle indices = s_indexArena->Allocate(indexBytes, sizeof(unsigned int));
+    if (vertices == GpuBufferArena::kInvalidHandle || indices == GpuBufferArena::kInvalidHandle)
+    {
+        s_vertexArena->Free(vertices);
+        s_indexArena->Free(indices);
+        return false;
+    }
+
+    m_vertexArena = s_vertexArena;
+    m_indexArena = s_indexArena;
+    m_vertexAlloc = vertices;
+    m_indexAlloc = indices;
+    m_vertexArena->Upload(vertices, m_vertices.data(), vertexBytes);
+    m_indexArena->Upload(indices, m_indices.data(), indexBytes);
+    m_vbo = m_vertexArena->GetBuffer(vertices);
+    m_ebo = m_indexArena->GetBuffer(indices);
+    return true;
 }
 
 void Mesh::DestroyGL()
 {
+    // Vor der Freigabe der Arena-Bloecke abmelden - der GeometryBuffer zeichnet aus ihnen,
+    // und ein spaeteres Mesh an derselben Adresse darf den Eintrag nicht erben
+    if (m_geometryBuffer)
+        m_geometryBuffer->Remove(*this);
     if (!m_hasGL)
         return;
 
@@ -114,8 +318,18 @@ void Mesh::DestroyGL()
 
 void Mesh::CleanupGLHandles()
 {
-    if (m_ebo != 0) { glDeleteBuffers(1, &m_ebo); m_ebo = 0; }
-    if (m_vbo != 0) { glDeleteBuffers(1, &m_vbo); m_vbo = 0; }
-    if (m_vao != 0) { glDeleteVertexArrays(1, &m_vao); m_vao = 0; }
+    if (m_vertexArena)
+    {
+        // Gemeinsame Seiten nicht loeschen, nur die Bloecke zurueckgeben
+        m_vertexArena->Free(m_vertexAlloc);
+        m_indexArena->Free(m_indexAlloc);
+        m_vertexArena = m_indexArena = nullptr;
+        m_vertexAlloc = m_indexAlloc = GpuBufferArena::kInvalidHandle;
+        m_vbo = m_ebo = 0;
+    }
+    if (m_ebo != 0) { GLState::DeleteBuffer(m_ebo); m_ebo = 0; }
+    if (m_vbo != 0) { GLState::DeleteBuffer(m_vbo); m_vbo = 0; }
+    if (m_vao != 0) { GLState::DeleteVertexArray(m_vao); m_vao = 0; }
     m_indexCount = 0;
+    m_instanceBuffer = 0;
 }
\ No newline at end of file
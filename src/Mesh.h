@@ -3,8 +3,16 @@
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <glad/glad.h>
 #include "OBJLoader.h" // benutzt die vorhandene OBJLoader::MeshData
+#include "Bounds.h"
+#include "Span.h"
+
+class MeshBVH;
+class GpuBufferArena;
+class GeometryBuffer;
 
 // Einfache Mesh-Klasse:
 // - Speichert vertices (hier: interleaved x,y,z,u,v,r,g,b) und indices
@@ -13,14 +21,36 @@
 class Mesh
 {
 public:
+    // Was mit den CPU-Kopien von vertices/indices nach dem GPU-Upload passiert.
+    // Release: nach SetupGL() freigeben (Standard, spart RAM)
+    // Keep:    behalten, z.B. für Kollision/Picking (BuildBVH, StaticBatcher, ...)
+    enum class CpuDataPolicy { Release, Keep };
+
     Mesh();
-    Mesh(const OBJLoader::MeshData& data);
+    Mesh(const OBJLoader::MeshData& data, CpuDataPolicy policy = CpuDataPolicy::Release);
+    Mesh(OBJLoader::MeshData&& data, CpuDataPolicy policy = CpuDataPolicy::Release);
     ~Mesh();
 
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // Gemeinsamer GPU-Speicher fuer alle danach mit SetupGL() hochgeladenen Meshes
+    // (nullptr = jedes Mesh bekommt eigene VBO/EBO). Die Arenen muessen die Meshes ueberleben.
+    static void SetBufferArenas(GpuBufferArena* vertices, GpuBufferArena* indices);
+
     // Setzt die Rohdaten (kopiert)
     void SetData(const OBJLoader::MeshData& data);
+    // Übernimmt vertices/indices per move (materials bleiben im MeshData des Aufrufers)
+    void SetData(OBJLoader::MeshData&& data);
+
+    void SetCpuDataPolicy(CpuDataPolicy policy) { m_cpuPolicy = policy; }
+    CpuDataPolicy GetCpuDataPolicy() const { return m_cpuPolicy; }
+
+    // Gibt die CPU-Kopien sofort frei (Anzahl und Bounds bleiben erhalten)
+    void ReleaseCpuData();
 
     // Erzeuge OpenGL-Objekte (VAO/VBO/EBO). Erwartet, dass gl context + glad initialisiert sind.
+    // Bei CpuDataPolicy::Release werden die CPU-Daten danach freigegeben.
     // Diese Methode richtet Attribut 0 (position: vec3), Attribut 1 (texcoord: vec2), 
     // und Attribut 2 (color: vec3) ein.
     // Rückgabe: true wenn erfolgreich (GL-Kontext vorhanden und Daten vorhanden)
@@ -29,27 +59,71 @@ public:
     // Zeichne das Mesh (ben�tigt ein gebundenes Shader-Programm)
     void Draw() const;
 
+    // Fuer Render-Queues: VAO einmal binden, dann beliebig oft zeichnen (kein Unbind dazwischen)
+    void BindGL() const;
+    void DrawBound() const;
+
+    // Instanced Zeichnen: Attribute 3-7 (InstanceData, Divisor 1) zeigen auf den Puffer.
+    // Wird pro Puffer nur einmal im VAO eingerichtet; danach BindGL() + DrawInstanced().
+    void AttachInstanceBuffer(GLuint buffer) const;
+    void DrawInstanced(GLsizei instanceCount, GLuint baseInstance) const;
+
     // L�scht die GL-Objekte (wird auch im Destruktor aufgerufen)
     void DestroyGL();
 
-    // Zugriffe auf Rohdaten
-    const std::vector<float>& GetVertices() const { return m_vertices; }
-    const std::vector<unsigned int>& GetIndices() const { return m_indices; }
+    // Zugriffe auf Rohdaten (leer, sobald die CPU-Daten freigegeben wurden)
+    Span<const float> GetVertices() const { return m_vertices; }
+    Span<const unsigned int> GetIndices() const { return m_indices; }
+    bool HasCpuData() const { return !m_vertices.empty() && !m_indices.empty(); }
+
+    // Bleiben auch nach ReleaseCpuData() gültig
+    size_t GetVertexCount() const { return m_vertexCount; }
+    GLsizei GetIndexCount() const { return m_indexCount; }
+    const AABB& GetBounds() const { return m_bounds; }
+    // Mittlere UV-Einheiten pro Welteinheit (Objektkoordinaten), 0 ohne UVs - siehe TexelDensity
+    float GetUVDensity() const { return m_uvDensity; }
+
+    // Baut die BVH für Picking/Sichtlinien (Raum: Objektkoordinaten des Meshes).
+    // Mit cachePath wird eine passende BVH aus der Datei geladen bzw. die neu gebaute dort gespeichert.
+    bool BuildBVH(const std::string& cachePath = "");
+    const MeshBVH* GetBVH() const { return m_bvh.get(); }
 
     bool HasGL() const { return m_hasGL; }
-    bool IsValid() const { return !m_vertices.empty() && !m_indices.empty(); }
+    // GL-Puffer (0 ohne SetupGL), z.B. zum Kopieren in einen GeometryBuffer
+    GLuint GetVertexBufferID() const { return m_vbo; }
+    GLuint GetIndexBufferID() const { return m_ebo; }
+    // Byte-Offsets der Daten in diesen Puffern (nur bei Arenen ungleich 0, aendern sich beim Defragmentieren)
+    size_t GetVertexBufferOffset() const;
+    size_t GetIndexBufferOffset() const;
+    bool IsValid() const { return m_hasGL || HasCpuData(); }
 
 private:
     std::vector<float> m_vertices;         // interleaved vertex attributes (x,y,z,u,v,r,g,b)
     std::vector<unsigned int> m_indices;
+    std::unique_ptr<MeshBVH> m_bvh;        // optional, siehe BuildBVH()
+    size_t m_vertexCount;
+    AABB m_bounds;                         // Objektkoordinaten
+    float m_uvDensity;
+    CpuDataPolicy m_cpuPolicy;
 
     // GL handles
     GLuint m_vao;
-    GLuint m_vbo;
+    GLuint m_vbo;                          // bei Arenen: deren Seite (gehoert nicht dem Mesh)
     GLuint m_ebo;
+    GpuBufferArena* m_vertexArena;         // nullptr = eigene VBO/EBO
+    GpuBufferArena* m_indexArena;
+    uint32_t m_vertexAlloc;
+    uint32_t m_indexAlloc;
     GLsizei m_indexCount;
+    mutable GLuint m_instanceBuffer;       // im VAO eingerichteter Instanz-Puffer, 0 = keiner
+    mutable GeometryBuffer* m_geometryBuffer; // zeichnet das Mesh aus seiner Arena-Seite, DestroyGL() meldet es dort ab
     bool m_hasGL;
 
+    friend class GeometryBuffer;
+
     // interne Helfer
     void CleanupGLHandles();
+    bool UploadToArenas();
+    GLint GetBaseVertex() const;
+    void OnDataChanged();
 };
\ No newline at end of file
@@ -0,0 +1,708 @@
+#include "MeshBVH.h"
+#include "BVHTraversal.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr int kBinCount = 12;
+constexpr uint32_t kMaxLeafSize = 8;
+constexpr uint32_t kParallelBuildThreshold = 4096;  // Subtrees larger than this build on the JobSystem
+constexpr int kMaxSahDepth = 64;                     // Deeper than this: median splits only
+constexpr size_t kStackSize = 128;
+constexpr float kTraversalCost = 1.0f;
+constexpr float kIntersectionCost = 1.0f;
+
+struct BuildPrim {
+    AABB bounds;
+    glm::vec3 centroid;
+};
+
+struct BuildContext {
+    const std::vector<BuildPrim>& prims;
+    std::vector<uint32_t>& order;
+};
+
+void SetNodeBounds(MeshBVH::Node& node, const AABB& bounds) {
+    node.bmin[0] = bounds.min.x; node.bmin[1] = bounds.min.y; node.bmin[2] = bounds.min.z;
+    node.bmax[0] = bounds.max.x; node.bmax[1] = bounds.max.y; node.bmax[2] = bounds.max.z;
+}
+
+// Builds the subtree over order[first, first + count) and appends it to 'out' in
+// depth-first order. Child indices are relative to the start of 'out'.
+void BuildRecursive(const BuildContext& ctx, uint32_t first, uint32_t count, int depth,
+                    std::vector<MeshBVH::Node>& out) {
+    AABB bounds, centroidBounds;
+    for (uint32_t i = first; i < first + count; ++i) {
+        const BuildPrim& prim = ctx.prims[ctx.order[i]];
+        bounds.Grow(prim.bounds);
+        centroidBounds.Grow(prim.centroid);
+    }
+
+    const uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+    out.push_back({});
+    SetNodeBounds(out[nodeIndex], bounds);
+
+    auto makeLeaf = [&]() {
+        out[nodeIndex].rightOrFirst = first;
+        out[nodeIndex].count = static_cast<uint16_t>(count);
+        out[nodeIndex].axis = 0;
+    };
+
+    if (count <= 2) {
+        makeLeaf();
+        return;
+    }
+
+    // Binned SAH over the centroid bounds
+    int bestAxis = -1;
+    int bestBin = -1;
+    float bestCost = FLT_MAX;
+    const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+
+    if (depth < kMaxSahDepth) {
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 1e-12f)
+                continue;
+
+            AABB binBounds[kBinCount];
+            uint32_t binCounts[kBinCount] = {};
+            const float scale = kBinCount / extent[axis];
+            for (uint32_t i = first; i < first + count; ++i) {
+                const BuildPrim& prim = ctx.prims[ctx.order[i]];
+                int bin = std::min(kBinCount - 1, static_cast<int>((prim.centroid[axis] - centroidBounds.min[axis]) * scale));
+                binBounds[bin].Grow(prim.bounds);
+                ++binCounts[bin];
+            }
+
+            // Sweep from the right to get the cost of every split plane
+            float rightArea[kBinCount - 1];
+            uint32_t rightCount[kBinCount - 1];
+            AABB acc;
+            uint32_t accCount = 0;
+            for (int i = kBinCount - 1; i > 0; --i) {
+                acc.Grow(binBounds[i]);
+                accCount += binCounts[i];
+                rightArea[i - 1] = acc.HalfArea();
+                rightCount[i - 1] = accCount;
+            }
+
+            acc = AABB();
+            accCount = 0;
+            for (int i = 0; i < kBinCount - 1; ++i) {
+                acc.Grow(binBounds[i]);
+                accCount += binCounts[i];
+                if (accCount == 0 || rightCount[i] == 0)
+                    continue;
+                float cost = accCount * acc.HalfArea() + rightCount[i] * rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = i;
+                }
+            }
+        }
+    }
+
+    const float parentArea = std::max(bounds.HalfArea(), 1e-20f);
+    const float leafCost = kIntersectionCost * count;
+    const float splitCost = kTraversalCost + kIntersectionCost * bestCost / parentArea;
+
+    if (count <= kMaxLeafSize && (bestAxis < 0 || splitCost >= leafCost)) {
+        makeLeaf();
+        return;
+    }
+
+    uint32_t mid = first;
+    int splitAxis = bestAxis;
+    if (bestAxis >= 0) {
+        const float scale = kBinCount / extent[bestAxis];
+        const float minC = centroidBounds.min[bestAxis];
+        auto it = std::partition(ctx.order.begin() + first, ctx.order.begin() + first + count,
+            [&](uint32_t p) {
+                int bin = std::min(kBinCount - 1, static_cast<int>((ctx.prims[p].centroid[bestAxis] - minC) * scale));
+                return bin <= bestBin;
+            });
+        mid = static_cast<uint32_t>(it - ctx.order.begin());
+    }
+
+    if (mid == first || mid == first + count) {
+        // No usable SAH split (identical centroids or depth limit) - median split on the largest axis
+        splitAxis = 0;
+        if (extent.y > extent[splitAxis]) splitAxis = 1;
+        if (extent.z > extent[splitAxis]) splitAxis = 2;
+        mid = first + count / 2;
+        std::nth_element(ctx.order.begin() + first, ctx.order.begin() + mid, ctx.order.begin() + first + count,
+            [&](uint32_t a, uint32_t b) { return ctx.prims[a].centroid[splitAxis] < ctx.prims[b].centroid[splitAxis]; });
+    }
+
+    out[nodeIndex].count = 0;
+    out[nodeIndex].axis = static_cast<uint16_t>(splitAxis);
+
+    const uint32_t leftCount = mid - first;
+    const uint32_t rightCount = count - leftCount;
+
+    if (count >= kParallelBuildThreshold) {
+        // Both halves touch disjoint ranges of 'order', so they can be built concurrently
+        std::vector<MeshBVH::Node> subtrees[2];
+        JobSystem::Get().ParallelFor(2, 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                if (i == 0)
+                    BuildRecursive(ctx, first, leftCount, depth + 1, subtrees[0]);
+                else
+                    BuildRecursive(ctx, mid, rightCount, depth + 1, subtrees[1]);
+            }
+        });
+
+        for (int s = 0; s < 2; ++s) {
+            const uint32_t base = static_cast<uint32_t>(out.size());
+            if (s == 1)
+                out[nodeIndex].rightOrFirst = base;
+            for (MeshBVH::Node node : subtrees[s]) {
+                if (!node.IsLeaf())
+                    node.rightOrFirst += base;
+                out.push_back(node);
+            }
+        }
+    } else {
+        BuildRecursive(ctx, first, leftCount, depth + 1, out);
+        out[nodeIndex].rightOrFirst = static_cast<uint32_t>(out.size());
+        BuildRecursive(ctx, mid, rightCount, depth + 1, out);
+    }
+}
+
+inline bool IntersectTriangle(const Ray& ray, const MeshBVH::Triangle& tri, float tMax,
+                              float& outT, float& outU, float& outV) {
+    const glm::vec3 p = glm::cross(ray.direction, tri.e2);
+    const float det = glm::dot(tri.e1, p);
+    if (std::fabs(det) < 1e-12f)
+        return false;
+
+    const float invDet = 1.0f / det;
+    const glm::vec3 s = ray.origin - tri.v0;
+    const float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    const glm::vec3 q = glm::cross(s, tri.e1);
+    const float v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    const float t = glm::dot(tri.e2, q) * invDet;
+    if (t < ray.tMin || t >= tMax)
+        return false;
+
+    outT = t;
+    outU = u;
+    outV = v;
+    return true;
+}
+
+// Slab test, returns the entry distance or FLT_MAX on a miss
+inline float IntersectNode(const MeshBVH::Node& node, const glm::vec3& origin, const glm::vec3& invDir,
+                           float tMin, float tMax) {
+    float tx0 = (node.bmin[0] - origin.x) * invDir.x, tx1 = (node.bmax[0] - origin.x) * invDir.x;
+    float ty0 = (node.bmin[1] - origin.y) * invDir.y, ty1 = (node.bmax[1] - origin.y) * invDir.y;
+    float tz0 = (node.bmin[2] - origin.z) * invDir.z, tz1 = (node.bmax[2] - origin.z) * invDir.z;
+    float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), tMin));
+    float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tMax));
+    return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+#if defined(RPG_SIMD_SSE2) || defined(RPG_SIMD_AVX)
+
+// Thin wrappers so the packet traversal below is written once for 4 and 8 lanes
+#if defined(RPG_SIMD_SSE2)
+struct F4 {
+    __m128 v;
+    static constexpr int Width = 4;
+    static F4 Load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static F4 Set(float f) { return { _mm_set1_ps(f) }; }
+    static F4 SetBits(uint32_t b) { return { _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(b))) }; }
+    static F4 AllOnes() { return { _mm_castsi128_ps(_mm_set1_epi32(-1)) }; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline F4 operator/(F4 a, F4 b) { return { _mm_div_ps(a.v, b.v) }; }
+inline F4 operator&(F4 a, F4 b) { return { _mm_and_ps(a.v, b.v) }; }
+inline F4 Min(F4 a, F4 b) { return { _mm_min_ps(a.v, b.v) }; }
+inline F4 Max(F4 a, F4 b) { return { _mm_max_ps(a.v, b.v) }; }
+inline F4 Less(F4 a, F4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline F4 LessEqual(F4 a, F4 b) { return { _mm_cmple_ps(a.v, b.v) }; }
+inline F4 Abs(F4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+inline F4 Select(F4 mask, F4 a, F4 b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+inline int MoveMask(F4 mask) { return _mm_movemask_ps(mask.v); }
+#endif
+
+#if defined(RPG_SIMD_AVX)
+struct F8 {
+    __m256 v;
+    static constexpr int Width = 8;
+    static F8 Load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static F8 Set(float f) { return { _mm256_set1_ps(f) }; }
+    static F8 SetBits(uint32_t b) { return { _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(b))) }; }
+    static F8 AllOnes() { return { _mm256_castsi256_ps(_mm256_set1_epi32(-1)) }; }
+    void Store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+inline F8 operator+(F8 a, F8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline F8 operator-(F8 a, F8 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline F8 operator*(F8 a, F8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline F8 operator/(F8 a, F8 b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline F8 operator&(F8 a, F8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline F8 Min(F8 a, F8 b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline F8 Max(F8 a, F8 b) { return { _mm256_max_ps(a.v, b.v) }; }
+inline F8 Less(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline F8 LessEqual(F8 a, F8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+inline F8 Abs(F8 a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+inline F8 Select(F8 mask, F8 a, F8 b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+inline int MoveMask(F8 mask) { return _mm256_movemask_ps(mask.v); }
+#endif
+
+// Closest-hit traversal of a whole packet. A node is visited if any lane hits it.
+template <class V>
+void TracePacket(const std::vector<MeshBVH::Node>& nodes, const std::vector<MeshBVH::Triangle>& triangles,
+                 const float* ox, const float* oy, const float* oz,
+                 const float* dx, const float* dy, const float* dz,
+                 const float* tMinIn, const float* tMaxIn, RayHit* outHits) {
+    constexpr int W = V::Width;
+    float inv[3][W];
+    for (int i = 0; i < W; ++i) {
+        inv[0][i] = SafeInverse(dx[i]);
+        inv[1][i] = SafeInverse(dy[i]);
+        inv[2][i] = SafeInverse(dz[i]);
+    }
+
+    const V Ox = V::Load(ox), Oy = V::Load(oy), Oz = V::Load(oz);
+    const V Dx = V::Load(dx), Dy = V::Load(dy), Dz = V::Load(dz);
+    const V Ix = V::Load(inv[0]), Iy = V::Load(inv[1]), Iz = V::Load(inv[2]);
+    const V TMin = V::Load(tMinIn);
+    const V Zero = V::Set(0.0f), One = V::Set(1.0f), Eps = V::Set(1e-12f);
+    V TMax = V::Load(tMaxIn);
+    V HitU = Zero, HitV = Zero;
+    V HitTri = V::SetBits(UINT32_MAX);
+
+    // Front-to-back order is picked from the first lane; packets are expected to be coherent
+    const bool dirNeg[3] = { dx[0] < 0.0f, dy[0] < 0.0f, dz[0] < 0.0f };
+
+    NodeStack<uint32_t, kStackSize> stack;
+    uint32_t nodeIndex = 0;
+
+    for (;;) {
+        const MeshBVH::Node& node = nodes[nodeIndex];
+
+        V t0x = (V::Set(node.bmin[0]) - Ox) * Ix, t1x = (V::Set(node.bmax[0]) - Ox) * Ix;
+        V t0y = (V::Set(node.bmin[1]) - Oy) * Iy, t1y = (V::Set(node.bmax[1]) - Oy) * Iy;
+        V t0z = (V::Set(node.bmin[2]) - Oz) * Iz, t1z = (V::Set(node.bmax[2]) - Oz) * Iz;
+        V tNear = Max(Max(Min(t0x, t1x), Min(t0y, t1y)), Max(Min(t0z, t1z), TMin));
+        V tFar = Min(Min(Max(t0x, t1x), Max(t0y, t1y)), Min(Max(t0z, t1z), TMax));
+
+        if (MoveMask(LessEqual(tNear, tFar)) != 0) {
+            if (node.IsLeaf()) {
+                for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i) {
+                    const MeshBVH::Triangle& tri = triangles[i];
+                    const V e1x = V::Set(tri.e1.x), e1y = V::Set(tri.e1.y), e1z = V::Set(tri.e1.z);
+                    const V e2x = V::Set(tri.e2.x), e2y = V::Set(tri.e2.y), e2z = V::Set(tri.e2.z);
+
+                    V px = Dy * e2z - Dz * e2y;
+                    V py = Dz * e2x - Dx * e2z;
+                    V pz = Dx * e2y - Dy * e2x;
+                    V det = e1x * px + e1y * py + e1z * pz;
+                    V invDet = One / det;
+
+                    V sx = Ox - V::Set(tri.v0.x), sy = Oy - V::Set(tri.v0.y), sz = Oz - V::Set(tri.v0.z);
+                    V u = (sx * px + sy * py + sz * pz) * invDet;
+                    V qx = sy * e1z - sz * e1y;
+                    V qy = sz * e1x - sx * e1z;
+                    V qz = sx * e1y - sy * e1x;
+                    V v = (Dx * qx + Dy * qy + Dz * qz) * invDet;
+                    V t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+                    V mask = Less(Eps, Abs(det)) & LessEqual(Zero, u) & LessEqual(Zero, v) &
+                             LessEqual(u + v, One) & LessEqual(TMin, t) & Less(t, TMax);
+                    if (MoveMask(mask) == 0)
+                        continue;
+
+                    TMax = Select(mask, t, TMax);
+                    HitU = Select(mask, u, HitU);
+                    HitV = Select(mask, v, HitV);
+                    HitTri = Select(mask, V::SetBits(tri.index), HitTri);
+                }
+            } else {
+                uint32_t nearChild = nodeIndex + 1;
+                uint32_t farChild = node.rightOrFirst;
+                if (dirNeg[node.axis])
+                    std::swap(nearChild, farChild);
+                stack.Push(farChild);
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        if (stack.Empty())
+            break;
+        nodeIndex = stack.Pop();
+    }
+
+    float tOut[W], uOut[W], vOut[W], triOut[W];
+    TMax.Store(tOut);
+    HitU.Store(uOut);
+    HitV.Store(vOut);
+    HitTri.Store(triOut);
+    for (int i = 0; i < W; ++i) {
+        RayHit hit;
+        std::memcpy(&hit.triangle, &triOut[i], sizeof(uint32_t));
+        if (hit.IsHit()) {
+            hit.t = tOut[i];
+            hit.u = uOut[i];
+            hit.v = vOut[i];
+        }
+        outHits[i] = hit;
+    }
+}
+
+#endif
+
+#if !defined(RPG_SIMD_SSE2)
+Ray RayFromPacket(const float* ox, const float* oy, const float* oz,
+                  const float* dx, const float* dy, const float* dz,
+                  const float* tMin, const float* tMax, int lane) {
+    Ray ray;
+    ray.origin = glm::vec3(ox[lane], oy[lane], oz[lane]);
+    ray.direction = glm::vec3(dx[lane], dy[lane], dz[lane]);
+    ray.tMin = tMin[lane];
+    ray.tMax = tMax[lane];
+    return ray;
+}
+#endif
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t nodeCount;
+    uint32_t triangleCount;
+    float bounds[6];
+};
+
+constexpr uint32_t kCacheVersion = 1;
+
+// Nodes are stored depth-first: the left child follows its parent, the right child comes
+// later still. Child links that only point forward also rule out cycles.
+bool ValidateNodes(const std::vector<MeshBVH::Node>& nodes, size_t triangleCount) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const MeshBVH::Node& node = nodes[i];
+        if (node.IsLeaf()) {
+            if (node.rightOrFirst > triangleCount || node.count > triangleCount - node.rightOrFirst)
+                return false;
+        } else if (node.axis > 2 || node.rightOrFirst <= i + 1 || node.rightOrFirst >= nodes.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void RayPacket4::Set(int lane, const Ray& ray) {
+    ox[lane] = ray.origin.x; oy[lane] = ray.origin.y; oz[lane] = ray.origin.z;
+    dx[lane] = ray.direction.x; dy[lane] = ray.direction.y; dz[lane] = ray.direction.z;
+    tMin[lane] = ray.tMin; tMax[lane] = ray.tMax;
+}
+
+void RayPacket8::Set(int lane, const Ray& ray) {
+    ox[lane] = ray.origin.x; oy[lane] = ray.origin.y; oz[lane] = ray.origin.z;
+    dx[lane] = ray.direction.x; dy[lane] = ray.direction.y; dz[lane] = ray.direction.z;
+    tMin[lane] = ray.tMin; tMax[lane] = ray.tMax;
+}
+
+bool MeshBVH::Build(const float* vertices, size_t vertexCount, size_t vertexStride,
+                    const unsigned int* indices, size_t indexCount) {
+    Clear();
+    if (!vertices || !indices || vertexCount == 0 || indexCount < 3 || vertexStride < 3) {
+        std::cerr << "[MeshBVH] Build: no geometry" << std::endl;
+        return false;
+    }
+
+    m_SourceHash = ComputeSourceHash(vertices, vertexCount, vertexStride, indices, indexCount);
+
+    const size_t triCount = indexCount / 3;
+    std::vector<BuildPrim> prims(triCount);
+    std::vector<Triangle> source(triCount);
+    std::vector<uint8_t> valid(triCount, 0);
+
+    JobSystem::Get().ParallelFor(triCount, 4096, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const unsigned int i0 = indices[t * 3 + 0], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+            if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+                continue;
+
+            const glm::vec3 p0(vertices[i0 * vertexStride], vertices[i0 * vertexStride + 1], vertices[i0 * vertexStride + 2]);
+            const glm::vec3 p1(vertices[i1 * vertexStride], vertices[i1 * vertexStride + 1], vertices[i1 * vertexStride + 2]);
+            const glm::vec3 p2(vertices[i2 * vertexStride], vertices[i2 * vertexStride + 1], vertices[i2 * vertexStride + 2]);
+
+            prims[t].bounds.Grow(p0);
+            prims[t].bounds.Grow(p1);
+            prims[t].bounds.Grow(p2);
+            prims[t].centroid = prims[t].bounds.Center();
+            source[t] = { p0, p1 - p0, p2 - p0, static_cast<uint32_t>(t) };
+            valid[t] = 1;
+        }
+    });
+
+    std::vector<uint32_t> order;
+    order.reserve(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        if (valid[t])
+            order.push_back(static_cast<uint32_t>(t));
+    }
+    if (order.size() != triCount)
+        std::cerr << "[MeshBVH] Build: skipped " << (triCount - order.size()) << " triangle(s) with invalid indices" << std::endl;
+    if (order.empty())
+        return false;
+
+    m_Nodes.reserve(order.size() / 2 + 1);
+    BuildContext ctx{ prims, order };
+    BuildRecursive(ctx, 0, static_cast<uint32_t>(order.size()), 0, m_Nodes);
+
+    m_Triangles.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        m_Triangles[i] = source[order[i]];
+
+    const Node& root = m_Nodes[0];
+    m_Bounds = AABB(glm::vec3(root.bmin[0], root.bmin[1], root.bmin[2]),
+                    glm::vec3(root.bmax[0], root.bmax[1], root.bmax[2]));
+    return true;
+}
+
+void MeshBVH::Clear() {
+    m_Nodes.clear();
+    m_Triangles.clear();
+    m_Bounds = AABB();
+    m_SourceHash = 0;
+}
+
+template <bool AnyHit>
+bool MeshBVH::Traverse(const Ray& ray, RayHit& hit) const {
+    if (m_Nodes.empty())
+        return false;
+
+    const glm::vec3 invDir = SafeInverse(ray.direction);
+    const bool dirNeg[3] = { ray.direction.x < 0.0f, ray.direction.y < 0.0f, ray.direction.z < 0.0f };
+
+    float tMax = ray.tMax;
+    bool found = false;
+
+    if (IntersectNode(m_Nodes[0], ray.origin, invDir, ray.tMin, tMax) == FLT_MAX)
+        return false;
+
+    NodeStack<uint32_t, kStackSize> stack;
+    uint32_t nodeIndex = 0;
+
+    for (;;) {
+        const Node& node = m_Nodes[nodeIndex];
+        if (node.IsLeaf()) {
+            for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i) {
+                float t, u, v;
+                if (IntersectTriangle(ray, m_Triangles[i], tMax, t, u, v)) {
+                    tMax = t;
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.triangle = m_Triangles[i].index;
+                    found = true;
+                    if (AnyHit)
+                        return true;
+                }
+            }
+        } else {
+            uint32_t nearChild = nodeIndex + 1;
+            uint32_t farChild = node.rightOrFirst;
+            if (dirNeg[node.axis])
+                std::swap(nearChild, farChild);
+
+            float tNear = IntersectNode(m_Nodes[nearChild], ray.origin, invDir, ray.tMin, tMax);
+            float tFar = IntersectNode(m_Nodes[farChild], ray.origin, invDir, ray.tMin, tMax);
+            if (tFar < tNear) {
+                std::swap(tNear, tFar);
+                std::swap(nearChild, farChild);
+            }
+
+            if (tNear != FLT_MAX) {
+                if (tFar != FLT_MAX)
+                    stack.Push(farChild);
+                nodeIndex = nearChild;
+                continue;
+            }
+        }
+
+        // Pop until we find a node that is still closer than the current hit
+        bool next = false;
+        while (!stack.Empty()) {
+            nodeIndex = stack.Pop();
+            if (IntersectNode(m_Nodes[nodeIndex], ray.origin, invDir, ray.tMin, tMax) != FLT_MAX) {
+                next = true;
+                break;
+            }
+        }
+        if (!next)
+            break;
+    }
+
+    return found;
+}
+
+bool MeshBVH::IntersectClosest(const Ray& ray, RayHit& outHit) const {
+    outHit = RayHit();
+    return Traverse<false>(ray, outHit);
+}
+
+bool MeshBVH::IntersectAny(const Ray& ray) const {
+    RayHit hit;
+    return Traverse<true>(ray, hit);
+}
+
+bool MeshBVH::IntersectSegment(const glm::vec3& a, const glm::vec3& b, RayHit* outHit) const {
+    Ray ray;
+    ray.origin = a;
+    ray.direction = b - a;  // Unnormalized, so t runs from 0 (a) to 1 (b)
+    ray.tMin = 0.0f;
+    ray.tMax = 1.0f;
+
+    if (outHit)
+        return IntersectClosest(ray, *outHit);
+    return IntersectAny(ray);
+}
+
+void MeshBVH::IntersectPacket4(const RayPacket4& packet, RayHit outHits[4]) const {
+    if (m_Nodes.empty()) {
+        for (int i = 0; i < 4; ++i)
+            outHits[i] = RayHit();
+        return;
+    }
+#if defined(RPG_SIMD_SSE2)
+    TracePacket<F4>(m_Nodes, m_Triangles, packet.ox, packet.oy, packet.oz,
+                    packet.dx, packet.dy, packet.dz, packet.tMin, packet.tMax, outHits);
+#else
+    for (int i = 0; i < 4; ++i)
+        IntersectClosest(RayFromPacket(packet.ox, packet.oy, packet.oz, packet.dx, packet.dy, packet.dz,
+                                       packet.tMin, packet.tMax, i), outHits[i]);
+#endif
+}
+
+void MeshBVH::IntersectPacket8(const RayPacket8& packet, RayHit outHits[8]) const {
+    if (m_Nodes.empty()) {
+        for (int i = 0; i < 8; ++i)
+            outHits[i] = RayHit();
+        return;
+    }
+#if defined(RPG_SIMD_AVX)
+    TracePacket<F8>(m_Nodes, m_Triangles, packet.ox, packet.oy, packet.oz,
+                    packet.dx, packet.dy, packet.dz, packet.tMin, packet.tMax, outHits);
+#elif defined(RPG_SIMD_SSE2)
+    // No AVX: trace as two 4-wide packets
+    for (int half = 0; half < 2; ++half) {
+        const int o = half * 4;
+        TracePacket<F4>(m_Nodes, m_Triangles, packet.ox + o, packet.oy + o, packet.oz + o,
+                        packet.dx + o, packet.dy + o, packet.dz + o, packet.tMin + o, packet.tMax + o, outHits + o);
+    }
+#else
+    for (int i = 0; i < 8; ++i)
+        IntersectClosest(RayFromPacket(packet.ox, packet.oy, packet.oz, packet.dx, packet.dy, packet.dz,
+                                       packet.tMin, packet.tMax, i), outHits[i]);
+#endif
+}
+
+uint64_t MeshBVH::ComputeSourceHash(const float* vertices, size_t vertexCount, size_t vertexStride,
+                                    const unsigned int* indices, size_t indexCount) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    for (size_t v = 0; v < vertexCount; ++v)
+        mix(vertices + v * vertexStride, 3 * sizeof(float));
+    mix(indices, indexCount * sizeof(unsigned int));
+    return hash;
+}
+
+bool MeshBVH::Save(const std::string& filepath) const {
+    if (m_Nodes.empty())
+        return false;
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[MeshBVH] Failed to write cache: " << filepath << std::endl;
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, "RBVH", 4);
+    header.version = kCacheVersion;
+    header.sourceHash = m_SourceHash;
+    header.nodeCount = static_cast<uint32_t>(m_Nodes.size());
+    header.triangleCount = static_cast<uint32_t>(m_Triangles.size());
+    header.bounds[0] = m_Bounds.min.x; header.bounds[1] = m_Bounds.min.y; header.bounds[2] = m_Bounds.min.z;
+    header.bounds[3] = m_Bounds.max.x; header.bounds[4] = m_Bounds.max.y; header.bounds[5] = m_Bounds.max.z;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_Nodes.data()), m_Nodes.size() * sizeof(Node));
+    file.write(reinterpret_cast<const char*>(m_Triangles.data()), m_Triangles.size() * sizeof(Triangle));
+    return file.good();
+}
+
+bool MeshBVH::Load(const std::string& filepath, uint64_t expectedSourceHash) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "RBVH", 4) != 0 || header.version != kCacheVersion) {
+        std::cerr << "[MeshBVH] Ignoring invalid cache: " << filepath << std::endl;
+        return false;
+    }
+    if (header.sourceHash != expectedSourceHash)
+        return false; // Stale cache - mesh changed since it was written
+
+    // The counts must match the file size before they are used to allocate
+    const std::streamoff dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    const uint64_t dataSize = static_cast<uint64_t>(file.tellg() - dataStart);
+    file.seekg(dataStart);
+    if (dataSize != static_cast<uint64_t>(header.nodeCount) * sizeof(Node) +
+                    static_cast<uint64_t>(header.triangleCount) * sizeof(Triangle)) {
+        std::cerr << "[MeshBVH] Cache size does not match its header: " << filepath << std::endl;
+        return false;
+    }
+
+    std::vector<Node> nodes(header.nodeCount);
+    std::vector<Triangle> triangles(header.triangleCount);
+    file.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(Node));
+    file.read(reinterpret_cast<char*>(triangles.data()), triangles.size() * sizeof(Triangle));
+    if (!file || nodes.empty()) {
+        std::cerr << "[MeshBVH] Truncated cache: " << filepath << std::endl;
+        return false;
+    }
+    if (!ValidateNodes(nodes, triangles.size())) {
+        std::cerr << "[MeshBVH] Corrupt cache (node out of range): " << filepath << std::endl;
+        return false;
+    }
+
+    m_Nodes = std::move(nodes);
+    m_Triangles = std::move(triangles);
+    m_SourceHash = header.sourceHash;
+    m_Bounds = AABB(glm::vec3(header.bounds[0], header.bounds[1], header.bounds[2]),
+                    glm::vec3(header.bounds[3], header.bounds[4], header.bounds[5]));
+    return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cfloat>
+#include "Bounds.h"
+#include "vendor/glm/glm.hpp"
+
+// Ray in mesh (object) space. Transform world rays with the inverse model matrix first.
+struct Ray {
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 direction{ 0.0f, 0.0f, 1.0f };
+    float tMin = 0.0f;
+    float tMax = FLT_MAX;
+};
+
+struct RayHit {
+    float t = FLT_MAX;
+    float u = 0.0f, v = 0.0f;          // Barycentrics of the hit (w = 1 - u - v)
+    uint32_t triangle = UINT32_MAX;    // Index of the triangle in the source index buffer (index / 3)
+
+    inline bool IsHit() const { return triangle != UINT32_MAX; }
+};
+
+// Structure-of-arrays ray packets for the SIMD packet queries
+struct RayPacket4 {
+    float ox[4], oy[4], oz[4];
+    float dx[4], dy[4], dz[4];
+    float tMin[4], tMax[4];
+
+    void Set(int lane, const Ray& ray);
+};
+
+struct RayPacket8 {
+    float ox[8], oy[8], oz[8];
+    float dx[8], dy[8], dz[8];
+    float tMin[8], tMax[8];
+
+    void Set(int lane, const Ray& ray);
+};
+
+/**
+ * MeshBVH - bounding volume hierarchy over the triangles of one mesh
+ *
+ * - Built with a binned SAH; large subtrees are built in parallel on the JobSystem
+ * - Flattened into a depth-first node array (left child directly follows its parent,
+ *   32 bytes per node) and a triangle array in leaf order
+ * - Keeps its own copy of the triangle positions, so queries keep working
+ *   after the mesh released its CPU-side vertex data
+ * - Can be saved to / loaded from a binary cache file next to the mesh
+ */
+class MeshBVH {
+public:
+    struct Node {
+        float bmin[3];
+        uint32_t rightOrFirst;  // Interior: index of the right child, Leaf: first triangle
+        float bmax[3];
+        uint16_t count;         // Number of triangles, 0 for interior nodes
+        uint16_t axis;          // Split axis of interior nodes (for ordered traversal)
+
+        inline bool IsLeaf() const { return count != 0; }
+    };
+
+    struct Triangle {
+        glm::vec3 v0, e1, e2;   // Precomputed edges for Moeller-Trumbore
+        uint32_t index;         // Source triangle index
+    };
+
+    MeshBVH() = default;
+
+    // Build over indexed triangles. vertexStride is the number of floats per vertex,
+    // position must be the first three floats (interleaved x,y,z,u,v,r,g,b works as is).
+    // Returns false if there is no valid geometry.
+    bool Build(const float* vertices, size_t vertexCount, size_t vertexStride,
+               const unsigned int* indices, size_t indexCount);
+
+    void Clear();
+
+    // Closest hit along the ray (within [tMin, tMax])
+    bool IntersectClosest(const Ray& ray, RayHit& outHit) const;
+
+    // True as soon as any triangle is hit (shadow / visibility style query)
+    bool IntersectAny(const Ray& ray) const;
+
+    // Line of sight: true if the segment from a to b is blocked by the mesh.
+    // If outHit is given, the closest blocking hit is reported (t in [0, 1] along the segment).
+    bool IntersectSegment(const glm::vec3& a, const glm::vec3& b, RayHit* outHit = nullptr) const;
+
+    // Packet queries - closest hit for 4 / 8 rays that are traced together.
+    // Coherent rays (e.g. picking rays around the cursor) profit the most.
+    void IntersectPacket4(const RayPacket4& packet, RayHit outHits[4]) const;
+    void IntersectPacket8(const RayPacket8& packet, RayHit outHits[8]) const;
+
+    // Binary cache. sourceHash identifies the geometry the BVH was built from;
+    // Load() fails if the stored hash does not match the expected one, or if the
+    // counts or any node's child / triangle range do not fit the file (rebuild then).
+    bool Save(const std::string& filepath) const;
+    bool Load(const std::string& filepath, uint64_t expectedSourceHash);
+
+    // Hash of the positions/indices a BVH would be built from (FNV-1a)
+    static uint64_t ComputeSourceHash(const float* vertices, size_t vertexCount, size_t vertexStride,
+                                      const unsigned int* indices, size_t indexCount);
+
+    inline bool IsValid() const { return !m_Nodes.empty(); }
+    inline const AABB& GetBounds() const { return m_Bounds; }
+    inline uint64_t GetSourceHash() const { return m_SourceHash; }
+    inline size_t GetNodeCount() const { return m_Nodes.size(); }
+    inline size_t GetTriangleCount() const { return m_Triangles.size(); }
+    inline const std::vector<Node>& GetNodes() const { return m_Nodes; }
+    inline const std::vector<Triangle>& GetTriangles() const { return m_Triangles; }
+
+private:
+    template <bool AnyHit>
+    bool Traverse(const Ray& ray, RayHit& hit) const;
+
+    std::vector<Node> m_Nodes;
+    std::vector<Triangle> m_Triangles;
+    AABB m_Bounds;
+    uint64_t m_SourceHash = 0;
+};
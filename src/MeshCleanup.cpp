@@ -0,0 +1,299 @@
+#include "MeshCleanup.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "vendor/glm/glm.hpp"
+
+namespace {
+
+constexpr size_t kStride = 8;         // x, y, z, u, v, r, g, b
+constexpr size_t kGrainSize = 4096;
+constexpr float kMaxCell = 4.0e18f;   // Cell coordinates are clamped to stay inside int64_t
+
+inline uint64_t HashCell(int64_t x, int64_t y, int64_t z) {
+    return (static_cast<uint64_t>(x) * 73856093ull) ^
+           (static_cast<uint64_t>(y) * 19349663ull) ^
+           (static_cast<uint64_t>(z) * 83492791ull);
+}
+
+struct CellEntry {
+    uint64_t hash;
+    uint32_t vertex;
+
+    bool operator<(const CellEntry& other) const {
+        return hash != other.hash ? hash < other.hash : vertex < other.vertex;
+    }
+};
+
+// Welds vertices that are within epsilon of each other. Returns remap[old] = representative.
+std::vector<uint32_t> WeldVertices(const std::vector<float>& vertices, size_t vertexCount,
+                                   const MeshCleanup::Options& options) {
+    JobSystem& jobs = JobSystem::Get();
+    const float cellSize = std::max(options.positionEpsilon, 1e-12f);
+    const float invCell = 1.0f / cellSize;
+    const float posEps2 = options.positionEpsilon * options.positionEpsilon;
+
+    // NaN / inf compare as "equal" in the distance test below, so such vertices are never welded
+    std::vector<uint8_t> finite(vertexCount);
+    jobs.ParallelFor(vertexCount, kGrainSize, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            finite[v] = 1;
+            for (size_t k = 0; k < kStride; ++k) {
+                if (!std::isfinite(vertices[v * kStride + k]))
+                    finite[v] = 0;
+            }
+        }
+    });
+
+    // Only called for finite vertices; far away positions share the clamped border cells
+    auto cellOf = [&](size_t v, int axis) {
+        const float cell = std::floor(vertices[v * kStride + axis] * invCell);
+        return static_cast<int64_t>(std::max(-kMaxCell, std::min(cell, kMaxCell)));
+    };
+
+    // Spatial hash grid: vertices sorted by the hash of their cell
+    std::vector<CellEntry> entries;
+    entries.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (finite[v])
+            entries.push_back({ 0, static_cast<uint32_t>(v) });
+    }
+    jobs.ParallelFor(entries.size(), kGrainSize, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const uint32_t v = entries[i].vertex;
+            entries[i].hash = HashCell(cellOf(v, 0), cellOf(v, 1), cellOf(v, 2));
+        }
+    });
+    std::sort(entries.begin(), entries.end());
+
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cellRanges;
+    cellRanges.reserve(vertexCount);
+    for (size_t i = 0; i < entries.size();) {
+        size_t j = i;
+        while (j < entries.size() && entries[j].hash == entries[i].hash)
+            ++j;
+        cellRanges.emplace(entries[i].hash, std::make_pair(static_cast<uint32_t>(i), static_cast<uint32_t>(j)));
+        i = j;
+    }
+
+    auto sameVertex = [&](size_t a, size_t b) {
+        const float* va = &vertices[a * kStride];
+        const float* vb = &vertices[b * kStride];
+        const float dx = va[0] - vb[0], dy = va[1] - vb[1], dz = va[2] - vb[2];
+        if (dx * dx + dy * dy + dz * dz > posEps2)
+            return false;
+        for (size_t k = 3; k < kStride; ++k) {
+            if (std::fabs(va[k] - vb[k]) > options.attributeEpsilon)
+                return false;
+        }
+        return true;
+    };
+
+    // For every vertex find the lowest-index match among the 27 neighbour cells.
+    // Independent per vertex, so this part runs in parallel.
+    std::vector<uint32_t> match(vertexCount);
+    jobs.ParallelFor(vertexCount, kGrainSize, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            uint32_t best = static_cast<uint32_t>(v);
+            if (!finite[v]) {
+                match[v] = best;
+                continue;
+            }
+            const int64_t cx = cellOf(v, 0), cy = cellOf(v, 1), cz = cellOf(v, 2);
+            for (int64_t dz = -1; dz <= 1; ++dz) {
+                for (int64_t dy = -1; dy <= 1; ++dy) {
+                    for (int64_t dx = -1; dx <= 1; ++dx) {
+                        auto it = cellRanges.find(HashCell(cx + dx, cy + dy, cz + dz));
+                        if (it == cellRanges.end())
+                            continue;
+                        for (uint32_t e = it->second.first; e < it->second.second; ++e) {
+                            const uint32_t other = entries[e].vertex;
+                            if (other >= best)
+                                break; // entries inside a cell are sorted by vertex index
+                            if (sameVertex(v, other))
+                                best = other;
+                        }
+                    }
+                }
+            }
+            match[v] = best;
+        }
+    });
+
+    // Resolve chains in index order: match[v] < v, so its representative is already final
+    std::vector<uint32_t> remap(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        remap[v] = match[v] == v ? static_cast<uint32_t>(v) : remap[match[v]];
+    return remap;
+}
+
+} // namespace
+
+MeshCleanup::Stats MeshCleanup::Run(OBJLoader::MeshData& mesh) {
+    return Run(mesh, Options());
+}
+
+MeshCleanup::Stats MeshCleanup::Run(OBJLoader::MeshData& mesh, const Options& options) {
+    Stats stats;
+    const size_t vertexCount = mesh.vertices.size() / kStride;
+    const size_t triangleCount = mesh.indices.size() / 3;
+    stats.verticesBefore = vertexCount;
+    stats.trianglesBefore = triangleCount;
+
+    if (vertexCount == 0 || triangleCount == 0) {
+        stats.verticesAfter = vertexCount;
+        stats.trianglesAfter = triangleCount;
+        return stats;
+    }
+
+    JobSystem& jobs = JobSystem::Get();
+
+    // 1) Weld
+    std::vector<uint32_t> remap;
+    if (options.weldVertices) {
+        remap = WeldVertices(mesh.vertices, vertexCount, options);
+    } else {
+        remap.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            remap[v] = static_cast<uint32_t>(v);
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] != v)
+            ++stats.weldedVertices;
+    }
+
+    // 2) Remap triangles and flag degenerate ones
+    std::vector<std::array<uint32_t, 3>> triangles(triangleCount);
+    std::vector<uint8_t> keep(triangleCount, 1);
+    jobs.ParallelFor(triangleCount, kGrainSize, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            std::array<uint32_t, 3>& tri = triangles[t];
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int index = mesh.indices[t * 3 + k];
+                tri[k] = index < vertexCount ? remap[index] : UINT32_MAX;
+            }
+            if (tri[0] == UINT32_MAX || tri[1] == UINT32_MAX || tri[2] == UINT32_MAX) {
+                keep[t] = 0; // Out of range index - treat as degenerate
+                continue;
+            }
+            if (!options.removeDegenerateTriangles)
+                continue;
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+                keep[t] = 0;
+                continue;
+            }
+            const float* p0 = &mesh.vertices[tri[0] * kStride];
+            const float* p1 = &mesh.vertices[tri[1] * kStride];
+            const float* p2 = &mesh.vertices[tri[2] * kStride];
+            const glm::vec3 e1(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]);
+            const glm::vec3 e2(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+            if (0.5f * glm::length(glm::cross(e1, e2)) <= options.areaEpsilon)
+                keep[t] = 0;
+        }
+    });
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!keep[t])
+            ++stats.degenerateTriangles;
+    }
+
+    // 3) Duplicates: rotate each triangle so its smallest index comes first (keeps winding),
+    //    sort and keep only the first occurrence of every key
+    if (options.removeDuplicateTriangles) {
+        struct TriKey {
+            uint32_t a, b, c, triangle;
+            bool operator<(const TriKey& o) const {
+                if (a != o.a) return a < o.a;
+                if (b != o.b) return b < o.b;
+                if (c != o.c) return c < o.c;
+                return triangle < o.triangle;
+            }
+        };
+        std::vector<TriKey> keys;
+        keys.reserve(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if (!keep[t])
+                continue;
+            const std::array<uint32_t, 3>& tri = triangles[t];
+            int first = 0;
+            if (tri[1] < tri[first]) first = 1;
+            if (tri[2] < tri[first]) first = 2;
+            keys.push_back({ tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3], static_cast<uint32_t>(t) });
+        }
+        std::sort(keys.begin(), keys.end());
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (keys[i].a == keys[i - 1].a && keys[i].b == keys[i - 1].b && keys[i].c == keys[i - 1].c) {
+                keep[keys[i].triangle] = 0;
+                ++stats.duplicateTriangles;
+            }
+        }
+    }
+
+    // 4) Compact: only vertices that are still referenced survive, in their original order
+    std::vector<uint32_t> newIndex(vertexCount, UINT32_MAX);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!keep[t])
+            continue;
+        for (uint32_t v : triangles[t])
+            newIndex[v] = 0;
+    }
+    uint32_t next = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (newIndex[v] != UINT32_MAX)
+            newIndex[v] = next++;
+    }
+    stats.unusedVertices = vertexCount - stats.weldedVertices - next;
+
+    std::vector<float> compacted(static_cast<size_t>(next) * kStride);
+    jobs.ParallelFor(vertexCount, kGrainSize, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            if (newIndex[v] == UINT32_MAX)
+                continue;
+            std::copy_n(&mesh.vertices[v * kStride], kStride, &compacted[static_cast<size_t>(newIndex[v]) * kStride]);
+        }
+    });
+
+    std::vector<unsigned int> indices;
+    indices.reserve(mesh.indices.size());
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!keep[t])
+            continue;
+        for (uint32_t v : triangles[t])
+            indices.push_back(newIndex[v]);
+    }
+
+    mesh.vertices = std::move(compacted);
+    mesh.indices = std::move(indices);
+
+    // Triangles keep their order, so each material range only shrinks by its removed triangles
+    size_t keptBefore = 0;
+    std::vector<OBJLoader::MaterialRange> ranges;
+    for (OBJLoader::MaterialRange& range : mesh.materialRanges) {
+        const size_t first = range.firstIndex / 3;
+        const size_t end = std::min((range.firstIndex + range.indexCount) / 3, triangleCount);
+        size_t kept = 0;
+        for (size_t t = first; t < end; ++t)
+            kept += keep[t];
+        range.firstIndex = keptBefore * 3;
+        range.indexCount = kept * 3;
+        keptBefore += kept;
+        if (kept > 0)
+            ranges.push_back(std::move(range));
+    }
+    mesh.materialRanges = std::move(ranges);
+
+    stats.verticesAfter = next;
+    stats.trianglesAfter = mesh.indices.size() / 3;
+
+    if (options.verbose) {
+        std::cout << "[MeshCleanup] Vertices: " << stats.verticesBefore << " -> " << stats.verticesAfter
+                  << " (welded " << stats.weldedVertices << ", unused " << stats.unusedVertices << ")" << std::endl;
+        std::cout << "[MeshCleanup] Triangles: " << stats.trianglesBefore << " -> " << stats.trianglesAfter
+                  << " (degenerate " << stats.degenerateTriangles << ", duplicate " << stats.duplicateTriangles << ")" << std::endl;
+    }
+    return stats;
+}
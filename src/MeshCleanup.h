@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include "OBJLoader.h"
+
+/**
+ * MeshCleanup - optional post-load pass over OBJLoader::MeshData
+ *
+ * LoadOBJ only merges vertices that are bit-for-bit identical. Exporters often
+ * emit positions that differ by float noise and zero-area triangles; this pass
+ * - welds vertices whose attributes are within an epsilon (spatial hash grid),
+ * - removes degenerate triangles (collapsed indices or ~zero area),
+ * - removes duplicate triangles (same vertices, same winding),
+ * - compacts the vertex buffer so no unused vertices remain.
+ * Triangle order is kept; MeshData::materialRanges are shrunk to match.
+ * Vertices with NaN / inf components are kept as they are and never welded.
+ * OBJLoader::LoadOBJ runs it when called with cleanup = true.
+ * Per-vertex work runs on the JobSystem, so large inputs scale with cores.
+ *
+ * Usage:
+ *   OBJLoader::LoadOBJ(path, data, true, true);          // cleanup = true: runs the pass after parsing
+ *   MeshCleanup::Stats stats = MeshCleanup::Run(data);   // or directly, e.g. on data built by hand
+ */
+class MeshCleanup {
+public:
+    struct Options {
+        float positionEpsilon = 1e-5f;   // Max distance between welded positions
+        float attributeEpsilon = 1e-4f;  // Max difference of UV / color components
+        float areaEpsilon = 1e-12f;      // Triangles with a smaller area are removed
+        bool weldVertices = true;
+        bool removeDegenerateTriangles = true;
+        bool removeDuplicateTriangles = true;
+        bool verbose = false;            // Log the stats after the pass
+    };
+
+    struct Stats {
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+        size_t trianglesBefore = 0;
+        size_t trianglesAfter = 0;
+        size_t weldedVertices = 0;       // Vertices merged into another vertex
+        size_t degenerateTriangles = 0;
+        size_t duplicateTriangles = 0;
+        size_t unusedVertices = 0;       // Unreferenced vertices dropped by the compaction
+    };
+
+    static Stats Run(OBJLoader::MeshData& mesh);
+    static Stats Run(OBJLoader::MeshData& mesh, const Options& options);
+};
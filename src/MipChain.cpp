@@ -0,0 +1,385 @@
+#include "MipChain.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "vendor/stb/stb_image.h"
+
+namespace {
+
+constexpr int kEncodeLutSize = 4096;
+constexpr size_t kRowGrain = 8;
+
+struct ColorLuts {
+    float decode[256];                      // sRGB byte -> linear
+    unsigned char encode[kEncodeLutSize];   // linear [0,1] quantized -> sRGB byte
+
+    ColorLuts() {
+        for (int i = 0; i < 256; ++i) {
+            const float c = i / 255.0f;
+            decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < kEncodeLutSize; ++i) {
+            const float l = i / static_cast<float>(kEncodeLutSize - 1);
+            const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            encode[i] = static_cast<unsigned char>(std::min(255.0f, c * 255.0f + 0.5f));
+        }
+    }
+};
+
+const ColorLuts& Luts() {
+    static const ColorLuts luts;
+    return luts;
+}
+
+inline unsigned char EncodeLinearByte(float v) {
+    v = std::min(std::max(v, 0.0f), 1.0f);
+    return static_cast<unsigned char>(v * 255.0f + 0.5f);
+}
+
+inline unsigned char EncodeSrgbByte(const ColorLuts& luts, float v) {
+    v = std::min(std::max(v, 0.0f), 1.0f);
+    return luts.encode[static_cast<int>(v * (kEncodeLutSize - 1) + 0.5f)];
+}
+
+void DecodeRow(const unsigned char* src, float* dst, int width, bool srgb) {
+    const ColorLuts& luts = Luts();
+    for (int x = 0; x < width; ++x) {
+        for (int c = 0; c < 3; ++c)
+            dst[x * 4 + c] = srgb ? luts.decode[src[x * 4 + c]] : src[x * 4 + c] * (1.0f / 255.0f);
+        dst[x * 4 + 3] = src[x * 4 + 3] * (1.0f / 255.0f);
+    }
+}
+
+void EncodeRow(const float* src, unsigned char* dst, int width, bool srgb) {
+    const ColorLuts& luts = Luts();
+    for (int x = 0; x < width; ++x) {
+        for (int c = 0; c < 3; ++c)
+            dst[x * 4 + c] = srgb ? EncodeSrgbByte(luts, src[x * 4 + c]) : EncodeLinearByte(src[x * 4 + c]);
+        dst[x * 4 + 3] = EncodeLinearByte(src[x * 4 + 3]);
+    }
+}
+
+// 2x2 box filter of two RGBA float rows into one. srcWidth == 1 repeats the column.
+void DownsampleRow(const float* row0, const float* row1, int srcWidth, float* dst, int dstWidth) {
+    int x = 0;
+    if (srcWidth > 1) {
+#if defined(RPG_SIMD_AVX)
+        // Two destination texels per iteration: s0 = [p0+q0, p1+q1], s1 = [p2+q2, p3+q3]
+        const __m256 quarter8 = _mm256_set1_ps(0.25f);
+        for (; x + 2 <= dstWidth; x += 2) {
+            const __m256 s0 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+            const __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+            const __m256 even = _mm256_permute2f128_ps(s0, s1, 0x20);
+            const __m256 odd = _mm256_permute2f128_ps(s0, s1, 0x31);
+            _mm256_storeu_ps(dst + x * 4, _mm256_mul_ps(_mm256_add_ps(even, odd), quarter8));
+        }
+#endif
+#if defined(RPG_SIMD_SSE2)
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for (; x < dstWidth; ++x) {
+            const float* a = row0 + x * 8;
+            const float* b = row1 + x * 8;
+            const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(a + 4)),
+                                          _mm_add_ps(_mm_loadu_ps(b), _mm_loadu_ps(b + 4)));
+            _mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, quarter));
+        }
+#endif
+    }
+    for (; x < dstWidth; ++x) {
+        const int x0 = x * 2;
+        const int x1 = srcWidth > 1 ? x0 + 1 : x0;
+        for (int c = 0; c < 4; ++c)
+            dst[x * 4 + c] = 0.25f * (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]);
+    }
+}
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    int32_t width;
+    int32_t height;
+    int32_t levelCount;
+    int32_t colorSpace;
+    int32_t sourceChannels;
+    uint32_t reserved;
+    uint64_t dataSize;
+};
+
+constexpr uint32_t kCacheVersion = 1;
+
+} // namespace
+
+int MipChain::LevelCount(int width, int height) {
+    int size = std::max(width, height);
+    int levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        ++levels;
+    }
+    return levels;
+}
+
+void MipChain::LayoutLevels(int width, int height) {
+    m_Levels.clear();
+    m_FirstLevel = 0;
+    size_t offset = 0;
+    const int count = LevelCount(width, height);
+    for (int i = 0; i < count; ++i) {
+        Level level;
+        level.width = std::max(1, width >> i);
+        level.height = std::max(1, height >> i);
+        level.offset = offset;
+        level.size = static_cast<size_t>(level.width) * level.height * 4;
+        offset += level.size;
+        m_Levels.push_back(level);
+    }
+    m_Data.resize(offset);
+}
+
+void MipChain::Build(const unsigned char* rgba, int width, int height, ColorSpace colorSpace) {
+    Clear();
+    if (!rgba || width <= 0 || height <= 0)
+        return;
+
+    m_ColorSpace = colorSpace;
+    LayoutLevels(width, height);
+    std::memcpy(m_Data.data(), rgba, m_Levels[0].size);
+    BuildLevels();
+}
+
+void MipChain::BuildLevels() {
+    const bool srgb = m_ColorSpace == ColorSpace::sRGB;
+    JobSystem& jobs = JobSystem::Get();
+
+    // Float copy of the previous level (level 0 is decoded row-pair by row-pair instead)
+    std::vector<float> source, target;
+
+    for (size_t i = 1; i < m_Levels.size(); ++i) {
+        const Level& src = m_Levels[i - 1];
+        const Level& dst = m_Levels[i];
+        target.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+        // 4 components per texel - same pitch for the byte levels and the float rows
+        const size_t srcPitch = static_cast<size_t>(src.width) * 4;
+        const size_t dstPitch = static_cast<size_t>(dst.width) * 4;
+
+        jobs.ParallelFor(static_cast<size_t>(dst.height), kRowGrain, [&](size_t begin, size_t end) {
+            std::vector<float> scratch(i == 1 ? srcPitch * 2 : 0);
+            for (size_t y = begin; y < end; ++y) {
+                const int y0 = static_cast<int>(y) * 2;
+                const int y1 = src.height > 1 ? y0 + 1 : y0;
+                const float* row0;
+                const float* row1;
+                if (i == 1) {
+                    DecodeRow(m_Data.data() + src.offset + y0 * srcPitch, scratch.data(), src.width, srgb);
+                    DecodeRow(m_Data.data() + src.offset + y1 * srcPitch, scratch.data() + srcPitch, src.width, srgb);
+                    row0 = scratch.data();
+                    row1 = scratch.data() + srcPitch;
+                } else {
+                    row0 = source.data() + y0 * srcPitch;
+                    row1 = source.data() + y1 * srcPitch;
+                }
+
+                float* out = target.data() + y * dstPitch;
+                DownsampleRow(row0, row1, src.width, out, dst.width);
+                EncodeRow(out, m_Data.data() + dst.offset + y * dstPitch, dst.width, srgb);
+            }
+        });
+        source.swap(target);
+    }
+}
+
+bool MipChain::LoadImage(const std::string& imagePath, bool useCache, ColorSpace colorSpace) {
+    // One mapping serves the hash and the decode
+    MappedFile file;
+    if (!file.Open(imagePath)) {
+        Clear();
+        return false;
+    }
+
+    const std::string cachePath = imagePath + ".mips";
+    const uint64_t hash = useCache ? HashData(file.GetData(), file.GetSize()) : 0;
+    if (useCache && hash != 0 && Load(cachePath, hash) && m_ColorSpace == colorSpace)
+        return true;
+
+    if (!DecodeImage(file.GetData(), file.GetSize(), colorSpace)) {
+        Clear();
+        return false;
+    }
+
+    if (useCache && hash != 0)
+        Save(cachePath, hash);
+    return true;
+}
+
+bool MipChain::DecodeImage(const unsigned char* data, size_t size, ColorSpace colorSpace) {
+    Clear();
+    m_ColorSpace = colorSpace;
+
+    // PNGs decode straight into level 0, flipped - no intermediate copy
+    PngDecoder::Info info;
+    if (PngDecoder::ReadInfo(data, size, info) && !info.interlaced) {
+        LayoutLevels(info.width, info.height);
+        if (PngDecoder::Decode(data, size, m_Data.data(), m_Levels[0].size)) {
+            m_SourceChannels = info.channels;
+            BuildLevels();
+            return true;
+        }
+        Clear();
+        m_ColorSpace = colorSpace;
+    }
+
+    // Everything else (JPEG, TGA, interlaced PNG, ...) goes through stb_image.
+    // Thread-local flag: the decode may run on a streaming thread
+    stbi_set_flip_vertically_on_load_thread(1);
+
+    int width = 0, height = 0, channels = 0;
+    unsigned char* pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 4);
+    if (!pixels)
+        return false;
+
+    Build(pixels, width, height, colorSpace);
+    m_SourceChannels = channels;
+    stbi_image_free(pixels);
+    return true;
+}
+
+bool MipChain::Save(const std::string& filepath, uint64_t sourceHash) const {
+    if (!IsValid() || m_FirstLevel != 0)
+        return false;
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[MipChain] Failed to write cache: " << filepath << std::endl;
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, "RMIP", 4);
+    header.version = kCacheVersion;
+    header.sourceHash = sourceHash;
+    header.width = GetWidth();
+    header.height = GetHeight();
+    header.levelCount = GetLevelCount();
+    header.colorSpace = static_cast<int32_t>(m_ColorSpace);
+    header.sourceChannels = m_SourceChannels;
+    header.dataSize = m_Data.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_Data.data()), m_Data.size());
+    return file.good();
+}
+
+bool MipChain::Load(const std::string& filepath, uint64_t expectedSourceHash) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "RMIP", 4) != 0 || header.version != kCacheVersion ||
+        header.width <= 0 || header.height <= 0) {
+        std::cerr << "[MipChain] Ignoring invalid cache: " << filepath << std::endl;
+        return false;
+    }
+    if (header.sourceHash != expectedSourceHash)
+        return false; // Stale cache - image changed since it was written
+
+    LayoutLevels(header.width, header.height);
+    if (header.levelCount >= 1)
+        TrimLevels(header.levelCount); // Trimmed chains are stored as they are
+    if (header.levelCount != GetLevelCount() || header.dataSize != m_Data.size()) {
+        std::cerr << "[MipChain] Ignoring invalid cache: " << filepath << std::endl;
+        Clear();
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(m_Data.data()), m_Data.size());
+    if (!file) {
+        std::cerr << "[MipChain] Truncated cache: " << filepath << std::endl;
+        Clear();
+        return false;
+    }
+
+    m_ColorSpace = static_cast<ColorSpace>(header.colorSpace);
+    m_SourceChannels = header.sourceChannels;
+    return true;
+}
+
+bool MipChain::LoadLevels(const std::string& filepath, int firstLevel, int endLevel) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "RMIP", 4) != 0 || header.version != kCacheVersion ||
+        header.width <= 0 || header.height <= 0) {
+        std::cerr << "[MipChain] Ignoring invalid cache: " << filepath << std::endl;
+        return false;
+    }
+
+    LayoutLevels(header.width, header.height);
+    if (header.levelCount >= 1)
+        TrimLevels(header.levelCount);
+    if (header.levelCount != GetLevelCount() || firstLevel < 0 || firstLevel >= endLevel || endLevel > GetLevelCount()) {
+        Clear();
+        return false;
+    }
+
+    // Levels are stored finest first, so the range is one contiguous read
+    m_Levels.resize(static_cast<size_t>(endLevel));
+    m_FirstLevel = firstLevel;
+    const size_t begin = m_Levels[firstLevel].offset;
+    m_Data.resize(m_Levels.back().offset + m_Levels.back().size - begin);
+
+    file.seekg(static_cast<std::streamoff>(sizeof(header) + begin));
+    file.read(reinterpret_cast<char*>(m_Data.data()), static_cast<std::streamsize>(m_Data.size()));
+    if (!file) {
+        std::cerr << "[MipChain] Truncated cache: " << filepath << std::endl;
+        Clear();
+        return false;
+    }
+
+    m_ColorSpace = static_cast<ColorSpace>(header.colorSpace);
+    m_SourceChannels = header.sourceChannels;
+    return true;
+}
+
+uint64_t MipChain::HashFile(const std::string& filepath) {
+    MappedFile file;
+    if (!file.Open(filepath))
+        return 0;
+    return HashData(file.GetData(), file.GetSize());
+}
+
+uint64_t MipChain::HashData(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void MipChain::TrimLevels(int levelCount) {
+    if (levelCount <= m_FirstLevel || levelCount >= GetLevelCount())
+        return;
+    m_Levels.resize(static_cast<size_t>(levelCount));
+    m_Data.resize(m_Levels.back().offset + m_Levels.back().size - m_Levels[m_FirstLevel].offset);
+}
+
+void MipChain::Clear() {
+    m_Levels.clear();
+    m_Data.clear();
+    m_FirstLevel = 0;
+    m_SourceChannels = 4;
+}
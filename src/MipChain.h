@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * MipChain - full RGBA8 mip chain built on the CPU
+ *
+ * Every level is a 2x2 box filter of the previous one (SSE / AVX when available,
+ * rows spread over the JobSystem). For sRGB data the filtering happens in linear
+ * space: texels are decoded through a LUT, averaged as floats, and re-encoded -
+ * averaging the encoded bytes directly would darken every minified texture.
+ * Alpha is always linear. The intermediate levels are kept as floats, so the
+ * 8-bit quantization error does not accumulate down the chain.
+ *
+ * Rows are stored bottom-up (OpenGL order), level 0 first, tightly packed.
+ * LoadImage() decodes a file (PngDecoder, stb_image for other formats) and caches the finished chain in "<image>.mips",
+ * keyed by a hash of the encoded file, so the filter only runs once per image.
+ * LoadLevels() reads just a range of levels from such a cache file (progressive
+ * streaming); the chain then only holds the data of [GetFirstLevel(), end).
+ */
+class MipChain {
+public:
+    enum class ColorSpace {
+        sRGB,       // Color textures - filtered in linear space
+        Linear      // Data textures (normal maps, masks) - filtered as stored
+    };
+
+    struct Level {
+        int width = 0;
+        int height = 0;
+        size_t offset = 0;  // Byte offset into GetData()
+        size_t size = 0;    // Bytes (width * height * 4)
+    };
+
+    // floor(log2(max(width, height))) + 1
+    static int LevelCount(int width, int height);
+
+    // Builds the chain from tightly packed RGBA8 rows (copied as level 0)
+    void Build(const unsigned char* rgba, int width, int height, ColorSpace colorSpace = ColorSpace::sRGB);
+
+    // Decodes an image (flipped for OpenGL) and builds or loads its chain.
+    // With useCache the chain is read from / written to imagePath + ".mips".
+    bool LoadImage(const std::string& imagePath, bool useCache, ColorSpace colorSpace = ColorSpace::sRGB);
+
+    bool Save(const std::string& filepath, uint64_t sourceHash) const;
+    bool Load(const std::string& filepath, uint64_t expectedSourceHash);
+    // Reads levels [firstLevel, endLevel) of a cache file without checking the source hash
+    bool LoadLevels(const std::string& filepath, int firstLevel, int endLevel);
+
+    // FNV-1a over the file contents, 0 if it can't be read
+    static uint64_t HashFile(const std::string& filepath);
+    static uint64_t HashData(const void* data, size_t size);
+
+    // Drops the levels after levelCount (e.g. atlases, whose gutters only cover the first few)
+    void TrimLevels(int levelCount);
+
+    void Clear();
+
+    inline bool IsValid() const { return !m_Levels.empty(); }
+    inline int GetWidth() const { return m_Levels.empty() ? 0 : m_Levels[0].width; }
+    inline int GetHeight() const { return m_Levels.empty() ? 0 : m_Levels[0].height; }
+    inline int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+    inline const Level& GetLevel(int level) const { return m_Levels[level]; }
+    inline int GetFirstLevel() const { return m_FirstLevel; }
+    inline const unsigned char* GetLevelData(int level) const {
+        return m_Data.data() + (m_Levels[level].offset - m_Levels[m_FirstLevel].offset);
+    }
+    inline const std::vector<unsigned char>& GetData() const { return m_Data; }
+    inline ColorSpace GetColorSpace() const { return m_ColorSpace; }
+    inline int GetSourceChannels() const { return m_SourceChannels; }
+
+private:
+    void LayoutLevels(int width, int height);
+    // Filters levels 1.. from level 0
+    void BuildLevels();
+    // PngDecoder for PNGs, stb_image for everything else (and PNGs it rejects)
+    bool DecodeImage(const unsigned char* data, size_t size, ColorSpace colorSpace);
+
+    std::vector<Level> m_Levels;
+    std::vector<unsigned char> m_Data;
+    ColorSpace m_ColorSpace = ColorSpace::sRGB;
+    int m_SourceChannels = 4;   // Channels in the source image (informational)
+    int m_FirstLevel = 0;       // Finest level with data (LoadLevels), 0 for full chains
+};
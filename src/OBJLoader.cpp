@@ -1,5 +1,8 @@
 #include "OBJLoader.h"
+#include "AssetManager.h"
 #include "Texture.h"
+#include "TextureAtlas.h"
+#include "MeshCleanup.h"
 #include <obj/objparser.h>
 #include <obj/mtlparser.h>
 #include <fstream>
@@ -7,6 +10,21 @@
 #include <iostream>
 #include <algorithm>
 
+static AssetManager* s_AssetManager = nullptr;
+static const TextureAtlas* s_TextureAtlas = nullptr;
+
+static std::shared_ptr<Texture> LoadStandaloneTexture(const std::string& path) {
+    return s_AssetManager ? s_AssetManager->LoadTexture(path).GetShared() : std::make_shared<Texture>(path);
+}
+
+void OBJLoader::SetAssetManager(AssetManager* assets) {
+    s_AssetManager = assets;
+}
+
+void OBJLoader::SetTextureAtlas(const TextureAtlas* atlas) {
+    s_TextureAtlas = atlas;
+}
+
 // Helper to resolve file paths relative to a base directory
 static std::string ResolvePath(const std::string& basePath, const std::string& filename) {
     // Extract directory from base path
@@ -27,7 +45,7 @@ static std::string ResolvePath(const std::string& basePath, const std::string& f
     return baseDir + normalizedFilename;
 }
 
-// Helper to load MTL file
+// Helper to load MTL file (textures: only the paths, see OBJLoader::LoadTextures)
 static bool LoadMTL(const std::string& mtlPath, std::map<std::string, Material>& materials) {
     std::cout << "[OBJLoader] Loading MTL file: " << mtlPath << std::endl;
     
@@ -42,6 +60,7 @@ static bool LoadMTL(const std::string& mtlPath, std::map<std::string, Material>&
     parser.beginMaterialSignal.connect([&](const std::string& name) {
         materials[name] = Material(name);
         currentMaterial = &materials[name];
+        currentMaterial->libraryPath = mtlPath;
         std::cout << "[MTL] New material: " << name << std::endl;
     });
     
@@ -88,15 +107,6 @@ static bool LoadMTL(const std::string& mtlPath, std::map<std::string, Material>&
             currentMaterial->diffuseTexturePath = fullTexPath;
             
             std::cout << "[MTL] map_Kd: " << texPath << " -> " << fullTexPath << std::endl;
-            
-            // Try to load the texture
-            auto texture = std::make_shared<Texture>(fullTexPath);
-            if (texture->IsValid()) {
-                currentMaterial->diffuseTexture = texture;
-                std::cout << "[MTL]   Texture loaded successfully!" << std::endl;
-            } else {
-                std::cerr << "[MTL]   Failed to load texture: " << fullTexPath << std::endl;
-            }
         }
     });
     
@@ -107,7 +117,49 @@ static bool LoadMTL(const std::string& mtlPath, std::map<std::string, Material>&
     return !materials.empty();
 }
 
-bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh) {
+void OBJLoader::LoadTextures(MeshData& mesh) {
+    for (auto& matPair : mesh.materials) {
+        Material& mat = matPair.second;
+        if (mat.diffuseTexture || mat.diffuseTexturePath.empty())
+            continue;
+
+        // Try to load the texture
+        // Atlas regions share the atlas texture; the UVs are remapped below
+        std::shared_ptr<Texture> texture;
+        if (s_TextureAtlas && s_TextureAtlas->GetTexture() && s_TextureAtlas->Find(mat.diffuseTexturePath))
+            texture = s_TextureAtlas->GetTexture();
+        else
+            texture = LoadStandaloneTexture(mat.diffuseTexturePath);
+        if (texture && texture->IsValid()) {
+            mat.diffuseTexture = texture;
+            std::cout << "[MTL] Texture loaded: " << mat.diffuseTexturePath << std::endl;
+        } else {
+            std::cerr << "[MTL] Failed to load texture: " << mat.diffuseTexturePath << std::endl;
+        }
+    }
+
+    if (s_TextureAtlas && s_TextureAtlas->GetTexture()) {
+        const auto& atlasTexture = s_TextureAtlas->GetTexture();
+        bool usesAtlas = false;
+        for (const auto& matPair : mesh.materials)
+            usesAtlas = usesAtlas || matPair.second.diffuseTexture == atlasTexture;
+
+        if (usesAtlas && !s_TextureAtlas->RemapUVs(mesh)) {
+            // UVs can't live in the atlas (tiling) - fall back to the standalone textures
+            for (auto& matPair : mesh.materials) {
+                Material& mat = matPair.second;
+                if (mat.diffuseTexture == atlasTexture) {
+                    auto texture = LoadStandaloneTexture(mat.diffuseTexturePath);
+                    mat.diffuseTexture = texture && texture->IsValid() ? texture : nullptr;
+                }
+            }
+        } else if (usesAtlas) {
+            std::cout << "[OBJLoader]   UVs remapped into texture atlas" << std::endl;
+        }
+    }
+}
+
+bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh, bool loadTextures, bool cleanup) {
     std::cout << "[OBJLoader] Loading OBJ file: " << filepath << std::endl;
     
     obj::objparser parser;
@@ -130,7 +182,7 @@ bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh) {
     
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    std::map<std::string, std::vector<unsigned int>> materialFaces;
+    std::vector<MaterialRange> materialRanges;
     
     std::string currentMtl;
     std::vector<obj::face_index> currentFace;
@@ -173,6 +225,10 @@ bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh) {
     
     parser.faceEndSignal.connect([&]() {
         if (currentFace.size() < 3) return;
+
+        // A new range whenever the material changes; the counts are filled in after parsing
+        if (materialRanges.empty() || materialRanges.back().material != currentMtl)
+            materialRanges.push_back({ currentMtl, indices.size(), 0 });
         
         // Get current material's diffuse color (default to white if no material)
         float matR = 1.0f, matG = 1.0f, matB = 1.0f;
@@ -242,6 +298,7 @@ bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh) {
     
     // Convert to interleaved format (x, y, z, u, v, r, g, b)
     outMesh.vertices.clear();
+    outMesh.vertices.reserve(vertices.size() * 8);
     for (const auto& v : vertices) {
         outMesh.vertices.push_back(v.x);
         outMesh.vertices.push_back(v.y);
@@ -253,11 +310,33 @@ bool OBJLoader::LoadOBJ(const std::string& filepath, MeshData& outMesh) {
         outMesh.vertices.push_back(v.b);
     }
     
-    outMesh.indices = indices;
+    outMesh.indices = std::move(indices);
+
+    outMesh.materialRanges.clear();
+    for (size_t i = 0; i < materialRanges.size(); ++i) {
+        MaterialRange& range = materialRanges[i];
+        const size_t end = i + 1 < materialRanges.size() ? materialRanges[i + 1].firstIndex : outMesh.indices.size();
+        range.indexCount = end - range.firstIndex;
+        if (range.indexCount > 0)
+            outMesh.materialRanges.push_back(std::move(range));
+    }
+    
+    // Weld float noise, drop degenerate / duplicate triangles (before the atlas remap,
+    // which needs the final vertex sharing)
+    if (cleanup) {
+        MeshCleanup::Run(outMesh);
+        if (outMesh.indices.empty()) {
+            std::cerr << "[OBJLoader] ERROR: OBJ file contains only degenerate geometry: " << filepath << std::endl;
+            return false;
+        }
+    }
+
+    if (loadTextures)
+        LoadTextures(outMesh);
     
     std::cout << "[OBJLoader] Successfully loaded OBJ: " << filepath << std::endl;
-    std::cout << "[OBJLoader]   Vertices: " << vertices.size() << std::endl;
-    std::cout << "[OBJLoader]   Triangles: " << indices.size() / 3 << std::endl;
+    std::cout << "[OBJLoader]   Vertices: " << outMesh.vertices.size() / 8 << std::endl;
+    std::cout << "[OBJLoader]   Triangles: " << outMesh.indices.size() / 3 << std::endl;
     std::cout << "[OBJLoader]   Has UVs: " << (outMesh.hasTexCoords ? "Yes" : "No") << std::endl;
     std::cout << "[OBJLoader]   Has Vertex Colors: " << (outMesh.hasVertexColors ? "Yes" : "No") << std::endl;
     std::cout << "[OBJLoader]   Materials: " << outMesh.materials.size() << std::endl;
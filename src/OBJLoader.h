@@ -3,31 +3,61 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 #include "Material.h"
+#include "Span.h"
+
+class TextureAtlas;
+class AssetManager;
 
 class OBJLoader {
 public:
     // Structure to hold mesh data with texture coordinates
+    // Consecutive triangles of one material (usemtl): indices [firstIndex, firstIndex + indexCount)
+    struct MaterialRange {
+        std::string material;               // Empty = faces before the first usemtl
+        size_t firstIndex = 0;
+        size_t indexCount = 0;
+    };
+
     struct MeshData {
         std::vector<float> vertices;        // Interleaved vertex data (x, y, z, u, v, r, g, b)
         std::vector<unsigned int> indices;  // Triangle indices
+        std::vector<MaterialRange> materialRanges; // In index order, covering all indices
         std::map<std::string, Material> materials; // Materials by name
         std::string activeMaterial;         // Currently active material name
         bool hasTexCoords = false;          // Whether mesh has texture coordinates
         bool hasVertexColors = false;       // Whether mesh has per-vertex material colors
     };
 
+    // map_Kd textures are loaded through the AssetManager (cached, shared between
+    // materials, streamed if it has a texture loader). nullptr: Texture(path), default
+    static void SetAssetManager(AssetManager* assets);
+
+    // Textures found in the atlas use the atlas texture, and the UVs of the
+    // loaded mesh are remapped into its region (nullptr disables, default)
+    static void SetTextureAtlas(const TextureAtlas* atlas);
+
     // Load an OBJ file and return mesh data with MTL support
     // Returns true on success, false on failure
-    static bool LoadOBJ(const std::string& filepath, MeshData& outMesh);
+    // Without loadTextures only the material texture paths are filled in - no GL
+    // calls, so the parse can run on a worker thread; call LoadTextures() on the
+    // main thread afterwards.
+    // With cleanup the mesh goes through MeshCleanup (epsilon welding, degenerate and
+    // duplicate triangle removal) before the textures are loaded.
+    static bool LoadOBJ(const std::string& filepath, MeshData& outMesh, bool loadTextures = true, bool cleanup = false);
+
+    // Loads the missing diffuse textures of the materials (atlas or standalone)
+    // and remaps the UVs into the atlas where possible
+    static void LoadTextures(MeshData& mesh);
     
-    // Get index data from mesh
-    static std::vector<unsigned int> GetIndexData(const MeshData& mesh) {
+    // Get index data from mesh (view, no copy - valid as long as the MeshData is unchanged)
+    static Span<const unsigned int> GetIndexData(const MeshData& mesh) {
         return mesh.indices;
     }
     
-    // Get interleaved vertex data from mesh (x, y, z, u, v, r, g, b)
-    static std::vector<float> GetInterleavedVertexData(const MeshData& mesh) {
+    // Get interleaved vertex data from mesh (x, y, z, u, v, r, g, b) (view, no copy)
+    static Span<const float> GetInterleavedVertexData(const MeshData& mesh) {
         return mesh.vertices;
     }
 };
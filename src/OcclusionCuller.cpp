@@ -0,0 +1,387 @@
+#include "OcclusionCuller.h"
+#include "Bounds.h"
+#include "JobSystem.h"
+#include "Simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Lane wrappers so the row loop below is written once for 8, 4 and 1 pixels
+#if defined(RPG_SIMD_AVX)
+struct V8 {
+    using Mask = __m256;
+    static constexpr int Width = 8;
+    __m256 v;
+
+    static V8 Set(float f) { return { _mm256_set1_ps(f) }; }
+    static V8 Ramp() { return { _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f) }; }
+    static Mask Inside(V8 e0, V8 e1, V8 e2) {
+        const __m256 zero = _mm256_setzero_ps();
+        return _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0.v, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1.v, zero, _CMP_GE_OQ)),
+                             _mm256_cmp_ps(e2.v, zero, _CMP_GE_OQ));
+    }
+    static bool Any(Mask mask) { return _mm256_movemask_ps(mask) != 0; }
+    // Depth test: nearer lanes write their depth and the owner id (blended as raw bits)
+    static void StoreMin(float* p, uint32_t* owners, Mask mask, V8 z, uint32_t owner) {
+        const __m256 old = _mm256_loadu_ps(p);
+        const __m256 nearer = _mm256_and_ps(mask, _mm256_cmp_ps(z.v, old, _CMP_LT_OQ));
+        _mm256_storeu_ps(p, _mm256_blendv_ps(old, z.v, nearer));
+        float* ownerBits = reinterpret_cast<float*>(owners);
+        const __m256 id = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(owner)));
+        _mm256_storeu_ps(ownerBits, _mm256_blendv_ps(_mm256_loadu_ps(ownerBits), id, nearer));
+    }
+};
+inline V8 operator+(V8 a, V8 b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline V8 operator*(V8 a, V8 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+using Lanes = V8;
+#elif defined(RPG_SIMD_SSE2)
+struct V4 {
+    using Mask = __m128;
+    static constexpr int Width = 4;
+    __m128 v;
+
+    static V4 Set(float f) { return { _mm_set1_ps(f) }; }
+    static V4 Ramp() { return { _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) }; }
+    static Mask Inside(V4 e0, V4 e1, V4 e2) {
+        const __m128 zero = _mm_setzero_ps();
+        return _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0.v, zero), _mm_cmpge_ps(e1.v, zero)), _mm_cmpge_ps(e2.v, zero));
+    }
+    static bool Any(Mask mask) { return _mm_movemask_ps(mask) != 0; }
+    // Depth test: nearer lanes write their depth and the owner id
+    static void StoreMin(float* p, uint32_t* owners, Mask mask, V4 z, uint32_t owner) {
+        const __m128 old = _mm_loadu_ps(p);
+        const __m128 nearer = _mm_and_ps(mask, _mm_cmplt_ps(z.v, old));
+        _mm_storeu_ps(p, _mm_or_ps(_mm_and_ps(nearer, z.v), _mm_andnot_ps(nearer, old)));
+        const __m128i select = _mm_castps_si128(nearer);
+        __m128i* ownerLanes = reinterpret_cast<__m128i*>(owners);
+        const __m128i id = _mm_set1_epi32(static_cast<int>(owner));
+        _mm_storeu_si128(ownerLanes, _mm_or_si128(_mm_and_si128(select, id), _mm_andnot_si128(select, _mm_loadu_si128(ownerLanes))));
+    }
+};
+inline V4 operator+(V4 a, V4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline V4 operator*(V4 a, V4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+using Lanes = V4;
+#else
+struct V1 {
+    using Mask = bool;
+    static constexpr int Width = 1;
+    float v;
+
+    static V1 Set(float f) { return { f }; }
+    static V1 Ramp() { return { 0.0f }; }
+    static Mask Inside(V1 e0, V1 e1, V1 e2) { return e0.v >= 0.0f && e1.v >= 0.0f && e2.v >= 0.0f; }
+    static bool Any(Mask mask) { return mask; }
+    static void StoreMin(float* p, uint32_t* owners, Mask mask, V1 z, uint32_t owner) {
+        if (mask && z.v < *p) {
+            *p = z.v;
+            *owners = owner;
+        }
+    }
+};
+inline V1 operator+(V1 a, V1 b) { return { a.v + b.v }; }
+inline V1 operator*(V1 a, V1 b) { return { a.v * b.v }; }
+using Lanes = V1;
+#endif
+
+// Edge functions E(x, y) = a * x + b * y + c (>= 0 inside) and the depth plane of one triangle
+struct TriangleSetup {
+    float a[3], b[3], c[3];
+    float z0, dzdx, dzdy;   // z(x, y) = z0 + dzdx * x + dzdy * y
+};
+
+template <class V>
+void RasterizeRow(float* row, uint32_t* ownerRow, int minX, int maxX, float py, const TriangleSetup& s, uint32_t owner) {
+    const V e0Row = V::Set(s.b[0] * py + s.c[0]);
+    const V e1Row = V::Set(s.b[1] * py + s.c[1]);
+    const V e2Row = V::Set(s.b[2] * py + s.c[2]);
+    const V zRow = V::Set(s.z0 + s.dzdy * py);
+    const V a0 = V::Set(s.a[0]), a1 = V::Set(s.a[1]), a2 = V::Set(s.a[2]);
+    const V dzdx = V::Set(s.dzdx);
+
+    // Start on a lane boundary - the row width is a multiple of every lane count
+    for (int x = minX - minX % V::Width; x <= maxX; x += V::Width) {
+        const V px = V::Set(static_cast<float>(x) + 0.5f) + V::Ramp();
+        const typename V::Mask inside = V::Inside(a0 * px + e0Row, a1 * px + e1Row, a2 * px + e2Row);
+        if (V::Any(inside))
+            V::StoreMin(row + x, ownerRow + x, inside, dzdx * px + zRow, owner);
+    }
+}
+
+// Signed distance to the near plane in clip space (z >= -w inside)
+inline float NearDistance(const glm::vec4& p) {
+    return p.z + p.w;
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : m_Width((std::max(width, kTileSize) + kTileSize - 1) / kTileSize * kTileSize),
+      m_Height((std::max(height, kTileSize) + kTileSize - 1) / kTileSize * kTileSize),
+      m_TilesX(0), m_TilesY(0), m_ViewProjection(1.0f), m_Rendered(false) {
+    m_TilesX = m_Width / kTileSize;
+    m_TilesY = m_Height / kTileSize;
+    m_Depth.assign(static_cast<size_t>(m_Width) * m_Height, 1.0f);
+    m_Owner.assign(static_cast<size_t>(m_Width) * m_Height, kNoOwner);
+    m_TileMaxDepth.assign(static_cast<size_t>(m_TilesX) * m_TilesY, 1.0f);
+}
+
+uint32_t OcclusionCuller::AddOccluder(Span<const float> vertices, size_t vertexStride, Span<const unsigned int> indices,
+                                      const glm::mat4& transform, uint32_t owner) {
+    Occluder occluder;
+    occluder.owner = owner;
+    occluder.positions.reserve(vertices.size() / vertexStride);
+    for (size_t v = 0; v + 2 < vertices.size(); v += vertexStride) {
+        const glm::vec3 position(transform * glm::vec4(vertices[v], vertices[v + 1], vertices[v + 2], 1.0f));
+        occluder.positions.push_back(position);
+        occluder.bounds.Grow(position);
+    }
+    occluder.indices.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    m_Occluders.push_back(std::move(occluder));
+    if (owner != kNoOwner && !HasOccluder(owner))
+        m_Owners.insert(std::lower_bound(m_Owners.begin(), m_Owners.end(), owner), owner);
+    return static_cast<uint32_t>(m_Occluders.size() - 1);
+}
+
+uint32_t OcclusionCuller::AddOccluderBox(const AABB& box, uint32_t owner) {
+    const float vertices[] = {
+        box.min.x, box.min.y, box.min.z,  box.max.x, box.min.y, box.min.z,
+        box.max.x, box.max.y, box.min.z,  box.min.x, box.max.y, box.min.z,
+        box.min.x, box.min.y, box.max.z,  box.max.x, box.min.y, box.max.z,
+        box.max.x, box.max.y, box.max.z,  box.min.x, box.max.y, box.max.z,
+    };
+    // Winding does not matter - both sides are rasterized
+    const unsigned int indices[] = {
+        0, 1, 2,  0, 2, 3,      // -z
+        4, 5, 6,  4, 6, 7,      // +z
+        0, 1, 5,  0, 5, 4,      // -y
+        3, 2, 6,  3, 6, 7,      // +y
+        0, 3, 7,  0, 7, 4,      // -x
+        1, 2, 6,  1, 6, 5,      // +x
+    };
+    return AddOccluder(Span<const float>(vertices, 24), 3, Span<const unsigned int>(indices, 36), glm::mat4(1.0f), owner);
+}
+
+void OcclusionCuller::ClearOccluders() {
+    m_Occluders.clear();
+    m_Owners.clear();
+    m_Triangles.clear();
+}
+
+bool OcclusionCuller::HasOccluder(uint32_t owner) const {
+    return std::binary_search(m_Owners.begin(), m_Owners.end(), owner);
+}
+
+void OcclusionCuller::Render(const glm::mat4& viewProjection, bool parallel) {
+    const auto start = std::chrono::steady_clock::now();
+    m_ViewProjection = viewProjection;
+    m_Triangles.clear();
+    m_Stats.occluders = 0;
+
+    // Transform, clip and set up on this thread - occluders have few triangles
+    const Frustum frustum = Frustum::FromMatrix(viewProjection);
+    std::vector<glm::vec4> clip;
+    for (const Occluder& occluder : m_Occluders) {
+        if (!frustum.Intersects(occluder.bounds))
+            continue;
+        ++m_Stats.occluders;
+
+        clip.resize(occluder.positions.size());
+        for (size_t i = 0; i < occluder.positions.size(); ++i)
+            clip[i] = viewProjection * glm::vec4(occluder.positions[i], 1.0f);
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+            const glm::vec4 corners[3] = { clip[occluder.indices[i]], clip[occluder.indices[i + 1]], clip[occluder.indices[i + 2]] };
+
+            // Clip against the near plane: 0 - 3 corners behind it give up to 4 vertices
+            glm::vec4 polygon[4];
+            int count = 0;
+            for (int k = 0; k < 3; ++k) {
+                const glm::vec4& current = corners[k];
+                const glm::vec4& next = corners[(k + 1) % 3];
+                const float dCurrent = NearDistance(current);
+                const float dNext = NearDistance(next);
+                if (dCurrent >= 0.0f)
+                    polygon[count++] = current;
+                if ((dCurrent >= 0.0f) != (dNext >= 0.0f))
+                    polygon[count++] = current + (next - current) * (dCurrent / (dCurrent - dNext));
+            }
+            for (int k = 1; k + 1 < count; ++k)
+                AddTriangle(polygon[0], polygon[k], polygon[k + 1], occluder.owner);
+        }
+    }
+    m_Stats.triangles = m_Triangles.size();
+
+    JobSystem& jobs = JobSystem::Get();
+    if (parallel && jobs.GetWorkerCount() > 0) {
+        // Bands of whole tile rows, a few per thread for load balancing
+        const size_t threads = jobs.GetWorkerCount() + 1;
+        const size_t grain = std::max<size_t>(1, m_TilesY / (threads * 2));
+        jobs.ParallelFor(static_cast<size_t>(m_TilesY), grain, [this](size_t begin, size_t end) {
+            RenderBand(static_cast<int>(begin), static_cast<int>(end));
+        });
+    } else {
+        RenderBand(0, m_TilesY);
+    }
+
+    m_Rendered = true;
+    m_Stats.renderMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, uint32_t owner) {
+    const glm::vec4* corners[3] = { &a, &b, &c };
+    ScreenTriangle triangle;
+    triangle.owner = owner;
+    for (int k = 0; k < 3; ++k) {
+        const glm::vec4& p = *corners[k];
+        const float inverseW = 1.0f / p.w;
+        triangle.x[k] = (p.x * inverseW * 0.5f + 0.5f) * static_cast<float>(m_Width);
+        triangle.y[k] = (p.y * inverseW * 0.5f + 0.5f) * static_cast<float>(m_Height);
+        triangle.z[k] = p.z * inverseW;
+    }
+
+    // Pixels whose centers (i + 0.5) can lie inside
+    const float minX = std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2]);
+    const float maxX = std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2]);
+    const float minY = std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2]);
+    const float maxY = std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2]);
+    if (maxX < 0.5f || maxY < 0.5f || minX > m_Width - 0.5f || minY > m_Height - 0.5f)
+        return;
+    triangle.minX = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+    triangle.maxX = std::min(m_Width - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+    triangle.minY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+    triangle.maxY = std::min(m_Height - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    m_Triangles.push_back(triangle);
+}
+
+void OcclusionCuller::RenderBand(int firstTileRow, int endTileRow) {
+    const int firstRow = firstTileRow * kTileSize;
+    const int endRow = endTileRow * kTileSize;
+    std::fill(m_Depth.begin() + static_cast<size_t>(firstRow) * m_Width,
+              m_Depth.begin() + static_cast<size_t>(endRow) * m_Width, 1.0f);
+    std::fill(m_Owner.begin() + static_cast<size_t>(firstRow) * m_Width,
+              m_Owner.begin() + static_cast<size_t>(endRow) * m_Width, kNoOwner);
+
+    for (const ScreenTriangle& triangle : m_Triangles) {
+        if (triangle.maxY < firstRow || triangle.minY >= endRow)
+            continue;
+
+        float x[3] = { triangle.x[0], triangle.x[1], triangle.x[2] };
+        float y[3] = { triangle.y[0], triangle.y[1], triangle.y[2] };
+        float z[3] = { triangle.z[0], triangle.z[1], triangle.z[2] };
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (std::fabs(area) < 1e-8f)
+            continue;
+        if (area < 0.0f) {
+            // Both sides are rasterized: make the winding counter-clockwise
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        TriangleSetup setup;
+        for (int k = 0; k < 3; ++k) {
+            // Each edge is set up from the same endpoint in both triangles that share it, so
+            // their edge functions are exact negatives and no pixel falls between them
+            int from = k, to = (k + 1) % 3;
+            const bool flip = y[to] < y[from] || (y[to] == y[from] && x[to] < x[from]);
+            if (flip)
+                std::swap(from, to);
+            const float a = y[from] - y[to];
+            const float b = x[to] - x[from];
+            const float c = -a * x[from] - b * y[from];
+            setup.a[k] = flip ? -a : a;
+            setup.b[k] = flip ? -b : b;
+            setup.c[k] = flip ? -c : c;
+        }
+        const float dx1 = x[1] - x[0], dy1 = y[1] - y[0], dz1 = z[1] - z[0];
+        const float dx2 = x[2] - x[0], dy2 = y[2] - y[0], dz2 = z[2] - z[0];
+        setup.dzdx = (dz1 * dy2 - dy1 * dz2) / area;
+        setup.dzdy = (dx1 * dz2 - dz1 * dx2) / area;
+        setup.z0 = z[0] - setup.dzdx * x[0] - setup.dzdy * y[0];
+
+        const int rowBegin = std::max(triangle.minY, firstRow);
+        const int rowEnd = std::min(triangle.maxY + 1, endRow);
+        for (int row = rowBegin; row < rowEnd; ++row)
+            RasterizeRow<Lanes>(m_Depth.data() + static_cast<size_t>(row) * m_Width, m_Owner.data() + static_cast<size_t>(row) * m_Width,
+                                triangle.minX, triangle.maxX, static_cast<float>(row) + 0.5f, setup, triangle.owner);
+    }
+
+    // HiZ: farthest depth of every tile
+    for (int tileY = firstTileRow; tileY < endTileRow; ++tileY) {
+        for (int tileX = 0; tileX < m_TilesX; ++tileX) {
+            float farthest = 0.0f;
+            for (int row = 0; row < kTileSize; ++row) {
+                const float* pixels = m_Depth.data() + static_cast<size_t>(tileY * kTileSize + row) * m_Width + tileX * kTileSize;
+                for (int column = 0; column < kTileSize; ++column)
+                    farthest = std::max(farthest, pixels[column]);
+            }
+            m_TileMaxDepth[static_cast<size_t>(tileY) * m_TilesX + tileX] = farthest;
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const AABB& box, uint32_t owner) const {
+    if (!m_Rendered || !box.IsValid())
+        return true;
+
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float nearest = FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 p((corner & 1) ? box.max.x : box.min.x,
+                          (corner & 2) ? box.max.y : box.min.y,
+                          (corner & 4) ? box.max.z : box.min.z);
+        const glm::vec4 clip = m_ViewProjection * glm::vec4(p, 1.0f);
+        if (NearDistance(clip) <= 0.0f || clip.w <= 0.0f)
+            return true;    // Reaches the camera
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        screenMin = glm::min(screenMin, glm::vec2(ndc));
+        screenMax = glm::max(screenMax, glm::vec2(ndc));
+        nearest = std::min(nearest, ndc.z);
+    }
+
+    // Every pixel the screen rectangle touches
+    const int minX = std::max(0, static_cast<int>(std::floor((screenMin.x * 0.5f + 0.5f) * m_Width)));
+    const int maxX = std::min(m_Width - 1, static_cast<int>(std::floor((screenMax.x * 0.5f + 0.5f) * m_Width)));
+    const int minY = std::max(0, static_cast<int>(std::floor((screenMin.y * 0.5f + 0.5f) * m_Height)));
+    const int maxY = std::min(m_Height - 1, static_cast<int>(std::floor((screenMax.y * 0.5f + 0.5f) * m_Height)));
+    if (minX > maxX || minY > maxY)
+        return true;    // Off screen - left to frustum culling
+
+    // Pixels written by the box's own occluders count as empty. The tiles do not know
+    // their owners, so such boxes skip the HiZ level and test every pixel.
+    const bool ownsOccluders = owner != kNoOwner && HasOccluder(owner);
+    for (int tileY = minY / kTileSize; tileY <= maxY / kTileSize; ++tileY) {
+        for (int tileX = minX / kTileSize; tileX <= maxX / kTileSize; ++tileX) {
+            if (!ownsOccluders && nearest > m_TileMaxDepth[static_cast<size_t>(tileY) * m_TilesX + tileX])
+                continue;   // Whole tile is in front of the box
+
+            const int rowBegin = std::max(minY, tileY * kTileSize);
+            const int rowEnd = std::min(maxY, tileY * kTileSize + kTileSize - 1);
+            const int columnBegin = std::max(minX, tileX * kTileSize);
+            const int columnEnd = std::min(maxX, tileX * kTileSize + kTileSize - 1);
+            for (int row = rowBegin; row <= rowEnd; ++row) {
+                const float* pixels = m_Depth.data() + static_cast<size_t>(row) * m_Width;
+                const uint32_t* owners = m_Owner.data() + static_cast<size_t>(row) * m_Width;
+                for (int column = columnBegin; column <= columnEnd; ++column) {
+                    if (pixels[column] >= nearest || (ownsOccluders && owners[column] == owner))
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void OcclusionCuller::Filter(std::vector<uint32_t>& indices, const BoundsOf& boundsOf) {
+    m_Stats.tested = indices.size();
+    indices.erase(std::remove_if(indices.begin(), indices.end(),
+                                 [this, &boundsOf](uint32_t index) { return !IsVisible(boundsOf(index), index); }),
+                  indices.end());
+    m_Stats.occluded = m_Stats.tested - indices.size();
+}
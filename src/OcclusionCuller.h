@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Bounds.h"
+#include "Span.h"
+#include "vendor/glm/glm.hpp"
+
+/**
+ * OcclusionCuller - software depth buffer for occlusion tests on the CPU
+ *
+ * Occluders are simplified, solid meshes (wall slabs, large props) kept in
+ * world space. Render() clips them against the near plane and rasterizes them
+ * into a small depth buffer (default 256 x 128, NDC depth, nearest wins) with
+ * SSE2 / AVX row loops; the screen is split into row bands that the JobSystem
+ * rasterizes in parallel. Each band then writes the farthest depth of its
+ * 8 x 8 tiles into a second level (HiZ).
+ *
+ * IsVisible() projects the corners of a box and compares its nearest depth
+ * against the tiles it covers first, then the pixels of the tiles that are
+ * not conclusive. Boxes that reach the near plane always count as visible.
+ *
+ * No GL involved - the depth buffer can be inspected / tested without a GPU.
+ * Occluders must not be larger than the objects they stand for, otherwise
+ * visible objects get culled. An occluder can name the object it stands for
+ * (owner = the index Filter() sees for it); the buffer remembers which owner
+ * wrote each pixel, and an object is never hidden by its own occluder.
+ *
+ * Usage:
+ *   OcclusionCuller occlusion;
+ *   occlusion.AddOccluderBox(wallBox, wallIndex);
+ *   occlusion.Render(projection * view);         // once per frame, after the camera moved
+ *   occlusion.Filter(visible, [&](uint32_t i) { return bounds[i]; });
+ */
+class OcclusionCuller {
+public:
+    static constexpr int kTileSize = 8;
+    static constexpr uint32_t kNoOwner = UINT32_MAX;
+
+    struct Stats {
+        size_t occluders = 0;       // Occluders inside the frustum last frame
+        size_t triangles = 0;       // Triangles rasterized after clipping
+        size_t tested = 0;          // Boxes passed to Filter()
+        size_t occluded = 0;
+        double renderMilliseconds = 0.0;
+    };
+
+    using BoundsOf = std::function<AABB(uint32_t index)>;
+
+    // Width and height are rounded up to multiples of kTileSize
+    explicit OcclusionCuller(int width = 256, int height = 128);
+
+    // Triangles of an interleaved vertex array (position = first three floats of each vertex)
+    uint32_t AddOccluder(Span<const float> vertices, size_t vertexStride, Span<const unsigned int> indices,
+                         const glm::mat4& transform = glm::mat4(1.0f), uint32_t owner = kNoOwner);
+    // Solid box, e.g. an authored wall volume or the inset bounds of a closed prop
+    uint32_t AddOccluderBox(const AABB& box, uint32_t owner = kNoOwner);
+    void ClearOccluders();
+
+    void Render(const glm::mat4& viewProjection, bool parallel = true);
+
+    // After Render(). Conservative: false only if the box is hidden behind occluders
+    // (other than the ones registered with this owner).
+    bool IsVisible(const AABB& box, uint32_t owner = kNoOwner) const;
+    // Removes the occluded entries from indices (order is kept); each index is its own owner
+    void Filter(std::vector<uint32_t>& indices, const BoundsOf& boundsOf);
+
+    inline int GetWidth() const { return m_Width; }
+    inline int GetHeight() const { return m_Height; }
+    inline size_t GetOccluderCount() const { return m_Occluders.size(); }
+    // NDC depth per pixel, row 0 at the bottom, 1.0 = nothing rasterized
+    inline const std::vector<float>& GetDepth() const { return m_Depth; }
+    // Owner of the occluder nearest at each pixel, kNoOwner where none is
+    inline const std::vector<uint32_t>& GetOwners() const { return m_Owner; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct ScreenTriangle {
+        float x[3], y[3];       // Pixel coordinates, y up
+        float z[3];             // NDC depth
+        int minX, maxX;         // Pixels whose centers may be covered, clamped to the buffer
+        int minY, maxY;
+        uint32_t owner;
+    };
+
+    struct Occluder {
+        std::vector<glm::vec3> positions;   // World space
+        std::vector<uint32_t> indices;
+        AABB bounds;
+        uint32_t owner;
+    };
+
+    void AddTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, uint32_t owner);
+    bool HasOccluder(uint32_t owner) const;
+    // Clears, rasterizes and builds the HiZ tiles of tile rows [firstTileRow, endTileRow)
+    void RenderBand(int firstTileRow, int endTileRow);
+
+    int m_Width;
+    int m_Height;
+    int m_TilesX;
+    int m_TilesY;
+    std::vector<Occluder> m_Occluders;
+    std::vector<ScreenTriangle> m_Triangles;
+    std::vector<float> m_Depth;             // m_Width * m_Height
+    std::vector<uint32_t> m_Owner;          // m_Width * m_Height, owner of the depth value
+    std::vector<uint32_t> m_Owners;         // Sorted owners of all occluders (kNoOwner excluded)
+    std::vector<float> m_TileMaxDepth;      // m_TilesX * m_TilesY
+    glm::mat4 m_ViewProjection;
+    bool m_Rendered;
+    Stats m_Stats;
+};
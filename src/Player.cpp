@@ -1,5 +1,6 @@
 #include "Player.h"
 #include "Mesh.h"
+#include "RenderQueue.h"
 #include "Shader.h"
 #include "vendor/glm/gtc/matrix_transform.hpp"
 #include <iostream>
@@ -109,6 +110,21 @@ void Player::Draw(Shader& shader) const
     m_mesh->Draw();
 }
 
+// Queue the player for a sorted RenderQueue flush
+void Player::Submit(RenderQueue& queue, Shader& shader, const Texture* texture) const
+{
+    if (!m_mesh || !m_mesh->HasGL()) {
+        return;
+    }
+
+    DrawPacket packet;
+    packet.mesh = m_mesh.get();
+    packet.shader = &shader;
+    packet.texture = texture;
+    packet.transform = glm::translate(glm::mat4(1.0f), m_position);
+    queue.Submit(packet);
+}
+
 // Mesh management
 void Player::SetMesh(std::shared_ptr<Mesh> mesh)
 {
@@ -0,0 +1,841 @@
+#include "PngDecoder.h"
+#include "Simd.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const unsigned char kSignature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+constexpr int kMaxDimension = 1 << 24;
+
+inline uint32_t ReadBE32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint32_t ChunkType(const char* name) {
+    return ReadBE32(reinterpret_cast<const unsigned char*>(name));
+}
+
+// ---------------------------------------------------------------------------
+// Inflate (RFC 1950 / 1951)
+// ---------------------------------------------------------------------------
+
+constexpr int kFastBits = 10;
+constexpr uint64_t kFastMask = (1u << kFastBits) - 1;
+
+// Canonical Huffman code. Codes up to kFastBits long are resolved with one
+// table lookup, longer ones with the canonical first-code search.
+struct Huffman {
+    uint16_t fast[1 << kFastBits];  // (length << 9) | symbol, 0 = not in the table
+    uint16_t firstCode[16];
+    uint16_t firstSymbol[16];
+    uint32_t maxCode[17];           // Exclusive, shifted up to 16 bits
+    uint8_t size[288];
+    uint16_t value[288];
+};
+
+inline int BitReverse16(int v) {
+    v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+    v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+    v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+    v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+    return v;
+}
+
+bool BuildHuffman(Huffman& h, const uint8_t* lengths, int count) {
+    int sizes[17] = {};
+    int nextCode[16] = {};
+    std::memset(h.fast, 0, sizeof(h.fast));
+    for (int i = 0; i < count; ++i)
+        ++sizes[lengths[i]];
+    sizes[0] = 0;
+    for (int i = 1; i < 16; ++i) {
+        if (sizes[i] > (1 << i))
+            return false;
+    }
+
+    int code = 0;
+    int symbol = 0;
+    for (int i = 1; i < 16; ++i) {
+        nextCode[i] = code;
+        h.firstCode[i] = static_cast<uint16_t>(code);
+        h.firstSymbol[i] = static_cast<uint16_t>(symbol);
+        code += sizes[i];
+        if (sizes[i] && code - 1 >= (1 << i))
+            return false;
+        h.maxCode[i] = static_cast<uint32_t>(code) << (16 - i);
+        code <<= 1;
+        symbol += sizes[i];
+    }
+    h.maxCode[16] = 0x10000;
+
+    for (int i = 0; i < count; ++i) {
+        const int length = lengths[i];
+        if (length == 0)
+            continue;
+        const int slot = nextCode[length] - h.firstCode[length] + h.firstSymbol[length];
+        h.size[slot] = static_cast<uint8_t>(length);
+        h.value[slot] = static_cast<uint16_t>(i);
+        if (length <= kFastBits) {
+            // Deflate sends codes MSB first into an LSB-first stream: index by the reversed code
+            const uint16_t entry = static_cast<uint16_t>((length << 9) | i);
+            for (int j = BitReverse16(nextCode[length]) >> (16 - length); j < (1 << kFastBits); j += 1 << length)
+                h.fast[j] = entry;
+        }
+        ++nextCode[length];
+    }
+    return true;
+}
+
+const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+struct FixedCodes {
+    Huffman literal;
+    Huffman distance;
+    FixedCodes() {
+        uint8_t lengths[288];
+        std::memset(lengths, 8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        BuildHuffman(literal, lengths, 288);
+        std::memset(lengths, 5, 30);
+        BuildHuffman(distance, lengths, 30);
+    }
+};
+
+const FixedCodes& GetFixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+// LSB-first bit reader. Kept as a value type so the hot loops can hold a copy
+// in registers - writes through the uint8_t output pointer may alias anything
+// reachable through memory.
+struct BitStream {
+    const uint8_t* in;
+    const uint8_t* end;
+    uint64_t bits;
+    int count;
+    size_t overrun;     // Zero bytes appended past the end of the input
+
+    // Keeps at least 56 bits buffered. Whole words are loaded while 8 bytes are
+    // left; bits above count are the following input and are OR'd in again later.
+    inline void Refill() {
+        if (end - in >= 8) {
+            uint64_t word;
+            std::memcpy(&word, in, 8);  // little endian
+            bits |= word << count;
+            const int bytes = (63 - count) >> 3;
+            in += bytes;
+            count += bytes << 3;
+        } else {
+            while (count <= 56) {
+                uint64_t byte = 0;
+                if (in < end)
+                    byte = *in++;
+                else
+                    ++overrun;
+                bits |= byte << count;
+                count += 8;
+            }
+        }
+    }
+
+    inline void Consume(int n) {
+        bits >>= n;
+        count -= n;
+    }
+
+    inline uint32_t Take(int n) {
+        const uint32_t value = static_cast<uint32_t>(bits & ((uint64_t(1) << n) - 1));
+        Consume(n);
+        return value;
+    }
+
+    // Needs 15 buffered bits
+    inline int Decode(const Huffman& h) {
+        const int entry = h.fast[bits & kFastMask];
+        if (entry) {
+            Consume(entry >> 9);
+            return entry & 511;
+        }
+        return DecodeSlow(h);
+    }
+
+    int DecodeSlow(const Huffman& h) {
+        const int code = BitReverse16(static_cast<int>(bits & 0xFFFF));
+        int length = kFastBits + 1;
+        while (static_cast<uint32_t>(code) >= h.maxCode[length])
+            ++length;
+        if (length >= 16)
+            return -1;
+        const int slot = (code >> (16 - length)) - h.firstCode[length] + h.firstSymbol[length];
+        if (slot >= 288 || h.size[slot] != length)
+            return -1;
+        Consume(length);
+        return h.value[slot];
+    }
+};
+
+class Inflater {
+public:
+    Inflater(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+        : m_Stream{ in, in + inSize, 0, 0, 0 }, m_Out(out), m_OutStart(out), m_OutEnd(out + outSize) {
+    }
+
+    // zlib stream: header, deflate blocks (the Adler-32 trailer is not checked)
+    bool Run() {
+        BitStream& s = m_Stream;
+        if (s.end - s.in < 2)
+            return false;
+        const int cmf = s.in[0];
+        const int flg = s.in[1];
+        if ((cmf * 256 + flg) % 31 != 0 || (cmf & 15) != 8 || (flg & 32) != 0)
+            return false;
+        s.in += 2;
+
+        bool final = false;
+        do {
+            s.Refill();
+            final = s.Take(1) != 0;
+            const uint32_t type = s.Take(2);
+            bool ok = false;
+            if (type == 0) {
+                ok = Stored();
+            } else if (type == 1) {
+                ok = Block(GetFixedCodes().literal, GetFixedCodes().distance);
+            } else if (type == 2) {
+                ok = ReadDynamicCodes() && Block(m_Literal, m_Distance);
+            }
+            if (!ok || s.overrun > 8)
+                return false;
+        } while (!final);
+        return true;
+    }
+
+    inline size_t Produced() const { return static_cast<size_t>(m_Out - m_OutStart); }
+
+private:
+    bool Stored() {
+        // Byte-align, then continue right after the bytes still held in the bit buffer
+        BitStream& s = m_Stream;
+        s.Consume(s.count & 7);
+        const size_t buffered = static_cast<size_t>(s.count >> 3);
+        if (s.overrun > buffered)
+            return false;
+        s.in -= buffered - s.overrun;
+        s.bits = 0;
+        s.count = 0;
+        s.overrun = 0;
+        if (s.end - s.in < 4)
+            return false;
+
+        const uint32_t length = s.in[0] | (s.in[1] << 8);
+        const uint32_t inverse = s.in[2] | (s.in[3] << 8);
+        s.in += 4;
+        if ((length ^ 0xFFFF) != inverse || static_cast<size_t>(s.end - s.in) < length ||
+            static_cast<size_t>(m_OutEnd - m_Out) < length)
+            return false;
+        std::memcpy(m_Out, s.in, length);
+        m_Out += length;
+        s.in += length;
+        return true;
+    }
+
+    bool ReadDynamicCodes() {
+        static const uint8_t kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        BitStream& s = m_Stream;
+        s.Refill();
+        const int literalCount = static_cast<int>(s.Take(5)) + 257;
+        const int distanceCount = static_cast<int>(s.Take(5)) + 1;
+        const int codeLengthCount = static_cast<int>(s.Take(4)) + 4;
+        if (literalCount > 286 || distanceCount > 30)
+            return false;
+
+        uint8_t codeLengths[19] = {};
+        for (int i = 0; i < codeLengthCount; ++i) {
+            s.Refill();
+            codeLengths[kOrder[i]] = static_cast<uint8_t>(s.Take(3));
+        }
+        if (!BuildHuffman(m_CodeLength, codeLengths, 19))
+            return false;
+
+        uint8_t lengths[286 + 30];
+        const int total = literalCount + distanceCount;
+        int n = 0;
+        while (n < total) {
+            s.Refill();
+            const int symbol = s.Decode(m_CodeLength);
+            if (symbol < 0 || symbol >= 19)
+                return false;
+            if (symbol < 16) {
+                lengths[n++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            int repeat = 0;
+            uint8_t fill = 0;
+            if (symbol == 16) {
+                if (n == 0)
+                    return false;
+                repeat = static_cast<int>(s.Take(2)) + 3;
+                fill = lengths[n - 1];
+            } else if (symbol == 17) {
+                repeat = static_cast<int>(s.Take(3)) + 3;
+            } else {
+                repeat = static_cast<int>(s.Take(7)) + 11;
+            }
+            if (total - n < repeat)
+                return false;
+            std::memset(lengths + n, fill, static_cast<size_t>(repeat));
+            n += repeat;
+        }
+        return BuildHuffman(m_Literal, lengths, literalCount) &&
+               BuildHuffman(m_Distance, lengths + literalCount, distanceCount);
+    }
+
+    bool Block(const Huffman& literal, const Huffman& distance) {
+        BitStream s = m_Stream;
+        uint8_t* out = m_Out;
+        uint8_t* const outStart = m_OutStart;
+        uint8_t* const outEnd = m_OutEnd;
+        bool ok = true;
+        for (;;) {
+            s.Refill();
+            int symbol = s.Decode(literal);
+            if (symbol < 256) {
+                if (symbol < 0 || out == outEnd) {
+                    ok = false;
+                    break;
+                }
+                *out++ = static_cast<uint8_t>(symbol);
+                // Literal runs: a second one still fits into the 56 buffered bits
+                symbol = s.Decode(literal);
+                if (symbol < 256) {
+                    if (symbol < 0 || out == outEnd) {
+                        ok = false;
+                        break;
+                    }
+                    *out++ = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                s.Refill();
+            }
+            if (symbol == 256)
+                break;
+            symbol -= 257;
+            if (symbol >= 29) {
+                ok = false;
+                break;
+            }
+
+            // 15 + 5 + 15 + 13 bits: one refill covers the whole match
+            const size_t length = kLengthBase[symbol] + s.Take(kLengthExtra[symbol]);
+            const int distanceSymbol = s.Decode(distance);
+            if (distanceSymbol < 0 || distanceSymbol >= 30) {
+                ok = false;
+                break;
+            }
+            const size_t dist = kDistBase[distanceSymbol] + s.Take(kDistExtra[distanceSymbol]);
+            if (dist > static_cast<size_t>(out - outStart) || length > static_cast<size_t>(outEnd - out)) {
+                ok = false;
+                break;
+            }
+
+            const uint8_t* from = out - dist;
+            if (dist >= 8 && static_cast<size_t>(outEnd - out) >= length + 8) {
+                // Word copies; the source is always already written. May overshoot by up to 7 bytes.
+                uint8_t* end = out + length;
+                do {
+                    std::memcpy(out, from, 8);
+                    out += 8;
+                    from += 8;
+                } while (out < end);
+                out = end;
+            } else if (dist == 1) {
+                std::memset(out, *from, length);
+                out += length;
+            } else {
+                for (size_t i = 0; i < length; ++i)
+                    out[i] = from[i];
+                out += length;
+            }
+        }
+        m_Stream = s;
+        m_Out = out;
+        return ok;
+    }
+
+    BitStream m_Stream;
+    uint8_t* m_Out;
+    uint8_t* m_OutStart;
+    uint8_t* m_OutEnd;
+    Huffman m_Literal;
+    Huffman m_Distance;
+    Huffman m_CodeLength;
+};
+
+// ---------------------------------------------------------------------------
+// Unfiltering. prior is the previous unfiltered row (zeros for the first one).
+// ---------------------------------------------------------------------------
+
+inline uint8_t Paeth(int a, int b, int c) {
+    const int pa = std::abs(b - c);
+    const int pb = std::abs(a - c);
+    const int pc = std::abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc)
+        return static_cast<uint8_t>(a);
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+void UnfilterScalar(int filter, const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n, int bpp) {
+    const size_t step = static_cast<size_t>(bpp);
+    switch (filter) {
+    case 1:
+        for (size_t i = 0; i < step && i < n; ++i)
+            dst[i] = src[i];
+        for (size_t i = step; i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + dst[i - step]);
+        break;
+    case 2:
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + prior[i]);
+        break;
+    case 3:
+        for (size_t i = 0; i < step && i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + (prior[i] >> 1));
+        for (size_t i = step; i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + ((dst[i - step] + prior[i]) >> 1));
+        break;
+    case 4:
+        for (size_t i = 0; i < step && i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + prior[i]);
+        for (size_t i = step; i < n; ++i)
+            dst[i] = static_cast<uint8_t>(src[i] + Paeth(dst[i - step], prior[i], prior[i - step]));
+        break;
+    default:
+        if (dst != src)
+            std::memcpy(dst, src, n);
+        break;
+    }
+}
+
+#ifdef RPG_SIMD_SSE2
+// Sub / Avg / Paeth depend on the pixel to the left, so these work one pixel
+// (all its channels) per step; Up has no such dependency and takes 16 bytes.
+
+// 3 byte pixels are loaded as 4 bytes while a 4th one follows in the row (wide)
+// and always stored as 4 - destination rows of 3 byte pixels need 1 byte of slack.
+template <int Bpp>
+inline __m128i LoadPixel(const uint8_t* p, bool wide) {
+    int value = 0;
+    if (Bpp == 4 || wide)
+        std::memcpy(&value, p, 4);
+    else
+        std::memcpy(&value, p, Bpp);
+    return _mm_cvtsi32_si128(value);
+}
+
+inline void StorePixel(uint8_t* p, __m128i v) {
+    const int value = _mm_cvtsi128_si32(v);
+    std::memcpy(p, &value, 4);
+}
+
+void UnfilterUpSSE2(const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi8(x, b));
+    }
+    for (; i < n; ++i)
+        dst[i] = static_cast<uint8_t>(src[i] + prior[i]);
+}
+
+template <int Bpp>
+void UnfilterSubSSE2(const uint8_t* src, uint8_t* dst, size_t n) {
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + Bpp <= n; i += Bpp) {
+        const bool wide = i + 4 <= n;
+        a = _mm_add_epi8(a, LoadPixel<Bpp>(src + i, wide));
+        StorePixel(dst + i, a);
+    }
+}
+
+template <int Bpp>
+void UnfilterAvgSSE2(const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i + Bpp <= n; i += Bpp) {
+        const bool wide = i + 4 <= n;
+        const __m128i b = LoadPixel<Bpp>(prior + i, wide);
+        // (a + b) >> 1 without widening: the rounding average minus the rounding bit
+        __m128i average = _mm_avg_epu8(a, b);
+        average = _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(LoadPixel<Bpp>(src + i, wide), average);
+        StorePixel(dst + i, a);
+    }
+}
+
+inline __m128i Abs16(__m128i v) {
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+inline __m128i Select(__m128i mask, __m128i whenTrue, __m128i whenFalse) {
+    return _mm_or_si128(_mm_and_si128(mask, whenTrue), _mm_andnot_si128(mask, whenFalse));
+}
+
+template <int Bpp>
+void UnfilterPaethSSE2(const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n) {
+    // 16-bit lanes throughout: only the work that depends on the previous pixel (a)
+    // is on the serial path, the rest is computed from b and c ahead of it
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+    __m128i a = zero;
+    __m128i c = zero;
+    for (size_t i = 0; i + Bpp <= n; i += Bpp) {
+        const bool wide = i + 4 <= n;
+        const __m128i b = _mm_unpacklo_epi8(LoadPixel<Bpp>(prior + i, wide), zero);
+        const __m128i x = _mm_unpacklo_epi8(LoadPixel<Bpp>(src + i, wide), zero);
+
+        // pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+        const __m128i paRaw = _mm_sub_epi16(b, c);
+        const __m128i pa = Abs16(paRaw);
+        const __m128i pbRaw = _mm_sub_epi16(a, c);
+        const __m128i pb = Abs16(pbRaw);
+        const __m128i pc = Abs16(_mm_add_epi16(paRaw, pbRaw));
+
+        // Ties prefer a, then b - as in the spec
+        const __m128i useB = _mm_cmpgt_epi16(pb, pc);               // true: c beats b
+        const __m128i bc = Select(useB, c, b);
+        const __m128i notA = _mm_cmpgt_epi16(pa, _mm_min_epi16(pb, pc));
+        const __m128i nearest = Select(notA, bc, a);
+        const __m128i d = _mm_and_si128(_mm_add_epi16(x, nearest), lowByte);
+        StorePixel(dst + i, _mm_packus_epi16(d, d));
+
+        a = d;
+        c = b;
+    }
+}
+
+template <int Bpp>
+void UnfilterSSE2(int filter, const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n) {
+    switch (filter) {
+    case 1: UnfilterSubSSE2<Bpp>(src, dst, n); break;
+    case 2: UnfilterUpSSE2(src, dst, prior, n); break;
+    case 3: UnfilterAvgSSE2<Bpp>(src, dst, prior, n); break;
+    case 4: UnfilterPaethSSE2<Bpp>(src, dst, prior, n); break;
+    default:
+        if (dst != src)
+            std::memcpy(dst, src, n);
+        break;
+    }
+}
+#endif
+
+void Unfilter(int filter, const uint8_t* src, uint8_t* dst, const uint8_t* prior, size_t n, int bpp) {
+#ifdef RPG_SIMD_SSE2
+    if (bpp == 4) {
+        UnfilterSSE2<4>(filter, src, dst, prior, n);
+        return;
+    }
+    if (bpp == 3) {
+        UnfilterSSE2<3>(filter, src, dst, prior, n);
+        return;
+    }
+    if (filter == 2) {
+        UnfilterUpSSE2(src, dst, prior, n);
+        return;
+    }
+#endif
+    UnfilterScalar(filter, src, dst, prior, n, bpp);
+}
+
+// ---------------------------------------------------------------------------
+// Chunk parsing and RGBA expansion
+// ---------------------------------------------------------------------------
+
+struct Image {
+    PngDecoder::Info info;
+    uint8_t palette[256 * 4];
+    bool hasKey = false;            // tRNS color key (gray / RGB)
+    uint16_t key[3] = {};
+    std::vector<uint8_t> idatStorage;
+    const uint8_t* idat = nullptr;  // Points into the file if there is a single IDAT chunk
+    size_t idatSize = 0;
+};
+
+int SamplesPerPixel(int colorType) {
+    switch (colorType) {
+    case 0: return 1;
+    case 2: return 3;
+    case 3: return 1;
+    case 4: return 2;
+    case 6: return 4;
+    default: return 0;
+    }
+}
+
+bool ValidDepth(int colorType, int depth) {
+    switch (colorType) {
+    case 0: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+    case 3: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+    case 2: case 4: case 6: return depth == 8 || depth == 16;
+    default: return false;
+    }
+}
+
+bool ParseHeader(const uint8_t* data, size_t size, PngDecoder::Info& info) {
+    if (size < 8 + 8 + 13 + 4 || std::memcmp(data, kSignature, 8) != 0)
+        return false;
+    const uint8_t* chunk = data + 8;
+    if (ReadBE32(chunk) != 13 || ReadBE32(chunk + 4) != ChunkType("IHDR"))
+        return false;
+    const uint8_t* ihdr = chunk + 8;
+    const uint32_t width = ReadBE32(ihdr);
+    const uint32_t height = ReadBE32(ihdr + 4);
+    info.bitDepth = ihdr[8];
+    info.colorType = ihdr[9];
+    info.interlaced = ihdr[12] != 0;
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension ||
+        !ValidDepth(info.colorType, info.bitDepth) || ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] > 1)
+        return false;
+    info.width = static_cast<int>(width);
+    info.height = static_cast<int>(height);
+    info.channels = info.colorType == 3 ? 3 : SamplesPerPixel(info.colorType);
+    return true;
+}
+
+bool ParseChunks(const uint8_t* data, size_t size, Image& image) {
+    if (!ParseHeader(data, size, image.info))
+        return false;
+
+    for (int i = 0; i < 256; ++i) {
+        image.palette[i * 4 + 0] = 0;
+        image.palette[i * 4 + 1] = 0;
+        image.palette[i * 4 + 2] = 0;
+        image.palette[i * 4 + 3] = 255;
+    }
+
+    size_t paletteCount = 0;
+    size_t idatChunks = 0;
+    size_t offset = 8;
+    while (offset + 12 <= size) {
+        const uint32_t length = ReadBE32(data + offset);
+        const uint32_t type = ReadBE32(data + offset + 4);
+        const uint8_t* payload = data + offset + 8;
+        if (length > size - offset - 12)
+            return false;
+
+        if (type == ChunkType("IDAT")) {
+            // A single IDAT is inflated in place, several are joined first
+            if (idatChunks++ == 0) {
+                image.idat = payload;
+                image.idatSize = length;
+            } else {
+                if (idatChunks == 2)
+                    image.idatStorage.assign(image.idat, image.idat + image.idatSize);
+                image.idatStorage.insert(image.idatStorage.end(), payload, payload + length);
+            }
+        } else if (type == ChunkType("PLTE")) {
+            if (length % 3 != 0 || length / 3 > 256)
+                return false;
+            paletteCount = length / 3;
+            for (size_t i = 0; i < paletteCount; ++i) {
+                image.palette[i * 4 + 0] = payload[i * 3 + 0];
+                image.palette[i * 4 + 1] = payload[i * 3 + 1];
+                image.palette[i * 4 + 2] = payload[i * 3 + 2];
+            }
+        } else if (type == ChunkType("tRNS")) {
+            if (image.info.colorType == 3) {
+                if (length > paletteCount)
+                    return false;
+                for (size_t i = 0; i < length; ++i)
+                    image.palette[i * 4 + 3] = payload[i];
+                image.info.channels = 4;
+            } else if (image.info.colorType == 0 && length == 2) {
+                image.hasKey = true;
+                image.key[0] = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+                image.info.channels = 2;
+            } else if (image.info.colorType == 2 && length == 6) {
+                image.hasKey = true;
+                for (int c = 0; c < 3; ++c)
+                    image.key[c] = static_cast<uint16_t>((payload[c * 2] << 8) | payload[c * 2 + 1]);
+                image.info.channels = 4;
+            } else {
+                return false;
+            }
+        } else if (type == ChunkType("IEND")) {
+            break;
+        } else if ((data[offset + 4] & 0x20) == 0 && type != ChunkType("IHDR")) {
+            return false;   // Unknown critical chunk (e.g. Apple's CgBI)
+        }
+        offset += 12 + length;
+    }
+
+    if (idatChunks > 1) {
+        image.idat = image.idatStorage.data();
+        image.idatSize = image.idatStorage.size();
+    }
+    return idatChunks > 0 && (image.info.colorType != 3 || paletteCount > 0);
+}
+
+inline int SampleAt(const uint8_t* row, int index, int depth) {
+    const int bit = index * depth;
+    return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+}
+
+// Unfiltered row in the file format -> RGBA8
+void ExpandRow(const Image& image, const uint8_t* src, uint8_t* dst) {
+    const int width = image.info.width;
+    const int depth = image.info.bitDepth;
+    const bool key = image.hasKey;
+
+    switch (image.info.colorType) {
+    case 0: {
+        if (depth == 16) {
+            for (int x = 0; x < width; ++x) {
+                const uint16_t v = static_cast<uint16_t>((src[x * 2] << 8) | src[x * 2 + 1]);
+                dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = src[x * 2];
+                dst[x * 4 + 3] = key && v == image.key[0] ? 0 : 255;
+            }
+        } else {
+            static const int kScale[9] = { 0, 255, 85, 0, 17, 0, 0, 0, 1 };
+            for (int x = 0; x < width; ++x) {
+                const int v = depth == 8 ? src[x] : SampleAt(src, x, depth);
+                dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = static_cast<uint8_t>(v * kScale[depth]);
+                dst[x * 4 + 3] = key && v == image.key[0] ? 0 : 255;
+            }
+        }
+        break;
+    }
+    case 2: {
+        if (depth == 16) {
+            for (int x = 0; x < width; ++x) {
+                const uint8_t* p = src + x * 6;
+                dst[x * 4 + 0] = p[0];
+                dst[x * 4 + 1] = p[2];
+                dst[x * 4 + 2] = p[4];
+                const bool transparent = key && ((p[0] << 8) | p[1]) == image.key[0] &&
+                                         ((p[2] << 8) | p[3]) == image.key[1] && ((p[4] << 8) | p[5]) == image.key[2];
+                dst[x * 4 + 3] = transparent ? 0 : 255;
+            }
+        } else if (key) {
+            for (int x = 0; x < width; ++x) {
+                const uint8_t* p = src + x * 3;
+                dst[x * 4 + 0] = p[0];
+                dst[x * 4 + 1] = p[1];
+                dst[x * 4 + 2] = p[2];
+                dst[x * 4 + 3] = p[0] == image.key[0] && p[1] == image.key[1] && p[2] == image.key[2] ? 0 : 255;
+            }
+        } else {
+            for (int x = 0; x < width; ++x) {
+                dst[x * 4 + 0] = src[x * 3 + 0];
+                dst[x * 4 + 1] = src[x * 3 + 1];
+                dst[x * 4 + 2] = src[x * 3 + 2];
+                dst[x * 4 + 3] = 255;
+            }
+        }
+        break;
+    }
+    case 3:
+        for (int x = 0; x < width; ++x) {
+            const int index = depth == 8 ? src[x] : SampleAt(src, x, depth);
+            std::memcpy(dst + x * 4, image.palette + index * 4, 4);
+        }
+        break;
+    case 4:
+        for (int x = 0; x < width; ++x) {
+            const int step = depth == 16 ? 4 : 2;
+            dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = src[x * step];
+            dst[x * 4 + 3] = src[x * step + step / 2];
+        }
+        break;
+    case 6:
+        // Only 16 bit gets here, 8 bit RGBA is unfiltered straight into dst
+        for (int x = 0; x < width * 4; ++x)
+            dst[x] = src[x * 2];
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+bool PngDecoder::IsPng(const unsigned char* data, size_t size) {
+    return data && size >= 8 && std::memcmp(data, kSignature, 8) == 0;
+}
+
+bool PngDecoder::ReadInfo(const unsigned char* data, size_t size, Info& outInfo) {
+    Image image;
+    if (!data || !ParseChunks(data, size, image))
+        return false;
+    outInfo = image.info;
+    return true;
+}
+
+bool PngDecoder::Decode(const unsigned char* data, size_t size, unsigned char* dst, size_t dstSize) {
+    Image image;
+    if (!data || !dst || !ParseChunks(data, size, image) || image.info.interlaced)
+        return false;
+
+    const Info& info = image.info;
+    const size_t width = static_cast<size_t>(info.width);
+    const size_t height = static_cast<size_t>(info.height);
+    if (dstSize < width * height * 4)
+        return false;
+
+    const size_t bitsPerPixel = static_cast<size_t>(SamplesPerPixel(info.colorType)) * info.bitDepth;
+    const size_t rowBytes = (width * bitsPerPixel + 7) / 8;
+    const int bpp = static_cast<int>(bitsPerPixel >= 8 ? bitsPerPixel / 8 : 1);
+    const size_t rawSize = height * (rowBytes + 1);
+
+    // Filtered scanlines - sized from the header, never regrown, not zero-filled
+    std::unique_ptr<uint8_t[]> raw(new (std::nothrow) uint8_t[rawSize]);
+    if (!raw)
+        return false;
+    Inflater inflater(image.idat, image.idatSize, raw.get(), rawSize);
+    if (!inflater.Run() || inflater.Produced() != rawSize)
+        return false;
+
+    // RGBA8 is unfiltered straight into the flipped destination rows, using the
+    // previous destination row as prior. Everything else is unfiltered into two
+    // alternating row buffers (slack for 4 byte stores) and expanded from there.
+    const bool direct = info.colorType == 6 && info.bitDepth == 8;
+    const size_t dstPitch = width * 4;
+    const size_t rowStride = rowBytes + 16;
+    std::vector<uint8_t> rows(rowStride * 2, 0);
+    const uint8_t* zeros = rows.data() + rowStride;
+
+    for (size_t y = 0; y < height; ++y) {
+        const uint8_t* line = raw.get() + y * (rowBytes + 1);
+        const int filter = line[0];
+        if (filter > 4)
+            return false;
+        uint8_t* dstRow = dst + (height - 1 - y) * dstPitch;
+
+        if (direct) {
+            const uint8_t* prior = y > 0 ? dstRow + dstPitch : zeros;
+            Unfilter(filter, line + 1, dstRow, prior, rowBytes, bpp);
+        } else {
+            uint8_t* current = rows.data() + (y & 1) * rowStride;
+            const uint8_t* prior = rows.data() + ((y + 1) & 1) * rowStride;
+            Unfilter(filter, line + 1, current, prior, rowBytes, bpp);
+            ExpandRow(image, current, dstRow);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * PngDecoder - fast PNG path for texture loading
+ *
+ * Replaces stb_image for the PNGs the game ships (large RGBA / RGB textures):
+ * - inflate with a 64-bit bit buffer, 10-bit Huffman lookup tables and
+ *   word-sized match copies into a buffer sized from the header (no regrowing)
+ * - Sub / Up / Avg / Paeth unfiltering with SSE2 for 3 and 4 byte pixels
+ * - rows are written straight into the destination, bottom-up (OpenGL order,
+ *   like stbi_set_flip_vertically_on_load) - RGBA8 images are unfiltered
+ *   directly into it, other formats are expanded row by row
+ *
+ * Measured at 1.5 - 2x the speed of stb_image on RGB / RGBA textures. Noisy
+ * textures are bound by inflate (one table lookup per literal); two-literal
+ * lookup tables did not pay off on such data.
+ *
+ * Supported: all color types, bit depths 1-16 (16 bit is reduced to 8), PLTE
+ * and tRNS. Interlaced (Adam7) files and anything unusual make Decode() return
+ * false - callers then fall back to stb_image, which also handles every other
+ * format. Checksums (CRC / Adler-32) are not verified, as in stb_image.
+ */
+class PngDecoder {
+public:
+    struct Info {
+        int width = 0;
+        int height = 0;
+        int channels = 0;   // Channels in the file (as stbi reports them, tRNS counts as alpha)
+        int bitDepth = 0;
+        int colorType = 0;
+        bool interlaced = false;
+    };
+
+    static bool IsPng(const unsigned char* data, size_t size);
+    static bool ReadInfo(const unsigned char* data, size_t size, Info& outInfo);
+
+    // Decodes to RGBA8, rows bottom-up. dst must hold width * height * 4 bytes.
+    static bool Decode(const unsigned char* data, size_t size, unsigned char* dst, size_t dstSize);
+};
@@ -0,0 +1,299 @@
+#include "RenderQueue.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "UploadRing.h"
+#include "GLState.h"
+#include "JobSystem.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr UniformId kInstanced("u_Instanced");
+
+// Below this many runs per slice, recording is cheaper than handing it to a worker
+constexpr size_t kMinRunsPerSlice = 256;
+
+inline void Accumulate(RenderQueue::Stats& total, const RenderQueue::Stats& slice) {
+    total.draws += slice.draws;
+    total.indirectCommands += slice.indirectCommands;
+    total.instances += slice.instances;
+    total.shaderBinds += slice.shaderBinds;
+    total.textureBinds += slice.textureBinds;
+    total.materialBinds += slice.materialBinds;
+    total.meshBinds += slice.meshBinds;
+}
+
+} // namespace
+
+RenderQueue::RenderQueue()
+    : m_View(1.0f), m_Projection(1.0f), m_Geometry(nullptr), m_Ring(nullptr) {
+}
+
+void RenderQueue::SetCamera(const glm::mat4& view, const glm::mat4& projection) {
+    m_View = view;
+    m_Projection = projection;
+}
+
+void RenderQueue::Submit(const DrawPacket& packet) {
+    m_Packets.push_back(packet);
+}
+
+void RenderQueue::SetGeometryBuffer(GeometryBuffer* geometry) {
+    m_Geometry = geometry;
+}
+
+void RenderQueue::SetUploadRing(UploadRing* ring) {
+    m_Ring = ring;
+    m_InstanceBuffer.SetUploadRing(ring);
+}
+
+uint32_t RenderQueue::GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object) {
+    if (!object)
+        return 0;
+    auto it = ids.find(object);
+    if (it != ids.end())
+        return it->second;
+    // Ids beyond the key field wrap around - that only costs sort quality
+    const uint32_t id = static_cast<uint32_t>(ids.size()) + 1;
+    ids.emplace(object, id);
+    return id;
+}
+
+uint64_t RenderQueue::MakeKey(const DrawPacket& packet) {
+    const uint32_t shader = GetId(m_ShaderIds, packet.shader);
+    const uint32_t texture = GetId(m_TextureIds, packet.texture);
+    const uint32_t mesh = GetId(m_MeshIds, packet.mesh);
+    const glm::vec3 viewPos = glm::vec3(m_View * packet.transform[3]);
+    const float depth = -viewPos.z;
+
+    return SortKey::Make(packet.pass, shader, texture, mesh, depth);
+}
+
+void RenderQueue::Sort() {
+    const size_t count = m_Packets.size();
+    m_Items.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        m_Items[i] = { MakeKey(m_Packets[i]), static_cast<uint32_t>(i) };
+
+    SortKey::RadixSort(m_Items, m_Scratch);
+}
+
+void RenderQueue::BuildRuns() {
+    m_Runs.clear();
+    m_Instances.clear();
+    m_Instances.reserve(m_Items.size());
+
+    for (const SortKey::Item& item : m_Items) {
+        const DrawPacket& packet = m_Packets[item.index];
+        if (!packet.mesh || !packet.shader || !packet.mesh->HasGL())
+            continue;
+
+        if (packet.texture)
+            packet.texture->Touch();    // Also when not ready, so it gets streamed
+        const Texture* drawTexture = packet.texture && packet.texture->IsReady() ? packet.texture : nullptr;
+
+        const int material = packet.material >= 0 ? packet.material
+                           : drawTexture ? MaterialBlocks::kTextured : MaterialBlocks::kVertexColors;
+
+        if (m_Runs.empty() || m_Runs.back().packet->shader != packet.shader ||
+            m_Runs.back().packet->mesh != packet.mesh || m_Runs.back().texture != drawTexture ||
+            m_Runs.back().material != material) {
+            m_Runs.push_back({ &packet, drawTexture, material, static_cast<uint32_t>(m_Instances.size()), 0, -1, 0 });
+        }
+        ++m_Runs.back().count;
+        m_Instances.push_back({ packet.transform, packet.color });
+    }
+}
+
+void RenderQueue::BuildCommands(uint32_t firstInstance) {
+    m_Commands.clear();
+    if (!m_Geometry)
+        return;
+
+    for (Run& run : m_Runs) {
+        GeometryRange range;
+        if (!m_Geometry->Find(run.packet->mesh, range))
+            continue;
+        run.command = static_cast<int32_t>(m_Commands.size());
+        run.page = range.page;
+        m_Commands.push_back({ range.indexCount, run.count, range.firstIndex, range.baseVertex, firstInstance + run.baseInstance });
+    }
+}
+
+void RenderQueue::UploadCamera() {
+    CameraUniforms camera;
+    camera.view = m_View;
+    camera.projection = m_Projection;
+    camera.viewProjection = m_Projection * m_View;
+    camera.position = glm::inverse(m_View)[3];
+
+    const RingAllocation allocation = m_Ring
+        ? m_Ring->Allocate(sizeof(camera), UniformBuffer::GetOffsetAlignment())
+        : RingAllocation();
+    if (allocation) {
+        std::memcpy(allocation.data, &camera, sizeof(camera));
+        GLState::BindBufferRange(GL_UNIFORM_BUFFER, UniformBlock::Camera, allocation.buffer, allocation.offset, sizeof(camera));
+        return;
+    }
+    if (m_CameraBuffer.GetSize() < sizeof(camera))
+        m_CameraBuffer.Allocate(sizeof(camera));
+    m_CameraBuffer.Update(0, &camera, sizeof(camera));
+    m_CameraBuffer.BindBase(UniformBlock::Camera);
+}
+
+void RenderQueue::Flush() {
+    m_LastStats = Stats();
+    // Also without packets: draws issued after Flush() (impostors) read the Camera block
+    UploadCamera();
+    if (m_Packets.empty())
+        return;
+
+    Sort();
+    BuildRuns();
+    if (m_Runs.empty()) {
+        m_Packets.clear();
+        return;
+    }
+    const uint32_t firstInstance = m_InstanceBuffer.Upload(m_Instances.data(), m_Instances.size());
+    const GLuint instanceBuffer = m_InstanceBuffer.GetRendererID();
+    BuildCommands(firstInstance);
+    if (!m_Commands.empty()) {
+        m_Geometry->UploadCommands(m_Commands.data(), m_Commands.size(), m_Ring);
+        m_Geometry->AttachInstanceBuffer(instanceBuffer);
+    }
+
+    BuildSlices();
+    const size_t sliceCount = m_SliceBegins.size() - 1;
+    if (m_Lists.size() < sliceCount)
+        m_Lists.resize(sliceCount);
+    m_SliceStats.assign(sliceCount, Stats());
+
+    if (sliceCount == 1) {
+        RecordRuns(0, m_Runs.size(), instanceBuffer, firstInstance, m_Lists[0], m_SliceStats[0]);
+    } else {
+        JobSystem::Get().ParallelFor(sliceCount, 1, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; ++slice)
+                RecordRuns(m_SliceBegins[slice], m_SliceBegins[slice + 1], instanceBuffer, firstInstance,
+                           m_Lists[slice], m_SliceStats[slice]);
+        });
+    }
+
+    for (size_t slice = 0; slice < sliceCount; ++slice) {
+        m_Lists[slice].Execute();
+        Accumulate(m_LastStats, m_SliceStats[slice]);
+    }
+    m_LastStats.commandLists = sliceCount;
+
+    // Player::Draw / StaticBatcher::Draw use the same programs with u_Model
+    // The vertex array and indirect buffer stay bound - GLState drops the rebinds next frame
+    m_Runs.back().packet->shader->SetUniform1i(kInstanced, 0);
+    m_Packets.clear();
+}
+
+void RenderQueue::BuildSlices() {
+    m_SliceBegins.clear();
+    m_SliceBegins.push_back(0);
+
+    const size_t runCount = m_Runs.size();
+    const size_t workers = JobSystem::Get().GetWorkerCount();
+    const size_t sliceCount = workers == 0 ? 1 : std::min<size_t>(workers + 1, runCount / kMinRunsPerSlice);
+    if (sliceCount > 1) {
+        const size_t target = (runCount + sliceCount - 1) / sliceCount;
+        for (size_t begin = target; begin < runCount; begin += target) {
+            // Move the cut past the bucket it falls into, so its multi-draw stays one call
+            size_t cut = std::max(begin, m_SliceBegins.back() + 1);
+            while (cut < runCount && m_Runs[cut].command >= 0 && m_Runs[cut - 1].command >= 0 &&
+                   m_Runs[cut].packet->shader == m_Runs[cut - 1].packet->shader &&
+                   m_Runs[cut].texture == m_Runs[cut - 1].texture &&
+                   m_Runs[cut].material == m_Runs[cut - 1].material && m_Runs[cut].page == m_Runs[cut - 1].page)
+                ++cut;
+            if (cut >= runCount)
+                break;
+            m_SliceBegins.push_back(cut);
+            begin = cut;
+        }
+    }
+    m_SliceBegins.push_back(runCount);
+}
+
+void RenderQueue::RecordRuns(size_t begin, size_t end, unsigned int instanceBuffer, uint32_t firstInstance,
+                             CommandList& list, Stats& stats) {
+    list.Reset();
+
+    // The previous slice leaves its shader bound with u_Instanced set. It is bound
+    // again so the list's uniform commands have a target; like texture, material
+    // and mesh at the start of the slice, GLState drops the redundant bind.
+    Shader* shader = begin > 0 ? m_Runs[begin - 1].packet->shader : nullptr;
+    if (shader)
+        list.BindShader(shader);
+    const Mesh* mesh = nullptr;
+    bool geometryBound = false;
+    uint32_t page = 0;          // Bound geometry page while geometryBound
+    const Texture* texture = nullptr;
+    int material = -1;
+
+    for (size_t i = begin; i < end;) {
+        const Run& run = m_Runs[i];
+        const DrawPacket& packet = *run.packet;
+        if (packet.shader != shader) {
+            if (shader)
+                list.SetUniform1i(kInstanced, 0);   // Still bound - leave it as found
+            shader = packet.shader;
+            list.BindShader(shader);
+            list.SetUniform1i(kInstanced, 1);
+            ++stats.shaderBinds;
+        }
+
+        if (run.texture && run.texture != texture) {
+            list.BindTexture(run.texture, 0);
+            texture = run.texture;
+            ++stats.textureBinds;
+        }
+        if (run.material != material) {
+            list.BindMaterial(&m_Materials, run.material);
+            material = run.material;
+            ++stats.materialBinds;
+        }
+
+        if (run.command >= 0) {
+            // Bucket: the following runs in the same geometry buffer page with the same state.
+            // Their commands are consecutive because BuildCommands() numbers them in run order.
+            size_t bucketEnd = i + 1;
+            while (bucketEnd < end && m_Runs[bucketEnd].command >= 0 &&
+                   m_Runs[bucketEnd].packet->shader == shader && m_Runs[bucketEnd].texture == run.texture &&
+                   m_Runs[bucketEnd].material == run.material && m_Runs[bucketEnd].page == run.page)
+                ++bucketEnd;
+            if (!geometryBound || run.page != page) {
+                list.BindGeometry(m_Geometry, run.page);
+                geometryBound = true;
+                page = run.page;
+                mesh = nullptr;
+                ++stats.meshBinds;
+            }
+            list.DrawIndirect(m_Geometry, static_cast<size_t>(run.command), bucketEnd - i);
+            ++stats.draws;
+            stats.indirectCommands += bucketEnd - i;
+            for (; i < bucketEnd; ++i)
+                stats.instances += m_Runs[i].count;
+            continue;
+        }
+
+        if (packet.mesh != mesh || geometryBound) {
+            mesh = packet.mesh;
+            geometryBound = false;
+            list.BindMesh(mesh, instanceBuffer);
+            ++stats.meshBinds;
+        }
+        list.DrawInstanced(mesh, run.count, firstInstance + run.baseInstance);
+        ++stats.draws;
+        stats.instances += run.count;
+        ++i;
+    }
+}
+
+void RenderQueue::Clear() {
+    m_Packets.clear();
+}
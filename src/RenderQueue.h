@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "CommandList.h"
+#include "GeometryBuffer.h"
+#include "InstanceBuffer.h"
+#include "MaterialBlocks.h"
+#include "SortKey.h"
+#include "UniformBuffer.h"
+#include "vendor/glm/glm.hpp"
+
+class Mesh;
+class Shader;
+class Texture;
+class UploadRing;
+
+// One draw: the mesh with the shader and texture, at transform
+struct DrawPacket {
+    const Mesh* mesh = nullptr;
+    Shader* shader = nullptr;
+    const Texture* texture = nullptr;   // nullptr = per-vertex material colors
+    glm::mat4 transform{ 1.0f };
+    glm::vec4 color{ 1.0f };            // Tint, multiplied with texture / vertex color
+    int material = -1;                  // Slot in RenderQueue::GetMaterials(), -1 = by texture
+    RenderPass pass = RenderPass::Opaque;
+};
+
+/**
+ * RenderQueue - collects the draws of a frame and issues them sorted by state
+ *
+ * Systems Submit() packets in any order. Flush() builds a 64-bit key per packet,
+ * radix sorts the keys and draws the packets in key order, binding the program,
+ * texture and VAO only when they change.
+ *
+ * Shaders get their per-frame data from the std140 Camera block, written once
+ * per Flush() and bound at UniformBlock::Camera - also when the queue is empty,
+ * so draws issued after Flush() can use it. Material parameters (texture
+ * on/off, tint) come from MaterialBlocks: a material change is one
+ * glBindBufferRange, with no glUniform calls per draw.
+ *
+ * Consecutive packets with the same shader, texture and mesh are drawn as one
+ * instanced draw: their transforms and colors go into one InstanceBuffer that is
+ * uploaded once per Flush(), and each run picks its range with baseInstance. The
+ * shader must read the model matrix from the instance attributes when
+ * u_Instanced is 1 (see basic.shader).
+ *
+ * Meshes added to the GeometryBuffer set with SetGeometryBuffer() share one VAO
+ * per buffer arena page. Their runs become DrawElementsIndirectCommands, and
+ * consecutive runs with the same shader, texture and page (a bucket) are drawn
+ * with one glMultiDrawElementsIndirect.
+ * Other meshes are still drawn one instanced call per run.
+ *
+ * Packets are sorted by a 64-bit key (layout in SortKey.h). The ids in the key
+ * are small per-queue numbers assigned to each shader / texture / mesh the
+ * first time it is submitted; depth is the view-space distance of the packet's
+ * origin.
+ *
+ * The sorted runs are turned into draw commands in slices: with enough runs,
+ * JobSystem workers each record a slice into their own CommandList (no GL
+ * calls), then the GL thread executes the lists in order. Slices start at
+ * bucket boundaries, so splitting adds no draw calls; state bound again at the
+ * start of a slice is filtered by GLState.
+ *
+ * Packets hold raw pointers - the objects must outlive Flush(). Submit() and
+ * Flush() are main thread only.
+ *
+ * Usage (each frame):
+ *   queue.SetCamera(view, projection);
+ *   player.Submit(queue, shader, texture);
+ *   batches.Submit(queue, shader);
+ *   queue.Flush();
+ */
+class RenderQueue {
+public:
+    struct Stats {
+        size_t draws = 0;           // Instanced and multi-draw calls
+        size_t indirectCommands = 0;
+        size_t instances = 0;       // Packets drawn
+        size_t shaderBinds = 0;
+        size_t textureBinds = 0;
+        size_t materialBinds = 0;
+        size_t meshBinds = 0;
+        size_t commandLists = 0;    // Slices recorded (> 1 = in parallel)
+    };
+
+    RenderQueue();
+
+    void SetCamera(const glm::mat4& view, const glm::mat4& projection);
+
+    void Submit(const DrawPacket& packet);
+
+    // Meshes in this buffer are drawn with multi-draw-indirect (nullptr = off).
+    // The buffer must outlive the queue or be unset first.
+    void SetGeometryBuffer(GeometryBuffer* geometry);
+
+    // Instance data and indirect commands are written into the ring (nullptr = own buffers).
+    // Flush() must run between the ring's BeginFrame() and EndFrame().
+    void SetUploadRing(UploadRing* ring);
+
+    // Sorts and draws everything submitted since the last Flush, then clears the queue
+    void Flush();
+    void Clear();
+
+    // Material slots for DrawPacket::material (GL thread only)
+    inline MaterialBlocks& GetMaterials() { return m_Materials; }
+
+    inline size_t GetPacketCount() const { return m_Packets.size(); }
+    inline const Stats& GetLastStats() const { return m_LastStats; }
+
+private:
+    // Consecutive sorted packets drawn with one instanced call
+    struct Run {
+        const DrawPacket* packet;   // First packet of the run
+        const Texture* texture;     // Texture to bind, nullptr = vertex colors
+        int material;               // MaterialBlocks slot
+        uint32_t baseInstance;
+        uint32_t count;
+        int32_t command;            // Index into m_Commands, -1 = not in the geometry buffer
+        uint32_t page;              // Geometry buffer page of the command
+    };
+
+    uint64_t MakeKey(const DrawPacket& packet);
+    static uint32_t GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object);
+    void Sort();
+    void BuildRuns();
+    void UploadCamera();
+    void BuildCommands(uint32_t firstInstance);
+    // Splits m_Runs into m_SliceBegins for parallel recording
+    void BuildSlices();
+    // Records runs [begin, end) - no GL calls, safe on worker threads
+    void RecordRuns(size_t begin, size_t end, unsigned int instanceBuffer, uint32_t firstInstance,
+                    CommandList& list, Stats& stats);
+
+    glm::mat4 m_View;
+    glm::mat4 m_Projection;
+    std::vector<DrawPacket> m_Packets;
+    std::vector<SortKey::Item> m_Items;
+    std::vector<SortKey::Item> m_Scratch;
+    std::vector<Run> m_Runs;
+    std::vector<InstanceData> m_Instances;
+    InstanceBuffer m_InstanceBuffer;
+    GeometryBuffer* m_Geometry;
+    UploadRing* m_Ring;
+    UniformBuffer m_CameraBuffer;   // Used when there is no ring
+    MaterialBlocks m_Materials;
+    std::vector<DrawElementsIndirectCommand> m_Commands;
+    std::vector<size_t> m_SliceBegins;      // First run of each slice, plus m_Runs.size()
+    std::vector<CommandList> m_Lists;       // One per slice, reused every frame
+    std::vector<Stats> m_SliceStats;
+    std::unordered_map<const void*, uint32_t> m_ShaderIds;
+    std::unordered_map<const void*, uint32_t> m_TextureIds;
+    std::unordered_map<const void*, uint32_t> m_MeshIds;
+    Stats m_LastStats;
+};
@@ -1,5 +1,7 @@
 #include "Shader.h"
 #include "Debug.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
 #include <glad/glad.h>
 #include <fstream>
 #include <sstream>
@@ -9,54 +11,130 @@ Shader::Shader(const std::string& filepath)
     : m_FilePath(filepath), m_RendererID(0) {
     ShaderProgramSource source = ParseShader(filepath);
     m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+    BuildUniformTable();
 }
 
 Shader::~Shader() {
-    GLCall(glDeleteProgram(m_RendererID));
+    GLState::DeleteProgram(m_RendererID);
 }
 
 void Shader::Bind() const {
-    GLCall(glUseProgram(m_RendererID));
+    GLState::UseProgram(m_RendererID);
 }
 
 void Shader::Unbind() const {
-    GLCall(glUseProgram(0));
+    GLState::UseProgram(0);
 }
 
-void Shader::SetUniform1i(const std::string& name, int value) {
-    GLCall(glUniform1i(GetUniformLocation(name), value));
+void Shader::SetUniform1i(UniformId id, int value) {
+    GLCall(glUniform1i(GetUniformLocation(id), value));
 }
 
-void Shader::SetUniform1f(const std::string& name, float value) {
-    GLCall(glUniform1f(GetUniformLocation(name), value));
+void Shader::SetUniform1f(UniformId id, float value) {
+    GLCall(glUniform1f(GetUniformLocation(id), value));
 }
 
-void Shader::SetUniform2f(const std::string& name, float v0, float v1) {
-    GLCall(glUniform2f(GetUniformLocation(name), v0, v1));
+void Shader::SetUniform2f(UniformId id, float v0, float v1) {
+    GLCall(glUniform2f(GetUniformLocation(id), v0, v1));
 }
 
-void Shader::SetUniform3f(const std::string& name, float v0, float v1, float v2) {
-    GLCall(glUniform3f(GetUniformLocation(name), v0, v1, v2));
+void Shader::SetUniform3f(UniformId id, float v0, float v1, float v2) {
+    GLCall(glUniform3f(GetUniformLocation(id), v0, v1, v2));
 }
 
-void Shader::SetUniform4f(const std::string& name, float f0, float f1, float f2, float f3) {
-    GLCall(glUniform4f(GetUniformLocation(name), f0, f1, f2, f3));
+void Shader::SetUniform4f(UniformId id, float f0, float f1, float f2, float f3) {
+    GLCall(glUniform4f(GetUniformLocation(id), f0, f1, f2, f3));
 }
 
-void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix) {
-    GLCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
+void Shader::SetUniformMat4f(UniformId id, const glm::mat4& matrix) {
+    GLCall(glUniformMatrix4fv(GetUniformLocation(id), 1, GL_FALSE, &matrix[0][0]));
 }
 
-int Shader::GetUniformLocation(const std::string& name) {
-    if (m_UniformLocationCache.find(name) != m_UniformLocationCache.end())
-        return m_UniformLocationCache[name];
+void Shader::BuildUniformTable() {
+    m_Uniforms.assign(16, UniformSlot());
+    if (m_RendererID == 0)
+        return;
+
+    GLint count = 0, maxLength = 0;
+    GLCall(glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORMS, &count));
+    GLCall(glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+    std::vector<char> name(static_cast<size_t>(maxLength) + 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        GLCall(glGetActiveUniform(m_RendererID, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data()));
+        GLCall(int location = glGetUniformLocation(m_RendererID, name.data()));
+        if (location < 0)
+            continue;   // Member of a uniform block - set through its buffer
+
+        // Arrays are reported as "name[0]"; the id is the plain name
+        if (length > 3 && std::string(name.data() + length - 3, 3) == "[0]")
+            length -= 3;
+        const UniformId id(name.data(), static_cast<size_t>(length));
+        if (FindUniform(id.GetHash()) != -2) {
+            std::cerr << "[Shader] Uniform '" << std::string(name.data(), length) << "' in '" << m_FilePath
+                      << "' collides with another uniform's hash - rename one of them" << std::endl;
+            continue;
+        }
+        InsertUniform(id.GetHash(), location);
+    }
+}
+
+void Shader::InsertUniform(uint32_t hash, int location) {
+    size_t used = 1;
+    for (const UniformSlot& slot : m_Uniforms)
+        used += slot.location != -2 ? 1 : 0;
+    if (used * 2 > m_Uniforms.size()) {
+        std::vector<UniformSlot> old;
+        old.swap(m_Uniforms);
+        m_Uniforms.assign(old.size() * 2, UniformSlot());
+        for (const UniformSlot& slot : old) {
+            if (slot.location != -2)
+                InsertUniform(slot.hash, slot.location);
+        }
+    }
 
-    GLCall(int location = glGetUniformLocation(m_RendererID, name.c_str()));
-    if (location == -1)
-        std::cout << "[Shader] Warning: uniform '" << name << "' doesn't exist in shader '" << m_FilePath << "'!" << std::endl;
+    const size_t mask = m_Uniforms.size() - 1;
+    size_t index = hash & mask;
+    while (m_Uniforms[index].location != -2)
+        index = (index + 1) & mask;
+    m_Uniforms[index] = { hash, location };
+}
+
+int Shader::FindUniform(uint32_t hash) const {
+    const size_t mask = m_Uniforms.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        const UniformSlot& slot = m_Uniforms[index];
+        if (slot.location == -2 || slot.hash == hash)
+            return slot.location;
+    }
+}
+
+int Shader::GetUniformLocation(UniformId id) {
+    const int location = FindUniform(id.GetHash());
+    if (location != -2)
+        return location;
 
-    m_UniformLocationCache[name] = location;
-    return location;
+    // Reported once, then remembered as unknown
+    std::cout << "[Shader] Warning: uniform '" << id.GetName() << "' doesn't exist in shader '" << m_FilePath << "'!" << std::endl;
+    InsertUniform(id.GetHash(), -1);
+    return -1;
+}
+
+bool Shader::HasUniform(UniformId id) const {
+    return FindUniform(id.GetHash()) >= 0;
+}
+
+bool Shader::Require(std::initializer_list<UniformId> ids) const {
+    bool complete = true;
+    for (const UniformId& id : ids) {
+        if (!HasUniform(id)) {
+            std::cerr << "[Shader] '" << m_FilePath << "' has no active uniform '" << id.GetName() << "'" << std::endl;
+            complete = false;
+        }
+    }
+    return complete;
 }
 
 ShaderProgramSource Shader::ParseShader(const std::string& filepath) {
@@ -137,5 +215,27 @@ unsigned int Shader::CreateShader(const std::string& vertexShader, const std::st
     GLCall(glDeleteShader(vs));
     GLCall(glDeleteShader(fs));
 
+    if (success)
+        BindUniformBlocks(program);
     return program;
 }
+
+void Shader::BindUniformBlocks(unsigned int program) {
+    // std140 blocks go to their fixed binding points - the buffers are bound once per frame / material
+    const struct { const char* name; unsigned int binding; } blocks[] = {
+        { "Camera", UniformBlock::Camera },
+        { "Material", UniformBlock::Material },
+    };
+    for (const auto& block : blocks) {
+        GLCall(unsigned int index = glGetUniformBlockIndex(program, block.name));
+        if (index != GL_INVALID_INDEX) {
+            GLCall(glUniformBlockBinding(program, index, block.binding));
+        }
+    }
+
+    // The diffuse sampler always reads texture unit 0
+    GLCall(int texture = glGetUniformLocation(program, "u_Texture"));
+    if (texture != -1) {
+        GLCall(glProgramUniform1i(program, texture, 0));
+    }
+}
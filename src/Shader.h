@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
+#include <initializer_list>
 #include <string>
-#include <unordered_map>
+#include <vector>
+#include "UniformId.h"
 #include "vendor/glm/glm.hpp"
 
 struct ShaderProgramSource {
@@ -12,7 +15,13 @@ class Shader {
 private:
     unsigned int m_RendererID;
     std::string m_FilePath;
-    std::unordered_map<std::string, int> m_UniformLocationCache;
+    // Open-addressing table hash -> location, filled from the active uniforms at link time.
+    // Power-of-two size, at most half full.
+    struct UniformSlot {
+        uint32_t hash = 0;
+        int location = -2;      // -2 = empty slot, -1 = unknown name (already reported)
+    };
+    std::vector<UniformSlot> m_Uniforms;
 
 public:
     Shader(const std::string& filepath);
@@ -21,13 +30,18 @@ public:
     void Bind() const;
     void Unbind() const;
 
-    // Uniform setters
-    void SetUniform1i(const std::string& name, int value);
-    void SetUniform1f(const std::string& name, float value);
-    void SetUniform2f(const std::string& name, float v0, float v1);
-    void SetUniform3f(const std::string& name, float v0, float v1, float v2);
-    void SetUniform4f(const std::string& name, float f0, float f1, float f2, float f3);
-    void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
+    // Uniform setters - a table lookup, no allocation. Unknown names are
+    // reported once and ignored afterwards.
+    void SetUniform1i(UniformId id, int value);
+    void SetUniform1f(UniformId id, float value);
+    void SetUniform2f(UniformId id, float v0, float v1);
+    void SetUniform3f(UniformId id, float v0, float v1, float v2);
+    void SetUniform4f(UniformId id, float f0, float f1, float f2, float f3);
+    void SetUniformMat4f(UniformId id, const glm::mat4& matrix);
+
+    bool HasUniform(UniformId id) const;
+    // Load-time check for the uniforms a user of the program relies on; reports the missing ones
+    bool Require(std::initializer_list<UniformId> ids) const;
 
     inline unsigned int GetRendererID() const { return m_RendererID; }
     inline const std::string& GetFilePath() const { return m_FilePath; }
@@ -36,5 +50,10 @@ private:
     ShaderProgramSource ParseShader(const std::string& filepath);
     unsigned int CompileShader(unsigned int type, const std::string& source);
     unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
-    int GetUniformLocation(const std::string& name);
+    // Uniform blocks to their UniformBlock binding points, u_Texture to unit 0
+    static void BindUniformBlocks(unsigned int program);
+    void BuildUniformTable();
+    void InsertUniform(uint32_t hash, int location);
+    int FindUniform(uint32_t hash) const;     // -2 if not in the table
+    int GetUniformLocation(UniformId id);
 };
@@ -0,0 +1,22 @@
+#pragma once
+
+// Compile-time SIMD feature selection.
+// SSE2 is part of every x86-64 target; AVX/AVX2 are only enabled when the
+// compiler is told to target them (see RPG_ENABLE_AVX2 in CMakeLists.txt).
+// Code using these macros must always keep a scalar fallback path.
+
+#if defined(__AVX2__)
+#define RPG_SIMD_AVX2 1
+#endif
+
+#if defined(__AVX__)
+#define RPG_SIMD_AVX 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RPG_SIMD_SSE2 1
+#endif
+
+#if defined(RPG_SIMD_SSE2) || defined(RPG_SIMD_AVX)
+#include <immintrin.h>
+#endif
@@ -0,0 +1,64 @@
+#include "SortKey.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+
+inline uint64_t Bits(uint32_t value, int count) {
+    return static_cast<uint64_t>(value) & ((uint64_t(1) << count) - 1);
+}
+
+// Top bits of a non-negative float - ordered like the float itself
+inline uint32_t DepthBits(float depth, int count) {
+    if (!(depth > 0.0f))
+        return 0;
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - count);
+}
+
+} // namespace
+
+uint64_t SortKey::Make(RenderPass pass, uint32_t shader, uint32_t texture, uint32_t mesh, float depth) {
+    const uint64_t passBits = static_cast<uint64_t>(pass) << 62;
+    if (pass == RenderPass::Transparent) {
+        const uint32_t farToNear = ~DepthBits(depth, 24);
+        return passBits | (Bits(farToNear, 24) << 38) | (Bits(shader, 12) << 26) | (Bits(texture, 16) << 10) | Bits(mesh, 10);
+    }
+    return passBits | (Bits(shader, 12) << 50) | (Bits(texture, 16) << 34) | (Bits(mesh, 16) << 18) | Bits(DepthBits(depth, 18), 18);
+}
+
+void SortKey::RadixSort(std::vector<Item>& items, std::vector<Item>& scratch) {
+    const size_t count = items.size();
+    if (count == 0)
+        return;
+    scratch.resize(count);
+
+    // All histograms in one read of the keys. Passes where every key has the same byte are skipped.
+    uint32_t histograms[8][256] = {};
+    for (const Item& item : items) {
+        for (int pass = 0; pass < 8; ++pass)
+            ++histograms[pass][(item.key >> (pass * 8)) & 0xFF];
+    }
+
+    Item* source = items.data();
+    Item* target = scratch.data();
+    for (int pass = 0; pass < 8; ++pass) {
+        uint32_t* histogram = histograms[pass];
+        const int shift = pass * 8;
+        if (histogram[(source[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            const uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i)
+            target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        std::swap(source, target);
+    }
+    if (source != items.data())
+        items.swap(scratch);
+}
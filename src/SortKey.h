@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class RenderPass : uint8_t {
+    Opaque = 0,         // Sorted by state, front to back
+    Transparent = 1,    // Sorted back to front, then by state
+    Overlay = 2         // Drawn last, sorted by state
+};
+
+/**
+ * SortKey - the 64-bit draw keys of RenderQueue and the radix sort that orders them
+ *
+ * Key layout (most significant first):
+ *   Opaque / Overlay:  pass:2 | shader:12 | texture:16 | mesh:16 | depth:18
+ *   Transparent:       pass:2 | ~depth:24 | shader:12 | texture:16 | mesh:10
+ * Ids wider than their field wrap around. Depth bits are the top bits of the
+ * float, which are monotonic for positive values; depth <= 0 counts as 0.
+ *
+ * Kept apart from RenderQueue so the ordering can be tested without GL.
+ */
+class SortKey {
+public:
+    struct Item {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    static uint64_t Make(RenderPass pass, uint32_t shader, uint32_t texture, uint32_t mesh, float depth);
+
+    // Stable LSD radix sort by key, 8 bits per pass. scratch is resized as needed.
+    static void RadixSort(std::vector<Item>& items, std::vector<Item>& scratch);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+// Non-owning view over contiguous data (stand-in for std::span, the project is C++17).
+// Used by accessors that hand out mesh/index data without copying it.
+template <typename T>
+class Span {
+public:
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using iterator = T*;
+
+    constexpr Span() : m_Data(nullptr), m_Size(0) {}
+    constexpr Span(T* data, size_t size) : m_Data(data), m_Size(size) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    Span(const std::vector<U>& v) : m_Data(v.data()), m_Size(v.size()) {}
+
+    template <typename U, typename = typename std::enable_if<std::is_same<T, U>::value>::type>
+    Span(std::vector<U>& v) : m_Data(v.data()), m_Size(v.size()) {}
+
+    inline T* data() const { return m_Data; }
+    inline size_t size() const { return m_Size; }
+    inline size_t size_bytes() const { return m_Size * sizeof(T); }
+    inline bool empty() const { return m_Size == 0; }
+
+    inline T& operator[](size_t i) const { return m_Data[i]; }
+    inline T* begin() const { return m_Data; }
+    inline T* end() const { return m_Data + m_Size; }
+
+    inline Span subspan(size_t offset, size_t count) const { return Span(m_Data + offset, count); }
+
+private:
+    T* m_Data;
+    size_t m_Size;
+};
@@ -0,0 +1,181 @@
+#include "StaticBatch.h"
+#include "Mesh.h"
+#include "MaterialBlocks.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "JobSystem.h"
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+constexpr size_t kVertexStride = 8; // x, y, z, u, v, r, g, b
+
+struct GroupKey {
+    const Texture* texture;
+    int cx, cy, cz;
+
+    bool operator<(const GroupKey& other) const {
+        return std::tie(texture, cx, cy, cz) < std::tie(other.texture, other.cx, other.cy, other.cz);
+    }
+};
+
+struct GroupPlacement {
+    size_t group;
+    size_t vertexOffset;    // in vertices
+    size_t indexOffset;     // in indices
+};
+
+} // namespace
+
+StaticBatcher::StaticBatcher(float cellSize)
+    : m_CellSize(cellSize > 0.0f ? cellSize : 32.0f) {
+}
+
+void StaticBatcher::Add(std::shared_ptr<Mesh> mesh, const glm::mat4& transform, std::shared_ptr<Texture> texture) {
+    if (!mesh || !mesh->HasCpuData()) {
+        std::cerr << "[StaticBatcher] Ignoring prop without CPU-side geometry" << std::endl;
+        return;
+    }
+    m_Instances.push_back({ std::move(mesh), transform, std::move(texture), AABB() });
+}
+
+void StaticBatcher::Build() {
+    if (m_Instances.empty())
+        return;
+
+    JobSystem& jobs = JobSystem::Get();
+
+    // 1) World bounds per instance (decides the grid cell)
+    for (Instance& inst : m_Instances)
+        inst.worldBounds = inst.mesh->GetBounds().Transformed(inst.transform);
+
+    // 2) Group by material and cell, lay out every instance inside its group
+    std::map<GroupKey, size_t> groupLookup;
+    std::vector<Batch> groups;
+    std::vector<size_t> groupVertexCounts, groupIndexCounts;
+    std::vector<GroupPlacement> placements(m_Instances.size());
+
+    for (size_t i = 0; i < m_Instances.size(); ++i) {
+        const Instance& inst = m_Instances[i];
+        const glm::vec3 c = inst.worldBounds.Center() / m_CellSize;
+        GroupKey key{ inst.texture.get(),
+                      static_cast<int>(std::floor(c.x)), static_cast<int>(std::floor(c.y)), static_cast<int>(std::floor(c.z)) };
+
+        auto it = groupLookup.find(key);
+        if (it == groupLookup.end()) {
+            it = groupLookup.emplace(key, groups.size()).first;
+            groups.emplace_back();
+            groups.back().texture = inst.texture;
+            groupVertexCounts.push_back(0);
+            groupIndexCounts.push_back(0);
+        }
+
+        const size_t g = it->second;
+        placements[i] = { g, groupVertexCounts[g], groupIndexCounts[g] };
+        groupVertexCounts[g] += inst.mesh->GetVertices().size() / kVertexStride;
+        groupIndexCounts[g] += inst.mesh->GetIndices().size();
+        groups[g].bounds.Grow(inst.worldBounds);
+        ++groups[g].sourceCount;
+    }
+
+    std::vector<OBJLoader::MeshData> merged(groups.size());
+    for (size_t g = 0; g < groups.size(); ++g) {
+        merged[g].vertices.resize(groupVertexCounts[g] * kVertexStride);
+        merged[g].indices.resize(groupIndexCounts[g]);
+    }
+
+    // 3) Pre-transform into the merged buffers. Each instance writes its own disjoint range.
+    jobs.ParallelFor(m_Instances.size(), 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Instance& inst = m_Instances[i];
+            const GroupPlacement& place = placements[i];
+            Span<const float> src = inst.mesh->GetVertices();
+            Span<const unsigned int> srcIndices = inst.mesh->GetIndices();
+            float* dst = merged[place.group].vertices.data() + place.vertexOffset * kVertexStride;
+
+            for (size_t v = 0; v + kVertexStride <= src.size(); v += kVertexStride) {
+                glm::vec4 p = inst.transform * glm::vec4(src[v], src[v + 1], src[v + 2], 1.0f);
+                dst[v + 0] = p.x;
+                dst[v + 1] = p.y;
+                dst[v + 2] = p.z;
+                for (size_t a = 3; a < kVertexStride; ++a)
+                    dst[v + a] = src[v + a];
+            }
+
+            unsigned int* dstIndices = merged[place.group].indices.data() + place.indexOffset;
+            const unsigned int base = static_cast<unsigned int>(place.vertexOffset);
+            for (size_t k = 0; k < srcIndices.size(); ++k)
+                dstIndices[k] = srcIndices[k] + base;
+        }
+    });
+
+    // 4) Upload - GL calls stay on this thread
+    for (size_t g = 0; g < groups.size(); ++g) {
+        groups[g].mesh = std::make_shared<Mesh>(std::move(merged[g]));
+        if (!groups[g].mesh->SetupGL()) {
+            std::cerr << "[StaticBatcher] Failed to upload batch " << g << std::endl;
+            continue;
+        }
+        m_Batches.push_back(std::move(groups[g]));
+    }
+
+    for (const Instance& inst : m_Instances) {
+        if (inst.mesh->GetCpuDataPolicy() == Mesh::CpuDataPolicy::Release && !inst.mesh->HasGL())
+            inst.mesh->ReleaseCpuData();
+    }
+
+    std::cout << "[StaticBatcher] Merged " << m_Instances.size() << " static prop(s) into "
+              << m_Batches.size() << " batch(es)" << std::endl;
+    m_Instances.clear();
+}
+
+void StaticBatcher::Draw(Shader& shader, MaterialBlocks& materials) const {
+    if (m_Batches.empty())
+        return;
+
+    shader.SetUniformMat4f("u_Model", glm::mat4(1.0f));
+    for (const Batch& batch : m_Batches) {
+        if (batch.texture)
+            batch.texture->Touch();     // Also when not ready, so it gets streamed
+        if (batch.texture && batch.texture->IsReady()) {
+            batch.texture->Bind(0);
+            materials.Bind(MaterialBlocks::kTextured);
+        } else {
+            materials.Bind(MaterialBlocks::kVertexColors);
+        }
+        batch.mesh->Draw();
+    }
+}
+
+void StaticBatcher::Submit(RenderQueue& queue, Shader& shader) const {
+    for (const Batch& batch : m_Batches) {
+        DrawPacket packet;
+        packet.mesh = batch.mesh.get();
+        packet.shader = &shader;
+        packet.texture = batch.texture.get();
+        // transform stays identity - the geometry is already in world space
+        queue.Submit(packet);
+    }
+}
+
+void StaticBatcher::Submit(RenderQueue& queue, Shader& shader, const std::vector<uint32_t>& visible) const {
+    for (uint32_t index : visible) {
+        if (index >= m_Batches.size())
+            continue;
+        const Batch& batch = m_Batches[index];
+        DrawPacket packet;
+        packet.mesh = batch.mesh.get();
+        packet.shader = &shader;
+        packet.texture = batch.texture.get();
+        queue.Submit(packet);
+    }
+}
+
+void StaticBatcher::Clear() {
+    m_Instances.clear();
+    m_Batches.clear();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+#include "vendor/glm/glm.hpp"
+
+class MaterialBlocks;
+class Mesh;
+class RenderQueue;
+class Shader;
+class Texture;
+
+/**
+ * StaticBatcher - merges non-moving props into shared vertex/index buffers
+ *
+ * At level load every static prop is registered with Add(). Build() then
+ * - groups the instances by material (diffuse texture) and by spatial grid cell,
+ * - pre-applies each instance transform on the CPU (in parallel on the JobSystem),
+ * - uploads one Mesh (VAO/VBO/EBO) per group.
+ * Each batch keeps its world-space bounds, so batches can still be culled.
+ *
+ * The source meshes only need their CPU-side data (SetupGL() is not required).
+ * Sources with CpuDataPolicy::Release that were never uploaded themselves drop
+ * their CPU copies after Build() - the merged batch is their GPU upload.
+ */
+class StaticBatcher {
+public:
+    struct Batch {
+        std::shared_ptr<Texture> texture;   // nullptr = per-vertex material colors
+        std::shared_ptr<Mesh> mesh;         // merged geometry, already in world space
+        AABB bounds;                        // world-space bounds of the merged geometry
+        size_t sourceCount = 0;             // number of props merged into this batch
+    };
+
+    explicit StaticBatcher(float cellSize = 32.0f);
+
+    // Register a static prop. The mesh must keep its CPU-side data until Build().
+    void Add(std::shared_ptr<Mesh> mesh, const glm::mat4& transform, std::shared_ptr<Texture> texture = nullptr);
+
+    // Merge all registered props. Needs a GL context (uploads the merged buffers).
+    void Build();
+
+    // Draw all batches. The shader and the Camera block must be bound; u_Model is set to identity.
+    void Draw(Shader& shader, MaterialBlocks& materials) const;
+    // Queue all batches instead (identity transform, sorted with everything else)
+    void Submit(RenderQueue& queue, Shader& shader) const;
+    // Queue only the listed batches (e.g. DynamicBVH::QueryFrustum output where batch i was inserted with userData i).
+    // Indices past the batch count are skipped, so the same scene index can hold other objects after the batches.
+    void Submit(RenderQueue& queue, Shader& shader, const std::vector<uint32_t>& visible) const;
+
+    void Clear();
+
+    inline const std::vector<Batch>& GetBatches() const { return m_Batches; }
+    inline size_t GetPendingCount() const { return m_Instances.size(); }
+    inline float GetCellSize() const { return m_CellSize; }
+
+private:
+    struct Instance {
+        std::shared_ptr<Mesh> mesh;
+        glm::mat4 transform;
+        std::shared_ptr<Texture> texture;
+        AABB worldBounds;
+    };
+
+    float m_CellSize;
+    std::vector<Instance> m_Instances;
+    std::vector<Batch> m_Batches;
+};
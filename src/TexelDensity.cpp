@@ -0,0 +1,34 @@
+#include "TexelDensity.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cmath>
+
+TexelDensity::TexelDensity()
+    : m_CameraPos(0.0f), m_PixelsPerUnit(1.0f), m_Bias(0.0f) {
+}
+
+void TexelDensity::SetView(const glm::mat4& view, float fovY, int viewportHeight) {
+    m_CameraPos = glm::vec3(glm::inverse(view)[3]);
+    m_PixelsPerUnit = static_cast<float>(viewportHeight) / (2.0f * std::tan(fovY * 0.5f));
+}
+
+int TexelDensity::SelectLevel(const Texture& texture, const AABB& worldBounds, float uvDensity) const {
+    const int lastLevel = texture.GetMipLevels() - 1;
+    if (uvDensity <= 0.0f || lastLevel <= 0 || !worldBounds.IsValid())
+        return 0;
+
+    // Inside the bounds the distance is 0 and the object needs everything
+    const glm::vec3 closest = glm::clamp(m_CameraPos, worldBounds.min, worldBounds.max);
+    const float distance = glm::length(m_CameraPos - closest);
+    if (distance <= 0.0f)
+        return 0;
+
+    const float pixelsPerUnit = m_PixelsPerUnit / distance;
+    const float texelsPerUnit = uvDensity * static_cast<float>(std::max(texture.GetWidth(), texture.GetHeight()));
+    const float level = std::floor(std::log2(texelsPerUnit / pixelsPerUnit) + m_Bias);
+    return std::min(std::max(static_cast<int>(level), 0), lastLevel);
+}
+
+void TexelDensity::Request(const Texture& texture, const AABB& worldBounds, float uvDensity) const {
+    texture.RequestLevel(SelectLevel(texture, worldBounds, uvDensity));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Bounds.h"
+#include "vendor/glm/glm.hpp"
+
+class Texture;
+
+/**
+ * TexelDensity - picks the mip level a texture needs on screen
+ *
+ * SetView() takes the view matrix, the vertical field of view and the viewport
+ * height once per frame. For an object with world-space bounds and a UV density
+ * (UV units per world unit, Mesh::GetUVDensity) the screen pixels covered by one
+ * world unit are measured at the point of the bounds closest to the camera; the
+ * texture maps uvDensity * size texels onto that world unit. The level is log2 of
+ * texels per pixel - one texel per pixel is all the view can show.
+ *
+ * Request() hands the level to Texture::RequestLevel; TextureResidency streams
+ * it in. Objects without a UV density ask for full detail.
+ *
+ * Usage (each frame, before drawing):
+ *   density.SetView(view, glm::radians(45.0f), windowHeight);
+ *   for (const auto& batch : batcher.GetBatches())
+ *       density.Request(*batch.texture, batch.bounds, batch.mesh->GetUVDensity());
+ */
+class TexelDensity {
+public:
+    TexelDensity();
+
+    void SetView(const glm::mat4& view, float fovY, int viewportHeight);
+
+    // Levels added to the selected one (> 0 streams less detail)
+    inline void SetBias(float levels) { m_Bias = levels; }
+
+    int SelectLevel(const Texture& texture, const AABB& worldBounds, float uvDensity) const;
+    void Request(const Texture& texture, const AABB& worldBounds, float uvDensity) const;
+
+private:
+    glm::vec3 m_CameraPos;
+    float m_PixelsPerUnit;  // Screen pixels covered by one world unit at distance 1
+    float m_Bias;
+};
@@ -1,61 +1,230 @@
 #include "Texture.h"
+#include "MipChain.h"
+#include "MappedFile.h"
+#include "Ktx2.h"
 #include "Debug.h"
+#include "GLState.h"
 #include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "vendor/stb/stb_image.h"
 
+// S3TC is an extension (universally available on desktop), glad only has core enums
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+static bool s_MipCacheEnabled = false;
+
+uint64_t Texture::s_CurrentFrame = 0;
+
+static bool HasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext && std::strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static GLenum CompressedInternalFormat(const Ktx2::Image& image) {
+    switch (image.format) {
+    case BlockCompression::Format::BC1:
+        return image.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case BlockCompression::Format::BC3:
+        return image.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockCompression::Format::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case BlockCompression::Format::BC7:
+        return image.srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+std::string Texture::FindCookedPath(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of("/\\");
+    const std::string stem = (dot != std::string::npos && (slash == std::string::npos || dot > slash)) ? path.substr(0, dot) : path;
+    const std::string cooked = stem + ".ktx2";
+    if (cooked == path)
+        return path;
+    std::ifstream file(cooked, std::ios::binary);
+    return file.is_open() ? cooked : std::string();
+}
+
+unsigned int Texture::CreateStorage(int width, int height, int levels, unsigned int internalFormat) {
+    unsigned int id = 0;
+    GLCall(glGenTextures(1, &id));
+    GLState::BindTexture(GL_TEXTURE_2D, id);
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GLCall(glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height));
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+    return id;
+}
+
+void Texture::SetCurrentFrame(uint64_t frame) {
+    s_CurrentFrame = frame;
+}
+
+void Texture::SetMipCacheEnabled(bool enabled) {
+    s_MipCacheEnabled = enabled;
+}
+
+bool Texture::IsMipCacheEnabled() {
+    return s_MipCacheEnabled;
+}
+
 Texture::Texture(const std::string& path)
     : m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr),
-      m_Width(0), m_Height(0), m_BPP(0) {
-    
-    // Flip texture vertically (OpenGL expects texture origin at bottom-left)
-    stbi_set_flip_vertically_on_load(1);
-    
-    m_LocalBuffer = stbi_load(path.c_str(), &m_Width, &m_Height, &m_BPP, 4);
+      m_Width(0), m_Height(0), m_BPP(0), m_MipLevels(0), m_Ready(true) {
     
-    if (!m_LocalBuffer) {
+    // Cooked block-compressed version: no decode, uploaded straight from the mapped file
+    if (glGenTextures != nullptr) {
+        const std::string cooked = FindCookedPath(path);
+        if (!cooked.empty() && LoadCompressed(cooked))
+            return;
+    }
+
+    // Decode (flipped - OpenGL expects texture origin at bottom-left) and build
+    // the full mip chain on the CPU, or load it from the .mips cache
+    MipChain chain;
+    if (!chain.LoadImage(path, s_MipCacheEnabled)) {
         std::cerr << "[Texture] Failed to load texture: " << path << std::endl;
-        std::cerr << "[Texture] stbi error: " << stbi_failure_reason() << std::endl;
+        // PNGs only reach stb_image when the fast decoder rejects them
+        if (const char* reason = stbi_failure_reason())
+            std::cerr << "[Texture] stbi error: " << reason << std::endl;
         return;
     }
-    
+    CreateFromMipChain(chain);
+
     std::cout << "[Texture] Successfully loaded: " << path << std::endl;
-    std::cout << "[Texture]   Size: " << m_Width << "x" << m_Height << ", Channels: " << m_BPP << std::endl;
-    
+    std::cout << "[Texture]   Size: " << m_Width << "x" << m_Height << ", Channels: " << m_BPP
+              << ", Mip levels: " << m_MipLevels << std::endl;
+}
+
+Texture::Texture(const std::string& name, const MipChain& chain)
+    : m_RendererID(0), m_FilePath(name), m_LocalBuffer(nullptr),
+      m_Width(0), m_Height(0), m_BPP(0), m_MipLevels(0), m_Ready(true) {
+    if (chain.IsValid())
+        CreateFromMipChain(chain);
+}
+
+void Texture::CreateFromMipChain(const MipChain& chain) {
+    m_Width = chain.GetWidth();
+    m_Height = chain.GetHeight();
+    m_BPP = chain.GetSourceChannels();
+    m_MipLevels = chain.GetLevelCount();
+
     // Only create OpenGL texture if we have a valid GL context
     // Check if OpenGL is initialized by testing if we can get a function pointer
     if (glGenTextures != nullptr) {
-        GLCall(glGenTextures(1, &m_RendererID));
-        GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
-        
-        // Set texture parameters
-        GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-        GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
-        
-        // Upload texture data to GPU
-        GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height,
-                            0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
-        GLCall(glBindTexture(GL_TEXTURE_2D, 0));
-        
-        // Free local buffer after uploading to GPU
-        if (m_LocalBuffer) {
-            stbi_image_free(m_LocalBuffer);
-            m_LocalBuffer = nullptr;
+        m_InternalFormat = GL_RGBA8;
+        m_RendererID = CreateStorage(m_Width, m_Height, m_MipLevels, m_InternalFormat);
+        GLState::BindTexture(GL_TEXTURE_2D, m_RendererID);
+
+        // Upload all mip levels to GPU (no glGenerateMipmap on the render thread)
+        GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        for (int level = 0; level < m_MipLevels; ++level) {
+            const MipChain::Level& mip = chain.GetLevel(level);
+            GLCall(glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.width, mip.height,
+                                   GL_RGBA, GL_UNSIGNED_BYTE, chain.GetLevelData(level)));
         }
+        GLState::BindTexture(GL_TEXTURE_2D, 0);
     } else {
-        // No OpenGL context - keep the image data in memory
+        // No OpenGL context - keep the image data (level 0) in memory
         // This allows testing without a full GL context
+        const size_t size = chain.GetLevel(0).size;
+        m_LocalBuffer = static_cast<unsigned char*>(STBI_MALLOC(size));
+        if (m_LocalBuffer)
+            std::memcpy(m_LocalBuffer, chain.GetLevelData(0), size);
         std::cout << "[Texture] No OpenGL context - image data loaded but not uploaded to GPU" << std::endl;
     }
 }
 
+Texture::Texture(const std::string& path, int width, int height, int mipLevels)
+    : m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr),
+      m_Width(width), m_Height(height), m_BPP(4), m_MipLevels(mipLevels > 0 ? mipLevels : 1), m_Ready(false) {
+    m_InternalFormat = GL_RGBA8;
+    m_ResidentLevel = m_MipLevels;
+}
+
+bool Texture::OpenCompressed(const std::string& ktx2Path) {
+    MappedFile file;
+    Ktx2::Image image;
+    return OpenCompressed(ktx2Path, file, image);
+}
+
+bool Texture::OpenCompressed(const std::string& ktx2Path, MappedFile& file, Ktx2::Image& image) {
+    if (!file.Open(ktx2Path) || !Ktx2::Parse(file.GetData(), file.GetSize(), image)) {
+        std::cerr << "[Texture] Failed to load cooked texture: " << ktx2Path << std::endl;
+        return false;
+    }
+    if ((image.format == BlockCompression::Format::BC1 || image.format == BlockCompression::Format::BC3) &&
+        !HasGLExtension("GL_EXT_texture_compression_s3tc")) {
+        std::cerr << "[Texture] S3TC not supported, ignoring cooked texture: " << ktx2Path << std::endl;
+        return false;
+    }
+
+    if (m_CookedPath.empty()) {
+        std::cout << "[Texture] Cooked texture: " << ktx2Path << std::endl;
+        std::cout << "[Texture]   Size: " << image.width << "x" << image.height << ", Format: "
+                  << BlockCompression::FormatName(image.format) << (image.srgb ? " sRGB" : "")
+                  << ", Mip levels: " << image.levels.size() << std::endl;
+    }
+
+    m_CookedPath = ktx2Path;
+    m_Width = image.width;
+    m_Height = image.height;
+    m_BPP = 4;
+    m_MipLevels = static_cast<int>(image.levels.size());
+    m_InternalFormat = CompressedInternalFormat(image);
+    m_BlockBytes = static_cast<int>(BlockCompression::BlockBytes(image.format));
+    return true;
+}
+
+bool Texture::LoadCompressed(const std::string& ktx2Path, int firstLevel) {
+    MappedFile file;
+    Ktx2::Image image;
+    if (!OpenCompressed(ktx2Path, file, image))
+        return false;
+
+    // Only the pages of the levels that are read get faulted in
+    firstLevel = std::min(std::max(firstLevel, 0), m_MipLevels - 1);
+    const unsigned int target = CreateStorage(std::max(1, m_Width >> firstLevel), std::max(1, m_Height >> firstLevel),
+                                              m_MipLevels - firstLevel, m_InternalFormat);
+    GLState::BindTexture(GL_TEXTURE_2D, target);
+    for (int level = firstLevel; level < m_MipLevels; ++level) {
+        const Ktx2::Level& mip = image.levels[level];
+        GLCall(glCompressedTexSubImage2D(GL_TEXTURE_2D, level - firstLevel, 0, 0, mip.width, mip.height,
+                                         m_InternalFormat, static_cast<GLsizei>(mip.size), mip.data));
+    }
+    GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+    if (m_RendererID != 0)
+        GLState::DeleteTexture(m_RendererID);
+    m_RendererID = target;
+    m_ResidentLevel = firstLevel;
+    m_Ready = true;
+    return true;
+}
+
 Texture::~Texture() {
     if (m_RendererID != 0 && glDeleteTextures != nullptr) {
-        GLCall(glDeleteTextures(1, &m_RendererID));
+        GLState::DeleteTexture(m_RendererID);
     }
     if (m_LocalBuffer) {
         stbi_image_free(m_LocalBuffer);
@@ -63,14 +232,66 @@ Texture::~Texture() {
 }
 
 void Texture::Bind(unsigned int slot) const {
-    if (m_RendererID != 0 && glActiveTexture != nullptr) {
-        GLCall(glActiveTexture(GL_TEXTURE0 + slot));
-        GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
-    }
+    Touch();
+    if (m_RendererID != 0 && glActiveTexture != nullptr)
+        GLState::BindTexture(slot, GL_TEXTURE_2D, m_RendererID);
 }
 
 void Texture::Unbind() const {
     if (glBindTexture != nullptr) {
-        GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+        GLState::BindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+size_t Texture::LevelBytes(int level) const {
+    const size_t width = static_cast<size_t>(std::max(1, m_Width >> level));
+    const size_t height = static_cast<size_t>(std::max(1, m_Height >> level));
+    if (m_BlockBytes > 0)
+        return ((width + 3) / 4) * ((height + 3) / 4) * static_cast<size_t>(m_BlockBytes);
+    return width * height * 4;
+}
+
+size_t Texture::GetLevelRangeBytes(int firstLevel, int endLevel) const {
+    size_t bytes = 0;
+    for (int level = std::max(firstLevel, 0); level < std::min(endLevel, m_MipLevels); ++level)
+        bytes += LevelBytes(level);
+    return bytes;
+}
+
+size_t Texture::GetResidentBytes() const {
+    return m_RendererID != 0 ? GetLevelRangeBytes(m_ResidentLevel, m_MipLevels) : 0;
+}
+
+size_t Texture::GetFullBytes() const {
+    return GetLevelRangeBytes(0, m_MipLevels);
+}
+
+bool Texture::DropTopLevels(int count) {
+    const int first = m_ResidentLevel + count;
+    const int keep = m_MipLevels - first;
+    if (m_RendererID == 0 || m_Streaming || count <= 0 || keep < 1)
+        return false;
+
+    // Immutable storage can't shrink: copy the remaining levels into a new object
+    const int width = std::max(1, m_Width >> first);
+    const int height = std::max(1, m_Height >> first);
+    const unsigned int target = CreateStorage(width, height, keep, m_InternalFormat);
+    for (int level = 0; level < keep; ++level) {
+        GLCall(glCopyImageSubData(m_RendererID, GL_TEXTURE_2D, level + count, 0, 0, 0,
+                                  target, GL_TEXTURE_2D, level, 0, 0, 0,
+                                  std::max(1, width >> level), std::max(1, height >> level), 1));
+    }
+    GLState::DeleteTexture(m_RendererID);
+    m_RendererID = target;
+    m_ResidentLevel = first;
+    return true;
+}
+
+void Texture::Evict() {
+    if (m_RendererID != 0) {
+        GLState::DeleteTexture(m_RendererID);
+        m_RendererID = 0;
     }
+    m_ResidentLevel = m_MipLevels;
+    m_Ready = false;
 }
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include "Ktx2.h"
+
+class MappedFile;
+class MipChain;
 
 class Texture {
 private:
@@ -8,17 +14,97 @@ private:
     std::string m_FilePath;
     unsigned char* m_LocalBuffer;
     int m_Width, m_Height, m_BPP;
+    int m_MipLevels;
+    bool m_Ready;   // false while the pixel data is still being streamed in
+
+    // Residency (see TextureResidency). The GL object holds levels [m_ResidentLevel, m_MipLevels),
+    // its level 0 is m_ResidentLevel of the full chain.
+    std::string m_CookedPath;           // KTX2 file the levels come from, empty for images
+    unsigned int m_InternalFormat = 0;
+    int m_BlockBytes = 0;               // Bytes per 4x4 block for compressed formats, 0 for RGBA8
+    int m_ResidentLevel = 0;            // First mip level in VRAM, m_MipLevels when evicted
+    int m_PendingLevel = 0;             // First level of the storage being streamed
+    bool m_Streaming = false;           // TextureStreamer is filling (new) storage
+    mutable uint64_t m_LastUsedFrame = 0;
+    mutable int m_RequestedLevel = 0;   // Finest level asked for in m_LastUsedFrame
+
+    friend class TextureStreamer;
+
+    // Reads format and size of a cooked texture without uploading anything
+    bool OpenCompressed(const std::string& ktx2Path);
+    // Same, keeping the mapping and the parsed levels for the upload
+    bool OpenCompressed(const std::string& ktx2Path, MappedFile& file, Ktx2::Image& image);
+    // Uploads levels [firstLevel, end) from the mapped file, replacing the resident ones
+    bool LoadCompressed(const std::string& ktx2Path, int firstLevel = 0);
+    void CreateFromMipChain(const MipChain& chain);
+    size_t LevelBytes(int level) const;
+
+    // Immutable storage with the default sampler state, returns the GL name
+    static unsigned int CreateStorage(int width, int height, int levels, unsigned int internalFormat);
 
 public:
+    // Loads the image and uploads a full CPU-built mip chain (see MipChain).
+    // A cooked "<name>.ktx2" next to the image (tools/TextureCooker) is preferred.
     Texture(const std::string& path);
+    // Uploads an already built chain (e.g. a TextureAtlas page)
+    Texture(const std::string& name, const MipChain& chain);
+    // No GPU storage yet - levels are streamed in later (see TextureStreamer)
+    Texture(const std::string& path, int width, int height, int mipLevels = 1);
     ~Texture();
 
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
     void Bind(unsigned int slot = 0) const;
     void Unbind() const;
 
     inline int GetWidth() const { return m_Width; }
     inline int GetHeight() const { return m_Height; }
+    inline int GetMipLevels() const { return m_MipLevels; }
     inline const std::string& GetFilePath() const { return m_FilePath; }
     inline unsigned int GetRendererID() const { return m_RendererID; }
     inline bool IsValid() const { return m_Width > 0 && m_Height > 0; }
+    inline bool IsReady() const { return IsValid() && m_Ready; }
+
+    // ----- Residency -----
+    // Marks the texture as used this frame and asks for `level` as the finest mip
+    // (the finest of all requests in a frame wins, see TexelDensity)
+    inline void RequestLevel(int level) const {
+        if (m_LastUsedFrame != s_CurrentFrame || level < m_RequestedLevel)
+            m_RequestedLevel = level;
+        m_LastUsedFrame = s_CurrentFrame;
+    }
+    // Marks the texture as used at full detail, unless a level was requested this frame.
+    // Bind() does it too; draw code also calls it for textures that aren't ready.
+    inline void Touch() const {
+        if (m_LastUsedFrame != s_CurrentFrame)
+            RequestLevel(0);
+    }
+    inline uint64_t GetLastUsedFrame() const { return m_LastUsedFrame; }
+    inline int GetRequestedLevel() const { return m_RequestedLevel; }
+    inline bool IsResident() const { return m_RendererID != 0; }
+    inline bool IsStreaming() const { return m_Streaming; }
+    inline int GetResidentLevel() const { return m_ResidentLevel; }
+    inline int GetPendingLevel() const { return m_PendingLevel; }
+    size_t GetLevelRangeBytes(int firstLevel, int endLevel) const;
+    size_t GetResidentBytes() const;    // VRAM used by the levels that are resident
+    size_t GetFullBytes() const;        // VRAM of the complete chain
+
+    // GL thread only. Moves the levels below the top `count` ones into a smaller
+    // texture object (glCopyImageSubData) and frees the old one.
+    bool DropTopLevels(int count);
+    // GL thread only. Frees the GL texture; the texture is not ready until restreamed.
+    void Evict();
+
+    static void SetCurrentFrame(uint64_t frame);
+
+    // Cache built mip chains next to the images ("<image>.mips")
+    static void SetMipCacheEnabled(bool enabled);
+    static bool IsMipCacheEnabled();
+
+    // Path of the cooked KTX2 version of an image, empty if there is none
+    static std::string FindCookedPath(const std::string& path);
+
+private:
+    static uint64_t s_CurrentFrame;
 };
@@ -0,0 +1,478 @@
+#include "TextureAtlas.h"
+#include "Texture.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "vendor/stb/stb_image.h"
+
+namespace {
+
+// Skyline bin packer: the packed area is described by its upper outline
+class SkylinePacker {
+public:
+    SkylinePacker(int width, int height)
+        : m_Width(width), m_Height(height) {
+        m_Skyline.push_back({ 0, 0, width });
+    }
+
+    bool Insert(int width, int height, int& outX, int& outY) {
+        int bestTop = m_Height + 1, bestWidth = m_Width + 1;
+        size_t bestNode = m_Skyline.size();
+        for (size_t i = 0; i < m_Skyline.size(); ++i) {
+            int y = 0;
+            if (!Fits(i, width, height, y))
+                continue;
+            // Lowest top edge first, then the narrowest ledge (least waste)
+            if (y + height < bestTop || (y + height == bestTop && m_Skyline[i].width < bestWidth)) {
+                bestTop = y + height;
+                bestWidth = m_Skyline[i].width;
+                bestNode = i;
+                outY = y;
+            }
+        }
+        if (bestNode == m_Skyline.size())
+            return false;
+
+        outX = m_Skyline[bestNode].x;
+        AddLevel(bestNode, outX, outY + height, width);
+        return true;
+    }
+
+private:
+    struct Node {
+        int x, y, width;
+    };
+
+    // Rect placed at node i's x rests on the highest node it spans
+    bool Fits(size_t i, int width, int height, int& outY) const {
+        const int x = m_Skyline[i].x;
+        if (x + width > m_Width)
+            return false;
+        int remaining = width;
+        int y = m_Skyline[i].y;
+        while (remaining > 0) {
+            y = std::max(y, m_Skyline[i].y);
+            if (y + height > m_Height)
+                return false;
+            remaining -= m_Skyline[i].width;
+            ++i;
+        }
+        outY = y;
+        return true;
+    }
+
+    void AddLevel(size_t index, int x, int y, int width) {
+        m_Skyline.insert(m_Skyline.begin() + index, { x, y, width });
+
+        // Shrink or remove the nodes now covered by the new one
+        for (size_t i = index + 1; i < m_Skyline.size();) {
+            const int covered = x + width - m_Skyline[i].x;
+            if (covered <= 0)
+                break;
+            if (covered >= m_Skyline[i].width) {
+                m_Skyline.erase(m_Skyline.begin() + i);
+                continue;
+            }
+            m_Skyline[i].x += covered;
+            m_Skyline[i].width -= covered;
+            break;
+        }
+
+        // Merge neighbours on the same height
+        for (size_t i = 0; i + 1 < m_Skyline.size();) {
+            if (m_Skyline[i].y == m_Skyline[i + 1].y) {
+                m_Skyline[i].width += m_Skyline[i + 1].width;
+                m_Skyline.erase(m_Skyline.begin() + i + 1);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    int m_Width, m_Height;
+    std::vector<Node> m_Skyline;
+};
+
+struct SourceImage {
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    int paddedWidth = 0, paddedHeight = 0;
+    int x = 0, y = 0;       // Padded rect position
+    bool placed = false;
+};
+
+inline int AlignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int NextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+struct LayoutHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    int32_t width;
+    int32_t height;
+    int32_t mipLevels;
+    uint32_t regionCount;
+};
+
+constexpr uint32_t kLayoutVersion = 1;
+
+} // namespace
+
+TextureAtlas::TextureAtlas()
+    : TextureAtlas(TextureAtlasSettings()) {
+}
+
+TextureAtlas::TextureAtlas(const TextureAtlasSettings& settings)
+    : m_Settings(settings) {
+    m_Settings.mipLevels = std::max(1, std::min(m_Settings.mipLevels, 12));
+    // The packer grows the atlas in powers of two
+    int maxSize = 1;
+    while (maxSize * 2 <= m_Settings.maxSize)
+        maxSize *= 2;
+    m_Settings.maxSize = maxSize;
+}
+
+void TextureAtlas::Add(const std::string& path) {
+    if (std::find(m_Sources.begin(), m_Sources.end(), path) == m_Sources.end())
+        m_Sources.push_back(path);
+}
+
+bool TextureAtlas::Build() {
+    m_Regions.clear();
+    m_RegionLookup.clear();
+    m_Chain.Clear();
+    m_Texture.reset();
+    if (m_Sources.empty())
+        return false;
+
+    JobSystem& jobs = JobSystem::Get();
+    const int align = 1 << (m_Settings.mipLevels - 1);
+    const int gutter = align;
+
+    // 1) Decode all sources in parallel (flipped, rows bottom-up like every texture)
+    std::vector<SourceImage> images(m_Sources.size());
+    jobs.ParallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+        stbi_set_flip_vertically_on_load_thread(1);
+        for (size_t i = begin; i < end; ++i) {
+            int channels = 0;
+            SourceImage& image = images[i];
+            image.pixels = stbi_load(m_Sources[i].c_str(), &image.width, &image.height, &channels, 4);
+            if (!image.pixels)
+                continue;
+            image.paddedWidth = AlignUp(image.width + 2 * gutter, align);
+            image.paddedHeight = AlignUp(image.height + 2 * gutter, align);
+        }
+    });
+
+    // 2) Pack, tallest first. Grow the atlas (powers of two) until everything fits.
+    std::vector<size_t> order;
+    long long area = 0;
+    int largest = align;
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (!images[i].pixels) {
+            std::cerr << "[TextureAtlas] Failed to load " << m_Sources[i] << std::endl;
+            continue;
+        }
+        if (images[i].paddedWidth > m_Settings.maxSize || images[i].paddedHeight > m_Settings.maxSize) {
+            std::cerr << "[TextureAtlas] Too large for the atlas: " << m_Sources[i] << std::endl;
+            continue;
+        }
+        order.push_back(i);
+        area += static_cast<long long>(images[i].paddedWidth) * images[i].paddedHeight;
+        largest = std::max(largest, std::max(images[i].paddedWidth, images[i].paddedHeight));
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (images[a].paddedHeight != images[b].paddedHeight)
+            return images[a].paddedHeight > images[b].paddedHeight;
+        return images[a].paddedWidth > images[b].paddedWidth;
+    });
+
+    int width = std::max(NextPowerOfTwo(largest), NextPowerOfTwo(static_cast<int>(std::sqrt(static_cast<double>(area)))));
+    width = std::min(width, m_Settings.maxSize);
+    int height = width;
+    for (;;) {
+        SkylinePacker packer(width, height);
+        bool all = true;
+        for (size_t i : order) {
+            SourceImage& image = images[i];
+            image.placed = packer.Insert(image.paddedWidth, image.paddedHeight, image.x, image.y);
+            all = all && image.placed;
+        }
+        if (all)
+            break;
+        if (width <= height && width * 2 <= m_Settings.maxSize)
+            width *= 2;
+        else if (height * 2 <= m_Settings.maxSize)
+            height *= 2;
+        else
+            break; // Keep what fits at max size
+    }
+
+    // 3) Blit with replicated borders, one region per job
+    std::vector<unsigned char> atlas(static_cast<size_t>(width) * height * 4, 0);
+    jobs.ParallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const SourceImage& image = images[i];
+            if (!image.pixels || !image.placed)
+                continue;
+            for (int py = 0; py < image.paddedHeight; ++py) {
+                const int sy = std::min(std::max(py - gutter, 0), image.height - 1);
+                unsigned char* dst = atlas.data() + (static_cast<size_t>(image.y + py) * width + image.x) * 4;
+                const unsigned char* src = image.pixels + static_cast<size_t>(sy) * image.width * 4;
+                for (int px = 0; px < image.paddedWidth; ++px) {
+                    const int sx = std::min(std::max(px - gutter, 0), image.width - 1);
+                    std::memcpy(dst + px * 4, src + sx * 4, 4);
+                }
+            }
+        }
+    });
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        const SourceImage& image = images[i];
+        if (image.pixels && image.placed) {
+            Region region;
+            region.path = m_Sources[i];
+            region.x = image.x + gutter;
+            region.y = image.y + gutter;
+            region.width = image.width;
+            region.height = image.height;
+            m_Regions.push_back(region);
+        } else if (image.pixels) {
+            std::cerr << "[TextureAtlas] Out of space, left out: " << m_Sources[i] << std::endl;
+        }
+        if (image.pixels)
+            stbi_image_free(image.pixels);
+    }
+    if (m_Regions.empty())
+        return false;
+
+    m_Width = width;
+    m_Height = height;
+    IndexRegions();
+
+    // 4) Mips - only the levels the gutters were sized for
+    m_Chain.Build(atlas.data(), width, height);
+    m_Chain.TrimLevels(m_Settings.mipLevels);
+    m_Texture = std::make_shared<Texture>("atlas", m_Chain);
+
+    std::cout << "[TextureAtlas] Packed " << m_Regions.size() << " texture(s) into " << width << "x" << height
+              << " (" << m_Chain.GetLevelCount() << " mips, gutter " << gutter << ")" << std::endl;
+    return true;
+}
+
+void TextureAtlas::IndexRegions() {
+    m_RegionLookup.clear();
+    for (size_t i = 0; i < m_Regions.size(); ++i) {
+        Region& region = m_Regions[i];
+        region.uvMin = glm::vec2(static_cast<float>(region.x) / m_Width, static_cast<float>(region.y) / m_Height);
+        region.uvMax = glm::vec2(static_cast<float>(region.x + region.width) / m_Width,
+                                 static_cast<float>(region.y + region.height) / m_Height);
+        m_RegionLookup[region.path] = i;
+    }
+}
+
+const TextureAtlas::Region* TextureAtlas::Find(const std::string& path) const {
+    auto it = m_RegionLookup.find(path);
+    return it != m_RegionLookup.end() ? &m_Regions[it->second] : nullptr;
+}
+
+bool TextureAtlas::RemapUVs(OBJLoader::MeshData& mesh) const {
+    if (!mesh.hasTexCoords)
+        return false;
+
+    // Region of every vertex: an index into m_Regions, or one of these
+    constexpr int32_t kUnused = -1;     // Not referenced by any range
+    constexpr int32_t kOwnUVs = -2;     // Material outside the atlas - UVs stay
+    const size_t vertexCount = mesh.vertices.size() / 8;
+    std::vector<int32_t> vertexRegion(vertexCount, kUnused);
+
+    auto regionOf = [this, &mesh](const std::string& material) {
+        auto it = mesh.materials.find(material);
+        const Region* region = it != mesh.materials.end() ? Find(it->second.diffuseTexturePath) : nullptr;
+        return region ? static_cast<int32_t>(region - m_Regions.data()) : kOwnUVs;
+    };
+
+    bool usesAtlas = false;
+    if (mesh.materialRanges.empty()) {
+        // No face -> material information: only unambiguous for a single atlas material
+        int32_t only = kOwnUVs;
+        for (const auto& matPair : mesh.materials) {
+            const int32_t region = regionOf(matPair.first);
+            if (region == kOwnUVs)
+                continue;
+            if (only != kOwnUVs && only != region) {
+                std::cerr << "[TextureAtlas] Mesh uses several atlas materials but has no material ranges" << std::endl;
+                return false;
+            }
+            only = region;
+        }
+        if (only == kOwnUVs)
+            return false;
+        std::fill(vertexRegion.begin(), vertexRegion.end(), only);
+        usesAtlas = true;
+    } else {
+        for (const OBJLoader::MaterialRange& range : mesh.materialRanges) {
+            const int32_t region = regionOf(range.material);
+            usesAtlas = usesAtlas || region != kOwnUVs;
+            const size_t end = std::min(range.firstIndex + range.indexCount, mesh.indices.size());
+            for (size_t i = range.firstIndex; i < end; ++i) {
+                const unsigned int v = mesh.indices[i];
+                if (v >= vertexCount)
+                    continue;
+                if (vertexRegion[v] != kUnused && vertexRegion[v] != region) {
+                    // LoadOBJ / MeshCleanup merge vertices with equal attributes across materials
+                    std::cerr << "[TextureAtlas] Vertex shared by materials with different UV regions ("
+                              << range.material << "), keeping the own textures" << std::endl;
+                    return false;
+                }
+                vertexRegion[v] = region;
+            }
+        }
+        if (!usesAtlas)
+            return false;
+    }
+
+    // Tiling UVs can't be expressed inside an atlas rectangle
+    constexpr float kEpsilon = 1e-4f;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (vertexRegion[v] < 0)
+            continue;
+        const float u = mesh.vertices[v * 8 + 3], t = mesh.vertices[v * 8 + 4];
+        if (u < -kEpsilon || u > 1.0f + kEpsilon || t < -kEpsilon || t > 1.0f + kEpsilon) {
+            std::cerr << "[TextureAtlas] UVs of " << m_Regions[vertexRegion[v]].path << " wrap, keeping its own texture" << std::endl;
+            return false;
+        }
+    }
+
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (vertexRegion[v] < 0)
+            continue;
+        const Region& region = m_Regions[vertexRegion[v]];
+        const glm::vec2 size = region.uvMax - region.uvMin;
+        float* uv = &mesh.vertices[v * 8 + 3];
+        uv[0] = region.uvMin.x + std::min(std::max(uv[0], 0.0f), 1.0f) * size.x;
+        uv[1] = region.uvMin.y + std::min(std::max(uv[1], 0.0f), 1.0f) * size.y;
+    }
+    return true;
+}
+
+uint64_t TextureAtlas::ComputeSourceHash() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(static_cast<uint64_t>(m_Settings.maxSize));
+    mix(static_cast<uint64_t>(m_Settings.mipLevels));
+    for (const std::string& source : m_Sources) {
+        for (char c : source)
+            mix(static_cast<unsigned char>(c));
+        mix(MipChain::HashFile(source));
+    }
+    return hash;
+}
+
+bool TextureAtlas::Save(const std::string& basePath) const {
+    if (!m_Chain.IsValid())
+        return false;
+
+    const uint64_t hash = ComputeSourceHash();
+    std::ofstream file(basePath + ".atlas", std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[TextureAtlas] Failed to write: " << basePath << ".atlas" << std::endl;
+        return false;
+    }
+
+    LayoutHeader header{};
+    std::memcpy(header.magic, "RATL", 4);
+    header.version = kLayoutVersion;
+    header.sourceHash = hash;
+    header.width = m_Width;
+    header.height = m_Height;
+    header.mipLevels = m_Chain.GetLevelCount();
+    header.regionCount = static_cast<uint32_t>(m_Regions.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const Region& region : m_Regions) {
+        const uint32_t length = static_cast<uint32_t>(region.path.size());
+        const int32_t rect[4] = { region.x, region.y, region.width, region.height };
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        file.write(region.path.data(), length);
+        file.write(reinterpret_cast<const char*>(rect), sizeof(rect));
+    }
+    return file.good() && m_Chain.Save(basePath + ".mips", hash);
+}
+
+bool TextureAtlas::Load(const std::string& basePath) {
+    std::ifstream file(basePath + ".atlas", std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    LayoutHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "RATL", 4) != 0 || header.version != kLayoutVersion) {
+        std::cerr << "[TextureAtlas] Ignoring invalid layout: " << basePath << ".atlas" << std::endl;
+        return false;
+    }
+    const uint64_t hash = ComputeSourceHash();
+    if (header.sourceHash != hash)
+        return false; // Sources changed since the atlas was cooked
+
+    std::vector<Region> regions(header.regionCount);
+    for (Region& region : regions) {
+        uint32_t length = 0;
+        file.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!file || length > 4096)
+            return false;
+        region.path.resize(length);
+        file.read(&region.path[0], length);
+        int32_t rect[4] = {};
+        file.read(reinterpret_cast<char*>(rect), sizeof(rect));
+        region.x = rect[0];
+        region.y = rect[1];
+        region.width = rect[2];
+        region.height = rect[3];
+    }
+    if (!file) {
+        std::cerr << "[TextureAtlas] Truncated layout: " << basePath << ".atlas" << std::endl;
+        return false;
+    }
+
+    MipChain chain;
+    if (!chain.Load(basePath + ".mips", hash) || chain.GetWidth() != header.width || chain.GetHeight() != header.height)
+        return false;
+
+    m_Regions = std::move(regions);
+    m_Width = header.width;
+    m_Height = header.height;
+    IndexRegions();
+    m_Texture = std::make_shared<Texture>("atlas", chain);
+    m_Chain.Clear();
+    return true;
+}
+
+bool TextureAtlas::BuildOrLoad(const std::string& basePath) {
+    if (Load(basePath)) {
+        std::cout << "[TextureAtlas] Loaded cooked atlas: " << basePath << std::endl;
+        return true;
+    }
+    if (!Build())
+        return false;
+    Save(basePath);
+    m_Chain.Clear(); // Pixels live on the GPU now
+    return true;
+}
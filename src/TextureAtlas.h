@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MipChain.h"
+#include "OBJLoader.h"
+#include "vendor/glm/glm.hpp"
+
+class Texture;
+
+struct TextureAtlasSettings {
+    int maxSize = 2048;     // Max atlas width / height in texels
+    int mipLevels = 4;      // Levels kept; the gutters are wide enough for all of them
+};
+
+/**
+ * TextureAtlas - packs many small material textures into one texture
+ *
+ * Build() decodes the added images in parallel, packs them with a skyline
+ * bin packer and builds the atlas mip chain. Every region is surrounded by a
+ * gutter of replicated border texels that is 2^(mipLevels-1) texels wide and
+ * aligned to that size, so no mip level that is kept bleeds between regions.
+ *
+ * Meshes are remapped at load time: OBJLoader hands map_Kd paths that are in
+ * the atlas the atlas texture and RemapUVs() moves the UVs into the region.
+ * All materials in one atlas share a Texture, so StaticBatcher puts them into
+ * the same batch.
+ *
+ * Save()/Load() store the packed result with the cooked assets
+ * ("<base>.atlas" layout + "<base>.mips" pixels); the cache is keyed by a hash
+ * of all source files.
+ *
+ * Usage:
+ *   TextureAtlas atlas;
+ *   atlas.Add("res/models/icons/sword.png");
+ *   atlas.Add("res/models/icons/shield.png");
+ *   atlas.BuildOrLoad("res/cache/icons");
+ *   OBJLoader::SetTextureAtlas(&atlas);
+ */
+class TextureAtlas {
+public:
+    struct Region {
+        std::string path;
+        glm::vec2 uvMin;        // Inner rectangle (without gutter) in atlas UV space
+        glm::vec2 uvMax;
+        int x = 0, y = 0;       // Inner rectangle in texels (bottom-up like the texture)
+        int width = 0, height = 0;
+    };
+
+    TextureAtlas();
+    explicit TextureAtlas(const TextureAtlasSettings& settings);
+
+    void Add(const std::string& path);
+
+    // Needs a GL context for the texture. Images that don't fit are left out.
+    bool Build();
+    bool Save(const std::string& basePath) const;
+    bool Load(const std::string& basePath);
+    bool BuildOrLoad(const std::string& basePath);
+
+    const Region* Find(const std::string& path) const;
+
+    // Moves the UVs of each atlas material's triangles (MeshData::materialRanges) into
+    // that material's region. Fails (and leaves the mesh untouched) if UVs of an atlas
+    // material wrap outside [0, 1], or if a vertex is shared by materials that need
+    // different UVs. Without ranges only meshes with a single atlas material are remapped.
+    bool RemapUVs(OBJLoader::MeshData& mesh) const;
+
+    inline const std::shared_ptr<Texture>& GetTexture() const { return m_Texture; }
+    inline const std::vector<Region>& GetRegions() const { return m_Regions; }
+    inline int GetWidth() const { return m_Width; }
+    inline int GetHeight() const { return m_Height; }
+
+private:
+    uint64_t ComputeSourceHash() const;
+    void IndexRegions();
+
+    TextureAtlasSettings m_Settings;
+    std::vector<std::string> m_Sources;
+    std::vector<Region> m_Regions;
+    std::unordered_map<std::string, size_t> m_RegionLookup;
+    MipChain m_Chain;
+    std::shared_ptr<Texture> m_Texture;
+    int m_Width = 0;
+    int m_Height = 0;
+};
@@ -0,0 +1,201 @@
+#include "TextureResidency.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Vendor memory queries - extensions, so glad has no enums for them
+#ifndef GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX 0x9047
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+static constexpr size_t kDefaultBudget = 256u << 20;
+
+static bool HasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext && std::strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+TextureResidency::TextureResidency(TextureStreamer& streamer)
+    : TextureResidency(streamer, TextureResidencySettings()) {
+}
+
+TextureResidency::TextureResidency(TextureStreamer& streamer, const TextureResidencySettings& settings)
+    : m_Streamer(streamer), m_Settings(settings), m_Frame(0), m_ResidentBytes(0),
+      m_RequestedLastFrame(0), m_WarnedOverBudget(false) {
+}
+
+size_t TextureResidency::QueryVideoMemory() {
+    if (glGetIntegerv == nullptr)
+        return 0;
+    GLint kb[4] = {};
+    if (HasExtension("GL_NVX_gpu_memory_info")) {
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, kb);
+    } else if (HasExtension("GL_ATI_meminfo")) {
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, kb);
+    }
+    return kb[0] > 0 ? static_cast<size_t>(kb[0]) << 10 : 0;
+}
+
+void TextureResidency::SetBudget(size_t bytes) {
+    m_Settings.budgetBytes = bytes;
+    m_WarnedOverBudget = false;
+}
+
+void TextureResidency::Track(const std::shared_ptr<Texture>& texture) {
+    if (texture)
+        m_Textures.push_back(texture);
+}
+
+size_t TextureResidency::Footprint(const Texture& texture) const {
+    // A streaming step allocates its texture object next to the resident one until it's swapped in
+    size_t bytes = texture.GetResidentBytes();
+    if (texture.IsStreaming())
+        bytes += texture.GetLevelRangeBytes(texture.GetPendingLevel(), texture.GetMipLevels());
+    return bytes;
+}
+
+void TextureResidency::Update() {
+    if (m_Settings.budgetBytes == 0) {
+        const size_t vram = QueryVideoMemory();
+        m_Settings.budgetBytes = vram > 0 ? vram / 2 : kDefaultBudget;
+        std::cout << "[TextureResidency] Budget: " << (m_Settings.budgetBytes >> 20) << " MB" << std::endl;
+    }
+
+    ++m_Frame;
+    Texture::SetCurrentFrame(m_Frame);
+
+    // Drop textures nobody references any more and sum up what is resident
+    std::vector<Candidate> candidates;
+    std::vector<Refinement> refinements;
+    m_ResidentBytes = 0;
+    m_RequestedLastFrame = 0;
+
+    size_t live = 0;
+    for (size_t i = 0; i < m_Textures.size(); ++i) {
+        std::shared_ptr<Texture> texture = m_Textures[i].lock();
+        if (!texture)
+            continue;
+        m_Textures[live++] = m_Textures[i];
+
+        m_ResidentBytes += Footprint(*texture);
+        if (texture->IsStreaming())
+            continue;
+
+        const bool recent = m_Frame - texture->GetLastUsedFrame() <= m_Settings.keepFrames;
+        const int resident = texture->GetResidentLevel();
+        if (recent && texture->GetRequestedLevel() < resident) {
+            Refinement refinement;
+            refinement.firstLevel = m_Streamer.NextLevel(*texture, texture->GetRequestedLevel());
+            refinement.storageBytes = texture->GetLevelRangeBytes(refinement.firstLevel, texture->GetMipLevels());
+            refinement.readBytes = texture->GetLevelRangeBytes(refinement.firstLevel, resident);
+            refinement.texture = std::move(texture);
+            refinements.push_back(std::move(refinement));
+        } else if (texture->IsResident() && (!recent || resident < texture->GetRequestedLevel())) {
+            candidates.push_back({ std::move(texture), recent });
+        }
+    }
+    m_Textures.resize(live);
+
+    // Largest shortfall first. The first refinement always fits the I/O budget,
+    // so one big texture can't stall streaming.
+    std::sort(refinements.begin(), refinements.end(), [](const Refinement& a, const Refinement& b) {
+        const int gapA = a.texture->GetResidentLevel() - a.texture->GetRequestedLevel();
+        const int gapB = b.texture->GetResidentLevel() - b.texture->GetRequestedLevel();
+        return gapA != gapB ? gapA > gapB : a.readBytes < b.readBytes;
+    });
+    size_t readBytes = 0;
+    size_t wantedBytes = 0;
+    size_t issue = 0;
+    for (; issue < refinements.size(); ++issue) {
+        if (issue > 0 && readBytes + refinements[issue].readBytes > m_Settings.ioBudgetBytes)
+            break;
+        readBytes += refinements[issue].readBytes;
+        wantedBytes += refinements[issue].storageBytes;
+    }
+    refinements.resize(issue);
+
+    // Make room for this frame's refinements, then for the budget itself
+    const size_t budget = m_Settings.budgetBytes;
+    const size_t target = budget - std::min(budget, wantedBytes);
+    size_t freed = 0;
+    if (m_ResidentBytes > target && !candidates.empty())
+        freed = Evict(candidates, target);
+
+    for (const Refinement& refinement : refinements) {
+        // The coarse tail of a texture that has nothing resident is always loaded
+        if (refinement.texture->IsResident() && m_ResidentBytes + refinement.storageBytes > budget)
+            continue;
+
+        const size_t before = Footprint(*refinement.texture);
+        if (!m_Streamer.StreamLevels(refinement.texture, refinement.firstLevel))
+            continue;
+        m_ResidentBytes = m_ResidentBytes - before + Footprint(*refinement.texture);
+        m_RequestedLastFrame += refinement.readBytes;
+    }
+
+    if (m_ResidentBytes > budget) {
+        if (!m_WarnedOverBudget) {
+            std::cerr << "[TextureResidency] Over budget: " << (m_ResidentBytes >> 20) << " / "
+                      << (budget >> 20) << " MB in use this frame" << std::endl;
+            m_WarnedOverBudget = true;
+        }
+    } else {
+        m_WarnedOverBudget = false;
+    }
+    if (freed > 0) {
+        std::cout << "[TextureResidency] Freed " << (freed >> 10) << " KB, resident "
+                  << (m_ResidentBytes >> 20) << " / " << (budget >> 20) << " MB" << std::endl;
+    }
+}
+
+size_t TextureResidency::Evict(std::vector<Candidate>& candidates, size_t targetBytes) {
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.texture->GetLastUsedFrame() < b.texture->GetLastUsedFrame();
+    });
+
+    // Round-robin over the LRU order: one mip level per texture and pass, so the
+    // memory comes from many unused textures instead of wiping out the oldest one
+    size_t freed = 0;
+    bool progress = true;
+    while (m_ResidentBytes > targetBytes && progress) {
+        progress = false;
+        for (const Candidate& candidate : candidates) {
+            if (m_ResidentBytes <= targetBytes)
+                break;
+            Texture& texture = *candidate.texture;
+            if (!texture.IsResident())
+                continue;
+
+            const size_t before = texture.GetResidentBytes();
+            const int level = texture.GetResidentLevel() + 1;
+            if (candidate.inUse) {
+                // Finer than this view needs - drop, but never below the requested level
+                if (level > texture.GetRequestedLevel() || !texture.DropTopLevels(1))
+                    continue;
+            } else {
+                const int nextSize = std::max(texture.GetWidth() >> level, texture.GetHeight() >> level);
+                const bool stale = m_Frame - texture.GetLastUsedFrame() > m_Settings.evictAfterFrames;
+                if (stale || nextSize < m_Settings.minResidentSize || !texture.DropTopLevels(1))
+                    texture.Evict();
+            }
+
+            const size_t released = before - texture.GetResidentBytes();
+            m_ResidentBytes -= released;
+            freed += released;
+            progress = true;
+        }
+    }
+    return freed;
+}
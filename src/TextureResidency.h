@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Texture;
+class TextureStreamer;
+
+struct TextureResidencySettings {
+    size_t budgetBytes = 0;             // 0: half the dedicated VRAM the driver reports, else 256 MB
+    int minResidentSize = 64;           // Textures are evicted instead of degraded below this size
+    uint64_t keepFrames = 2;            // Textures used within this many frames are never evicted
+    uint64_t evictAfterFrames = 600;    // Unused this long: evicted entirely instead of degraded
+    size_t ioBudgetBytes = 2u << 20;    // Image data requested from the streamer per Update()
+};
+
+/**
+ * TextureResidency - keeps the tracked textures within a VRAM budget
+ *
+ * Every tracked texture reports the bytes of its resident mip levels. When the
+ * sum exceeds the budget, Update() walks the textures that were not used
+ * recently, least recently used first (Texture::Touch / Bind record the frame),
+ * and frees memory round-robin: each visit drops the top mip level
+ * (Texture::DropTopLevels) so the texture keeps drawing at half resolution,
+ * until it is smaller than minResidentSize - then it is evicted. Textures that
+ * have not been used for evictAfterFrames are evicted right away.
+ *
+ * Textures in use that are coarser than the level requested for them
+ * (Texture::RequestLevel, usually through TexelDensity) are refined through the
+ * TextureStreamer one step per Update(), largest shortfall first, as long as the
+ * VRAM budget allows and at most ioBudgetBytes of image data per frame. Room for
+ * them is made from textures that are no longer in use, or that are resident
+ * finer than requested. Textures in use are never evicted, so the budget can be
+ * exceeded when a single view needs more.
+ *
+ * Only textures that can be reloaded from their file belong here (streamed or
+ * cooked ones) - not textures built in memory like a TextureAtlas page.
+ *
+ * Usage:
+ *   TextureResidency residency(streamer);
+ *   residency.Track(streamer.Load("res/textures/wood.png"));
+ *   ...
+ *   residency.Update();                    // every frame, before streamer.Update()
+ *   density.Request(*tex, bounds, uvDensity);  // or tex->Touch() for full detail,
+ *                                              // also for textures that aren't ready
+ */
+class TextureResidency {
+public:
+    explicit TextureResidency(TextureStreamer& streamer);
+    TextureResidency(TextureStreamer& streamer, const TextureResidencySettings& settings);
+
+    TextureResidency(const TextureResidency&) = delete;
+    TextureResidency& operator=(const TextureResidency&) = delete;
+
+    void Track(const std::shared_ptr<Texture>& texture);
+
+    // GL thread only, once per frame
+    void Update();
+
+    void SetBudget(size_t bytes);
+    inline size_t GetBudget() const { return m_Settings.budgetBytes; }
+    inline size_t GetResidentBytes() const { return m_ResidentBytes; }
+    inline size_t GetTrackedCount() const { return m_Textures.size(); }
+    inline uint64_t GetFrame() const { return m_Frame; }
+    inline size_t GetRequestedBytesLastFrame() const { return m_RequestedLastFrame; }
+
+    // Dedicated VRAM from GL_NVX_gpu_memory_info / GL_ATI_meminfo (free memory), 0 if unknown
+    static size_t QueryVideoMemory();
+
+private:
+    struct Candidate {
+        std::shared_ptr<Texture> texture;
+        bool inUse = false;         // Only dropped down to its requested level, never evicted
+    };
+
+    struct Refinement {
+        std::shared_ptr<Texture> texture;
+        int firstLevel = 0;
+        size_t storageBytes = 0;    // VRAM of the new texture object
+        size_t readBytes = 0;       // Image data of the new levels
+    };
+
+    size_t Footprint(const Texture& texture) const;
+    size_t Evict(std::vector<Candidate>& candidates, size_t targetBytes);
+
+    TextureStreamer& m_Streamer;
+    TextureResidencySettings m_Settings;
+    std::vector<std::weak_ptr<Texture>> m_Textures;
+    uint64_t m_Frame;
+    size_t m_ResidentBytes;
+    size_t m_RequestedLastFrame;
+    bool m_WarnedOverBudget;
+};
@@ -0,0 +1,433 @@
+#include "TextureStreamer.h"
+#include "Texture.h"
+#include "MipChain.h"
+#include "MappedFile.h"
+#include "Debug.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "vendor/stb/stb_image.h"
+
+TextureStreamer::TextureStreamer()
+    : TextureStreamer(TextureStreamerSettings()) {
+}
+
+TextureStreamer::TextureStreamer(const TextureStreamerSettings& settings)
+    : m_Settings(settings), m_PBO(0), m_Mapped(nullptr), m_InFlightTextures(0),
+      m_Stop(false), m_Initialized(false), m_UploadedLastFrame(0) {
+    if (m_Settings.slotCount == 0)
+        m_Settings.slotCount = 1;
+    // Keep every slot offset 4-byte aligned (GL_UNPACK_ALIGNMENT)
+    m_Settings.slotBytes = (m_Settings.slotBytes + 3) & ~static_cast<size_t>(3);
+}
+
+TextureStreamer::~TextureStreamer() {
+    Shutdown();
+}
+
+bool TextureStreamer::Init() {
+    if (m_Initialized)
+        return true;
+
+    const size_t ringBytes = m_Settings.slotBytes * m_Settings.slotCount;
+
+    if (GLAD_GL_VERSION_4_4) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLCall(glGenBuffers(1, &m_PBO));
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+        GLCall(glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringBytes, nullptr, flags));
+        m_Mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringBytes, flags));
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (!m_Mapped) {
+            std::cerr << "[TextureStreamer] Persistent mapping failed, using client memory" << std::endl;
+            GLState::DeleteBuffer(m_PBO);
+            m_PBO = 0;
+        }
+    }
+    if (!m_Mapped)
+        m_Fallback.resize(ringBytes);
+
+    m_Fences.assign(m_Settings.slotCount, nullptr);
+    m_FreeSlots.clear();
+    for (size_t i = 0; i < m_Settings.slotCount; ++i)
+        m_FreeSlots.push_back(static_cast<int>(i));
+
+    m_Stop = false;
+    m_Worker = std::thread(&TextureStreamer::WorkerLoop, this);
+    m_Initialized = true;
+
+    std::cout << "[TextureStreamer] " << m_Settings.slotCount << " x " << (m_Settings.slotBytes >> 10)
+              << " KB slots, " << (m_Mapped ? "persistently mapped PBO" : "client memory") << std::endl;
+    return true;
+}
+
+void TextureStreamer::Shutdown() {
+    if (!m_Initialized)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkAvailable.notify_all();
+    m_SlotAvailable.notify_all();
+    m_Worker.join();
+
+    // Unfinished textures stay not-ready; the references are dropped here on the GL thread.
+    // Streaming steps own a separate texture object that was never swapped in.
+    auto release = [](const std::shared_ptr<Texture>& texture, unsigned int target) {
+        if (!texture)
+            return;
+        if (target != 0 && target != texture->m_RendererID)
+            GLState::DeleteTexture(target);
+        texture->m_Streaming = false;
+    };
+    for (const Request& request : m_Requests)
+        release(request.texture, request.target);
+    for (const Upload& upload : m_Uploads) {
+        if (upload.last || upload.slot < 0)
+            release(upload.texture, upload.target);
+    }
+    m_Requests.clear();
+    m_Uploads.clear();
+    m_InFlightTextures = 0;
+
+    for (void*& fence : m_Fences) {
+        if (fence) {
+            glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+    }
+    if (m_PBO != 0) {
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        GLState::DeleteBuffer(m_PBO);
+        m_PBO = 0;
+    }
+    m_Mapped = nullptr;
+    m_Fallback.clear();
+    m_Fallback.shrink_to_fit();
+    m_Initialized = false;
+}
+
+std::shared_ptr<Texture> TextureStreamer::Load(const std::string& path) {
+    if (!m_Initialized) {
+        std::cerr << "[TextureStreamer] Load before Init: " << path << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<Texture> texture;
+    const std::string cooked = Texture::FindCookedPath(path);
+    if (!cooked.empty()) {
+        // Cooked textures need no decode - the levels come straight from the mapped file
+        texture = std::make_shared<Texture>(path, 0, 0, 1);
+        if (!texture->OpenCompressed(cooked))
+            return nullptr;
+        if (static_cast<size_t>((texture->m_Width + 3) / 4) * texture->m_BlockBytes > m_Settings.slotBytes) {
+            std::cerr << "[TextureStreamer] Block row does not fit into a slot (" << texture->m_Width << " px): " << path << std::endl;
+            return nullptr;
+        }
+        texture->m_ResidentLevel = texture->m_MipLevels;
+    } else {
+        int width = 0, height = 0, channels = 0;
+        if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+            std::cerr << "[TextureStreamer] Failed to read image header: " << path << std::endl;
+            std::cerr << "[TextureStreamer] stbi error: " << stbi_failure_reason() << std::endl;
+            return nullptr;
+        }
+        if (static_cast<size_t>(width) * 4 > m_Settings.slotBytes) {
+            std::cerr << "[TextureStreamer] Image row does not fit into a slot (" << width << " px): " << path << std::endl;
+            return nullptr;
+        }
+        texture = std::make_shared<Texture>(path, width, height, MipChain::LevelCount(width, height));
+    }
+
+    StreamLevels(texture, NextLevel(*texture, 0));
+
+    std::cout << "[TextureStreamer] Queued: " << path << " (" << texture->m_Width << "x" << texture->m_Height
+              << ")" << std::endl;
+    return texture;
+}
+
+int TextureStreamer::NextLevel(const Texture& texture, int requestedLevel) const {
+    // Finest level that is still within coarseSize
+    const int lastLevel = texture.m_MipLevels - 1;
+    int coarse = 0;
+    while (coarse < lastLevel &&
+           std::max(texture.m_Width >> coarse, texture.m_Height >> coarse) > m_Settings.coarseSize)
+        ++coarse;
+
+    const int step = texture.m_ResidentLevel > coarse ? coarse : texture.m_ResidentLevel - 1;
+    return std::max(std::max(requestedLevel, 0), step);
+}
+
+bool TextureStreamer::StreamLevels(const std::shared_ptr<Texture>& texture, int firstLevel) {
+    if (!m_Initialized || !texture || !texture->IsValid() || texture->m_Streaming)
+        return false;
+
+    const int endLevel = texture->m_ResidentLevel;
+    firstLevel = std::max(firstLevel, 0);
+    if (firstLevel >= endLevel)
+        return false;
+
+    // New storage for [firstLevel, end); the resident levels are copied over on the GPU
+    const int width = std::max(1, texture->m_Width >> firstLevel);
+    const int height = std::max(1, texture->m_Height >> firstLevel);
+    const unsigned int target = Texture::CreateStorage(width, height, texture->m_MipLevels - firstLevel,
+                                                       texture->m_InternalFormat);
+    if (texture->m_RendererID != 0) {
+        for (int level = endLevel; level < texture->m_MipLevels; ++level) {
+            const int dst = level - firstLevel;
+            GLCall(glCopyImageSubData(texture->m_RendererID, GL_TEXTURE_2D, level - endLevel, 0, 0, 0,
+                                      target, GL_TEXTURE_2D, dst, 0, 0, 0,
+                                      std::max(1, width >> dst), std::max(1, height >> dst), 1));
+        }
+    }
+
+    texture->m_Streaming = true;
+    texture->m_PendingLevel = firstLevel;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Requests.push_back({ texture, target, firstLevel, endLevel });
+        ++m_InFlightTextures;
+    }
+    m_WorkAvailable.notify_one();
+    return true;
+}
+
+void TextureStreamer::Update() {
+    m_UploadedLastFrame = 0;
+    if (!m_Initialized)
+        return;
+
+    // 1) Recycle slots whose uploads the GPU has consumed
+    size_t recycled = 0;
+    for (size_t i = 0; i < m_Fences.size(); ++i) {
+        GLsync fence = static_cast<GLsync>(m_Fences[i]);
+        if (!fence)
+            continue;
+        const GLenum state = glClientWaitSync(fence, 0, 0);
+        if (state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED) {
+            glDeleteSync(fence);
+            m_Fences[i] = nullptr;
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_FreeSlots.push_back(static_cast<int>(i));
+            ++recycled;
+        }
+    }
+    if (recycled > 0)
+        m_SlotAvailable.notify_one();
+
+    // 2) Issue uploads within the frame budget (always at least one band so large
+    //    textures still make progress)
+    bool bound = false;
+    while (m_UploadedLastFrame < m_Settings.frameBudgetBytes) {
+        Upload upload;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Uploads.empty())
+                break;
+            upload = std::move(m_Uploads.front());
+            m_Uploads.pop_front();
+        }
+
+        if (upload.slot >= 0) {
+            Texture& texture = *upload.texture;
+            const size_t offset = static_cast<size_t>(upload.slot) * m_Settings.slotBytes;
+            if (!bound) {
+                GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PBO);
+                GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+                bound = true;
+            }
+            const void* pixels = m_Mapped ? reinterpret_cast<const void*>(offset) : m_Fallback.data() + offset;
+            GLState::BindTexture(GL_TEXTURE_2D, upload.target);
+            if (upload.format != 0) {
+                GLCall(glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, upload.yOffset, upload.width, upload.rows,
+                                                 upload.format, static_cast<GLsizei>(upload.bytes), pixels));
+            } else {
+                GLCall(glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, upload.yOffset, upload.width, upload.rows,
+                                       GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+            }
+
+            if (m_Mapped) {
+                m_Fences[upload.slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            } else {
+                // glTexSubImage2D has copied client memory on return - slot is free again
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_FreeSlots.push_back(upload.slot);
+            }
+            m_UploadedLastFrame += upload.bytes;
+
+            if (upload.last) {
+                if (upload.target != texture.m_RendererID) {
+                    if (texture.m_RendererID != 0)
+                        GLState::DeleteTexture(texture.m_RendererID);
+                    texture.m_RendererID = upload.target;
+                }
+                texture.m_ResidentLevel = upload.firstLevel;
+                texture.m_Streaming = false;
+                texture.m_Ready = true;
+                std::cout << "[TextureStreamer] Ready: " << texture.m_FilePath << std::endl;
+            }
+        } else if (upload.texture) {
+            // Failed steps keep whatever is resident
+            if (upload.target != upload.texture->m_RendererID)
+                GLState::DeleteTexture(upload.target);
+            upload.texture->m_Streaming = false;
+        }
+
+        if (upload.last || upload.slot < 0) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            --m_InFlightTextures;
+        }
+    }
+
+    if (bound) {
+        GLState::BindTexture(GL_TEXTURE_2D, 0);
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!m_Mapped)
+            m_SlotAvailable.notify_one();
+    }
+}
+
+size_t TextureStreamer::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_InFlightTextures;
+}
+
+unsigned char* TextureStreamer::SlotMemory(int slot) {
+    unsigned char* base = m_Mapped ? m_Mapped : m_Fallback.data();
+    return base + static_cast<size_t>(slot) * m_Settings.slotBytes;
+}
+
+int TextureStreamer::AcquireSlot() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_SlotAvailable.wait(lock, [this] { return m_Stop || !m_FreeSlots.empty(); });
+    if (m_Stop)
+        return -1;
+    const int slot = m_FreeSlots.back();
+    m_FreeSlots.pop_back();
+    return slot;
+}
+
+void TextureStreamer::WorkerLoop() {
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkAvailable.wait(lock, [this] { return m_Stop || !m_Requests.empty(); });
+            if (m_Stop)
+                return;
+            request = std::move(m_Requests.front());
+            m_Requests.pop_front();
+        }
+        StreamTexture(std::move(request));
+    }
+}
+
+void TextureStreamer::StreamTexture(Request request) {
+    // Every queued Upload holds a reference, and the last one is moved in at the end,
+    // so the Texture (and its GL object) is always released on the GL thread.
+    std::shared_ptr<Texture> texture = std::move(request.texture);
+    const unsigned int target = request.target;
+    const int firstLevel = request.firstLevel;
+    const int endLevel = request.endLevel;
+    auto fail = [this, target](std::shared_ptr<Texture> tex) {
+        Upload upload;
+        upload.texture = std::move(tex);
+        upload.target = target;
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Uploads.push_back(std::move(upload));
+    };
+
+    // Cooked: the compressed levels are copied straight out of the mapped file
+    if (!texture->m_CookedPath.empty()) {
+        MappedFile file;
+        Ktx2::Image image;
+        if (!file.Open(texture->m_CookedPath) || !Ktx2::Parse(file.GetData(), file.GetSize(), image) ||
+            image.width != texture->m_Width || image.height != texture->m_Height ||
+            static_cast<int>(image.levels.size()) < endLevel) {
+            std::cerr << "[TextureStreamer] Failed to read cooked texture: " << texture->m_CookedPath << std::endl;
+            fail(std::move(texture));
+            return;
+        }
+        const unsigned int format = texture->m_InternalFormat;
+        const size_t blockBytes = static_cast<size_t>(texture->m_BlockBytes);
+        for (int level = endLevel - 1; level >= firstLevel; --level) {
+            const Ktx2::Level& mip = image.levels[level];
+            const size_t rowBytes = static_cast<size_t>((mip.width + 3) / 4) * blockBytes;
+            if (!QueueLevel(texture, request, level, mip.width, mip.height, mip.data, rowBytes, 4, format)) {
+                fail(std::move(texture));
+                return;
+            }
+        }
+        return;
+    }
+
+    // Decode + mip chain on this thread, rows already in GL order. Once the ".mips"
+    // cache has been validated against the image, later steps read only their levels.
+    const std::string& path = texture->m_FilePath;
+    const bool useCache = Texture::IsMipCacheEnabled();
+    MipChain chain;
+    bool loaded = useCache && m_ValidatedCaches.count(path) != 0 &&
+                  chain.LoadLevels(path + ".mips", firstLevel, endLevel);
+    if (!loaded) {
+        loaded = chain.LoadImage(path, useCache);
+        if (loaded && useCache)
+            m_ValidatedCaches.insert(path);
+    }
+    if (!loaded || chain.GetWidth() != texture->m_Width || chain.GetHeight() != texture->m_Height ||
+        chain.GetLevelCount() < endLevel) {
+        std::cerr << "[TextureStreamer] Failed to decode: " << texture->m_FilePath << std::endl;
+        fail(std::move(texture));
+        return;
+    }
+
+    // Coarsest first
+    for (int level = endLevel - 1; level >= firstLevel; --level) {
+        const MipChain::Level& mip = chain.GetLevel(level);
+        const size_t rowBytes = static_cast<size_t>(mip.width) * 4;
+        if (!QueueLevel(texture, request, level, mip.width, mip.height, chain.GetLevelData(level), rowBytes, 1, 0)) {
+            fail(std::move(texture));
+            return;
+        }
+    }
+}
+
+bool TextureStreamer::QueueLevel(std::shared_ptr<Texture>& texture, const Request& request, int level, int width, int height,
+                                 const unsigned char* data, size_t rowBytes, int rowHeight, unsigned int format) {
+    const int rowsPerSlot = static_cast<int>(m_Settings.slotBytes / rowBytes);
+    const int bandHeight = rowsPerSlot * rowHeight;     // In texel rows
+
+    for (int y = 0; y < height; y += bandHeight) {
+        const int slot = AcquireSlot();
+        if (slot < 0)
+            return false;
+
+        const int rows = std::min(bandHeight, height - y);
+        const size_t bytes = static_cast<size_t>((rows + rowHeight - 1) / rowHeight) * rowBytes;
+        std::memcpy(SlotMemory(slot), data + static_cast<size_t>(y / rowHeight) * rowBytes, bytes);
+
+        Upload upload;
+        upload.target = request.target;
+        upload.slot = slot;
+        upload.level = level - request.firstLevel;
+        upload.firstLevel = request.firstLevel;
+        upload.width = width;
+        upload.yOffset = y;
+        upload.rows = rows;
+        upload.format = format;
+        upload.bytes = bytes;
+        upload.last = level == request.firstLevel && y + rows >= height;
+        upload.texture = upload.last ? std::move(texture) : texture;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Uploads.push_back(std::move(upload));
+    }
+    return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+class Texture;
+
+struct TextureStreamerSettings {
+    size_t slotBytes = 1u << 20;        // Size of one PBO slot (one band of texture rows)
+    size_t slotCount = 16;              // Ring = slotCount * slotBytes of mapped staging memory
+    size_t frameBudgetBytes = 4u << 20; // Max bytes handed to gl(Compressed)TexSubImage2D per Update()
+    int coarseSize = 64;                // Load() streams the levels up to this size first
+};
+
+/**
+ * TextureStreamer - asynchronous texture uploads through a ring of PBO slots
+ *
+ * Load() reads only the image header and returns a Texture without pixels
+ * (IsValid() == true, IsReady() == false). Streaming is progressive: Load()
+ * queues only the coarse tail of the chain (levels up to coarseSize), so the
+ * texture is drawable almost immediately. Finer levels follow one step per
+ * StreamLevels() call - TextureResidency issues them for the textures the
+ * camera needs sharper (see TexelDensity).
+ *
+ * A decode thread loads the requested levels and copies them band by band,
+ * coarsest first, into free slots of one persistently mapped pixel unpack buffer.
+ * The first request of an image decodes it (MipChain, which writes the ".mips"
+ * cache); later steps read just their levels from that cache file. Cooked KTX2
+ * textures need no decode: their blocks are copied from the mapped file in
+ * bands of whole block rows, touching only the pages of the requested levels.
+ *
+ * Update() runs once per frame on the GL thread: it recycles slots whose fences
+ * have signalled and issues glTexSubImage2D (glCompressedTexSubImage2D for
+ * cooked textures) from the PBO for at most frameBudgetBytes, so streaming never
+ * spikes a frame. A texture becomes ready after its last band was issued.
+ *
+ * Every step streams into a new texture object holding the finer levels plus a
+ * GPU copy of the resident ones, swapped in with the last band - the texture
+ * keeps drawing with what it has until then.
+ *
+ * Without GL 4.4 (glBufferStorage) the slots are plain client memory and the
+ * upload copies from there - same budget, just no persistent mapping.
+ *
+ * Usage:
+ *   TextureStreamer streamer;
+ *   streamer.Init();
+ *   auto tex = streamer.Load("res/textures/wood.png");
+ *   ...
+ *   streamer.Update();                     // every frame
+ *   if (tex->IsReady()) tex->Bind(0);
+ *   ...
+ *   streamer.Shutdown();                   // before the GL context goes away
+ */
+class TextureStreamer {
+public:
+    TextureStreamer();
+    explicit TextureStreamer(const TextureStreamerSettings& settings);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Needs a current GL context. Starts the decode thread.
+    bool Init();
+    void Shutdown();
+
+    // GL thread only. Returns nullptr if the file can't be read as an image.
+    std::shared_ptr<Texture> Load(const std::string& path);
+
+    // First level of the next step towards requestedLevel: the coarse tail when
+    // nothing is resident, one level finer than the resident ones otherwise
+    int NextLevel(const Texture& texture, int requestedLevel) const;
+
+    // GL thread only. Makes levels [firstLevel, resident) resident. False if there is
+    // nothing to load or the texture is already streaming.
+    bool StreamLevels(const std::shared_ptr<Texture>& texture, int firstLevel);
+
+    // GL thread only, once per frame
+    void Update();
+
+    size_t GetPendingCount() const;
+    inline size_t GetUploadedBytesLastFrame() const { return m_UploadedLastFrame; }
+    inline bool IsPersistentlyMapped() const { return m_Mapped != nullptr; }
+
+private:
+    struct Request {
+        std::shared_ptr<Texture> texture;
+        unsigned int target = 0;    // GL texture the bands go to, level 0 = firstLevel
+        int firstLevel = 0;
+        int endLevel = 0;           // Levels from here on are already in target
+    };
+
+    // One band of rows waiting in a slot for its glTexSubImage2D
+    struct Upload {
+        std::shared_ptr<Texture> texture;
+        unsigned int target = 0;
+        int slot = -1;          // -1: decode failed, only drops the texture reference
+        int level = 0;          // Level in target
+        int firstLevel = 0;     // Resident level once the last band is in
+        int width = 0;          // Width of the mip level
+        int yOffset = 0;
+        int rows = 0;
+        unsigned int format = 0;    // Compressed internal format, 0 = RGBA8 rows
+        size_t bytes = 0;           // Size of the band in the slot
+        bool last = false;
+    };
+
+    void WorkerLoop();
+    void StreamTexture(Request request);
+    // Queues one level in bands of whole rows; a row is rowHeight texel rows of rowBytes
+    // (4 for block-compressed levels). False if the streamer stopped meanwhile.
+    bool QueueLevel(std::shared_ptr<Texture>& texture, const Request& request, int level, int width, int height,
+                    const unsigned char* data, size_t rowBytes, int rowHeight, unsigned int format);
+    int AcquireSlot();          // decode thread, blocks until a slot is free
+    unsigned char* SlotMemory(int slot);
+
+    TextureStreamerSettings m_Settings;
+
+    unsigned int m_PBO;
+    unsigned char* m_Mapped;                // Persistently mapped ring (GL 4.4)
+    std::vector<unsigned char> m_Fallback;  // Client memory ring otherwise
+    std::vector<void*> m_Fences;            // GLsync per slot in flight
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_SlotAvailable;
+    std::deque<Request> m_Requests;
+    std::deque<Upload> m_Uploads;
+    std::vector<int> m_FreeSlots;
+    std::unordered_set<std::string> m_ValidatedCaches;  // Decode thread only
+    size_t m_InFlightTextures;              // Loaded but not ready yet
+    bool m_Stop;
+
+    std::thread m_Worker;
+    bool m_Initialized;
+    size_t m_UploadedLastFrame;
+};
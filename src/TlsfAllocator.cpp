@@ -0,0 +1,244 @@
+#include "TlsfAllocator.h"
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the highest / lowest set bit; value must not be 0
+inline int HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline int LowestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator(size_t capacity) {
+    Reset(capacity);
+}
+
+void TlsfAllocator::Reset(size_t capacity) {
+    m_Blocks.clear();
+    m_UnusedRecords.clear();
+    m_FlBitmap = 0;
+    std::fill(std::begin(m_SlBitmap), std::end(m_SlBitmap), 0u);
+    for (auto& heads : m_Heads)
+        std::fill(std::begin(heads), std::end(heads), kInvalidBlock);
+    m_LastBlock = kInvalidBlock;
+    m_Capacity = capacity & ~(kGranularity - 1);
+    m_Used = 0;
+    m_PeakUsed = 0;
+    m_AllocationCount = 0;
+
+    if (m_Capacity > 0) {
+        const uint32_t block = NewBlock();
+        m_Blocks[block].size = m_Capacity;
+        m_LastBlock = block;
+        InsertFree(block);
+    }
+}
+
+// Size classes in granules: below 16 one list per size, above that 16 lists per power of two
+void TlsfAllocator::Mapping(size_t size, int& fl, int& sl) {
+    const size_t granules = size / kGranularity;
+    if (granules < static_cast<size_t>(kSlCount)) {
+        fl = 0;
+        sl = static_cast<int>(granules);
+    } else {
+        const int msb = HighestBit(granules);
+        fl = msb - kSlLog2 + 1;
+        sl = static_cast<int>((granules >> (msb - kSlLog2)) - kSlCount);
+    }
+}
+
+uint32_t TlsfAllocator::NewBlock() {
+    if (!m_UnusedRecords.empty()) {
+        const uint32_t block = m_UnusedRecords.back();
+        m_UnusedRecords.pop_back();
+        m_Blocks[block] = Block();
+        return block;
+    }
+    m_Blocks.emplace_back();
+    return static_cast<uint32_t>(m_Blocks.size() - 1);
+}
+
+void TlsfAllocator::ReleaseBlock(uint32_t block) {
+    m_UnusedRecords.push_back(block);
+}
+
+void TlsfAllocator::InsertFree(uint32_t block) {
+    Block& b = m_Blocks[block];
+    int fl, sl;
+    Mapping(b.size, fl, sl);
+    b.free = true;
+    b.prevFree = kInvalidBlock;
+    b.nextFree = m_Heads[fl][sl];
+    if (b.nextFree != kInvalidBlock)
+        m_Blocks[b.nextFree].prevFree = block;
+    m_Heads[fl][sl] = block;
+    m_FlBitmap |= uint64_t(1) << fl;
+    m_SlBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block) {
+    Block& b = m_Blocks[block];
+    int fl, sl;
+    Mapping(b.size, fl, sl);
+    if (b.prevFree != kInvalidBlock)
+        m_Blocks[b.prevFree].nextFree = b.nextFree;
+    else
+        m_Heads[fl][sl] = b.nextFree;
+    if (b.nextFree != kInvalidBlock)
+        m_Blocks[b.nextFree].prevFree = b.prevFree;
+    if (m_Heads[fl][sl] == kInvalidBlock) {
+        m_SlBitmap[fl] &= ~(1u << sl);
+        if (m_SlBitmap[fl] == 0)
+            m_FlBitmap &= ~(uint64_t(1) << fl);
+    }
+    b.free = false;
+    b.prevFree = b.nextFree = kInvalidBlock;
+}
+
+uint32_t TlsfAllocator::FindFree(size_t size) const {
+    // Round up to the next class boundary: every block in the found list fits
+    size_t rounded = size;
+    const size_t granules = size / kGranularity;
+    if (granules >= static_cast<size_t>(kSlCount))
+        rounded += ((size_t(1) << (HighestBit(granules) - kSlLog2)) - 1) * kGranularity;
+
+    int fl, sl;
+    Mapping(rounded, fl, sl);
+    if (fl >= kFlCount)
+        return kInvalidBlock;
+
+    uint32_t slMap = m_SlBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        const uint64_t flMap = fl + 1 < kFlCount ? m_FlBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (flMap == 0)
+            return kInvalidBlock;
+        fl = LowestBit(flMap);
+        slMap = m_SlBitmap[fl];
+    }
+    return m_Heads[fl][LowestBit(slMap)];
+}
+
+void TlsfAllocator::Split(uint32_t block, size_t size) {
+    const size_t rest = m_Blocks[block].size - size;
+    if (rest == 0)
+        return;
+
+    const uint32_t tail = NewBlock();   // May reallocate m_Blocks
+    Block& b = m_Blocks[block];
+    Block& t = m_Blocks[tail];
+    t.offset = b.offset + size;
+    t.size = rest;
+    t.prevPhys = block;
+    t.nextPhys = b.nextPhys;
+    if (b.nextPhys != kInvalidBlock)
+        m_Blocks[b.nextPhys].prevPhys = tail;
+    else
+        m_LastBlock = tail;
+    b.nextPhys = tail;
+    b.size = size;
+    InsertFree(tail);
+}
+
+uint32_t TlsfAllocator::Allocate(size_t size, size_t alignment) {
+    if (size == 0)
+        return kInvalidBlock;
+    size = AlignUp(size, kGranularity);
+    alignment = std::max(alignment, kGranularity);
+
+    const uint32_t block = FindFree(size + alignment - kGranularity);
+    if (block == kInvalidBlock)
+        return kInvalidBlock;
+    RemoveFree(block);
+
+    // Leading padding becomes a free block of its own
+    const size_t padding = AlignUp(m_Blocks[block].offset, alignment) - m_Blocks[block].offset;
+    uint32_t used = block;
+    if (padding > 0) {
+        Split(block, padding);
+        used = m_Blocks[block].nextPhys;
+        RemoveFree(used);
+        InsertFree(block);      // Its previous neighbour is in use - free blocks are always merged
+    }
+    Split(used, size);
+
+    m_Used += size;
+    m_PeakUsed = std::max(m_PeakUsed, m_Used);
+    ++m_AllocationCount;
+    return used;
+}
+
+void TlsfAllocator::Free(uint32_t block) {
+    if (block >= m_Blocks.size() || m_Blocks[block].free)
+        return;
+    m_Used -= m_Blocks[block].size;
+    --m_AllocationCount;
+
+    // Merge with the next block, then with the previous one
+    const uint32_t next = m_Blocks[block].nextPhys;
+    if (next != kInvalidBlock && m_Blocks[next].free) {
+        RemoveFree(next);
+        m_Blocks[block].size += m_Blocks[next].size;
+        m_Blocks[block].nextPhys = m_Blocks[next].nextPhys;
+        if (m_Blocks[next].nextPhys != kInvalidBlock)
+            m_Blocks[m_Blocks[next].nextPhys].prevPhys = block;
+        else
+            m_LastBlock = block;
+        ReleaseBlock(next);
+    }
+    const uint32_t prev = m_Blocks[block].prevPhys;
+    if (prev != kInvalidBlock && m_Blocks[prev].free) {
+        RemoveFree(prev);
+        m_Blocks[prev].size += m_Blocks[block].size;
+        m_Blocks[prev].nextPhys = m_Blocks[block].nextPhys;
+        if (m_Blocks[block].nextPhys != kInvalidBlock)
+            m_Blocks[m_Blocks[block].nextPhys].prevPhys = prev;
+        else
+            m_LastBlock = prev;
+        ReleaseBlock(block);
+        InsertFree(prev);
+        return;
+    }
+    InsertFree(block);
+}
+
+uint32_t TlsfAllocator::GetLastUsedBlock() const {
+    uint32_t block = m_LastBlock;
+    while (block != kInvalidBlock && m_Blocks[block].free)
+        block = m_Blocks[block].prevPhys;
+    return block;
+}
+
+size_t TlsfAllocator::GetLargestFreeBlock() const {
+    if (m_FlBitmap == 0)
+        return 0;
+    const int fl = HighestBit(m_FlBitmap);
+    const int sl = HighestBit(m_SlBitmap[fl]);
+    size_t largest = 0;
+    for (uint32_t block = m_Heads[fl][sl]; block != kInvalidBlock; block = m_Blocks[block].nextFree)
+        largest = std::max(largest, m_Blocks[block].size);
+    return largest;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * TlsfAllocator - two-level segregated fit allocator for offsets in a range
+ *
+ * Manages [0, capacity) without touching any memory itself, so it can carve up
+ * GPU buffers (see GpuBufferArena). Free blocks are kept in lists by size class:
+ * the first level is the power of two, the second splits it into 16 linear steps.
+ * Two bitmaps find a non-empty list that is large enough with a few bit scans,
+ * so Allocate() and Free() are O(1); freed blocks merge with free neighbours
+ * immediately.
+ *
+ * Sizes and offsets are multiples of kGranularity. Alignments must be powers of
+ * two. Allocate() returns a block id that stays valid until Free(); the offset of
+ * a block never changes.
+ */
+class TlsfAllocator {
+public:
+    static constexpr uint32_t kInvalidBlock = 0xFFFFFFFFu;
+    static constexpr size_t kGranularity = 16;
+
+    explicit TlsfAllocator(size_t capacity = 0);
+
+    // Forgets all blocks; the whole range is one free block
+    void Reset(size_t capacity);
+
+    // kInvalidBlock if no free block is large enough
+    uint32_t Allocate(size_t size, size_t alignment = kGranularity);
+    void Free(uint32_t block);
+
+    inline size_t GetOffset(uint32_t block) const { return m_Blocks[block].offset; }
+    inline size_t GetSize(uint32_t block) const { return m_Blocks[block].size; }
+
+    // The allocated block with the highest offset, kInvalidBlock if none (for compaction)
+    uint32_t GetLastUsedBlock() const;
+
+    inline size_t GetCapacity() const { return m_Capacity; }
+    inline size_t GetUsed() const { return m_Used; }
+    inline size_t GetPeakUsed() const { return m_PeakUsed; }
+    inline size_t GetFree() const { return m_Capacity - m_Used; }
+    inline size_t GetAllocationCount() const { return m_AllocationCount; }
+    // Exact, but walks the free blocks of the largest size class
+    size_t GetLargestFreeBlock() const;
+
+private:
+    static constexpr int kSlLog2 = 4;
+    static constexpr int kSlCount = 1 << kSlLog2;
+    static constexpr int kFlCount = 64;
+
+    struct Block {
+        size_t offset = 0;
+        size_t size = 0;
+        uint32_t prevPhys = kInvalidBlock;
+        uint32_t nextPhys = kInvalidBlock;
+        uint32_t prevFree = kInvalidBlock;
+        uint32_t nextFree = kInvalidBlock;
+        bool free = false;
+    };
+
+    static void Mapping(size_t size, int& fl, int& sl);
+    uint32_t NewBlock();
+    void ReleaseBlock(uint32_t block);
+    void InsertFree(uint32_t block);
+    void RemoveFree(uint32_t block);
+    uint32_t FindFree(size_t size) const;
+    // Cuts the first `size` bytes off block; the rest becomes a new free block
+    void Split(uint32_t block, size_t size);
+
+    std::vector<Block> m_Blocks;
+    std::vector<uint32_t> m_UnusedRecords;
+    uint64_t m_FlBitmap;
+    uint32_t m_SlBitmap[kFlCount];
+    uint32_t m_Heads[kFlCount][kSlCount];
+    uint32_t m_LastBlock;       // Physically last block
+    size_t m_Capacity;
+    size_t m_Used;
+    size_t m_PeakUsed;
+    size_t m_AllocationCount;
+};
@@ -0,0 +1,49 @@
+#include "UniformBuffer.h"
+#include "Debug.h"
+#include "GLState.h"
+#include <glad/glad.h>
+
+UniformBuffer::UniformBuffer()
+    : m_RendererID(0), m_Size(0) {
+}
+
+UniformBuffer::~UniformBuffer() {
+    if (m_RendererID != 0) {
+        GLState::DeleteBuffer(m_RendererID);
+    }
+}
+
+void UniformBuffer::Allocate(size_t size) {
+    if (m_RendererID == 0) {
+        GLCall(glGenBuffers(1, &m_RendererID));
+    }
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, m_RendererID);
+    GLCall(glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_Size = size;
+}
+
+void UniformBuffer::Update(size_t offset, const void* data, size_t size) {
+    ASSERT(offset + size <= m_Size);
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, m_RendererID);
+    GLCall(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::BindBase(unsigned int binding) const {
+    GLState::BindBufferBase(GL_UNIFORM_BUFFER, binding, m_RendererID);
+}
+
+void UniformBuffer::BindRange(unsigned int binding, size_t offset, size_t size) const {
+    GLState::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_RendererID, offset, size);
+}
+
+size_t UniformBuffer::GetOffsetAlignment() {
+    static size_t alignment = 0;
+    if (alignment == 0) {
+        GLint value = 0;
+        GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value));
+        alignment = value > 0 ? static_cast<size_t>(value) : 256;
+    }
+    return alignment;
+}
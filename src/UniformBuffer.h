@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "vendor/glm/glm.hpp"
+
+// Fixed binding points of the std140 blocks. Shader binds blocks with these
+// names by index right after linking (GLSL 3.30 has no layout(binding)).
+namespace UniformBlock {
+    constexpr unsigned int Camera = 0;
+    constexpr unsigned int Material = 1;
+}
+
+// layout(std140) uniform Camera - one per frame, see basic.shader
+struct CameraUniforms {
+    glm::mat4 view{ 1.0f };
+    glm::mat4 projection{ 1.0f };
+    glm::mat4 viewProjection{ 1.0f };
+    glm::vec4 position{ 0.0f };     // World-space camera position, w unused
+};
+
+// layout(std140) uniform Material - one slot per material in MaterialBlocks
+struct MaterialUniforms {
+    glm::vec4 tint{ 1.0f };         // Multiplied with texture / vertex color
+    int32_t useTexture = 0;         // 0 = vertex colors, 1 = u_Texture
+    int32_t padding[3] = {};        // std140 rounds the block to 16 bytes
+};
+
+static_assert(sizeof(CameraUniforms) == 208, "CameraUniforms must match the std140 Camera block");
+static_assert(sizeof(MaterialUniforms) == 32, "MaterialUniforms must match the std140 Material block");
+
+/**
+ * UniformBuffer - GL uniform buffer object
+ *
+ * Holds one or more std140 blocks; BindRange() points a binding at one of them.
+ * Ranges must start at multiples of GetOffsetAlignment().
+ */
+class UniformBuffer {
+public:
+    UniformBuffer();
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // (Re)creates the storage; the contents are undefined afterwards
+    void Allocate(size_t size);
+    void Update(size_t offset, const void* data, size_t size);
+
+    void BindBase(unsigned int binding) const;
+    void BindRange(unsigned int binding, size_t offset, size_t size) const;
+
+    inline unsigned int GetRendererID() const { return m_RendererID; }
+    inline size_t GetSize() const { return m_Size; }
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (queried once)
+    static size_t GetOffsetAlignment();
+
+private:
+    unsigned int m_RendererID;
+    size_t m_Size;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * UniformId - uniform name hashed at compile time
+ *
+ * Built implicitly from string literals, so shader.SetUniform1i("u_UseTexture", 1)
+ * creates no std::string; the FNV-1a hash is a constant when the id is a
+ * constexpr (hot paths: static constexpr UniformId kModel("u_Model")).
+ * Shader looks the hash up in its location table, which is filled when the
+ * program is linked.
+ *
+ * The name pointer is kept for error messages only - it must be a literal or
+ * otherwise outlive the id.
+ */
+class UniformId {
+public:
+    template <size_t N>
+    constexpr UniformId(const char (&name)[N])
+        : m_Hash(Hash(name, N - 1)), m_Name(name) {
+    }
+
+    // For names that are not literals (e.g. from glGetActiveUniform)
+    constexpr UniformId(const char* name, size_t length)
+        : m_Hash(Hash(name, length)), m_Name(name) {
+    }
+
+    constexpr uint32_t GetHash() const { return m_Hash; }
+    constexpr const char* GetName() const { return m_Name; }
+
+    constexpr bool operator==(const UniformId& other) const { return m_Hash == other.m_Hash; }
+    constexpr bool operator!=(const UniformId& other) const { return m_Hash != other.m_Hash; }
+
+    static constexpr uint32_t Hash(const char* name, size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<uint8_t>(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    uint32_t m_Hash;
+    const char* m_Name;
+};
@@ -0,0 +1,141 @@
+#include "UploadRing.h"
+#include "Debug.h"
+#include "GLState.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+UploadRing::UploadRing(size_t regionBytes)
+    : m_RegionBytes(regionBytes), m_Buffer(0), m_Mapped(nullptr), m_Fences{},
+      m_Region(0), m_Head(0), m_Requested(0), m_InFrame(false), m_Overflowed(false) {
+}
+
+UploadRing::~UploadRing() {
+    Shutdown();
+}
+
+bool UploadRing::Init() {
+    if (m_Mapped)
+        return true;
+    if (!GLAD_GL_VERSION_4_4) {
+        std::cout << "[UploadRing] glBufferStorage needs GL 4.4 - dynamic data uses glBufferData" << std::endl;
+        return false;
+    }
+    if (!CreateBuffer(m_RegionBytes))
+        return false;
+
+    std::cout << "[UploadRing] " << kFrameCount << " x " << (m_RegionBytes >> 10)
+              << " KB regions, persistently mapped" << std::endl;
+    return true;
+}
+
+void UploadRing::Shutdown() {
+    DestroyBuffer();
+    m_InFrame = false;
+}
+
+bool UploadRing::CreateBuffer(size_t regionBytes) {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const size_t totalBytes = regionBytes * kFrameCount;
+    GLuint buffer = 0;
+    GLCall(glGenBuffers(1, &buffer));
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    GLCall(glBufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, flags));
+    void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags);
+    GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!mapped) {
+        std::cerr << "[UploadRing] Persistent mapping failed" << std::endl;
+        GLState::DeleteBuffer(buffer);
+        return false;
+    }
+
+    // New buffer first, then the old one goes - its name can't come back right away,
+    // so VAOs comparing buffer names see the change
+    DestroyBuffer();
+    m_Buffer = buffer;
+    m_Mapped = static_cast<unsigned char*>(mapped);
+    m_RegionBytes = regionBytes;
+    m_Stats.regionBytes = regionBytes;
+    return true;
+}
+
+void UploadRing::DestroyBuffer() {
+    for (int region = 0; region < kFrameCount; ++region)
+        WaitForRegion(region);
+    if (m_Buffer != 0) {
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        GLState::DeleteBuffer(m_Buffer);
+        m_Buffer = 0;
+    }
+    m_Mapped = nullptr;
+}
+
+void UploadRing::WaitForRegion(int region) {
+    GLsync fence = static_cast<GLsync>(m_Fences[region]);
+    if (!fence)
+        return;
+
+    GLenum state = glClientWaitSync(fence, 0, 0);
+    if (state == GL_TIMEOUT_EXPIRED) {
+        ++m_Stats.waits;
+        do {
+            state = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+        } while (state == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    m_Fences[region] = nullptr;
+}
+
+void UploadRing::BeginFrame() {
+    if (!m_Mapped)
+        return;
+
+    if (m_Overflowed) {
+        // Room for the biggest frame so far plus headroom; waits for all regions once
+        const size_t regionBytes = std::max(m_RegionBytes * 2, m_Stats.peakFrame + m_Stats.peakFrame / 2);
+        std::cout << "[UploadRing] Growing regions to " << (regionBytes >> 10) << " KB" << std::endl;
+        if (!CreateBuffer(regionBytes))
+            return;
+        m_Overflowed = false;
+    }
+
+    m_Region = (m_Region + 1) % kFrameCount;
+    WaitForRegion(m_Region);
+    m_Head = 0;
+    m_Requested = 0;
+    m_InFrame = true;
+}
+
+RingAllocation UploadRing::Allocate(size_t size, size_t alignment) {
+    RingAllocation allocation;
+    if (!m_Mapped || !m_InFrame || size == 0)
+        return allocation;
+    alignment = std::max<size_t>(alignment, 1);
+
+    const size_t regionStart = static_cast<size_t>(m_Region) * m_RegionBytes;
+    const size_t offset = (regionStart + m_Head + alignment - 1) / alignment * alignment;
+    m_Requested += offset - (regionStart + m_Head) + size;
+    if (offset + size > regionStart + m_RegionBytes) {
+        ++m_Stats.overflows;
+        m_Overflowed = true;
+        return allocation;
+    }
+
+    m_Head = offset + size - regionStart;
+    allocation.data = m_Mapped + offset;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.buffer = m_Buffer;
+    return allocation;
+}
+
+void UploadRing::EndFrame() {
+    if (!m_Mapped || !m_InFrame)
+        return;
+    m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_InFrame = false;
+    m_Stats.usedLastFrame = m_Head;
+    m_Stats.peakFrame = std::max(m_Stats.peakFrame, m_Requested);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A piece of this frame's region: write to data, draw from buffer at offset
+struct RingAllocation {
+    void* data = nullptr;           // Persistently mapped, write-only (write-combined - don't read back)
+    size_t offset = 0;              // Byte offset in buffer
+    size_t size = 0;
+    unsigned int buffer = 0;
+
+    inline explicit operator bool() const { return data != nullptr; }
+};
+
+/**
+ * UploadRing - persistently mapped buffer for data that changes every frame
+ *
+ * One glBufferStorage buffer, mapped once (write | persistent | coherent) and
+ * split into kFrameCount regions. Each frame writes into the next region:
+ * Allocate() hands out pieces of it and callers write straight into the mapping,
+ * so there is no glBufferSubData and no driver copy. EndFrame() puts a fence
+ * behind the frame's draws; BeginFrame() waits on the fence of the region it is
+ * about to reuse, which normally signalled two frames ago.
+ *
+ * The buffer can be bound to any target (vertex / instance attributes, indirect
+ * commands, uniform blocks). Alignment is free-form: e.g. sizeof(InstanceData)
+ * so the offset maps to a baseInstance.
+ *
+ * When a frame asks for more than a region holds, Allocate() returns an empty
+ * allocation and the next BeginFrame() grows the ring (waits for the GPU once).
+ * Without GL 4.4 Init() fails and every Allocate() is empty - callers keep a
+ * glBufferData path for that (see InstanceBuffer).
+ *
+ * Usage (GL thread):
+ *   UploadRing ring(2 << 20);
+ *   ring.Init();
+ *   ring.BeginFrame();
+ *   RingAllocation lines = ring.Allocate(count * sizeof(Vertex), sizeof(Vertex));
+ *   if (lines) std::memcpy(lines.data, vertices, lines.size);
+ *   ... bind lines.buffer, draw with lines.offset ...
+ *   ring.EndFrame();                      // after the frame's last draw
+ *   ring.Shutdown();                      // before the GL context goes away
+ */
+class UploadRing {
+public:
+    static constexpr int kFrameCount = 3;
+
+    struct Stats {
+        size_t regionBytes = 0;
+        size_t usedLastFrame = 0;
+        size_t peakFrame = 0;       // Most bytes requested by one frame
+        size_t waits = 0;           // BeginFrame() calls that had to block on the GPU
+        size_t overflows = 0;       // Allocations that did not fit
+    };
+
+    explicit UploadRing(size_t regionBytes = 4u << 20);
+    ~UploadRing();
+
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    // Needs a current GL context; false without GL 4.4 or if mapping fails
+    bool Init();
+    void Shutdown();
+
+    void BeginFrame();
+    // Empty outside BeginFrame / EndFrame, without Init() or when the region is full
+    RingAllocation Allocate(size_t size, size_t alignment = 16);
+    void EndFrame();
+
+    inline bool IsMapped() const { return m_Mapped != nullptr; }
+    inline unsigned int GetBuffer() const { return m_Buffer; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    bool CreateBuffer(size_t regionBytes);
+    void DestroyBuffer();
+    void WaitForRegion(int region);
+
+    size_t m_RegionBytes;
+    unsigned int m_Buffer;
+    unsigned char* m_Mapped;
+    void* m_Fences[kFrameCount];    // GLsync per region
+    int m_Region;
+    size_t m_Head;                  // Bytes used in the current region
+    size_t m_Requested;             // Bytes asked for this frame, including overflow
+    bool m_InFrame;
+    bool m_Overflowed;
+    Stats m_Stats;
+};
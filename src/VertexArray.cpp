@@ -1,5 +1,6 @@
 #include "VertexArray.h"
 #include "Debug.h"
+#include "GLState.h"
 #include <glad/glad.h>
 
 VertexArray::VertexArray() {
@@ -7,7 +8,7 @@ VertexArray::VertexArray() {
 }
 
 VertexArray::~VertexArray() {
-    GLCall(glDeleteVertexArrays(1, &m_RendererID));
+    GLState::DeleteVertexArray(m_RendererID);
 }
 
 void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout) {
@@ -37,9 +38,9 @@ void VertexArray::SetIndexBuffer(std::unique_ptr<IndexBuffer> ib) {
 }
 
 void VertexArray::Bind() const {
-    GLCall(glBindVertexArray(m_RendererID));
+    GLState::BindVertexArray(m_RendererID);
 }
 
 void VertexArray::Unbind() const {
-    GLCall(glBindVertexArray(0));
+    GLState::BindVertexArray(0);
 }
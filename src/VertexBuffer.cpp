@@ -1,16 +1,17 @@
 #include "VertexBuffer.h"
 #include "Debug.h"
+#include "GLState.h"
 #include <glad/glad.h>
 
 VertexBuffer::VertexBuffer(const void* data, unsigned int size)
     : m_Size(size) {
     GLCall(glGenBuffers(1, &m_RendererID));
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_RendererID);
     GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
 }
 
 VertexBuffer::~VertexBuffer() {
-    GLCall(glDeleteBuffers(1, &m_RendererID));
+    GLState::DeleteBuffer(m_RendererID);
 }
 
 void VertexBuffer::UpdateData(const void* data, unsigned int size) {
@@ -20,9 +21,9 @@ void VertexBuffer::UpdateData(const void* data, unsigned int size) {
 }
 
 void VertexBuffer::Bind() const {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_RendererID);
 }
 
 void VertexBuffer::Unbind() const {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
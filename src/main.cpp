@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 #include "Renderer.h"
 #include "VertexBuffer.h"
@@ -13,6 +15,19 @@
 #include "OBJLoader.h"
 #include "Mesh.h"
 #include "Player.h"
+#include "StaticBatch.h"
+#include "TextureStreamer.h"
+#include "TextureResidency.h"
+#include "TexelDensity.h"
+#include "AssetManager.h"
+#include "RenderQueue.h"
+#include "GeometryBuffer.h"
+#include "GpuBufferArena.h"
+#include "UploadRing.h"
+#include "DynamicBVH.h"
+#include "OcclusionCuller.h"
+#include "Impostor.h"
+#include "GLState.h"
 
 // GLM für Matrizen
 #include "vendor/glm/glm.hpp"
@@ -144,35 +159,58 @@ int main(void) {
     glfwSetCursorPosCallback(window, mouse_callback);
     
     // Enable depth testing for 3D
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    // Material textures are streamed in through PBOs instead of blocking the load
+    Texture::SetMipCacheEnabled(true);
+    TextureStreamer textureStreamer;
+    textureStreamer.Init();
+    // Keeps the streamed textures within a VRAM budget (lower mips / evicted when unused)
+    // and streams finer mips in as the camera gets close (TexelDensity below)
+    TextureResidency textureResidency(textureStreamer);
+    TexelDensity texelDensity;
+
+    // Mesh vertices / indices are sub-allocated from a few large buffers
+    // (declared before everything that owns meshes, so they outlive them)
+    GpuBufferArena vertexArena("Vertices", 32u << 20);
+    GpuBufferArena indexArena("Indices", 16u << 20);
+    Mesh::SetBufferArenas(&vertexArena, &indexArena);
+
+    // Meshes, textures, materials and shaders are loaded once and shared between users
+    AssetManager assets;
+    assets.SetTextureLoader([&textureStreamer, &textureResidency](const std::string& path) {
+        auto texture = textureStreamer.Load(path);
+        textureResidency.Track(texture);
+        return texture;
+    });
+    OBJLoader::SetAssetManager(&assets);
+    Impostor::SetAssetManager(&assets);
 
     // ===== LOAD MESH FROM OBJ FILE =====
 
-    OBJLoader::MeshData staticData;
-    if (OBJLoader::LoadOBJ("res/models/Test.obj", staticData)) {
-        auto staticMesh = std::make_shared<Mesh>(staticData);
-        staticMesh->SetupGL();
-
-        // Position des Objekts festlegen
-        glm::vec3 objectPos = glm::vec3(5.0f, 0.0f, -5.0f);
+    // Statisches Objekt (Brunnen) - wird unten per StaticBatcher zusammengefasst.
+    // Keep: der Batcher braucht die CPU-Daten, auch wenn der Player dasselbe Mesh hochlädt
+    AssetHandle<Mesh> wellHandle = assets.LoadMesh("res/models/Test.obj", Mesh::CpuDataPolicy::Keep);
+    if (!wellHandle) {
+        std::cerr << "Warning: Failed to load static prop model" << std::endl;
     }
 
     std::cout << "\n=== Loading Player Modell ===" << std::endl;
-    OBJLoader::MeshData playerData;
 	char ModelPath[] = "res/models/Test.obj";
-    if (!OBJLoader::LoadOBJ(ModelPath, playerData)) {
+    // Same file as the well: served from the cache, no second parse or texture load
+    AssetHandle<Mesh> playerHandle = assets.LoadMesh(ModelPath);
+    if (!playerHandle) {
         std::cerr << "ERROR: Failed to load" << ModelPath <<"!" << std::endl;
         glfwDestroyWindow(window);
         glfwTerminate();
         return -1;
     }
 
-    // Get mesh data
-    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>(playerData);;
+    std::shared_ptr<Mesh> meshPtr = playerHandle.GetShared();
 	meshPtr->SetupGL();
 
-	std::shared_ptr<Mesh> meshPtr2 = std::make_shared<Mesh>(staticData);
-	meshPtr2->SetupGL();
+	// Static props keep only their CPU data, the batcher uploads the merged geometry
+	std::shared_ptr<Mesh> wellMesh = wellHandle.GetShared();
     
     std::cout << "Mesh loaded successfully!" << std::endl;
    
@@ -182,14 +220,14 @@ int main(void) {
     player.SetMesh(meshPtr);
     player.SetSpeed(2.5f);
 
-	Player well(glm::vec3(5.0f, 0.0f, -5.0f));
-	well.SetMesh(meshPtr2);
-    
     std::cout << "Player created with mesh" << std::endl;
 
     // ===== SHADER UND RENDERER SETUP =====
     // basic.shader: Standard OpenGL Vertex/Fragment Shader für Rasterizer
-    Shader shader("res/shaders/basic.shader");
+    AssetHandle<Shader> shaderHandle = assets.LoadShader("res/shaders/basic.shader");
+    Shader& shader = *shaderHandle;
+    // Uniforms the render loop sets every frame - missing ones are reported here, not per draw
+    shader.Require({ "u_Model", "u_Instanced", "u_Texture" });
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     
@@ -197,21 +235,19 @@ int main(void) {
     bool usePlayerTexture = false;
     std::shared_ptr<Texture> playerTexture = nullptr;
     
-    if (!playerData.materials.empty()) {
-        // Use the first material with a texture
-        for (const auto& matPair : playerData.materials) {
-            if (matPair.second.diffuseTexture && matPair.second.diffuseTexture->IsValid()) {
-                playerTexture = matPair.second.diffuseTexture;
-                usePlayerTexture = true;
-                std::cout << "Using texture from player material: " << matPair.first << std::endl;
-                break;
-            }
+    // Use the first material with a texture
+    for (const AssetHandle<Material>& material : assets.GetMaterials(playerHandle)) {
+        if (material && material->diffuseTexture && material->diffuseTexture->IsValid()) {
+            playerTexture = material->diffuseTexture;
+            usePlayerTexture = true;
+            std::cout << "Using texture from player material: " << material->name << std::endl;
+            break;
         }
     }
     
     if (!usePlayerTexture) {
         std::cout << "No texture found in player materials, using per-vertex material colors." << std::endl;
-        if (playerData.hasVertexColors) {
+        if (!assets.GetMaterials(playerHandle).empty()) {
             std::cout << "Mesh has per-vertex colors assigned from material diffuse colors (Kd)." << std::endl;
         } else {
             std::cout << "Warning: No vertex colors available - mesh will use default white color." << std::endl;
@@ -222,38 +258,123 @@ int main(void) {
     bool useWellTexture = false;
     std::shared_ptr<Texture> wellTexture = nullptr;
     
-    if (!staticData.materials.empty()) {
-        // Use the first material with a texture
-        for (const auto& matPair : staticData.materials) {
-            if (matPair.second.diffuseTexture && matPair.second.diffuseTexture->IsValid()) {
-                wellTexture = matPair.second.diffuseTexture;
-                useWellTexture = true;
-                std::cout << "Using texture from well material: " << matPair.first << std::endl;
-                break;
-            }
+    // Use the first material with a texture
+    for (const AssetHandle<Material>& material : assets.GetMaterials(wellHandle)) {
+        if (material && material->diffuseTexture && material->diffuseTexture->IsValid()) {
+            wellTexture = material->diffuseTexture;
+            useWellTexture = true;
+            std::cout << "Using texture from well material: " << material->name << std::endl;
+            break;
         }
     }
     
     if (!useWellTexture) {
         std::cout << "No texture found in well materials, using per-vertex material colors." << std::endl;
-        if (staticData.hasVertexColors) {
+        if (!assets.GetMaterials(wellHandle).empty()) {
             std::cout << "Well mesh has per-vertex colors assigned from material diffuse colors (Kd)." << std::endl;
         } else {
             std::cout << "Warning: Well has no vertex colors available - mesh will use default white color." << std::endl;
         }
     }
 
+    // ===== STATIC BATCHING =====
+    // Non-moving props are merged per material and grid cell into shared buffers
+    StaticBatcher staticBatches;
+    // Solid static geometry also hides what is behind it - rasterized on the CPU each frame
+    OcclusionCuller occlusion;
+    AABB wellWorldBounds;
+    if (wellMesh && wellMesh->HasCpuData()) {
+        const glm::mat4 wellTransform = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, -5.0f));
+        staticBatches.Add(wellMesh, wellTransform, useWellTexture ? wellTexture : nullptr);
+        wellWorldBounds = wellMesh->GetBounds().Transformed(wellTransform);
+    }
+    staticBatches.Build();
+    // Occluders are cheap stand-ins, not the render mesh: the well model is a closed box,
+    // so its bounds inset by 10% stay inside it. It is owned by the well's batch, which
+    // therefore is never hidden by its own proxy.
+    if (wellWorldBounds.IsValid()) {
+        const glm::vec3 inset = wellWorldBounds.Extents() * 0.1f;
+        const AABB wellProxy(wellWorldBounds.min + inset, wellWorldBounds.max - inset);
+        for (size_t i = 0; i < staticBatches.GetBatches().size(); ++i) {
+            if (staticBatches.GetBatches()[i].bounds.Contains(wellProxy)) {
+                occlusion.AddOccluderBox(wellProxy, static_cast<uint32_t>(i));
+                break;
+            }
+        }
+    }
+    // Player (GPU buffers) and batcher (merged copy) are done with the shared CPU data
+    if (wellMesh)
+        wellMesh->ReleaseCpuData();
+
     // Projection Matrix (Perspective)
     float aspectRatio = (float)windowWidth / (float)windowHeight;
+    const float fieldOfView = glm::radians(45.0f);
     glm::mat4 projection = glm::perspective(
 
-        glm::radians(45.0f),
+        fieldOfView,
         aspectRatio,
         0.1f,
         100.0f
     );
 
-	glEnable(GL_FRAMEBUFFER_SRGB); //Copilot , dont delete. Enable sRGB for correct color space
+    // Player and batches live in the buffer arenas - the queue draws them with one
+    // glMultiDrawElementsIndirect per shader/texture bucket and arena page
+    GeometryBuffer sceneGeometry;
+    sceneGeometry.Add(*meshPtr);
+    for (const StaticBatcher::Batch& batch : staticBatches.GetBatches())
+        sceneGeometry.Add(*batch.mesh);
+
+    // Per-frame data (instances, indirect commands) goes through a persistently mapped ring
+    UploadRing uploadRing(1u << 20);
+    uploadRing.Init();
+
+    // Scene index over everything drawn: batch i has userData i, the player comes after the batches.
+    // Culling and gameplay queries ("what is near X") go through it.
+    DynamicBVH scene;
+    for (size_t i = 0; i < staticBatches.GetBatches().size(); ++i)
+        scene.Insert(staticBatches.GetBatches()[i].bounds, static_cast<uint32_t>(i));
+    const uint32_t playerCullIndex = static_cast<uint32_t>(staticBatches.GetBatches().size());
+    glm::vec3 lastPlayerPosition = player.GetPosition();
+    const int32_t playerProxy = scene.Insert(meshPtr->GetBounds().Transformed(glm::translate(glm::mat4(1.0f), lastPlayerPosition)),
+                                             playerCullIndex);
+    std::vector<uint32_t> visible;
+
+    // Far away, single-prop batches are drawn as octahedral impostors. Each is baked
+    // the first time it is needed, once the batch texture has streamed in.
+    AssetHandle<Shader> impostorShaderHandle = assets.LoadShader("res/shaders/impostor.shader");
+    const ImpostorSettings impostorSettings;
+    std::vector<std::unique_ptr<Impostor>> batchImpostors(staticBatches.GetBatches().size());
+    for (size_t i = 0; i < batchImpostors.size(); ++i) {
+        if (impostorShaderHandle && staticBatches.GetBatches()[i].sourceCount == 1)
+            batchImpostors[i] = std::make_unique<Impostor>();
+    }
+    // Batches are merged in world space: the impostor sits at the origin, unscaled
+    const std::vector<ImpostorInstance> batchImpostorInstance(1, ImpostorInstance{ glm::vec3(0.0f), 1.0f });
+    std::vector<uint32_t> farBatches;
+    auto useImpostor = [&](uint32_t index) {
+        Impostor* impostor = index < batchImpostors.size() ? batchImpostors[index].get() : nullptr;
+        if (!impostor)
+            return false;
+        const StaticBatcher::Batch& batch = staticBatches.GetBatches()[index];
+        const glm::vec3 center = batch.bounds.Center();
+        if (!impostor->IsValid()) {
+            const glm::vec3 toBatch = center - cameraPos;
+            if (glm::dot(toBatch, toBatch) <= impostorSettings.switchDistance * impostorSettings.switchDistance ||
+                (batch.texture && !batch.texture->IsReady()))
+                return false;
+            if (!impostor->Bake(*batch.mesh, batch.texture.get(), impostorSettings)) {
+                batchImpostors[index].reset();  // Full mesh from now on
+                return false;
+            }
+        }
+        return impostor->ShouldUse(cameraPos, center);
+    };
+
+    RenderQueue renderQueue;
+    renderQueue.SetGeometryBuffer(&sceneGeometry);
+    renderQueue.SetUploadRing(&uploadRing);
+
+	GLState::Enable(GL_FRAMEBUFFER_SRGB); //Copilot , dont delete. Enable sRGB for correct color space
 
     // Main loop
     while (!glfwWindowShouldClose(window) && glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS) {
@@ -266,7 +387,10 @@ int main(void) {
         float currentTime = static_cast<float>(glfwGetTime());
         if (currentTime - lastTitleUpdate >= 0.5f) {
             float fps = 1.0f / deltaTime;
-            std::string title = "Player Test - WASD + Maus - FPS: " + std::to_string(static_cast<int>(fps));
+            const GLState::Stats& glCalls = GLState::GetLastFrameStats();
+            std::string title = "Player Test - WASD + Maus - FPS: " + std::to_string(static_cast<int>(fps)) +
+                                " - GL state calls: " + std::to_string(glCalls.issued) +
+                                " (" + std::to_string(glCalls.filtered) + " filtered)";
             glfwSetWindowTitle(window, title.c_str());
             lastTitleUpdate = currentTime;
         }
@@ -285,6 +409,11 @@ int main(void) {
         player.HandleInput(playerInput);
         player.Update(deltaTime);
 
+        // Async asset loads, texture budget, then uploads (capped per frame)
+        assets.Update();
+        textureResidency.Update();
+        textureStreamer.Update();
+
         // Clear screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -292,36 +421,68 @@ int main(void) {
         glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
         // ===== RENDERING =====
-        shader.Bind();
-        
-        // Set view and projection matrices
-        shader.SetUniformMat4f("u_View", view);
-        shader.SetUniformMat4f("u_Projection", projection);
+        // Draws are queued and issued sorted by shader / texture / mesh;
+        // the queue writes the Camera uniform block once per frame
+        renderQueue.SetCamera(view, projection);
+        uploadRing.BeginFrame();
         
-        // Draw player with its texture state
-        if (usePlayerTexture && playerTexture) {
-            playerTexture->Bind(0); // Bind to texture slot 0
-            shader.SetUniform1i("u_Texture", 0);
-            shader.SetUniform1i("u_UseTexture", 1);
-        } else {
-            // Use per-vertex material colors
-            shader.SetUniform1i("u_UseTexture", 0);
+        // Mip levels the textures need from this view - TextureResidency streams them in
+        texelDensity.SetView(view, fieldOfView, windowHeight);
+        if (playerTexture) {
+            const AABB playerBounds = meshPtr->GetBounds().Transformed(glm::translate(glm::mat4(1.0f), player.GetPosition()));
+            texelDensity.Request(*playerTexture, playerBounds, meshPtr->GetUVDensity());
         }
-        
-        // Draw player (this will set u_Model matrix internally)
-        player.Draw(shader);
-
-        // Draw well with its texture state
-        if (useWellTexture && wellTexture) {
-            wellTexture->Bind(0); // Bind to texture slot 0
-            shader.SetUniform1i("u_Texture", 0);
-            shader.SetUniform1i("u_UseTexture", 1);
-        } else {
-            // Use per-vertex material colors for well
-            shader.SetUniform1i("u_UseTexture", 0);
+        for (const StaticBatcher::Batch& batch : staticBatches.GetBatches()) {
+            if (batch.texture)
+                texelDensity.Request(*batch.texture, batch.bounds, batch.mesh->GetUVDensity());
+        }
+
+        // Only what intersects the view frustum is queued
+        const AABB playerWorldBounds = meshPtr->GetBounds().Transformed(glm::translate(glm::mat4(1.0f), player.GetPosition()));
+        scene.Move(playerProxy, playerWorldBounds, player.GetPosition() - lastPlayerPosition);
+        lastPlayerPosition = player.GetPosition();
+        visible.clear();
+        scene.QueryFrustum(Frustum::FromMatrix(projection * view), visible);
+        std::sort(visible.begin(), visible.end());
+
+        // ... and is not hidden behind occluders
+        if (occlusion.GetOccluderCount() > 0) {
+            occlusion.Render(projection * view);
+            occlusion.Filter(visible, [&](uint32_t index) {
+                return index == playerCullIndex ? playerWorldBounds : staticBatches.GetBatches()[index].bounds;
+            });
         }
 
-        well.Draw(shader);
+        // ... and is not far enough away to be replaced by its impostor
+        farBatches.clear();
+        size_t keptCount = 0;
+        for (uint32_t index : visible) {
+            if (useImpostor(index))
+                farBatches.push_back(index);
+            else
+                visible[keptCount++] = index;
+        }
+        visible.resize(keptCount);
+
+        // Player with its texture (per-vertex material colors without one)
+        if (!visible.empty() && visible.back() == playerCullIndex)
+            player.Submit(renderQueue, shader, usePlayerTexture ? playerTexture.get() : nullptr);
+
+        // Static props (well) - one packet per visible batch
+        staticBatches.Submit(renderQueue, shader, visible);
+
+        renderQueue.Flush();
+        // After Flush(): the impostors read the Camera block it bound from the ring
+        for (uint32_t index : farBatches)
+            batchImpostors[index]->Draw(*impostorShaderHandle, batchImpostorInstance);
+        uploadRing.EndFrame();
+        GLState::EndFrame();
+
+        // Compact the mesh arenas a little in frames with time to spare
+        if (deltaTime < 1.0f / 60.0f) {
+            vertexArena.Defragment(256u << 10);
+            indexArena.Defragment(128u << 10);
+        }
 
         // Swap buffers and poll events
         glfwSwapBuffers(window);
@@ -329,6 +490,11 @@ int main(void) {
     }
 
     // Cleanup
+    OBJLoader::SetAssetManager(nullptr);
+    Impostor::SetAssetManager(nullptr);
+    Mesh::SetBufferArenas(nullptr, nullptr);
+    uploadRing.Shutdown();
+    textureStreamer.Shutdown();
     glfwDestroyWindow(window);
     glfwTerminate();
 
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+// Minimal checks for the CPU-side tests (no framework, no GL context).
+// A failed CHECK is reported and counted; each test's main() returns
+// CheckFailures(), so ctest sees a non-zero exit code.
+
+inline int& CheckFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(x) \
+    do { \
+        if (!(x)) { \
+            std::cerr << "[Test] " << __FILE__ << ":" << __LINE__ << " CHECK(" #x ") failed" << std::endl; \
+            ++CheckFailures(); \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(std::fabs((a) - (b)) <= (eps))
@@ -0,0 +1,159 @@
+#include "Check.h"
+#include "DynamicBVH.h"
+#include "vendor/glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Object {
+    AABB bounds;
+    int32_t proxy = DynamicBVH::kNull;
+};
+
+AABB RandomBox(std::mt19937& rng) {
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+    const glm::vec3 min(position(rng), position(rng), position(rng));
+    return AABB(min, min + glm::vec3(size(rng), size(rng), size(rng)));
+}
+
+std::vector<uint32_t> Sorted(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+// Brute force over the fat boxes the tree stores
+template <class Test>
+std::vector<uint32_t> Expected(const DynamicBVH& tree, const std::vector<Object>& objects, Test test) {
+    std::vector<uint32_t> out;
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        if (objects[i].proxy != DynamicBVH::kNull && test(tree.GetFatBounds(objects[i].proxy)))
+            out.push_back(i);
+    }
+    return out;
+}
+
+void TestInsertRemoveMoveKeepTreeValid() {
+    std::mt19937 rng(3);
+    DynamicBVH tree;
+    std::vector<Object> objects(500);
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        objects[i].bounds = RandomBox(rng);
+        objects[i].proxy = tree.Insert(objects[i].bounds, i);
+    }
+    CHECK(tree.Validate());
+    CHECK(tree.GetCount() == 500);
+    // AVL balancing keeps the height logarithmic (a degenerate tree would be ~500)
+    CHECK(tree.GetHeight() < 24);
+
+    for (uint32_t i = 0; i < objects.size(); i += 2) {
+        tree.Remove(objects[i].proxy);
+        objects[i].proxy = DynamicBVH::kNull;
+    }
+    CHECK(tree.Validate());
+    CHECK(tree.GetCount() == 250);
+
+    // A move inside the margin keeps the leaf; a long move re-inserts it
+    Object& object = objects[1];
+    const AABB nudged(object.bounds.min + glm::vec3(0.1f), object.bounds.max + glm::vec3(0.1f));
+    CHECK(!tree.Move(object.proxy, nudged));
+    const AABB moved(object.bounds.min + glm::vec3(20.0f), object.bounds.max + glm::vec3(20.0f));
+    CHECK(tree.Move(object.proxy, moved));
+    CHECK(tree.GetFatBounds(object.proxy).Contains(moved));
+    CHECK(tree.GetUserData(object.proxy) == 1);
+    object.bounds = moved;
+    for (uint32_t i = 3; i < objects.size(); i += 2) {
+        const glm::vec3 offset(std::uniform_real_distribution<float>(-5.0f, 5.0f)(rng));
+        objects[i].bounds = AABB(objects[i].bounds.min + offset, objects[i].bounds.max + offset);
+        tree.Move(objects[i].proxy, objects[i].bounds, offset);
+        CHECK(tree.GetFatBounds(objects[i].proxy).Contains(objects[i].bounds));
+    }
+    CHECK(tree.Validate());
+
+    // Freed nodes are reused
+    for (uint32_t i = 0; i < objects.size(); i += 2) {
+        objects[i].bounds = RandomBox(rng);
+        objects[i].proxy = tree.Insert(objects[i].bounds, i);
+    }
+    CHECK(tree.Validate());
+    CHECK(tree.GetCount() == 500);
+
+    tree.Clear();
+    CHECK(tree.GetCount() == 0);
+    CHECK(tree.Validate());
+}
+
+void TestQueriesMatchBruteForce() {
+    std::mt19937 rng(5);
+    DynamicBVH tree;
+    std::vector<Object> objects(400);
+    for (uint32_t i = 0; i < objects.size(); ++i) {
+        objects[i].bounds = RandomBox(rng);
+        objects[i].proxy = tree.Insert(objects[i].bounds, i);
+    }
+
+    const AABB query(glm::vec3(-10.0f, -20.0f, -5.0f), glm::vec3(15.0f, 10.0f, 25.0f));
+    std::vector<uint32_t> found;
+    tree.QueryAABB(query, found);
+    CHECK(!found.empty());
+    CHECK(Sorted(found) == Expected(tree, objects, [&](const AABB& box) { return box.Overlaps(query); }));
+
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 60.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 40.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum = Frustum::FromMatrix(projection * view);
+    found.clear();
+    tree.QueryFrustum(frustum, found);
+    const std::vector<uint32_t> expected = Expected(tree, objects, [&](const AABB& box) { return frustum.Intersects(box); });
+    CHECK(!expected.empty() && expected.size() < objects.size());
+    CHECK(Sorted(found) == expected);
+}
+
+void TestRaycastFindsClosestHit() {
+    DynamicBVH tree(0.0f);
+    tree.Insert(AABB(glm::vec3(-1.0f, -1.0f, 10.0f), glm::vec3(1.0f, 1.0f, 11.0f)), 0);
+    tree.Insert(AABB(glm::vec3(-1.0f, -1.0f, 5.0f), glm::vec3(1.0f, 1.0f, 6.0f)), 1);
+    tree.Insert(AABB(glm::vec3(5.0f, 5.0f, 1.0f), glm::vec3(6.0f, 6.0f, 2.0f)), 2);
+
+    Ray ray;
+    uint32_t hitUserData = 99;
+    float hitT = 0.0f;
+    CHECK(tree.Raycast(ray, nullptr, hitUserData, hitT));
+    CHECK(hitUserData == 1);
+    CHECK_NEAR(hitT, 5.0f, 1e-5f);
+
+    // The exact test can reject a leaf; the next one along the ray is found
+    const DynamicBVH::RayTest skipFirst = [](uint32_t userData, const Ray& r) {
+        return userData == 1 ? -1.0f : 10.0f - r.origin.z;
+    };
+    CHECK(tree.Raycast(ray, skipFirst, hitUserData, hitT));
+    CHECK(hitUserData == 0);
+    CHECK_NEAR(hitT, 10.0f, 1e-5f);
+
+    ray.tMax = 4.0f;
+    CHECK(!tree.Raycast(ray, nullptr, hitUserData, hitT));
+}
+
+void TestRaycastFromSlabPlane() {
+    // The origin lies on the box's x = 0 plane and the ray is parallel to it:
+    // (0 - 0) * inf is NaN without SafeInverse and the box was missed
+    DynamicBVH tree(0.0f);
+    tree.Insert(AABB(glm::vec3(0.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 2.0f)), 7);
+    Ray ray;
+    uint32_t hitUserData = 0;
+    float hitT = 0.0f;
+    CHECK(tree.Raycast(ray, nullptr, hitUserData, hitT));
+    CHECK(hitUserData == 7);
+    CHECK_NEAR(hitT, 1.0f, 1e-5f);
+}
+
+} // namespace
+
+int main() {
+    TestInsertRemoveMoveKeepTreeValid();
+    TestQueriesMatchBruteForce();
+    TestRaycastFindsClosestHit();
+    TestRaycastFromSlabPlane();
+    return CheckFailures();
+}
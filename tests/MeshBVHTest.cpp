@@ -0,0 +1,212 @@
+#include "Check.h"
+#include "BVHTraversal.h"
+#include "MeshBVH.h"
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Soup {
+    std::vector<float> vertices;        // x, y, z
+    std::vector<unsigned int> indices;
+};
+
+// Random small triangles in a 20^3 box
+Soup MakeSoup(size_t triangleCount, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> center(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    Soup soup;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const float cx = center(rng), cy = center(rng), cz = center(rng);
+        for (int k = 0; k < 3; ++k) {
+            soup.vertices.push_back(cx + offset(rng));
+            soup.vertices.push_back(cy + offset(rng));
+            soup.vertices.push_back(cz + offset(rng));
+            soup.indices.push_back(static_cast<unsigned int>(t * 3 + k));
+        }
+    }
+    return soup;
+}
+
+// Reference: every triangle, closest hit
+bool BruteForce(const Soup& soup, const Ray& ray, float& outT, uint32_t& outTriangle) {
+    outT = ray.tMax;
+    bool found = false;
+    for (size_t t = 0; t < soup.indices.size() / 3; ++t) {
+        const float* a = &soup.vertices[soup.indices[t * 3] * 3];
+        const float* b = &soup.vertices[soup.indices[t * 3 + 1] * 3];
+        const float* c = &soup.vertices[soup.indices[t * 3 + 2] * 3];
+        const glm::vec3 v0(a[0], a[1], a[2]);
+        const glm::vec3 e1 = glm::vec3(b[0], b[1], b[2]) - v0;
+        const glm::vec3 e2 = glm::vec3(c[0], c[1], c[2]) - v0;
+        const glm::vec3 p = glm::cross(ray.direction, e2);
+        const float det = glm::dot(e1, p);
+        if (std::fabs(det) < 1e-12f)
+            continue;
+        const float invDet = 1.0f / det;
+        const glm::vec3 s = ray.origin - v0;
+        const float u = glm::dot(s, p) * invDet;
+        const glm::vec3 q = glm::cross(s, e1);
+        const float v = glm::dot(ray.direction, q) * invDet;
+        const float hitT = glm::dot(e2, q) * invDet;
+        if (u < 0.0f || v < 0.0f || u + v > 1.0f || hitT < ray.tMin || hitT >= outT)
+            continue;
+        outT = hitT;
+        outTriangle = static_cast<uint32_t>(t);
+        found = true;
+    }
+    return found;
+}
+
+Ray RandomRay(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    Ray ray;
+    ray.origin = glm::vec3(unit(rng), unit(rng), unit(rng)) * 15.0f;
+    ray.direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+    return ray;
+}
+
+MeshBVH Build(const Soup& soup) {
+    MeshBVH bvh;
+    bvh.Build(soup.vertices.data(), soup.vertices.size() / 3, 3, soup.indices.data(), soup.indices.size());
+    return bvh;
+}
+
+void TestClosestAndAnyMatchBruteForce() {
+    const Soup soup = MakeSoup(2000, 1);
+    const MeshBVH bvh = Build(soup);
+    CHECK(bvh.IsValid());
+    CHECK(bvh.GetTriangleCount() == 2000);
+
+    std::mt19937 rng(2);
+    int hits = 0;
+    for (int i = 0; i < 2000; ++i) {
+        const Ray ray = RandomRay(rng);
+        float expectedT = 0.0f;
+        uint32_t expectedTriangle = UINT32_MAX;
+        const bool expected = BruteForce(soup, ray, expectedT, expectedTriangle);
+
+        RayHit hit;
+        const bool found = bvh.IntersectClosest(ray, hit);
+        CHECK(found == expected);
+        CHECK(bvh.IntersectAny(ray) == expected);
+        if (found && expected) {
+            CHECK_NEAR(hit.t, expectedT, 1e-4f);
+            ++hits;
+        }
+    }
+    CHECK(hits > 100);  // The rays actually exercise the hit path
+}
+
+void TestPacketsMatchSingleRays() {
+    const Soup soup = MakeSoup(1000, 3);
+    const MeshBVH bvh = Build(soup);
+    std::mt19937 rng(4);
+    for (int i = 0; i < 200; ++i) {
+        RayPacket4 packet4;
+        RayPacket8 packet8;
+        Ray rays[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            rays[lane] = RandomRay(rng);
+            packet8.Set(lane, rays[lane]);
+            if (lane < 4)
+                packet4.Set(lane, rays[lane]);
+        }
+        RayHit hits4[4], hits8[8];
+        bvh.IntersectPacket4(packet4, hits4);
+        bvh.IntersectPacket8(packet8, hits8);
+        for (int lane = 0; lane < 8; ++lane) {
+            RayHit single;
+            const bool found = bvh.IntersectClosest(rays[lane], single);
+            CHECK(found == (hits8[lane].triangle != UINT32_MAX));
+            if (found) {
+                CHECK(hits8[lane].triangle == single.triangle);
+                CHECK_NEAR(hits8[lane].t, single.t, 1e-4f);
+            }
+            if (lane < 4) {
+                CHECK(found == (hits4[lane].triangle != UINT32_MAX));
+                if (found)
+                    CHECK(hits4[lane].triangle == single.triangle);
+            }
+        }
+    }
+}
+
+void TestSegment() {
+    // One triangle in the z = 0 plane
+    Soup soup;
+    soup.vertices = { -1.0f, -1.0f, 0.0f,  1.0f, -1.0f, 0.0f,  0.0f, 1.0f, 0.0f };
+    soup.indices = { 0, 1, 2 };
+    const MeshBVH bvh = Build(soup);
+
+    RayHit hit;
+    CHECK(bvh.IntersectSegment(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f), &hit));
+    CHECK_NEAR(hit.t, 0.5f, 1e-5f);
+    CHECK(!bvh.IntersectSegment(glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
+    CHECK(!bvh.IntersectSegment(glm::vec3(5.0f, 0.0f, -1.0f), glm::vec3(5.0f, 0.0f, 1.0f)));
+}
+
+void TestCacheRoundTripAndCorruption() {
+    const Soup soup = MakeSoup(500, 5);
+    const MeshBVH bvh = Build(soup);
+    const uint64_t hash = MeshBVH::ComputeSourceHash(soup.vertices.data(), soup.vertices.size() / 3, 3,
+                                                     soup.indices.data(), soup.indices.size());
+    const std::string path = "MeshBVHTest.rbvh";
+    CHECK(bvh.Save(path));
+
+    MeshBVH loaded;
+    CHECK(loaded.Load(path, hash));
+    CHECK(loaded.GetNodeCount() == bvh.GetNodeCount());
+    CHECK(!loaded.Load(path, hash + 1));   // Stale source
+
+    // Point the root's right child back at the root
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(48 + 12);    // Header, then Node::rightOrFirst of node 0
+        const uint32_t bad = 0;
+        file.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    }
+    MeshBVH corrupt;
+    CHECK(!corrupt.Load(path, hash));
+
+    // Counts that do not match the file size
+    CHECK(bvh.Save(path));
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.put('x');
+    }
+    CHECK(!corrupt.Load(path, hash));
+    std::remove(path.c_str());
+}
+
+void TestTraversalHelpers() {
+    NodeStack<uint32_t, 4> stack;
+    for (uint32_t i = 0; i < 100; ++i)
+        stack.Push(i);
+    bool ordered = true;
+    for (uint32_t i = 100; i-- > 0;)
+        ordered = ordered && stack.Pop() == i;
+    CHECK(ordered);
+    CHECK(stack.Empty());
+
+    // Zero components must give large finite values, not inf
+    const glm::vec3 inverse = SafeInverse(glm::vec3(0.0f, -0.0f, 2.0f));
+    CHECK(std::isfinite(inverse.x) && inverse.x > 0.0f);
+    CHECK(std::isfinite(inverse.y));
+    CHECK_NEAR(inverse.z, 0.5f, 1e-6f);
+}
+
+} // namespace
+
+int main() {
+    TestClosestAndAnyMatchBruteForce();
+    TestPacketsMatchSingleRays();
+    TestSegment();
+    TestCacheRoundTripAndCorruption();
+    TestTraversalHelpers();
+    return CheckFailures();
+}
@@ -0,0 +1,108 @@
+#include "Check.h"
+#include "MeshCleanup.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+void AddVertex(OBJLoader::MeshData& mesh, float x, float y, float z, float u = 0.0f, float v = 0.0f) {
+    const float vertex[8] = { x, y, z, u, v, 1.0f, 1.0f, 1.0f };
+    mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 8);
+}
+
+void TestWeldsNoiseAndKeepsSeams() {
+    // Quad as two triangles that do not share vertices; the shared edge differs by float noise
+    OBJLoader::MeshData mesh;
+    AddVertex(mesh, 0.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 1.0f, 0.0f);
+    AddVertex(mesh, 0.0f, 0.0f, 1e-7f);
+    AddVertex(mesh, 1.0f + 1e-7f, 1.0f, 0.0f);
+    AddVertex(mesh, 0.0f, 1.0f, 0.0f);
+    // Same position as vertex 0 but another UV: a texture seam, must stay separate
+    AddVertex(mesh, 0.0f, 0.0f, 0.0f, 0.5f, 0.5f);
+    mesh.indices = { 0, 1, 2,  3, 4, 5,  6, 2, 5 };
+
+    const MeshCleanup::Stats stats = MeshCleanup::Run(mesh);
+    CHECK(stats.weldedVertices == 2);
+    CHECK(stats.verticesAfter == 5);
+    CHECK(mesh.vertices.size() == 5 * 8);
+    CHECK(mesh.indices.size() == 9);
+    CHECK(mesh.indices[3] == mesh.indices[0]);
+    CHECK(mesh.indices[4] == mesh.indices[2]);
+    CHECK(mesh.indices[6] != mesh.indices[0]);
+}
+
+void TestRemovesDegenerateAndDuplicateTriangles() {
+    OBJLoader::MeshData mesh;
+    AddVertex(mesh, 0.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 0.0f, 1.0f, 0.0f);
+    AddVertex(mesh, 2.0f, 0.0f, 0.0f);  // Collinear with 0 and 1
+    AddVertex(mesh, 5.0f, 5.0f, 5.0f);  // Only used by removed triangles
+    mesh.indices = {
+        0, 1, 2,
+        1, 2, 0,    // Same triangle, rotated - duplicate
+        0, 2, 1,    // Opposite winding - kept
+        0, 1, 3,    // Zero area
+        4, 4, 0,    // Collapsed
+    };
+
+    const MeshCleanup::Stats stats = MeshCleanup::Run(mesh);
+    CHECK(stats.duplicateTriangles == 1);
+    CHECK(stats.degenerateTriangles == 2);
+    CHECK(stats.trianglesAfter == 2);
+    CHECK(mesh.indices.size() == 6);
+    CHECK(stats.unusedVertices == 2);
+    CHECK(mesh.vertices.size() == 3 * 8);
+}
+
+void TestShrinksMaterialRanges() {
+    OBJLoader::MeshData mesh;
+    AddVertex(mesh, 0.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 0.0f, 1.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 1.0f, 0.0f);
+    mesh.indices = {
+        0, 1, 2,  0, 0, 1,      // A: one kept, one collapsed
+        1, 3, 2,                // B
+        0, 1, 3,  3, 3, 3,      // C: one kept, one collapsed
+    };
+    mesh.materialRanges = { { "A", 0, 6 }, { "B", 6, 3 }, { "C", 9, 6 } };
+
+    MeshCleanup::Run(mesh);
+    CHECK(mesh.materialRanges.size() == 3);
+    CHECK(mesh.materialRanges[0].firstIndex == 0 && mesh.materialRanges[0].indexCount == 3);
+    CHECK(mesh.materialRanges[1].firstIndex == 3 && mesh.materialRanges[1].indexCount == 3);
+    CHECK(mesh.materialRanges[2].firstIndex == 6 && mesh.materialRanges[2].indexCount == 3);
+}
+
+void TestNonFiniteVerticesAreNotWelded() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    OBJLoader::MeshData mesh;
+    AddVertex(mesh, 0.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 1.0f, 0.0f, 0.0f);
+    AddVertex(mesh, 0.0f, 1.0f, 0.0f);
+    AddVertex(mesh, nan, 0.0f, 0.0f);
+    AddVertex(mesh, nan, 0.0f, 0.0f);
+    AddVertex(mesh, inf, 0.0f, 0.0f);
+    AddVertex(mesh, 3e38f, 3e38f, 0.0f);    // Far outside the int64 cell range
+    AddVertex(mesh, -3e38f, 0.0f, 0.0f);
+    mesh.indices = { 0, 1, 2,  3, 1, 2,  4, 1, 2,  5, 1, 2,  6, 7, 0 };
+
+    const MeshCleanup::Stats stats = MeshCleanup::Run(mesh);
+    CHECK(stats.weldedVertices == 0);
+    CHECK(stats.verticesBefore == 8);
+}
+
+} // namespace
+
+int main() {
+    TestWeldsNoiseAndKeepsSeams();
+    TestRemovesDegenerateAndDuplicateTriangles();
+    TestShrinksMaterialRanges();
+    TestNonFiniteVerticesAreNotWelded();
+    return CheckFailures();
+}
@@ -0,0 +1,110 @@
+#include "Check.h"
+#include "OcclusionCuller.h"
+#include "vendor/glm/gtc/matrix_transform.hpp"
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kWall = 3;
+
+// Camera at the origin looking down -z
+glm::mat4 ViewProjection() {
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+// Quad at z = -5, wider than the view at that distance
+void AddWall(OcclusionCuller& occlusion) {
+    const std::vector<float> vertices = {
+        -10.0f, -10.0f, -5.0f,
+         10.0f, -10.0f, -5.0f,
+         10.0f,  10.0f, -5.0f,
+        -10.0f,  10.0f, -5.0f,
+    };
+    const std::vector<unsigned int> indices = { 0, 1, 2,  0, 2, 3 };
+    occlusion.AddOccluder(vertices, 3, indices, glm::mat4(1.0f), kWall);
+}
+
+const AABB kBehind(glm::vec3(-0.5f, -0.5f, -10.0f), glm::vec3(0.5f, 0.5f, -9.0f));
+const AABB kInFront(glm::vec3(-0.5f, -0.5f, -3.0f), glm::vec3(0.5f, 0.5f, -2.0f));
+
+void TestQuadHidesBoxBehindIt() {
+    OcclusionCuller occlusion;
+    AddWall(occlusion);
+    occlusion.Render(ViewProjection());
+
+    CHECK(!occlusion.IsVisible(kBehind));
+    CHECK(occlusion.IsVisible(kInFront));
+    // Reaches through the wall
+    CHECK(occlusion.IsVisible(AABB(glm::vec3(-0.5f, -0.5f, -10.0f), glm::vec3(0.5f, 0.5f, -4.0f))));
+    // Touches the near plane
+    CHECK(occlusion.IsVisible(AABB(glm::vec3(-0.5f), glm::vec3(0.5f))));
+
+    // The whole buffer is covered and owned by the wall
+    bool covered = true;
+    for (size_t i = 0; i < occlusion.GetDepth().size(); ++i)
+        covered = covered && occlusion.GetDepth()[i] < 1.0f && occlusion.GetOwners()[i] == kWall;
+    CHECK(covered);
+}
+
+void TestNarrowQuadLeavesEdgesVisible() {
+    OcclusionCuller occlusion;
+    const std::vector<float> vertices = {
+        -0.2f, -0.2f, -5.0f,
+         0.2f, -0.2f, -5.0f,
+         0.2f,  0.2f, -5.0f,
+        -0.2f,  0.2f, -5.0f,
+    };
+    const std::vector<unsigned int> indices = { 0, 1, 2,  0, 2, 3 };
+    occlusion.AddOccluder(vertices, 3, indices);
+    occlusion.Render(ViewProjection());
+    // Only partly covered by the quad
+    CHECK(occlusion.IsVisible(kBehind));
+    CHECK(!occlusion.IsVisible(AABB(glm::vec3(-0.1f, -0.1f, -10.0f), glm::vec3(0.1f, 0.1f, -9.0f))));
+}
+
+void TestOwnOccluderDoesNotHide() {
+    OcclusionCuller occlusion;
+    AddWall(occlusion);
+    occlusion.Render(ViewProjection());
+    CHECK(occlusion.IsVisible(kBehind, kWall));
+    CHECK(!occlusion.IsVisible(kBehind, kWall + 1));
+
+    // Filter() uses the index as the owner
+    std::vector<uint32_t> indices = { 0, kWall, 5 };
+    occlusion.Filter(indices, [](uint32_t) { return kBehind; });
+    CHECK(indices.size() == 1 && indices[0] == kWall);
+    CHECK(occlusion.GetStats().tested == 3);
+    CHECK(occlusion.GetStats().occluded == 2);
+}
+
+void TestBoxOccluderAndSerialRenderMatch() {
+    OcclusionCuller parallel;
+    OcclusionCuller serial;
+    const AABB wall(glm::vec3(-10.0f, -10.0f, -5.5f), glm::vec3(10.0f, 10.0f, -5.0f));
+    parallel.AddOccluderBox(wall);
+    serial.AddOccluderBox(wall);
+    parallel.Render(ViewProjection(), true);
+    serial.Render(ViewProjection(), false);
+
+    CHECK(parallel.GetDepth() == serial.GetDepth());
+    CHECK(!parallel.IsVisible(kBehind));
+    CHECK(parallel.IsVisible(kInFront));
+
+    // Nothing is hidden without occluders
+    parallel.ClearOccluders();
+    parallel.Render(ViewProjection());
+    CHECK(parallel.GetOccluderCount() == 0);
+    CHECK(parallel.IsVisible(kBehind));
+}
+
+} // namespace
+
+int main() {
+    TestQuadHidesBoxBehindIt();
+    TestNarrowQuadLeavesEdgesVisible();
+    TestOwnOccluderDoesNotHide();
+    TestBoxOccluderAndSerialRenderMatch();
+    return CheckFailures();
+}
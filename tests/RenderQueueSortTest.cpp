@@ -0,0 +1,98 @@
+#include "Check.h"
+#include "SortKey.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<SortKey::Item> SortedItems(const std::vector<uint64_t>& keys) {
+    std::vector<SortKey::Item> items;
+    for (size_t i = 0; i < keys.size(); ++i)
+        items.push_back({ keys[i], static_cast<uint32_t>(i) });
+    std::vector<SortKey::Item> scratch;
+    SortKey::RadixSort(items, scratch);
+    return items;
+}
+
+void TestRadixSortMatchesStableSort() {
+    std::mt19937_64 rng(7);
+    for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(1000), size_t(20000) }) {
+        std::vector<SortKey::Item> items(count);
+        for (size_t i = 0; i < count; ++i) {
+            // Few distinct values in the low bytes so equal keys (and stability) are exercised
+            const uint64_t key = (rng() & 0xFFFF000000000000ull) | (rng() % 16);
+            items[i] = { key, static_cast<uint32_t>(i) };
+        }
+        std::vector<SortKey::Item> expected = items;
+        std::stable_sort(expected.begin(), expected.end(),
+            [](const SortKey::Item& a, const SortKey::Item& b) { return a.key < b.key; });
+
+        std::vector<SortKey::Item> scratch;
+        SortKey::RadixSort(items, scratch);
+        CHECK(items.size() == count);
+        bool same = true;
+        for (size_t i = 0; i < count; ++i)
+            same = same && items[i].key == expected[i].key && items[i].index == expected[i].index;
+        CHECK(same);
+    }
+}
+
+void TestUniformKeysKeepOrder() {
+    // Every byte pass is skipped - the items must come back untouched
+    const std::vector<SortKey::Item> items = SortedItems({ 42, 42, 42, 42 });
+    for (size_t i = 0; i < items.size(); ++i)
+        CHECK(items[i].index == i);
+}
+
+void TestOpaqueOrdersByStateThenFrontToBack() {
+    const std::vector<uint64_t> keys = {
+        SortKey::Make(RenderPass::Opaque, 2, 1, 1, 1.0f),   // 0: second shader
+        SortKey::Make(RenderPass::Opaque, 1, 2, 1, 1.0f),   // 1: second texture
+        SortKey::Make(RenderPass::Opaque, 1, 1, 2, 1.0f),   // 2: second mesh
+        SortKey::Make(RenderPass::Opaque, 1, 1, 1, 50.0f),  // 3: far
+        SortKey::Make(RenderPass::Opaque, 1, 1, 1, 2.0f),   // 4: near
+        SortKey::Make(RenderPass::Opaque, 1, 1, 1, -3.0f),  // 5: behind the camera counts as 0
+    };
+    const std::vector<SortKey::Item> items = SortedItems(keys);
+    const uint32_t expected[] = { 5, 4, 3, 2, 1, 0 };
+    for (size_t i = 0; i < items.size(); ++i)
+        CHECK(items[i].index == expected[i]);
+}
+
+void TestPassesAndTransparentBackToFront() {
+    const std::vector<uint64_t> keys = {
+        SortKey::Make(RenderPass::Overlay, 0, 0, 0, 1.0f),      // 0
+        SortKey::Make(RenderPass::Transparent, 1, 1, 1, 5.0f),  // 1: near
+        SortKey::Make(RenderPass::Transparent, 9, 9, 9, 80.0f), // 2: far, drawn first despite state
+        SortKey::Make(RenderPass::Opaque, 4095, 65535, 65535, 1000.0f), // 3: largest opaque key
+        SortKey::Make(RenderPass::Transparent, 3, 1, 1, 20.0f), // 4: middle
+    };
+    const std::vector<SortKey::Item> items = SortedItems(keys);
+    const uint32_t expected[] = { 3, 2, 4, 1, 0 };
+    for (size_t i = 0; i < items.size(); ++i)
+        CHECK(items[i].index == expected[i]);
+}
+
+void TestTransparentSameDepthOrdersByState() {
+    const std::vector<uint64_t> keys = {
+        SortKey::Make(RenderPass::Transparent, 2, 1, 1, 10.0f),
+        SortKey::Make(RenderPass::Transparent, 1, 2, 1, 10.0f),
+        SortKey::Make(RenderPass::Transparent, 1, 1, 1, 10.0f),
+    };
+    const std::vector<SortKey::Item> items = SortedItems(keys);
+    const uint32_t expected[] = { 2, 1, 0 };
+    for (size_t i = 0; i < items.size(); ++i)
+        CHECK(items[i].index == expected[i]);
+}
+
+} // namespace
+
+int main() {
+    TestRadixSortMatchesStableSort();
+    TestUniformKeysKeepOrder();
+    TestOpaqueOrdersByStateThenFrontToBack();
+    TestPassesAndTransparentBackToFront();
+    TestTransparentSameDepthOrdersByState();
+    return CheckFailures();
+}
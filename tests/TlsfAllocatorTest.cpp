@@ -0,0 +1,140 @@
+#include "Check.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Live blocks must lie inside the range and must not overlap
+bool Disjoint(const TlsfAllocator& allocator, const std::vector<uint32_t>& blocks) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (uint32_t block : blocks)
+        ranges.emplace_back(allocator.GetOffset(block), allocator.GetSize(block));
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges[i].first + ranges[i].second > allocator.GetCapacity())
+            return false;
+        if (i > 0 && ranges[i - 1].first + ranges[i - 1].second > ranges[i].first)
+            return false;
+    }
+    return true;
+}
+
+void TestAllocateRoundsAndCounts() {
+    TlsfAllocator allocator(4096);
+    const uint32_t a = allocator.Allocate(10);
+    const uint32_t b = allocator.Allocate(100);
+    CHECK(a != TlsfAllocator::kInvalidBlock && b != TlsfAllocator::kInvalidBlock);
+    CHECK(allocator.GetSize(a) == 16);
+    CHECK(allocator.GetSize(b) == 112);
+    CHECK(allocator.GetOffset(a) % TlsfAllocator::kGranularity == 0);
+    CHECK(allocator.GetOffset(b) % TlsfAllocator::kGranularity == 0);
+    CHECK(allocator.GetUsed() == 128);
+    CHECK(allocator.GetAllocationCount() == 2);
+    CHECK(Disjoint(allocator, { a, b }));
+    CHECK(allocator.Allocate(0) == TlsfAllocator::kInvalidBlock);
+}
+
+void TestAlignment() {
+    TlsfAllocator allocator(1 << 16);
+    std::vector<uint32_t> blocks;
+    blocks.push_back(allocator.Allocate(48));
+    for (size_t alignment : { size_t(64), size_t(256), size_t(4096) }) {
+        const uint32_t block = allocator.Allocate(80, alignment);
+        CHECK(block != TlsfAllocator::kInvalidBlock);
+        CHECK(allocator.GetOffset(block) % alignment == 0);
+        blocks.push_back(block);
+    }
+    CHECK(Disjoint(allocator, blocks));
+    // The padding in front of aligned blocks went back to the free lists
+    CHECK(allocator.GetUsed() == 48 + 3 * 80);
+}
+
+void TestExhaustionAndMerge() {
+    TlsfAllocator allocator(1024);
+    std::vector<uint32_t> blocks;
+    for (int i = 0; i < 8; ++i)
+        blocks.push_back(allocator.Allocate(128));
+    CHECK(allocator.GetFree() == 0);
+    CHECK(allocator.Allocate(16) == TlsfAllocator::kInvalidBlock);
+    CHECK(allocator.GetLastUsedBlock() == blocks[7]);
+
+    // Free every other block: 512 bytes free, but no 256-byte hole
+    for (int i = 0; i < 8; i += 2)
+        allocator.Free(blocks[i]);
+    CHECK(allocator.GetFree() == 512);
+    CHECK(allocator.GetLargestFreeBlock() == 128);
+    CHECK(allocator.Allocate(256) == TlsfAllocator::kInvalidBlock);
+
+    // Freeing the rest merges everything back into one block
+    for (int i = 1; i < 8; i += 2)
+        allocator.Free(blocks[i]);
+    CHECK(allocator.GetUsed() == 0);
+    CHECK(allocator.GetAllocationCount() == 0);
+    CHECK(allocator.GetLargestFreeBlock() == 1024);
+    CHECK(allocator.GetLastUsedBlock() == TlsfAllocator::kInvalidBlock);
+    const uint32_t all = allocator.Allocate(1024);
+    CHECK(all != TlsfAllocator::kInvalidBlock);
+    CHECK(allocator.GetOffset(all) == 0);
+    CHECK(allocator.GetPeakUsed() == 1024);
+}
+
+void TestDoubleFreeIsIgnored() {
+    TlsfAllocator allocator(256);
+    const uint32_t a = allocator.Allocate(64);
+    allocator.Free(a);
+    allocator.Free(a);
+    allocator.Free(TlsfAllocator::kInvalidBlock);
+    CHECK(allocator.GetUsed() == 0);
+    CHECK(allocator.GetLargestFreeBlock() == 256);
+}
+
+void TestRandomStress() {
+    const size_t capacity = 1 << 20;
+    TlsfAllocator allocator(capacity);
+    std::mt19937 rng(11);
+    std::vector<uint32_t> live;
+    size_t used = 0;
+    bool disjoint = true;
+    for (int step = 0; step < 20000; ++step) {
+        if (!live.empty() && (rng() % 3 == 0 || allocator.GetFree() < capacity / 8)) {
+            const size_t i = rng() % live.size();
+            used -= allocator.GetSize(live[i]);
+            allocator.Free(live[i]);
+            live[i] = live.back();
+            live.pop_back();
+        } else {
+            const size_t size = 1 + rng() % 4000;
+            const size_t alignment = size_t(16) << (rng() % 5);
+            const uint32_t block = allocator.Allocate(size, alignment);
+            if (block == TlsfAllocator::kInvalidBlock)
+                continue;
+            disjoint = disjoint && allocator.GetOffset(block) % alignment == 0 && allocator.GetSize(block) >= size;
+            used += allocator.GetSize(block);
+            live.push_back(block);
+        }
+        if (step % 1000 == 0)
+            disjoint = disjoint && Disjoint(allocator, live);
+    }
+    CHECK(disjoint);
+    CHECK(allocator.GetUsed() == used);
+    CHECK(allocator.GetAllocationCount() == live.size());
+
+    for (uint32_t block : live)
+        allocator.Free(block);
+    CHECK(allocator.GetUsed() == 0);
+    CHECK(allocator.GetLargestFreeBlock() == capacity);
+}
+
+} // namespace
+
+int main() {
+    TestAllocateRoundsAndCounts();
+    TestAlignment();
+    TestExhaustionAndMerge();
+    TestDoubleFreeIsIgnored();
+    TestRandomStress();
+    return CheckFailures();
+}
@@ -0,0 +1,132 @@
+// TextureCooker - offline PNG/TGA/JPG -> KTX2 (BC1/BC3/BC5/BC7 + full mip chain)
+//
+// Usage:
+//   RPG-TextureCooker [-format auto|bc1|bc3|bc5|bc7] [-srgb] [-o output.ktx2] input...
+//
+// Without -o every input is written next to itself as "<name>.ktx2", which is
+// where Texture looks for the cooked version at runtime.
+// auto picks BC1 for opaque images and BC3 if any texel has alpha < 255.
+// BC5 (normal maps) keeps R/G only and filters its mips without sRGB decoding.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "vendor/stb/stb_image.h"
+
+#include "BlockCompression.h"
+#include "Ktx2.h"
+#include "MipChain.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    bool autoFormat = true;
+    BlockCompression::Format format = BlockCompression::Format::BC1;
+    bool srgb = false;
+    std::string output;
+    std::vector<std::string> inputs;
+};
+
+void PrintUsage() {
+    std::cout << "Usage: RPG-TextureCooker [-format auto|bc1|bc3|bc5|bc7] [-srgb] [-o output.ktx2] input..." << std::endl;
+}
+
+std::string CookedPath(const std::string& input) {
+    const size_t dot = input.find_last_of('.');
+    const size_t slash = input.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        return input.substr(0, dot) + ".ktx2";
+    return input + ".ktx2";
+}
+
+bool HasAlpha(const MipChain& chain) {
+    const unsigned char* pixels = chain.GetLevelData(0);
+    const size_t texels = static_cast<size_t>(chain.GetWidth()) * chain.GetHeight();
+    for (size_t i = 0; i < texels; ++i) {
+        if (pixels[i * 4 + 3] != 255)
+            return true;
+    }
+    return false;
+}
+
+bool Cook(const std::string& input, const std::string& output, const Options& options) {
+    const auto start = std::chrono::steady_clock::now();
+
+    BlockCompression::Format format = options.format;
+    const MipChain::ColorSpace colorSpace = !options.autoFormat && format == BlockCompression::Format::BC5
+        ? MipChain::ColorSpace::Linear : MipChain::ColorSpace::sRGB;
+
+    MipChain chain;
+    if (!chain.LoadImage(input, false, colorSpace)) {
+        // The file may fail before stb_image runs (mapping, fast PNG path) - then there is no reason
+        const char* reason = stbi_failure_reason();
+        std::cerr << "[Cooker] Failed to load " << input << ": "
+                  << (reason ? reason : "file missing, unreadable or not a supported image") << std::endl;
+        return false;
+    }
+    if (options.autoFormat)
+        format = HasAlpha(chain) ? BlockCompression::Format::BC3 : BlockCompression::Format::BC1;
+
+    std::vector<std::vector<unsigned char>> levels;
+    size_t compressedBytes = 0;
+    for (int level = 0; level < chain.GetLevelCount(); ++level) {
+        const MipChain::Level& mip = chain.GetLevel(level);
+        levels.push_back(BlockCompression::Compress(format, chain.GetLevelData(level), mip.width, mip.height));
+        compressedBytes += levels.back().size();
+    }
+
+    const bool srgb = options.srgb && format != BlockCompression::Format::BC5;
+    if (!Ktx2::Write(output, format, srgb, chain.GetWidth(), chain.GetHeight(), levels))
+        return false;
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Cooker] " << input << " -> " << output << " (" << chain.GetWidth() << "x" << chain.GetHeight()
+              << ", " << BlockCompression::FormatName(format) << (srgb ? " sRGB" : "") << ", "
+              << levels.size() << " mips, " << chain.GetData().size() / 1024 << " KB -> "
+              << compressedBytes / 1024 << " KB, " << static_cast<int>(ms) << " ms)" << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-format" && i + 1 < argc) {
+            const std::string name = argv[++i];
+            if (name == "auto") {
+                options.autoFormat = true;
+            } else if (BlockCompression::ParseFormat(name, options.format)) {
+                options.autoFormat = false;
+            } else {
+                std::cerr << "[Cooker] Unknown format: " << name << std::endl;
+                return 1;
+            }
+        } else if (arg == "-srgb") {
+            options.srgb = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.inputs.empty() || (!options.output.empty() && options.inputs.size() != 1)) {
+        PrintUsage();
+        return 1;
+    }
+
+    int failures = 0;
+    for (const std::string& input : options.inputs) {
+        if (!Cook(input, options.output.empty() ? CookedPath(input) : options.output, options))
+            ++failures;
+    }
+    return failures == 0 ? 0 : 1;
+}